@@ -0,0 +1,5 @@
+#pragma once
+
+#include "soldier_model.h"
+
+#include <benchmark/benchmark.h>
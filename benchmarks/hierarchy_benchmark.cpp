@@ -0,0 +1,139 @@
+#include "bench_util.h"
+#include "synthetic_skeleton.h"
+#include "hierarchy_kernel.h"
+
+using namespace DirectX;
+
+//
+// -- final transforms of a synthetic skeleton with state.range(0) bones. Every variant samples the clip the
+// -- same way (PackedAnimationClip::Interpolate, as GetFinalTransforms does), BM_ClipSampling is that part alone
+struct HierarchyFixture {
+    SyntheticSkeleton Skeleton;
+    PackedAnimationClip Clip;
+    std::vector<UINT> Order;
+    PoseWorkspace Workspace;
+    std::vector<XMFLOAT4X4> FinalTransforms;
+    std::vector<XMFLOAT4X4> ToRootTransforms;
+    float TimePoint = 0.0f;
+
+    explicit HierarchyFixture (UINT num_bones)
+        : Skeleton(MakeSyntheticSkeleton(num_bones)), Order(SyntheticBoneOrder(num_bones)),
+          FinalTransforms(num_bones), ToRootTransforms(num_bones) {
+        Clip.Build(Skeleton.Clips["Swing"]);
+        Workspace.Resize(num_bones);
+    }
+    void NextFrame () {
+        TimePoint += 1.0f / 60.0f;
+        if (TimePoint > Clip.GetClipEndTime())
+            TimePoint = 0.0f;
+    }
+};
+
+static void BM_ClipSampling (benchmark::State & state) {
+    HierarchyFixture fixture((UINT)state.range(0));
+    for (auto _ : state) {
+        fixture.Clip.Interpolate(fixture.TimePoint, fixture.Workspace.ToParentTransforms, fixture.Workspace.KeyframeCursors[0]);
+        benchmark::DoNotOptimize(fixture.Workspace.ToParentTransforms.data());
+        fixture.NextFrame();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+// -- sampling then the single fused hierarchy pass
+static void BM_FusedFinalTransforms (benchmark::State & state) {
+    HierarchyFixture fixture((UINT)state.range(0));
+    SkinnedData skinned_info;
+    skinned_info.Set(fixture.Skeleton.Hierarchy, fixture.Skeleton.Offsets, fixture.Skeleton.Clips);
+    SkinnedData::ClipHandle clip = skinned_info.FindClip("Swing");
+
+    for (auto _ : state) {
+        skinned_info.GetFinalTransforms(clip, fixture.TimePoint, fixture.FinalTransforms.data(), fixture.Workspace);
+        benchmark::DoNotOptimize(fixture.FinalTransforms.data());
+        fixture.NextFrame();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+// -- same as above into 3x4 affine matrices
+static void BM_FusedFinalTransforms3x4 (benchmark::State & state) {
+    HierarchyFixture fixture((UINT)state.range(0));
+    SkinnedData skinned_info;
+    skinned_info.Set(fixture.Skeleton.Hierarchy, fixture.Skeleton.Offsets, fixture.Skeleton.Clips);
+    SkinnedData::ClipHandle clip = skinned_info.FindClip("Swing");
+    std::vector<XMFLOAT3X4> final_transforms(state.range(0));
+
+    for (auto _ : state) {
+        skinned_info.GetFinalTransforms(clip, fixture.TimePoint, final_transforms.data(), fixture.Workspace);
+        benchmark::DoNotOptimize(final_transforms.data());
+        fixture.NextFrame();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+// -- sampling then the to-root and offset/transpose loops the fused pass replaced
+static void BM_TwoPassFinalTransforms (benchmark::State & state) {
+    HierarchyFixture fixture((UINT)state.range(0));
+    PoseWorkspace & workspace = fixture.Workspace;
+
+    for (auto _ : state) {
+        fixture.Clip.Interpolate(fixture.TimePoint, workspace.ToParentTransforms, workspace.KeyframeCursors[0]);
+        TwoPassFinalTransforms(
+            fixture.Skeleton.Hierarchy, fixture.Skeleton.Offsets, fixture.Order,
+            workspace.ToParentTransforms.data(), fixture.ToRootTransforms.data(), fixture.FinalTransforms.data()
+        );
+        benchmark::DoNotOptimize(fixture.FinalTransforms.data());
+        fixture.NextFrame();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+//
+// -- the hierarchy pass alone on one sampled pose: ConcatenateBoneHierarchy with kernel state.range(1)
+// -- (see HierarchyKernel) into state.range(2) ? 3x4 : transposed 4x4, against the two loops it replaced
+static void BM_HierarchyKernel (benchmark::State & state) {
+    HierarchyKernel kernel = (HierarchyKernel)state.range(1);
+    if (!HierarchyKernelSupported(kernel)) {
+        state.SkipWithError("kernel not supported by this CPU");
+        return;
+    }
+    HierarchyFixture fixture((UINT)state.range(0));
+    PoseWorkspace & workspace = fixture.Workspace;
+    fixture.Clip.Interpolate(0.37f, workspace.ToParentTransforms, workspace.KeyframeCursors[0]);
+    std::vector<XMFLOAT3X4> affine_offsets(state.range(0));
+    for (size_t i = 0; i < affine_offsets.size(); ++i)
+        XMStoreFloat3x4(&affine_offsets[i], XMLoadFloat4x4(&fixture.Skeleton.Offsets[i]));
+    std::vector<XMFLOAT3X4> affine_final_transforms(state.range(0));
+    bool output_affine = 0 != state.range(2);
+
+    for (auto _ : state) {
+        ConcatenateBoneHierarchy(
+            fixture.Order.data(), (UINT)fixture.Order.size(), fixture.Skeleton.Hierarchy.data(),
+            workspace.ToParentTransforms.data(), affine_offsets.data(), workspace.ToRootTransforms.data(),
+            output_affine ? nullptr : fixture.FinalTransforms.data(), output_affine ? affine_final_transforms.data() : nullptr,
+            kernel
+        );
+        benchmark::DoNotOptimize(fixture.FinalTransforms.data());
+        benchmark::DoNotOptimize(affine_final_transforms.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetLabel(HierarchyKernelName(kernel));
+}
+static void BM_TwoPassHierarchy (benchmark::State & state) {
+    HierarchyFixture fixture((UINT)state.range(0));
+    PoseWorkspace & workspace = fixture.Workspace;
+    fixture.Clip.Interpolate(0.37f, workspace.ToParentTransforms, workspace.KeyframeCursors[0]);
+
+    for (auto _ : state) {
+        TwoPassFinalTransforms(
+            fixture.Skeleton.Hierarchy, fixture.Skeleton.Offsets, fixture.Order,
+            workspace.ToParentTransforms.data(), fixture.ToRootTransforms.data(), fixture.FinalTransforms.data()
+        );
+        benchmark::DoNotOptimize(fixture.FinalTransforms.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ClipSampling)->Arg(64)->Arg(96)->Arg(256);
+BENCHMARK(BM_FusedFinalTransforms)->Arg(64)->Arg(96)->Arg(256);
+BENCHMARK(BM_FusedFinalTransforms3x4)->Arg(64)->Arg(96)->Arg(256);
+BENCHMARK(BM_TwoPassFinalTransforms)->Arg(64)->Arg(96)->Arg(256);
+BENCHMARK(BM_HierarchyKernel)
+    ->ArgNames({"bones", "kernel", "affine"})
+    ->ArgsProduct({{64, 96, 256}, {(int)HierarchyKernel::Scalar, (int)HierarchyKernel::Sse2, (int)HierarchyKernel::Avx2Fma}, {0, 1}});
+BENCHMARK(BM_TwoPassHierarchy)->Arg(64)->Arg(96)->Arg(256);
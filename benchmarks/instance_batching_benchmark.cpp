@@ -0,0 +1,47 @@
+#include "bench_util.h"
+#include "instance_batching.h"
+
+using namespace DirectX;
+
+//
+// -- InstanceBatcher::Build over state.range(0) model instances of the soldier, one item per subset,
+// -- emitted model after model as a scene walk does. Items processed counts draw items
+static void BM_InstanceBatcherBuild (benchmark::State & state) {
+    SoldierModel & soldier = Soldier();
+    if (!soldier.Loaded) {
+        state.SkipWithError("cannot load soldier.m3d");
+        return;
+    }
+    UINT num_models = (UINT)state.range(0);
+    UINT num_bones = soldier.SkinnedInfo.BoneCount();
+
+    std::vector<InstanceDrawItem> items;
+    items.reserve((size_t)num_models * soldier.Subsets.size());
+    for (UINT m = 0; m < num_models; ++m) {
+        for (M3DLoader::Subset const & subset : soldier.Subsets) {
+            InstanceDrawItem item;
+            item.Geometry = &soldier;
+            item.IndexCount = subset.FaceCount * 3;
+            // -- draw arguments as the demo builds its submeshes from the loaded subsets
+            item.StartIndexLocation = subset.IndexByteOffset / subset.IndexSize;
+            item.BaseVertexLocation = (int)subset.BaseVertex;
+            item.IndexFormat = subset.IndexSize;
+            item.MaterialIndex = subset.Id;
+            item.PaletteOffset = m * num_bones;
+            XMStoreFloat4x4(&item.World, XMMatrixTranslation(2.0f * (m % 100), 0.0f, 2.0f * (m / 100)));
+            items.push_back(item);
+        }
+    }
+
+    InstanceBatcher batcher;
+    std::vector<InstanceBatch> batches;
+    std::vector<InstanceData> instances(items.size());
+    for (auto _ : state) {
+        batcher.Build(items.data(), (UINT)items.size(), batches, instances.data());
+        benchmark::DoNotOptimize(instances.data());
+        benchmark::DoNotOptimize(batches.data());
+    }
+    state.SetItemsProcessed(state.iterations() * items.size());
+    state.counters["batches"] = (double)batches.size();
+}
+BENCHMARK(BM_InstanceBatcherBuild)->ArgName("instances")->Arg(100)->Arg(1000)->Arg(10000)->Unit(benchmark::kMicrosecond);
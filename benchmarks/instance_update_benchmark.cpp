@@ -0,0 +1,43 @@
+#include "bench_util.h"
+#include "job_system.h"
+
+using namespace DirectX;
+
+//
+// -- headless scaling of UpdateSkinnedInstances: state.range(0) soldier instances on state.range(1) threads,
+// -- each packing its final transforms into one shared 3x4 palette. Wall time, the calling thread works too
+static void BM_UpdateSkinnedInstances (benchmark::State & state) {
+    SoldierModel & soldier = Soldier();
+    if (!soldier.Loaded) {
+        state.SkipWithError("cannot load soldier.m3d");
+        return;
+    }
+    UINT num_instances = (UINT)state.range(0);
+    UINT num_bones = soldier.SkinnedInfo.BoneCount();
+
+    std::vector<SkinnedModelInstance> instances(num_instances);
+    for (UINT i = 0; i < num_instances; ++i) {
+        SkinnedModelInstance & instance = instances[i];
+        instance.SkinnedInfo = &soldier.SkinnedInfo;
+        instance.FinalTransforms.resize(num_bones);
+        instance.Workspace.Resize(num_bones);
+        instance.SetClip("Take1");
+        // -- spread over the clip so instances don't sample the same keys
+        instance.TimePoint = 0.01f * i;
+        instance.PaletteOffset = i * num_bones;
+    }
+    std::vector<XMFLOAT3X4> palette((size_t)num_instances * num_bones);
+
+    JobSystem jobs((unsigned)state.range(1));
+    for (auto _ : state) {
+        UpdateSkinnedInstances(jobs, instances.data(), num_instances, 1.0f / 60.0f, palette.data());
+        benchmark::DoNotOptimize(palette.data());
+    }
+    state.SetItemsProcessed(state.iterations() * num_instances);
+    state.counters["hardware_threads"] = (double)std::thread::hardware_concurrency();
+}
+BENCHMARK(BM_UpdateSkinnedInstances)
+    ->ArgNames({"instances", "threads"})
+    ->ArgsProduct({{100, 1000, 10000}, {1, 2, 4, 8, 16}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,79 @@
+#include "bench_util.h"
+#include "synthetic_skeleton.h"
+
+#include <chrono>
+
+using namespace DirectX;
+
+//
+// -- IK time an instance may spend per update, the budget_used counter is the measured time over this budget
+static double const IkBudgetMicroseconds = 2.0;
+
+// -- fraction of the budget used by an instance solving solves_per_instance chains like the ones timed by state
+static void report_budget (benchmark::State & state, std::chrono::steady_clock::duration elapsed, double solves_per_instance) {
+    double microseconds_per_solve = std::chrono::duration<double, std::micro>(elapsed).count() / state.iterations();
+    state.counters["budget_used"] = microseconds_per_solve * solves_per_instance / IkBudgetMicroseconds;
+}
+// -- targets moving around the tip of the animated pose like feet on uneven ground, cycled through every iteration
+static std::vector<XMFLOAT3> targets_near (FXMVECTOR tip, float radius) {
+    std::vector<XMFLOAT3> targets(64);
+    for (UINT k = 0; k < targets.size(); ++k) {
+        XMVECTOR offset = XMVectorSet(sinf(k * 0.9f), cosf(k * 1.3f), sinf(k * 0.4f), 0.0f);
+        XMStoreFloat3(&targets[k], XMVectorMultiplyAdd(offset, XMVectorReplicate(radius), tip));
+    }
+    return targets;
+}
+
+static void BM_TwoBoneIk (benchmark::State & state) {
+    std::vector<int> hierarchy;
+    std::vector<XMFLOAT4X4> animated_pose;
+    MakeSyntheticChain(4, 0.3f, hierarchy, animated_pose);
+    std::vector<XMFLOAT4X4> pose(animated_pose);
+
+    IkChain chain;
+    chain.TipBone = 3;
+    std::vector<XMFLOAT3> targets = targets_near(SyntheticToRoot(3, hierarchy, animated_pose).r[3], 0.3f);
+    UINT k = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (auto _ : state) {
+        // -- every update solves on a freshly sampled pose
+        std::copy(animated_pose.begin(), animated_pose.end(), pose.begin());
+        chain.Target = targets[k++ % targets.size()];
+        SolveIkChain(chain, hierarchy.data(), pose.data());
+        benchmark::DoNotOptimize(pose.data());
+    }
+    // -- one foot, an instance has two
+    report_budget(state, std::chrono::steady_clock::now() - start, 2.0);
+}
+BENCHMARK(BM_TwoBoneIk);
+
+// -- longest FABRIK chain documented to fit the budget (see IkChain::NumLinks)
+static UINT const FabrikLinksInBudget = 4;
+
+// -- FABRIK over state.range(0) links of a 16 bone chain. Chains up to FabrikLinksInBudget links fail the
+// -- benchmark when they go over the budget, longer ones only report how far over it they are.
+// -- A fixed iteration count runs each chain once, the short trial runs would judge the budget on a cold start
+static void BM_FabrikIk (benchmark::State & state) {
+    std::vector<int> hierarchy;
+    std::vector<XMFLOAT4X4> animated_pose;
+    MakeSyntheticChain(16, 0.3f, hierarchy, animated_pose);
+    std::vector<XMFLOAT4X4> pose(animated_pose);
+
+    IkChain chain;
+    chain.Solver = IkSolver::Fabrik;
+    chain.TipBone = 15;
+    chain.NumLinks = (UINT)state.range(0);
+    std::vector<XMFLOAT3> targets = targets_near(SyntheticToRoot(15, hierarchy, animated_pose).r[3], 0.3f);
+    UINT k = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (auto _ : state) {
+        std::copy(animated_pose.begin(), animated_pose.end(), pose.begin());
+        chain.Target = targets[k++ % targets.size()];
+        SolveIkChain(chain, hierarchy.data(), pose.data());
+        benchmark::DoNotOptimize(pose.data());
+    }
+    report_budget(state, std::chrono::steady_clock::now() - start, 1.0);
+    if (chain.NumLinks <= FabrikLinksInBudget && state.counters["budget_used"] > 1.0)
+        state.SkipWithError("FABRIK chain documented to fit the IK budget is over it");
+}
+BENCHMARK(BM_FabrikIk)->DenseRange(2, 8)->Arg(15)->Iterations(100000);
@@ -0,0 +1,59 @@
+#include "bench_util.h"
+
+#include <random>
+
+//
+// -- BoneAnimation::FindKeyframe at 30 keys per second, sampled at 60 fps (cursor hits) or in random order
+// -- (binary search), against the linear scan it replaced. Arg is the number of keyframes
+static BoneAnimation make_bone_animation (UINT num_keyframes) {
+    BoneAnimation animation;
+    animation.Keyframes.resize(num_keyframes);
+    for (UINT i = 0; i < num_keyframes; ++i)
+        animation.Keyframes[i].TimePoint = (float)i / 30.0f;
+    return animation;
+}
+static std::vector<float> sample_times (BoneAnimation const & animation, bool shuffled) {
+    std::vector<float> times;
+    for (float t = animation.GetStartTime(); t < animation.GetEndTime(); t += 1.0f / 60.0f)
+        times.push_back(t);
+    if (shuffled)
+        std::shuffle(times.begin(), times.end(), std::mt19937(1));
+    return times;
+}
+static UINT linear_scan (BoneAnimation const & animation, float t) {
+    for (UINT i = 0; i + 1 < animation.Keyframes.size(); ++i)
+        if (t >= animation.Keyframes[i].TimePoint && t <= animation.Keyframes[i + 1].TimePoint)
+            return i;
+    return 0;
+}
+
+static void run_find_keyframe (benchmark::State & state, bool shuffled) {
+    BoneAnimation animation = make_bone_animation((UINT)state.range(0));
+    std::vector<float> times = sample_times(animation, shuffled);
+    UINT cursor = 0;
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(animation.FindKeyframe(times[next], cursor));
+        next = next + 1 < times.size() ? next + 1 : 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+static void BM_FindKeyframeSequential (benchmark::State & state) {
+    run_find_keyframe(state, false);
+}
+static void BM_FindKeyframeRandom (benchmark::State & state) {
+    run_find_keyframe(state, true);
+}
+static void BM_FindKeyframeLinearScan (benchmark::State & state) {
+    BoneAnimation animation = make_bone_animation((UINT)state.range(0));
+    std::vector<float> times = sample_times(animation, false);
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(linear_scan(animation, times[next]));
+        next = next + 1 < times.size() ? next + 1 : 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FindKeyframeSequential)->Arg(10)->Arg(100)->Arg(10000);
+BENCHMARK(BM_FindKeyframeRandom)->Arg(10)->Arg(100)->Arg(10000);
+BENCHMARK(BM_FindKeyframeLinearScan)->Arg(10)->Arg(100)->Arg(10000);
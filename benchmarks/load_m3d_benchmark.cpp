@@ -0,0 +1,100 @@
+#include "bench_util.h"
+#include "job_system.h"
+#include "m3d_text_reader.h"
+
+#include <fstream>
+#include <sstream>
+
+using namespace DirectX;
+
+//
+// -- LoadM3D of the text soldier.m3d, serially (state.range(0) == 0) or on state.range(0) threads.
+// -- The file stays in the page cache after the first iteration, so this is parsing and validation time
+static void BM_LoadM3DText (benchmark::State & state) {
+    std::unique_ptr<JobSystem> jobs;
+    if (state.range(0) > 0)
+        jobs.reset(new JobSystem((unsigned)state.range(0)));
+    std::string const filename = ModelPath("soldier.m3d");
+
+    for (auto _ : state) {
+        M3DLoader loader;
+        loader.Jobs = jobs.get();
+        std::vector<M3DLoader::SkinnedVertex> vertices;
+        std::vector<BYTE> indices;
+        std::vector<M3DLoader::Subset> subsets;
+        std::vector<M3DLoader::M3DMaterial> materials;
+        SkinnedData skinned_info;
+        if (!loader.LoadM3D(filename, vertices, indices, subsets, materials, skinned_info)) {
+            state.SkipWithError("cannot load soldier.m3d");
+            return;
+        }
+        benchmark::DoNotOptimize(vertices.data());
+    }
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    state.SetBytesProcessed(state.iterations() * (int64_t)file.tellg());
+}
+BENCHMARK(BM_LoadM3DText)->ArgName("threads")->Arg(0)->Arg(1)->Arg(2)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+//
+// -- the vertex section of soldier.m3d, read the way the loader reads its records
+static std::string const & vertex_section () {
+    static std::string const text = [] {
+        std::ifstream file(ModelPath("soldier.m3d"), std::ios::binary);
+        std::string all((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        size_t begin = all.find("*Vertices*");
+        size_t end = all.find("*Triangles*");
+        return std::string::npos == begin || std::string::npos == end ? std::string() : all.substr(begin, end - begin);
+    }();
+    return text;
+}
+// -- every record: position, tangent, normal, texture coordinates and blend weights, then the blend indices
+template <typename Stream, typename Ignore>
+static float read_vertex_records (Stream & fin, Ignore & ignore) {
+    static int const num_floats [] = {3, 4, 3, 2, 4};
+    float sum = 0.0f;
+    fin >> ignore; // header text
+    while (fin) {
+        for (int n : num_floats) {
+            fin >> ignore;
+            for (int i = 0; i < n; ++i) {
+                float value = 0.0f;
+                fin >> value;
+                sum += value;
+            }
+        }
+        int bone_indices[4];
+        fin >> ignore >> bone_indices[0] >> bone_indices[1] >> bone_indices[2] >> bone_indices[3];
+        sum += (float)bone_indices[0];
+    }
+    return sum;
+}
+static void BM_ReadVertexRecords (benchmark::State & state) {
+    std::string const & text = vertex_section();
+    if (text.empty()) {
+        state.SkipWithError("cannot read soldier.m3d");
+        return;
+    }
+    for (auto _ : state) {
+        M3DTextReader fin(text.data(), text.size());
+        M3DTextReader::Label ignore;
+        benchmark::DoNotOptimize(read_vertex_records(fin, ignore));
+    }
+    state.SetBytesProcessed(state.iterations() * (int64_t)text.size());
+}
+BENCHMARK(BM_ReadVertexRecords)->Unit(benchmark::kMillisecond);
+
+// -- the same records with std::istream, as the loader read them before M3DTextReader
+static void BM_ReadVertexRecordsIstream (benchmark::State & state) {
+    std::string const & text = vertex_section();
+    if (text.empty()) {
+        state.SkipWithError("cannot read soldier.m3d");
+        return;
+    }
+    for (auto _ : state) {
+        std::istringstream fin(text);
+        std::string ignore;
+        benchmark::DoNotOptimize(read_vertex_records(fin, ignore));
+    }
+    state.SetBytesProcessed(state.iterations() * (int64_t)text.size());
+}
+BENCHMARK(BM_ReadVertexRecordsIstream)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,27 @@
+#include "bench_util.h"
+
+using namespace DirectX;
+
+//
+// -- one frame of one soldier: sample the clip and run the hierarchy pass
+static void BM_SoldierFinalTransforms (benchmark::State & state) {
+    SoldierModel & soldier = Soldier();
+    if (!soldier.Loaded) {
+        state.SkipWithError("cannot load soldier.m3d");
+        return;
+    }
+    SkinnedData const & skinned_info = soldier.SkinnedInfo;
+    SkinnedData::ClipHandle clip = skinned_info.FindClip("Take1");
+
+    PoseWorkspace workspace;
+    workspace.Resize(skinned_info.BoneCount());
+    std::vector<XMFLOAT4X4> final_transforms(skinned_info.BoneCount());
+    float time_point = skinned_info.GetClipStartTime(clip);
+    for (auto _ : state) {
+        skinned_info.GetFinalTransforms(clip, time_point, final_transforms.data(), workspace);
+        benchmark::DoNotOptimize(final_transforms.data());
+        time_point = skinned_info.LoopTimePoint(clip, time_point + 1.0f / 60.0f);
+    }
+    state.SetItemsProcessed(state.iterations() * skinned_info.BoneCount());
+}
+BENCHMARK(BM_SoldierFinalTransforms);
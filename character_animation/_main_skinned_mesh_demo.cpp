@@ -3,12 +3,15 @@
 #include "../common/upload_buffer.h"
 #include "../common/geometry_generator.h"
 #include "../common/camera.h"
+#include "../common/job_system.h"
 
 #include "frame_resource.h"
 #include "shadow_map.h"
 #include "ssao.h"
 #include "skinned_data.h"
 #include "load_m3d.h"
+#include "skinning.h"
+#include "instance_batching.h"
 
 #include <imgui/imgui.h>
 #include <imgui/imgui_impl_win32.h>
@@ -20,27 +23,6 @@ using namespace DirectX::PackedVector;
 
 int const g_num_frame_resources = 3;
 
-struct SkinnedModelInstance {
-    SkinnedData * SkinnedInfo = nullptr;
-    std::vector<DirectX::XMFLOAT4X4> FinalTransforms;
-    std::string ClipName;
-    float TimePoint = 0.0f;
-
-    // -- called every frame, increments time,
-    // -- interpolates animation data for each bone based on current anim clip, and
-    // -- generates final transforms which are set to the effect for processing in the vertex shader
-    void UpdateSkinnedAnimation (float dt) {
-        TimePoint += dt;
-
-        // -- loop animation
-        if (TimePoint > SkinnedInfo->GetClipEndTime(ClipName))
-            TimePoint = 0.0f;
-
-        // -- compute final transforms for the given time point
-        SkinnedInfo->GetFinalTransforms(ClipName, TimePoint, FinalTransforms);
-    }
-};
-
 // -- store draw params to draw a shape
 struct RenderItem {
     RenderItem () = default;
@@ -66,9 +48,7 @@ struct RenderItem {
     UINT IndexCount = 0;
     UINT StartIndexLocation = 0;
     int BaseVertexLocation = 0;
-
-    // -- only applicable to skinned render item
-    UINT SkinnedCBIndex = -1;
+    DXGI_FORMAT IndexFormat = DXGI_FORMAT_UNKNOWN;  // see SubmeshGeometry::IndexFormat
 
     // -- nullptr if this render item is not animated by skinned mesh
     SkinnedModelInstance * SkinnedModelInst = nullptr;
@@ -77,12 +57,18 @@ struct RenderItem {
 enum class RenderLayer : int {
     Opaque = 0,
     SkinnedOpaque,
+    SkinnedCrowd,       // only drawn instanced, together with the skinned opaque items
     DebugShadowMap,
     DebugSSAO,
     Sky,
 
     COUNT_
 };
+enum class SkinningMode : int {
+    VertexShader = 0,   // every pass that draws a skinned item skins its vertices again in the vertex shader
+    GpuPreSkinning,     // a compute shader skins once per frame, the passes draw the posed vertices
+    CpuPreSkinning      // the job system skins once per frame into an upload buffer, the passes draw it
+};
 
 class SkinnedMeshDemo : public D3DApp {
 private:
@@ -92,6 +78,7 @@ private:
 
     ComPtr<ID3D12RootSignature> root_sig_ = nullptr;
     ComPtr<ID3D12RootSignature> ssao_root_sig_ = nullptr;
+    ComPtr<ID3D12RootSignature> pre_skinning_root_sig_ = nullptr;
 
     ComPtr<ID3D12DescriptorHeap> srv_descriptor_heap_ = nullptr;
 
@@ -123,7 +110,22 @@ private:
 
     UINT skinned_srv_heap_start_index_ = 0;
     std::string skinned_model_filename_ = "models/soldier.m3d";
-    std::unique_ptr<SkinnedModelInstance> skinned_model_inst_;
+    // -- instances share one bone palette per frame resource, each at its PaletteOffset
+    std::vector<SkinnedModelInstance> skinned_model_insts_;
+    UINT skinned_palette_bone_count_ = 0;
+    // -- instances from here on make the crowd, they are only animated and drawn when drawing instanced
+    UINT skinned_crowd_start_ = 1;
+    InstanceBatcher instance_batcher_;
+    std::vector<InstanceDrawItem> instance_draw_items_;
+    std::vector<InstanceBatch> skinned_batches_;
+    // -- bind pose vertices (kept for CPU pre-skinning) and the vertices instance i is posed into by pre-skinning
+    std::vector<M3DLoader::SkinnedVertex> skinned_vertices_;
+    std::vector<ComPtr<ID3D12Resource>> pre_skinned_vbs_;
+    std::vector<DualQuaternion> skinned_dual_quats_;
+    std::unique_ptr<JobSystem> anim_jobs_;
+    // -- animation LODs picked by the projected height of the model (bind pose height in model space)
+    std::array<AnimationLod, 4> skinned_lods_;
+    float skinned_model_height_ = 0.0f;
     SkinnedData skinned_info_;
     std::vector<M3DLoader::Subset> skinned_subsets_;
     std::vector<M3DLoader::M3DMaterial> skinned_mats_;
@@ -173,6 +175,9 @@ public: // -- helpers
         bool dir_light_enabled = true;
         bool show_smap_debug = false;
         bool show_ssao_debug = false;
+        bool dual_quat_skinning = false;
+        int skinning_mode = (int)SkinningMode::GpuPreSkinning;
+        bool instanced_crowd = false;
         bool mouse_active_ = false;
 
         std::vector<int> bone_hierarchy;
@@ -181,6 +186,11 @@ public: // -- helpers
     } imgui_params_ = {};
 
     static constexpr bool EnableImGui = true;
+    // -- threads per group of pre_skinning.hlsl (PRE_SKINNING_GROUP_SIZE)
+    static constexpr UINT PreSkinningGroupSize = 64;
+    // -- soldiers drawn behind the animated soldier with instanced skinning
+    static constexpr UINT SkinnedCrowdRows = 4;
+    static constexpr UINT SkinnedCrowdColumns = 4;
 
 public:
     SkinnedMeshDemo (HINSTANCE instance);
@@ -217,6 +227,7 @@ private:
     void LoadTextures ();
     void BuildRootSignature ();
     void BuildSSAORootSignature ();
+    void BuildPreSkinningRootSignature ();
     void BuildDescriptorHeaps ();
     void BuildShaderAndInputLayout ();
     void BuildShapeGeometry ();
@@ -233,6 +244,14 @@ private:
 
     void DrawSceneToShadowMap ();
     void DrawNormalAndDepth ();
+    void PreSkinVertices ();
+    // -- the skinned layer: one draw per render item, or one instanced draw per batch with the crowd
+    void DrawSkinnedItems (ID3D12GraphicsCommandList * cmdlist);
+    void DrawInstanceBatches (ID3D12GraphicsCommandList * cmdlist, std::vector<InstanceBatch> const & batches);
+
+    // -- pso of the skinned layer for a pass, pre-skinned vertices are drawn with the unskinned pso of the pass
+    ID3D12PipelineState * GetSkinnedPso (std::string const & pass_pso_name);
+    D3D12_VERTEX_BUFFER_VIEW GetPosedVertexBufferView (SkinnedModelInstance const * inst) const;
 
 
     CD3DX12_CPU_DESCRIPTOR_HANDLE GetHCpuSrv (int index) const;
@@ -281,6 +300,7 @@ bool SkinnedMeshDemo::Init () {
     LoadTextures();
     BuildRootSignature();
     BuildSSAORootSignature();
+    BuildPreSkinningRootSignature();
     BuildDescriptorHeaps();
     BuildShaderAndInputLayout();
     BuildShapeGeometry();
@@ -391,6 +411,13 @@ void SkinnedMeshDemo::ImGuiUpdate () {
     ImGui::Checkbox("Show Shadow Mapping Debug Window", &imgui_params_.show_smap_debug);
     ImGui::Checkbox("Show SSAO Debug Window", &imgui_params_.show_ssao_debug);
 
+    ImGui::Separator();
+    ImGui::Checkbox("Dual Quaternion Skinning", &imgui_params_.dual_quat_skinning);
+    ImGui::Combo(
+        "Skinning", &imgui_params_.skinning_mode,
+        "   Vertex Shader (every pass)\0   Compute Pre-Skinning\0   CPU Pre-Skinning\0\0");
+    ImGui::Checkbox("Instanced Skinned Crowd", &imgui_params_.instanced_crowd);
+
     ImGui::Separator();
     if (ImGui::CollapsingHeader("Bone Hierarchy")) {
         if (ImGui::TreeNode("Bone0")) {
@@ -483,8 +510,9 @@ void SkinnedMeshDemo::Update (GameTimer const & gt) {
     }
 
     AnimateMaterials(gt);
-    UpdateObjectCBs(gt);
+    // -- skinned instances first: their root motion moves render items before object cbs are written
     UpdateSkinnedCBs(gt);
+    UpdateObjectCBs(gt);
     UpdateMaterialBuffer(gt);
     UpdateShadowTransform(gt);
     UpdateMainPassCB(gt);
@@ -496,15 +524,22 @@ void SkinnedMeshDemo::DrawRenderItems (
     std::vector<RenderItem *> const & items
 ) {
     UINT obj_cb_byte_size = D3DUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
-    UINT skinned_cb_byte_size = D3DUtil::CalcConstantBufferByteSize(sizeof(SkinnedConstants));
+    UINT bone_byte_size = imgui_params_.dual_quat_skinning ?
+        curr_frame_resource_->BoneDualQuats->GetElementByteSize() :
+        curr_frame_resource_->BonePalette->GetElementByteSize();
 
     auto obj_cb = curr_frame_resource_->ObjCB->GetResource();
-    auto skinned_cb = curr_frame_resource_->SkinnedCB->GetResource();
+    auto bone_palette = imgui_params_.dual_quat_skinning ?
+        curr_frame_resource_->BoneDualQuats->GetResource() :
+        curr_frame_resource_->BonePalette->GetResource();
 
     for (UINT i = 0; i < items.size(); ++i) {
         RenderItem * ri = items[i];
-        cmdlist->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
-        cmdlist->IASetIndexBuffer(&ri->Geo->IndexBufferView());
+        D3D12_VERTEX_BUFFER_VIEW vbv = ri->Geo->VertexBufferView();
+        if (ri->SkinnedModelInst != nullptr && SkinningMode::VertexShader != (SkinningMode)imgui_params_.skinning_mode)
+            vbv = GetPosedVertexBufferView(ri->SkinnedModelInst);
+        cmdlist->IASetVertexBuffers(0, 1, &vbv);
+        cmdlist->IASetIndexBuffer(&ri->Geo->IndexBufferView(ri->IndexFormat));
         cmdlist->IASetPrimitiveTopology(ri->PrimitiveType);
 
         D3D12_GPU_VIRTUAL_ADDRESS obj_cb_address =
@@ -512,11 +547,12 @@ void SkinnedMeshDemo::DrawRenderItems (
         cmdlist->SetGraphicsRootConstantBufferView(0, obj_cb_address);
 
         if (ri->SkinnedModelInst != nullptr) {
-            D3D12_GPU_VIRTUAL_ADDRESS skinned_cb_address =
-                skinned_cb->GetGPUVirtualAddress() + ri->SkinnedCBIndex * skinned_cb_byte_size;
-            cmdlist->SetGraphicsRootConstantBufferView(1, skinned_cb_address);
+            // -- the palette srv starts at the instance's first bone, the shaders index it by vertex bone index
+            D3D12_GPU_VIRTUAL_ADDRESS palette_address =
+                bone_palette->GetGPUVirtualAddress() + (UINT64)ri->SkinnedModelInst->PaletteOffset * bone_byte_size;
+            cmdlist->SetGraphicsRootShaderResourceView(1, palette_address);
         } else {
-            cmdlist->SetGraphicsRootConstantBufferView(1, 0);   // no skinned data
+            cmdlist->SetGraphicsRootShaderResourceView(1, 0);   // no skinned data
         }
 
         cmdlist->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
@@ -549,8 +585,8 @@ void SkinnedMeshDemo::DrawSceneToShadowMap () {
     cmdlist_->SetPipelineState(psos_["ShadowOpaque"].Get());
     DrawRenderItems(cmdlist_.Get(), render_layers_[(int)RenderLayer::Opaque]);
 
-    cmdlist_->SetPipelineState(psos_["SkinnedShadowOpaque"].Get());
-    DrawRenderItems(cmdlist_.Get(), render_layers_[(int)RenderLayer::SkinnedOpaque]);
+    cmdlist_->SetPipelineState(GetSkinnedPso("ShadowOpaque"));
+    DrawSkinnedItems(cmdlist_.Get());
 
     cmdlist_->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(
         shadow_map_ptr_->GetResource(), D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_GENERIC_READ));
@@ -586,12 +622,99 @@ void SkinnedMeshDemo::DrawNormalAndDepth () {
     cmdlist_->SetPipelineState(psos_["DrawNormals"].Get());
     DrawRenderItems(cmdlist_.Get(), render_layers_[(int)RenderLayer::Opaque]);
 
-    cmdlist_->SetPipelineState(psos_["SkinnedDrawNormals"].Get());
-    DrawRenderItems(cmdlist_.Get(), render_layers_[(int)RenderLayer::SkinnedOpaque]);
+    cmdlist_->SetPipelineState(GetSkinnedPso("DrawNormals"));
+    DrawSkinnedItems(cmdlist_.Get());
 
     cmdlist_->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(
         normal_map, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_GENERIC_READ));
 }
+void SkinnedMeshDemo::PreSkinVertices () {
+    UINT num_vertices = (UINT)skinned_vertices_.size();
+    UINT num_insts = skinned_crowd_start_;
+
+    std::vector<D3D12_RESOURCE_BARRIER> barriers(num_insts);
+    for (UINT i = 0; i < num_insts; ++i)
+        barriers[i] = CD3DX12_RESOURCE_BARRIER::Transition(
+            pre_skinned_vbs_[i].Get(), D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    cmdlist_->ResourceBarrier(num_insts, barriers.data());
+
+    UINT bone_byte_size = imgui_params_.dual_quat_skinning ?
+        curr_frame_resource_->BoneDualQuats->GetElementByteSize() :
+        curr_frame_resource_->BonePalette->GetElementByteSize();
+    auto bone_palette = imgui_params_.dual_quat_skinning ?
+        curr_frame_resource_->BoneDualQuats->GetResource() :
+        curr_frame_resource_->BonePalette->GetResource();
+
+    cmdlist_->SetComputeRootSignature(pre_skinning_root_sig_.Get());
+    cmdlist_->SetPipelineState(psos_[imgui_params_.dual_quat_skinning ? "PreSkinningDQ" : "PreSkinning"].Get());
+    cmdlist_->SetComputeRoot32BitConstant(0, num_vertices, 0);
+    cmdlist_->SetComputeRootShaderResourceView(2, geometries_[skinned_model_filename_]->VertexBufferGpu->GetGPUVirtualAddress());
+    for (UINT i = 0; i < num_insts; ++i) {
+        D3D12_GPU_VIRTUAL_ADDRESS palette_address =
+            bone_palette->GetGPUVirtualAddress() + (UINT64)skinned_model_insts_[i].PaletteOffset * bone_byte_size;
+        cmdlist_->SetComputeRootShaderResourceView(1, palette_address);
+        cmdlist_->SetComputeRootUnorderedAccessView(3, pre_skinned_vbs_[i]->GetGPUVirtualAddress());
+        cmdlist_->Dispatch((num_vertices + PreSkinningGroupSize - 1) / PreSkinningGroupSize, 1, 1);
+    }
+
+    for (UINT i = 0; i < num_insts; ++i)
+        barriers[i] = CD3DX12_RESOURCE_BARRIER::Transition(
+            pre_skinned_vbs_[i].Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+    cmdlist_->ResourceBarrier(num_insts, barriers.data());
+}
+ID3D12PipelineState * SkinnedMeshDemo::GetSkinnedPso (std::string const & pass_pso_name) {
+    if (imgui_params_.instanced_crowd)
+        return psos_["InstancedSkinned" + pass_pso_name + (imgui_params_.dual_quat_skinning ? "DQ" : "")].Get();
+    if (SkinningMode::VertexShader != (SkinningMode)imgui_params_.skinning_mode)
+        return psos_[pass_pso_name].Get();
+    return psos_["Skinned" + pass_pso_name + (imgui_params_.dual_quat_skinning ? "DQ" : "")].Get();
+}
+D3D12_VERTEX_BUFFER_VIEW SkinnedMeshDemo::GetPosedVertexBufferView (SkinnedModelInstance const * inst) const {
+    UINT inst_index = (UINT)(inst - skinned_model_insts_.data());
+    UINT vb_byte_size = (UINT)skinned_vertices_.size() * sizeof(PosedVertex);
+
+    D3D12_VERTEX_BUFFER_VIEW vbv;
+    if (SkinningMode::GpuPreSkinning == (SkinningMode)imgui_params_.skinning_mode)
+        vbv.BufferLocation = pre_skinned_vbs_[inst_index]->GetGPUVirtualAddress();
+    else
+        vbv.BufferLocation =
+            curr_frame_resource_->PosedVertices->GetResource()->GetGPUVirtualAddress() + (UINT64)inst_index * vb_byte_size;
+    vbv.StrideInBytes = sizeof(PosedVertex);
+    vbv.SizeInBytes = vb_byte_size;
+    return vbv;
+}
+void SkinnedMeshDemo::DrawSkinnedItems (ID3D12GraphicsCommandList * cmdlist) {
+    if (imgui_params_.instanced_crowd)
+        DrawInstanceBatches(cmdlist, skinned_batches_);
+    else
+        DrawRenderItems(cmdlist, render_layers_[(int)RenderLayer::SkinnedOpaque]);
+}
+void SkinnedMeshDemo::DrawInstanceBatches (
+    ID3D12GraphicsCommandList * cmdlist,
+    std::vector<InstanceBatch> const & batches
+) {
+    // -- the whole bone palette, instances add their PaletteOffset to the bone indices
+    auto bone_palette = imgui_params_.dual_quat_skinning ?
+        curr_frame_resource_->BoneDualQuats->GetResource() :
+        curr_frame_resource_->BonePalette->GetResource();
+    cmdlist->SetGraphicsRootShaderResourceView(1, bone_palette->GetGPUVirtualAddress());
+
+    auto instance_buffer = curr_frame_resource_->InstanceBuffer->GetResource();
+    for (InstanceBatch const & batch : batches) {
+        MeshGeometry const * geo = static_cast<MeshGeometry const *>(batch.Geometry);
+        D3D12_VERTEX_BUFFER_VIEW vbv = geo->VertexBufferView();
+        D3D12_INDEX_BUFFER_VIEW ibv = geo->IndexBufferView((DXGI_FORMAT)batch.IndexFormat);
+        cmdlist->IASetVertexBuffers(0, 1, &vbv);
+        cmdlist->IASetIndexBuffer(&ibv);
+        cmdlist->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+        D3D12_GPU_VIRTUAL_ADDRESS instances_address =
+            instance_buffer->GetGPUVirtualAddress() + (UINT64)batch.FirstInstance * sizeof(InstanceData);
+        cmdlist->SetGraphicsRootShaderResourceView(8, instances_address);
+
+        cmdlist->DrawIndexedInstanced(batch.IndexCount, batch.InstanceCount, batch.StartIndexLocation, batch.BaseVertexLocation, 0);
+    }
+}
 void SkinnedMeshDemo::Draw (GameTimer const & gt) {
     auto cmdalloc = curr_frame_resource_->CmdlistAllocator;
 
@@ -602,6 +725,13 @@ void SkinnedMeshDemo::Draw (GameTimer const & gt) {
     ID3D12DescriptorHeap * descriptor_heaps [] = {srv_descriptor_heap_.Get()};
     cmdlist_->SetDescriptorHeaps(_countof(descriptor_heaps), descriptor_heaps);
 
+    //
+    // -- pre-skinning: skin once, the shadow, normal/depth and main passes all draw the result
+    // -- (instanced draws skin in the vertex shader, every instance of a batch reads the same vertex buffer)
+    //
+    if (SkinningMode::GpuPreSkinning == (SkinningMode)imgui_params_.skinning_mode && !imgui_params_.instanced_crowd)
+        PreSkinVertices();
+
     cmdlist_->SetGraphicsRootSignature(root_sig_.Get());
 
     //
@@ -691,8 +821,8 @@ void SkinnedMeshDemo::Draw (GameTimer const & gt) {
     cmdlist_->SetPipelineState(psos_["Opaque"].Get());
     DrawRenderItems(cmdlist_.Get(), render_layers_[(int)RenderLayer::Opaque]);
 
-    cmdlist_->SetPipelineState(psos_["SkinnedOpaque"].Get());
-    DrawRenderItems(cmdlist_.Get(), render_layers_[(int)RenderLayer::SkinnedOpaque]);
+    cmdlist_->SetPipelineState(GetSkinnedPso("Opaque"));
+    DrawSkinnedItems(cmdlist_.Get());
 
     if (imgui_params_.show_smap_debug) {
         cmdlist_->SetPipelineState(psos_["ShadowMapDebug"].Get());
@@ -784,19 +914,112 @@ void SkinnedMeshDemo::UpdateObjectCBs (GameTimer const & gt) {
     }
 }
 void SkinnedMeshDemo::UpdateSkinnedCBs (GameTimer const & gt) {
-    auto curr_skinned_cb = curr_frame_resource_->SkinnedCB.get();
+    // -- the crowd is only animated (and drawn) with instanced skinning
+    bool instanced = imgui_params_.instanced_crowd;
+    UINT num_insts = instanced ? (UINT)skinned_model_insts_.size() : skinned_crowd_start_;
+    std::vector<RenderItem *> const * skinned_layers [] = {
+        &render_layers_[(int)RenderLayer::SkinnedOpaque],
+        &render_layers_[(int)RenderLayer::SkinnedCrowd]
+    };
+    UINT num_layers = instanced ? 2 : 1;
+
+    // -- pick animation LOD of every instance from its projected height on screen
+    float proj_scale = 0.5f / tanf(0.5f * camera_.GetFovY());
+    for (UINT l = 0; l < num_layers; ++l) {
+        for (auto ri : *skinned_layers[l]) {
+            XMFLOAT4X4 const & world = ri->World;
+            float height = skinned_model_height_ * XMVectorGetX(XMVector3Length(XMVectorSet(world._21, world._22, world._23, 0.0f)));
+            float distance = XMVectorGetX(XMVector3Length(
+                XMVectorSubtract(XMVectorSet(world._41, world._42, world._43, 1.0f), camera_.GetPosition())
+            ));
+            float screen_size = height * proj_scale / MathHelper::Max(distance, camera_.GetNearZ());
 
-    // -- we only hav one skinned model being animated
-    skinned_model_inst_->UpdateSkinnedAnimation(gt.DeltaTime());
+            UINT lod = SelectAnimationLod(skinned_lods_.data(), (UINT)skinned_lods_.size(), screen_size);
+            ri->SkinnedModelInst->SetLod(skinned_lods_[lod]);
+        }
+    }
 
-    SkinnedConstants skinned_constants;
-    std::copy(
-        std::begin(skinned_model_inst_->FinalTransforms),
-        std::end(skinned_model_inst_->FinalTransforms),
-        &skinned_constants.BoneTransforms[0]
-    );
+    // -- instances are animated in parallel and write their 3x4 bone transforms straight into the palette
+    if (!imgui_params_.dual_quat_skinning) {
+        UpdateSkinnedInstances(
+            *anim_jobs_,
+            skinned_model_insts_.data(), num_insts,
+            gt.DeltaTime(),
+            reinterpret_cast<XMFLOAT3X4 *>(curr_frame_resource_->BonePalette->GetMappedData())
+        );
+    } else {
+        // -- dual quaternion skinning uploads 8 floats per bone instead of 12
+        // -- (converted in system memory first, CPU pre-skinning reads them back)
+        UpdateSkinnedInstances(
+            *anim_jobs_,
+            skinned_model_insts_.data(), num_insts,
+            gt.DeltaTime()
+        );
+        for (UINT i = 0; i < num_insts; ++i) {
+            SkinnedModelInstance const & inst = skinned_model_insts_[i];
+            ToDualQuaternions(
+                inst.FinalTransforms.data(), (UINT)inst.FinalTransforms.size(),
+                skinned_dual_quats_.data() + inst.PaletteOffset
+            );
+        }
+        memcpy(
+            curr_frame_resource_->BoneDualQuats->GetMappedData(),
+            skinned_dual_quats_.data(), skinned_dual_quats_.size() * sizeof(DualQuaternion)
+        );
+    }
+
+    // -- CPU pre-skinning: skin every instance once, all passes draw the uploaded vertices
+    if (SkinningMode::CpuPreSkinning == (SkinningMode)imgui_params_.skinning_mode && !instanced) {
+        UINT num_vertices = (UINT)skinned_vertices_.size();
+        auto posed_vertices = reinterpret_cast<PosedVertex *>(curr_frame_resource_->PosedVertices->GetMappedData());
+        for (UINT i = 0; i < skinned_crowd_start_; ++i) {
+            SkinnedModelInstance const & inst = skinned_model_insts_[i];
+            if (imgui_params_.dual_quat_skinning)
+                SkinVerticesParallel(
+                    *anim_jobs_, skinned_vertices_.data(), num_vertices,
+                    skinned_dual_quats_.data() + inst.PaletteOffset, posed_vertices + i * num_vertices
+                );
+            else
+                SkinVerticesParallel(
+                    *anim_jobs_, skinned_vertices_.data(), num_vertices,
+                    inst.FinalTransforms.data(), posed_vertices + i * num_vertices
+                );
+        }
+    }
+
+    // -- root motion moves the render items, the pose itself stays in place.
+    // -- Take1 is an in-place clip loaded without M3DLoader::ExtractRootMotion, so its delta is identity
+    for (UINT l = 0; l < num_layers; ++l) {
+        for (auto ri : *skinned_layers[l]) {
+            XMMATRIX world = XMLoadFloat4x4(&ri->World);
+            XMStoreFloat4x4(&ri->World, XMMatrixMultiply(ri->SkinnedModelInst->RootMotionDelta.ToMatrix(), world));
+            ri->NumFramesDirty = g_num_frame_resources;
+        }
+    }
 
-    curr_skinned_cb->CopyData(0, skinned_constants);
+    // -- instanced skinning: render items with the same submesh and material become one draw
+    if (instanced) {
+        instance_draw_items_.clear();
+        for (UINT l = 0; l < num_layers; ++l) {
+            for (auto ri : *skinned_layers[l]) {
+                InstanceDrawItem item;
+                item.Geometry = ri->Geo;
+                item.IndexCount = ri->IndexCount;
+                item.StartIndexLocation = ri->StartIndexLocation;
+                item.BaseVertexLocation = ri->BaseVertexLocation;
+                item.IndexFormat = ri->IndexFormat;
+                item.MaterialIndex = ri->Mat->MatBufferIndex;
+                item.PaletteOffset = ri->SkinnedModelInst->PaletteOffset;
+                item.World = ri->World;
+                instance_draw_items_.push_back(item);
+            }
+        }
+        instance_batcher_.Build(
+            instance_draw_items_.data(), (UINT)instance_draw_items_.size(),
+            skinned_batches_,
+            reinterpret_cast<InstanceData *>(curr_frame_resource_->InstanceBuffer->GetMappedData())
+        );
+    }
 }
 void SkinnedMeshDemo::UpdateMaterialBuffer (GameTimer const & gt) {
     auto curr_mat_buf = curr_frame_resource_->MatBuffer.get();
@@ -1308,67 +1531,175 @@ void SkinnedMeshDemo::BuildRenderItems () {
         ritem->IndexCount = ritem->Geo->DrawArgs[submesh_name].IndexCount;
         ritem->StartIndexLocation = ritem->Geo->DrawArgs[submesh_name].StartIndexLocation;
         ritem->BaseVertexLocation = ritem->Geo->DrawArgs[submesh_name].BaseVertexLocation;
+        ritem->IndexFormat = ritem->Geo->DrawArgs[submesh_name].IndexFormat;
 
         // -- all render items for this soldier.m3d instance share the same skinned model instance
-        ritem->SkinnedCBIndex = 0;
-        ritem->SkinnedModelInst = skinned_model_inst_.get();
+        ritem->SkinnedModelInst = &skinned_model_insts_[0];
 
         render_layers_[(int)RenderLayer::SkinnedOpaque].push_back(ritem.get());
         all_ritems_.push_back(std::move(ritem));
     }
+
+    //
+    // -- crowd of soldiers behind the box, only drawn (and animated) with instanced skinning
+    for (UINT row = 0; row < SkinnedCrowdRows; ++row) {
+        for (UINT col = 0; col < SkinnedCrowdColumns; ++col) {
+            UINT inst_index = skinned_crowd_start_ + row * SkinnedCrowdColumns + col;
+            for (UINT i = 0; i < skinned_mats_.size(); ++i) {
+                std::string submesh_name = "sm_" + std::to_string(i);
+
+                auto ritem = std::make_unique<RenderItem>();
+
+                XMMATRIX model_scale = XMMatrixScaling(0.05f, 0.05f, -0.05f);
+                XMMATRIX model_rot = XMMatrixRotationY(MathHelper::PI);
+                XMMATRIX model_offset = XMMatrixTranslation(-3.0f + col * 2.0f, 0.0f, 3.0f + row * 2.5f);
+                XMStoreFloat4x4(&ritem->World, model_scale * model_rot * model_offset);
+
+                ritem->TexTransform = MathHelper::Identity4x4();
+                ritem->ObjCBIndex = obj_index++;
+                ritem->Mat = materials_[skinned_mats_[i].Name].get();
+                ritem->Geo = geometries_[skinned_model_filename_].get();
+                ritem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+                ritem->IndexCount = ritem->Geo->DrawArgs[submesh_name].IndexCount;
+                ritem->StartIndexLocation = ritem->Geo->DrawArgs[submesh_name].StartIndexLocation;
+                ritem->BaseVertexLocation = ritem->Geo->DrawArgs[submesh_name].BaseVertexLocation;
+                ritem->IndexFormat = ritem->Geo->DrawArgs[submesh_name].IndexFormat;
+                ritem->SkinnedModelInst = &skinned_model_insts_[inst_index];
+
+                render_layers_[(int)RenderLayer::SkinnedCrowd].push_back(ritem.get());
+                all_ritems_.push_back(std::move(ritem));
+            }
+        }
+    }
 }
 void SkinnedMeshDemo::LoadSkinnedModel () {
-    std::vector<M3DLoader::SkinnedVertex> vertices;
-    std::vector<std::uint16_t> indices;
+    anim_jobs_ = std::make_unique<JobSystem>();
 
     M3DLoader loader;
-    loader.LoadM3D(skinned_model_filename_, vertices, indices,
-        skinned_subsets_, skinned_mats_, skinned_info_);
-
-    skinned_model_inst_ = std::make_unique<SkinnedModelInstance>();
-    skinned_model_inst_->SkinnedInfo = &skinned_info_;
-    skinned_model_inst_->FinalTransforms.resize(skinned_info_.BoneCount());
-    skinned_model_inst_->ClipName = "Take1";
-    skinned_model_inst_->TimePoint = 0.0f;
+    // -- soldier.m3d clips are keyed at 60Hz, resampling makes keyframe lookup a direct index
+    loader.AnimationSampleRate = 60.0f;
+    // -- the one-time text conversion parses its sections on the animation threads
+    loader.Jobs = anim_jobs_.get();
+
+    // -- the text model is converted to the binary format once, later runs only map the binary file
+    // -- and copy its vertices and indices straight from the mapping to the upload buffers
+    std::string const binary_filename = skinned_model_filename_ + "b";
+    M3DBinaryFile model_file;
+    bool loaded = model_file.Open(binary_filename);
+    if (!loaded)
+        loaded = loader.ConvertToBinary(skinned_model_filename_, binary_filename) && model_file.Open(binary_filename);
+    loaded = loaded && loader.LoadM3D(model_file, skinned_subsets_, skinned_mats_, skinned_info_);
+    if (!loaded) {
+        // -- text file problems have a line, binary file problems don't
+        for (M3DLoader::Diagnostic const & diagnostic : loader.Diagnostics) {
+            std::string location = diagnostic.Line > 0 ?
+                skinned_model_filename_ + "(" + std::to_string(diagnostic.Line) + ")" : binary_filename;
+            std::string message = location + ": " + M3DLoader::SectionName(diagnostic.Section) + ": " + diagnostic.Reason + "\n";
+            ::OutputDebugStringA(message.c_str());
+        }
+        THROW_IF_FAILED(E_FAIL);
+    }
+    M3DLoader::SkinnedVertex const * vertices = model_file.SkinnedVertices();
+    BYTE const * indices = model_file.Indices();
+    UINT const num_vertices = model_file.VertexCount();
+
+    // -- all bones at full rate up close, fewer bones and fewer updates as the model gets smaller on screen
+    skinned_info_.BuildBoneLods(3);
+    skinned_lods_ = {{
+        {0.25f, 0, 1},
+        {0.1f, 1, 1},
+        {0.05f, 1, 2},
+        {0.0f, 2, 4},
+    }};
+    float min_y = MathHelper::Infinity;
+    float max_y = -MathHelper::Infinity;
+    for (UINT i = 0; i < num_vertices; ++i) {
+        min_y = MathHelper::Min(min_y, vertices[i].Pos.y);
+        max_y = MathHelper::Max(max_y, vertices[i].Pos.y);
+    }
+    skinned_model_height_ = max_y - min_y;
+
+    // -- instances are referenced by render items, so this vector is never resized afterwards
+    // -- (the hero first, then the crowd drawn with instanced skinning)
+    skinned_model_insts_.resize(skinned_crowd_start_ + SkinnedCrowdRows * SkinnedCrowdColumns);
+    skinned_palette_bone_count_ = 0;
+    for (UINT i = 0; i < (UINT)skinned_model_insts_.size(); ++i) {
+        SkinnedModelInstance & inst = skinned_model_insts_[i];
+        inst.SkinnedInfo = &skinned_info_;
+        inst.PaletteOffset = skinned_palette_bone_count_;
+        skinned_palette_bone_count_ += skinned_info_.BoneCount();
+        inst.FinalTransforms.resize(skinned_info_.BoneCount());
+        inst.Workspace.Resize(skinned_info_.BoneCount());
+        inst.SetClip("Take1");
+
+        // -- spread the crowd over the clip so it does not move in lockstep
+        if (i >= skinned_crowd_start_) {
+            float start_time = skinned_info_.GetClipStartTime(inst.Clip);
+            float duration = skinned_info_.GetClipEndTime(inst.Clip) - start_time;
+            inst.TimePoint = start_time + duration * (i - skinned_crowd_start_) / (SkinnedCrowdRows * SkinnedCrowdColumns);
+        }
+    }
+    skinned_dual_quats_.resize(skinned_palette_bone_count_);
 
     //
     // -- build corresponding VB and IB:
 
-    UINT const vb_byte_size = (UINT)vertices.size() * sizeof(SkinnedVertex);
-    UINT const ib_byte_size = (UINT)indices.size() * sizeof(std::uint16_t);
+    UINT const vb_byte_size = model_file.VertexByteSize();
+    UINT const ib_byte_size = model_file.IndexByteSize();
 
     auto geo = std::make_unique<MeshGeometry>();
     geo->Name = skinned_model_filename_;
 
     THROW_IF_FAILED(D3DCreateBlob(vb_byte_size, &geo->VertexBufferCpu));
-    CopyMemory(geo->VertexBufferCpu->GetBufferPointer(), vertices.data(), vb_byte_size);
+    CopyMemory(geo->VertexBufferCpu->GetBufferPointer(), vertices, vb_byte_size);
 
     THROW_IF_FAILED(D3DCreateBlob(ib_byte_size, &geo->IndexBufferCpu));
-    CopyMemory(geo->IndexBufferCpu->GetBufferPointer(), indices.data(), ib_byte_size);
+    CopyMemory(geo->IndexBufferCpu->GetBufferPointer(), indices, ib_byte_size);
 
     geo->VertexBufferGpu =
-        D3DUtil::CreateDefaultBuffer(device_.Get(), cmdlist_.Get(), vertices.data(), vb_byte_size, geo->VertexBufferUploader);
+        D3DUtil::CreateDefaultBuffer(device_.Get(), cmdlist_.Get(), vertices, vb_byte_size, geo->VertexBufferUploader);
 
     geo->IndexBufferGpu =
-        D3DUtil::CreateDefaultBuffer(device_.Get(), cmdlist_.Get(), indices.data(), ib_byte_size, geo->IndexBufferUploader);
+        D3DUtil::CreateDefaultBuffer(device_.Get(), cmdlist_.Get(), indices, ib_byte_size, geo->IndexBufferUploader);
 
     geo->VertexByteStride = sizeof(SkinnedVertex);
     geo->VertexBufferByteSize = vb_byte_size;
     geo->IndexFormat = DXGI_FORMAT_R16_UINT;
     geo->IndexBufferByteSize = ib_byte_size;
 
+    // -- every subset has its own index size and is drawn through a view of the whole buffer in that format,
+    // -- its indices are relative to its base vertex so 16-bit ones also work for models over 65536 vertices
     for (UINT i = 0; i < (UINT)skinned_subsets_.size(); ++i) {
+        M3DLoader::Subset const & subset = skinned_subsets_[i];
         SubmeshGeometry submesh;
         std::string name = "sm_" + std::to_string(i);
 
-        submesh.IndexCount = (UINT)skinned_subsets_[i].FaceCount * 3;
-        submesh.StartIndexLocation = skinned_subsets_[i].FaceStart * 3;
-        submesh.BaseVertexLocation = 0;
+        submesh.IndexCount = subset.FaceCount * 3;
+        submesh.StartIndexLocation = subset.IndexByteOffset / subset.IndexSize;
+        submesh.BaseVertexLocation = (INT)subset.BaseVertex;
+        submesh.IndexFormat = sizeof(USHORT) == subset.IndexSize ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
 
         geo->DrawArgs[name] = submesh;
     }
     geometries_[geo->Name] = std::move(geo);
 
+    //
+    // -- posed vertices of every instance, written by the pre-skinning compute shader and read as a vertex buffer
+    // -- (the crowd is only drawn with instanced skinning and is never pre-skinned)
+    for (UINT i = 0; i < skinned_crowd_start_; ++i) {
+        ComPtr<ID3D12Resource> posed_vb;
+        THROW_IF_FAILED(device_->CreateCommittedResource(
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+            D3D12_HEAP_FLAG_NONE,
+            &CD3DX12_RESOURCE_DESC::Buffer(num_vertices * sizeof(PosedVertex), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+            D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER,
+            nullptr,
+            IID_PPV_ARGS(&posed_vb)
+        ));
+        pre_skinned_vbs_.push_back(posed_vb);
+    }
+    skinned_vertices_.assign(vertices, vertices + num_vertices);
+
     //
     // -- store bone hierarchy for visualization
     imgui_params_.bone_hierarchy = skinned_info_.GetBoneHierarchy();
@@ -1575,9 +1906,16 @@ void SkinnedMeshDemo::BuildDescriptorHeaps () {
     );
 }
 void SkinnedMeshDemo::BuildFrameResources () {
+    // -- one instance per skinned render item when the whole crowd is batched
+    UINT num_skinned_ritems = (UINT)(
+        render_layers_[(int)RenderLayer::SkinnedOpaque].size() + render_layers_[(int)RenderLayer::SkinnedCrowd].size()
+    );
     for (unsigned i = 0; i < g_num_frame_resources; ++i)
         frame_resources_.push_back(
-            std::make_unique<FrameResource>(device_.Get(), 2, (UINT)all_ritems_.size(), 1, (UINT)materials_.size())
+            std::make_unique<FrameResource>(
+                device_.Get(), 2, (UINT)all_ritems_.size(), skinned_palette_bone_count_,
+                (UINT)(skinned_crowd_start_ * skinned_vertices_.size()), num_skinned_ritems, (UINT)materials_.size()
+            )
         );
 }
 std::array<CD3DX12_STATIC_SAMPLER_DESC const, 7>
@@ -1661,16 +1999,17 @@ void SkinnedMeshDemo::BuildRootSignature () {
     CD3DX12_DESCRIPTOR_RANGE tex_table3;
     tex_table3.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, num_tex_maps, 3, 0);  // (t3, space0) rest of textures
 
-    CD3DX12_ROOT_PARAMETER slot_root_params[8];
+    CD3DX12_ROOT_PARAMETER slot_root_params[9];
     // -- ordererd from most frequent to least
     slot_root_params[0].InitAsConstantBufferView(0);    // (b0) obj cb
-    slot_root_params[1].InitAsConstantBufferView(1);    // (b1) skinned cb
+    slot_root_params[1].InitAsShaderResourceView(1, 1); // (t1, space1) bone palette
     slot_root_params[2].InitAsConstantBufferView(2);    // (b2) pass cb
     slot_root_params[3].InitAsShaderResourceView(0, 1); // (t0, space1) mat buffer
     slot_root_params[4].InitAsDescriptorTable(1, &tex_table0, D3D12_SHADER_VISIBILITY_PIXEL);
     slot_root_params[5].InitAsDescriptorTable(1, &tex_table1, D3D12_SHADER_VISIBILITY_PIXEL);
     slot_root_params[6].InitAsDescriptorTable(1, &tex_table2, D3D12_SHADER_VISIBILITY_PIXEL);
     slot_root_params[7].InitAsDescriptorTable(1, &tex_table3, D3D12_SHADER_VISIBILITY_PIXEL);
+    slot_root_params[8].InitAsShaderResourceView(3, 1); // (t3, space1) instance data
 
     auto static_samplers = GetStaticSamplers();
 
@@ -1778,6 +2117,36 @@ void SkinnedMeshDemo::BuildSSAORootSignature () {
         IID_PPV_ARGS(ssao_root_sig_.GetAddressOf())
     ));
 }
+void SkinnedMeshDemo::BuildPreSkinningRootSignature () {
+    CD3DX12_ROOT_PARAMETER slot_root_params[4];
+    slot_root_params[0].InitAsConstants(1, 3);          // (b3) vertex count
+    slot_root_params[1].InitAsShaderResourceView(1, 1); // (t1, space1) bone palette of the instance
+    slot_root_params[2].InitAsShaderResourceView(2, 1); // (t2, space1) bind pose skinned vertices
+    slot_root_params[3].InitAsUnorderedAccessView(0, 1);// (u0, space1) posed vertices of the instance
+
+    CD3DX12_ROOT_SIGNATURE_DESC root_sig_desc(
+        _countof(slot_root_params), slot_root_params,
+        0, nullptr,
+        D3D12_ROOT_SIGNATURE_FLAG_NONE
+    );
+
+    ComPtr<ID3DBlob> serialized_root_sig = nullptr;
+    ComPtr<ID3DBlob> error_blob = nullptr;
+    HRESULT hr = D3D12SerializeRootSignature(&root_sig_desc, D3D_ROOT_SIGNATURE_VERSION_1,
+        serialized_root_sig.GetAddressOf(), error_blob.GetAddressOf());
+
+    if (error_blob != nullptr) {
+        ::OutputDebugStringA((char *)error_blob->GetBufferPointer());
+    }
+    THROW_IF_FAILED(hr);
+
+    THROW_IF_FAILED(device_->CreateRootSignature(
+        0, // node mask
+        serialized_root_sig->GetBufferPointer(),
+        serialized_root_sig->GetBufferSize(),
+        IID_PPV_ARGS(pre_skinning_root_sig_.GetAddressOf())
+    ));
+}
 void SkinnedMeshDemo::BuildShaderAndInputLayout () {
     D3D_SHADER_MACRO const alphatest_defines [] {
         "ALPHATEST", "1", NULL, NULL
@@ -1785,13 +2154,31 @@ void SkinnedMeshDemo::BuildShaderAndInputLayout () {
     D3D_SHADER_MACRO const skinned_defines [] {
         "SKINNED", "1", NULL, NULL
     };
+    D3D_SHADER_MACRO const skinned_dual_quat_defines [] {
+        "SKINNED", "1", "DUAL_QUATERNION", "1", NULL, NULL
+    };
+    D3D_SHADER_MACRO const dual_quat_defines [] {
+        "DUAL_QUATERNION", "1", NULL, NULL
+    };
+    D3D_SHADER_MACRO const instanced_skinned_defines [] {
+        "SKINNED", "1", "INSTANCED", "1", NULL, NULL
+    };
+    D3D_SHADER_MACRO const instanced_skinned_dual_quat_defines [] {
+        "SKINNED", "1", "INSTANCED", "1", "DUAL_QUATERNION", "1", NULL, NULL
+    };
 
     shaders_["StandardVS"] = D3DUtil::CompileShader(L"shaders\\default.hlsl", nullptr, "VS", "vs_5_1");
     shaders_["SkinnedVS"] = D3DUtil::CompileShader(L"shaders\\default.hlsl", skinned_defines, "VS", "vs_5_1");
+    shaders_["SkinnedDQVS"] = D3DUtil::CompileShader(L"shaders\\default.hlsl", skinned_dual_quat_defines, "VS", "vs_5_1");
+    shaders_["InstancedSkinnedVS"] = D3DUtil::CompileShader(L"shaders\\default.hlsl", instanced_skinned_defines, "VS", "vs_5_1");
+    shaders_["InstancedSkinnedDQVS"] = D3DUtil::CompileShader(L"shaders\\default.hlsl", instanced_skinned_dual_quat_defines, "VS", "vs_5_1");
     shaders_["OpaquePS"] = D3DUtil::CompileShader(L"shaders\\default.hlsl", nullptr, "PS", "ps_5_1");
 
     shaders_["ShadowVS"] = D3DUtil::CompileShader(L"shaders\\shadows.hlsl", nullptr, "VS", "vs_5_1");
     shaders_["SkinnedShadowVS"] = D3DUtil::CompileShader(L"shaders\\shadows.hlsl", skinned_defines, "VS", "vs_5_1");
+    shaders_["SkinnedShadowDQVS"] = D3DUtil::CompileShader(L"shaders\\shadows.hlsl", skinned_dual_quat_defines, "VS", "vs_5_1");
+    shaders_["InstancedSkinnedShadowVS"] = D3DUtil::CompileShader(L"shaders\\shadows.hlsl", instanced_skinned_defines, "VS", "vs_5_1");
+    shaders_["InstancedSkinnedShadowDQVS"] = D3DUtil::CompileShader(L"shaders\\shadows.hlsl", instanced_skinned_dual_quat_defines, "VS", "vs_5_1");
     shaders_["ShadowOpaquePS"] = D3DUtil::CompileShader(L"shaders\\shadows.hlsl", nullptr, "PS", "ps_5_1");
     shaders_["ShadowAlphatestedPS"] = D3DUtil::CompileShader(L"shaders\\shadows.hlsl", alphatest_defines, "PS", "ps_5_1");
 
@@ -1801,6 +2188,11 @@ void SkinnedMeshDemo::BuildShaderAndInputLayout () {
 
     shaders_["DrawNormalsVS"] = D3DUtil::CompileShader(L"shaders\\draw_normals.hlsl", nullptr, "VS", "vs_5_1");
     shaders_["SkinnedDrawNormalsVS"] = D3DUtil::CompileShader(L"shaders\\draw_normals.hlsl", skinned_defines, "VS", "vs_5_1");
+    shaders_["SkinnedDrawNormalsDQVS"] = D3DUtil::CompileShader(L"shaders\\draw_normals.hlsl", skinned_dual_quat_defines, "VS", "vs_5_1");
+    shaders_["InstancedSkinnedDrawNormalsVS"] =
+        D3DUtil::CompileShader(L"shaders\\draw_normals.hlsl", instanced_skinned_defines, "VS", "vs_5_1");
+    shaders_["InstancedSkinnedDrawNormalsDQVS"] =
+        D3DUtil::CompileShader(L"shaders\\draw_normals.hlsl", instanced_skinned_dual_quat_defines, "VS", "vs_5_1");
     shaders_["DrawNormalsPS"] = D3DUtil::CompileShader(L"shaders\\draw_normals.hlsl", nullptr, "PS", "ps_5_1");
 
     shaders_["SSAOVS"] = D3DUtil::CompileShader(L"shaders\\ssao.hlsl", nullptr, "VS", "vs_5_1");
@@ -1812,6 +2204,9 @@ void SkinnedMeshDemo::BuildShaderAndInputLayout () {
     shaders_["SkyVS"] = D3DUtil::CompileShader(L"shaders\\sky.hlsl", nullptr, "VS", "vs_5_1");
     shaders_["SkyPS"] = D3DUtil::CompileShader(L"shaders\\sky.hlsl", nullptr, "PS", "ps_5_1");
 
+    shaders_["PreSkinningCS"] = D3DUtil::CompileShader(L"shaders\\pre_skinning.hlsl", nullptr, "CS", "cs_5_1");
+    shaders_["PreSkinningDQCS"] = D3DUtil::CompileShader(L"shaders\\pre_skinning.hlsl", dual_quat_defines, "CS", "cs_5_1");
+
 
     input_layout_ = {
         {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
@@ -1861,6 +2256,15 @@ void SkinnedMeshDemo::BuildPSOs () {
     skinned_opaque_pso_desc.PS.pShaderBytecode = shaders_["OpaquePS"]->GetBufferPointer();
     skinned_opaque_pso_desc.PS.BytecodeLength = shaders_["OpaquePS"]->GetBufferSize();
     THROW_IF_FAILED(device_->CreateGraphicsPipelineState(&skinned_opaque_pso_desc, IID_PPV_ARGS(&psos_["SkinnedOpaque"])));
+    skinned_opaque_pso_desc.VS.pShaderBytecode = shaders_["SkinnedDQVS"]->GetBufferPointer();
+    skinned_opaque_pso_desc.VS.BytecodeLength = shaders_["SkinnedDQVS"]->GetBufferSize();
+    THROW_IF_FAILED(device_->CreateGraphicsPipelineState(&skinned_opaque_pso_desc, IID_PPV_ARGS(&psos_["SkinnedOpaqueDQ"])));
+    skinned_opaque_pso_desc.VS.pShaderBytecode = shaders_["InstancedSkinnedVS"]->GetBufferPointer();
+    skinned_opaque_pso_desc.VS.BytecodeLength = shaders_["InstancedSkinnedVS"]->GetBufferSize();
+    THROW_IF_FAILED(device_->CreateGraphicsPipelineState(&skinned_opaque_pso_desc, IID_PPV_ARGS(&psos_["InstancedSkinnedOpaque"])));
+    skinned_opaque_pso_desc.VS.pShaderBytecode = shaders_["InstancedSkinnedDQVS"]->GetBufferPointer();
+    skinned_opaque_pso_desc.VS.BytecodeLength = shaders_["InstancedSkinnedDQVS"]->GetBufferSize();
+    THROW_IF_FAILED(device_->CreateGraphicsPipelineState(&skinned_opaque_pso_desc, IID_PPV_ARGS(&psos_["InstancedSkinnedOpaqueDQ"])));
     //
     // -- shadow map pass pso:
     //
@@ -1886,6 +2290,15 @@ void SkinnedMeshDemo::BuildPSOs () {
     skinned_smap_pso_desc.PS.pShaderBytecode = shaders_["ShadowOpaquePS"]->GetBufferPointer();
     skinned_smap_pso_desc.PS.BytecodeLength = shaders_["ShadowOpaquePS"]->GetBufferSize();
     THROW_IF_FAILED(device_->CreateGraphicsPipelineState(&skinned_smap_pso_desc, IID_PPV_ARGS(&psos_["SkinnedShadowOpaque"])));
+    skinned_smap_pso_desc.VS.pShaderBytecode = shaders_["SkinnedShadowDQVS"]->GetBufferPointer();
+    skinned_smap_pso_desc.VS.BytecodeLength = shaders_["SkinnedShadowDQVS"]->GetBufferSize();
+    THROW_IF_FAILED(device_->CreateGraphicsPipelineState(&skinned_smap_pso_desc, IID_PPV_ARGS(&psos_["SkinnedShadowOpaqueDQ"])));
+    skinned_smap_pso_desc.VS.pShaderBytecode = shaders_["InstancedSkinnedShadowVS"]->GetBufferPointer();
+    skinned_smap_pso_desc.VS.BytecodeLength = shaders_["InstancedSkinnedShadowVS"]->GetBufferSize();
+    THROW_IF_FAILED(device_->CreateGraphicsPipelineState(&skinned_smap_pso_desc, IID_PPV_ARGS(&psos_["InstancedSkinnedShadowOpaque"])));
+    skinned_smap_pso_desc.VS.pShaderBytecode = shaders_["InstancedSkinnedShadowDQVS"]->GetBufferPointer();
+    skinned_smap_pso_desc.VS.BytecodeLength = shaders_["InstancedSkinnedShadowDQVS"]->GetBufferSize();
+    THROW_IF_FAILED(device_->CreateGraphicsPipelineState(&skinned_smap_pso_desc, IID_PPV_ARGS(&psos_["InstancedSkinnedShadowOpaqueDQ"])));
     //
     // -- debug layer PSOs:
     //
@@ -1924,6 +2337,15 @@ void SkinnedMeshDemo::BuildPSOs () {
     skinned_draw_normals_pso_ds.PS.pShaderBytecode = shaders_["DrawNormalsPS"]->GetBufferPointer();
     skinned_draw_normals_pso_ds.PS.BytecodeLength = shaders_["DrawNormalsPS"]->GetBufferSize();
     THROW_IF_FAILED(device_->CreateGraphicsPipelineState(&skinned_draw_normals_pso_ds, IID_PPV_ARGS(&psos_["SkinnedDrawNormals"])));
+    skinned_draw_normals_pso_ds.VS.pShaderBytecode = shaders_["SkinnedDrawNormalsDQVS"]->GetBufferPointer();
+    skinned_draw_normals_pso_ds.VS.BytecodeLength = shaders_["SkinnedDrawNormalsDQVS"]->GetBufferSize();
+    THROW_IF_FAILED(device_->CreateGraphicsPipelineState(&skinned_draw_normals_pso_ds, IID_PPV_ARGS(&psos_["SkinnedDrawNormalsDQ"])));
+    skinned_draw_normals_pso_ds.VS.pShaderBytecode = shaders_["InstancedSkinnedDrawNormalsVS"]->GetBufferPointer();
+    skinned_draw_normals_pso_ds.VS.BytecodeLength = shaders_["InstancedSkinnedDrawNormalsVS"]->GetBufferSize();
+    THROW_IF_FAILED(device_->CreateGraphicsPipelineState(&skinned_draw_normals_pso_ds, IID_PPV_ARGS(&psos_["InstancedSkinnedDrawNormals"])));
+    skinned_draw_normals_pso_ds.VS.pShaderBytecode = shaders_["InstancedSkinnedDrawNormalsDQVS"]->GetBufferPointer();
+    skinned_draw_normals_pso_ds.VS.BytecodeLength = shaders_["InstancedSkinnedDrawNormalsDQVS"]->GetBufferSize();
+    THROW_IF_FAILED(device_->CreateGraphicsPipelineState(&skinned_draw_normals_pso_ds, IID_PPV_ARGS(&psos_["InstancedSkinnedDrawNormalsDQ"])));
     //
     // -- SSAO PSO:
     //
@@ -1966,6 +2388,18 @@ void SkinnedMeshDemo::BuildPSOs () {
     sky_pso_desc.PS.pShaderBytecode = shaders_["SkyPS"]->GetBufferPointer();
     sky_pso_desc.PS.BytecodeLength = shaders_["SkyPS"]->GetBufferSize();
     THROW_IF_FAILED(device_->CreateGraphicsPipelineState(&sky_pso_desc, IID_PPV_ARGS(&psos_["Sky"])));
+    //
+    // -- pre-skinning PSOs:
+    //
+    D3D12_COMPUTE_PIPELINE_STATE_DESC pre_skinning_pso_desc = {};
+    pre_skinning_pso_desc.pRootSignature = pre_skinning_root_sig_.Get();
+    pre_skinning_pso_desc.CS.pShaderBytecode = shaders_["PreSkinningCS"]->GetBufferPointer();
+    pre_skinning_pso_desc.CS.BytecodeLength = shaders_["PreSkinningCS"]->GetBufferSize();
+    pre_skinning_pso_desc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+    THROW_IF_FAILED(device_->CreateComputePipelineState(&pre_skinning_pso_desc, IID_PPV_ARGS(&psos_["PreSkinning"])));
+    pre_skinning_pso_desc.CS.pShaderBytecode = shaders_["PreSkinningDQCS"]->GetBufferPointer();
+    pre_skinning_pso_desc.CS.BytecodeLength = shaders_["PreSkinningDQCS"]->GetBufferSize();
+    THROW_IF_FAILED(device_->CreateComputePipelineState(&pre_skinning_pso_desc, IID_PPV_ARGS(&psos_["PreSkinningDQ"])));
 }
 
 //
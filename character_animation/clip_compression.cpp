@@ -0,0 +1,313 @@
+#include "clip_compression.h"
+#include "skinned_data.h"
+
+using namespace DirectX;
+
+static float const g_quat_component_range = 0.70710678f;    // smallest three are within +-1/sqrt(2)
+
+static bool near_equal3 (XMFLOAT3 const & a, XMFLOAT3 const & b, float tolerance) {
+    return
+        fabsf(a.x - b.x) <= tolerance &&
+        fabsf(a.y - b.y) <= tolerance &&
+        fabsf(a.z - b.z) <= tolerance;
+}
+static USHORT quantize (float v, float min, float extent) {
+    if (extent <= 0.0f)
+        return 0;
+    float n = MathHelper::Clamp((v - min) / extent, 0.0f, 1.0f);
+    return (USHORT)(n * 65535.0f + 0.5f);
+}
+static float dequantize (USHORT v, float min, float extent) {
+    return min + extent * (v * (1.0f / 65535.0f));
+}
+
+void CompressedAnimationClip::EncodeQuaternion (FXMVECTOR q, USHORT out_bits[3]) {
+    XMFLOAT4 v;
+    XMStoreFloat4(&v, XMQuaternionNormalize(q));
+    float c[4] = {v.x, v.y, v.z, v.w};
+
+    // -- drop the largest component, q and -q are the same rotation so make it positive
+    UINT largest = 0;
+    for (UINT i = 1; i < 4; ++i)
+        if (fabsf(c[i]) > fabsf(c[largest]))
+            largest = i;
+    float sign = c[largest] < 0.0f ? -1.0f : 1.0f;
+
+    USHORT packed[3];
+    for (UINT i = 0, j = 0; i < 4; ++i) {
+        if (i == largest)
+            continue;
+        float n = MathHelper::Clamp(sign * c[i] / g_quat_component_range * 0.5f + 0.5f, 0.0f, 1.0f);
+        packed[j++] = (USHORT)(n * 32767.0f + 0.5f);
+    }
+
+    // -- index of the dropped component goes in the top bits of the first two words
+    out_bits[0] = packed[0] | (USHORT)((largest & 1) << 15);
+    out_bits[1] = packed[1] | (USHORT)((largest >> 1) << 15);
+    out_bits[2] = packed[2];
+}
+XMVECTOR CompressedAnimationClip::DecodeQuaternion (USHORT const bits[3]) {
+    UINT largest = (bits[0] >> 15) | ((bits[1] >> 15) << 1);
+
+    float smallest[3];
+    float sum_sq = 0.0f;
+    for (UINT j = 0; j < 3; ++j) {
+        float n = (bits[j] & 0x7fff) * (1.0f / 32767.0f);
+        smallest[j] = (n * 2.0f - 1.0f) * g_quat_component_range;
+        sum_sq += smallest[j] * smallest[j];
+    }
+
+    float c[4];
+    for (UINT i = 0, j = 0; i < 4; ++i)
+        c[i] = (i == largest) ? sqrtf(MathHelper::Max(1.0f - sum_sq, 0.0f)) : smallest[j++];
+
+    return XMVectorSet(c[0], c[1], c[2], c[3]);
+}
+
+void CompressedAnimationClip::Build (AnimationClip const & clip, ClipCompressionSettings const & settings) {
+    UINT num_bones = (UINT)clip.BoneAnimations.size();
+
+    tracks_.clear();
+    tracks_.resize(num_bones);
+    time_points_.clear();
+    data_.clear();
+
+    start_time_ = clip.GetClipStartTime();
+    end_time_ = clip.GetClipEndTime();
+
+    // -- direct frame indexing needs every bone to share the same uniform keyframes
+    sample_rate_ = clip.SampleRate;
+    for (UINT i = 0; i < num_bones; ++i) {
+        size_t num_keyframes = clip.BoneAnimations[i].Keyframes.size();
+        if (num_keyframes < 2 || num_keyframes != clip.BoneAnimations[0].Keyframes.size())
+            sample_rate_ = 0.0f;
+    }
+
+    XMFLOAT3 const zero3(0.0f, 0.0f, 0.0f);
+    XMFLOAT3 const one3(1.0f, 1.0f, 1.0f);
+    XMFLOAT4 const identity_quat(0.0f, 0.0f, 0.0f, 1.0f);
+
+    for (UINT i = 0; i < num_bones; ++i) {
+        std::vector<Keyframe> const & keyframes = clip.BoneAnimations[i].Keyframes;
+        BoneTrack & track = tracks_[i];
+        track.NumKeyframes = (UINT)keyframes.size();
+
+        //
+        // -- classify tracks and find translation/scale ranges
+        XMVECTOR p_min = XMLoadFloat3(&keyframes[0].Translation);
+        XMVECTOR p_max = p_min;
+        XMVECTOR s_min = XMLoadFloat3(&keyframes[0].Scale);
+        XMVECTOR s_max = s_min;
+        XMVECTOR q0 = XMLoadFloat4(&keyframes[0].RotationQuat);
+
+        bool constant_p = true, constant_s = true, constant_q = true;
+        for (Keyframe const & k : keyframes) {
+            XMVECTOR p = XMLoadFloat3(&k.Translation);
+            XMVECTOR s = XMLoadFloat3(&k.Scale);
+            p_min = XMVectorMin(p_min, p);
+            p_max = XMVectorMax(p_max, p);
+            s_min = XMVectorMin(s_min, s);
+            s_max = XMVectorMax(s_max, s);
+
+            constant_p = constant_p && near_equal3(k.Translation, keyframes[0].Translation, settings.TranslationTolerance);
+            constant_s = constant_s && near_equal3(k.Scale, keyframes[0].Scale, settings.ScaleTolerance);
+
+            // -- compare in the same hemisphere as the first key
+            XMVECTOR q = XMLoadFloat4(&k.RotationQuat);
+            if (XMVectorGetX(XMQuaternionDot(q, q0)) < 0.0f)
+                q = XMVectorNegate(q);
+            constant_q = constant_q &&
+                XMVector4NearEqual(q, q0, XMVectorReplicate(settings.RotationTolerance));
+        }
+
+        if (!constant_p) {
+            track.TranslationFormat = TrackFormat::Animated;
+            XMStoreFloat3(&track.TranslationMin, p_min);
+            XMStoreFloat3(&track.TranslationExtent, XMVectorSubtract(p_max, p_min));
+        } else if (!near_equal3(keyframes[0].Translation, zero3, settings.TranslationTolerance)) {
+            track.TranslationFormat = TrackFormat::Constant;
+            track.TranslationMin = keyframes[0].Translation;
+        }
+
+        if (!constant_q) {
+            track.RotationFormat = TrackFormat::Animated;
+        } else {
+            XMVECTOR identity = XMLoadFloat4(&identity_quat);
+            if (XMVectorGetW(q0) < 0.0f)
+                identity = XMVectorNegate(identity);
+            if (!XMVector4NearEqual(q0, identity, XMVectorReplicate(settings.RotationTolerance))) {
+                track.RotationFormat = TrackFormat::Constant;
+                track.ConstantRotation = keyframes[0].RotationQuat;
+            }
+        }
+
+        if (!constant_s) {
+            track.ScaleFormat = TrackFormat::Animated;
+            XMStoreFloat3(&track.ScaleMin, s_min);
+            XMStoreFloat3(&track.ScaleExtent, XMVectorSubtract(s_max, s_min));
+        } else if (!near_equal3(keyframes[0].Scale, one3, settings.ScaleTolerance)) {
+            track.ScaleFormat = TrackFormat::Constant;
+            track.ScaleMin = keyframes[0].Scale;
+        }
+
+        track.Stride = 3 * (
+            (track.TranslationFormat == TrackFormat::Animated) +
+            (track.RotationFormat == TrackFormat::Animated) +
+            (track.ScaleFormat == TrackFormat::Animated)
+        );
+        if (0 == track.Stride)
+            continue;
+
+        //
+        // -- append time points (only needed for arbitrarily timed clips) and quantized keys
+        track.TimeOffset = (UINT)time_points_.size();
+        if (0.0f == sample_rate_)
+            for (Keyframe const & k : keyframes)
+                time_points_.push_back(k.TimePoint);
+
+        track.DataOffset = (UINT)data_.size();
+        data_.resize(data_.size() + (size_t)track.Stride * track.NumKeyframes);
+        USHORT * dst = data_.data() + track.DataOffset;
+        for (Keyframe const & k : keyframes) {
+            if (track.TranslationFormat == TrackFormat::Animated) {
+                *dst++ = quantize(k.Translation.x, track.TranslationMin.x, track.TranslationExtent.x);
+                *dst++ = quantize(k.Translation.y, track.TranslationMin.y, track.TranslationExtent.y);
+                *dst++ = quantize(k.Translation.z, track.TranslationMin.z, track.TranslationExtent.z);
+            }
+            if (track.RotationFormat == TrackFormat::Animated) {
+                EncodeQuaternion(XMLoadFloat4(&k.RotationQuat), dst);
+                dst += 3;
+            }
+            if (track.ScaleFormat == TrackFormat::Animated) {
+                *dst++ = quantize(k.Scale.x, track.ScaleMin.x, track.ScaleExtent.x);
+                *dst++ = quantize(k.Scale.y, track.ScaleMin.y, track.ScaleExtent.y);
+                *dst++ = quantize(k.Scale.z, track.ScaleMin.z, track.ScaleExtent.z);
+            }
+        }
+    }
+}
+size_t CompressedAnimationClip::ByteSize () const {
+    return
+        sizeof(*this) +
+        tracks_.size() * sizeof(BoneTrack) +
+        time_points_.size() * sizeof(float) +
+        data_.size() * sizeof(USHORT);
+}
+void CompressedAnimationClip::decode_keyframe (
+    BoneTrack const & track, UINT k,
+    XMVECTOR & out_s, XMVECTOR & out_q, XMVECTOR & out_p
+) const {
+    USHORT const * src = data_.data() + track.DataOffset + (size_t)k * track.Stride;
+
+    if (track.TranslationFormat == TrackFormat::Animated) {
+        out_p = XMVectorSet(
+            dequantize(src[0], track.TranslationMin.x, track.TranslationExtent.x),
+            dequantize(src[1], track.TranslationMin.y, track.TranslationExtent.y),
+            dequantize(src[2], track.TranslationMin.z, track.TranslationExtent.z),
+            0.0f
+        );
+        src += 3;
+    } else {
+        out_p = XMLoadFloat3(&track.TranslationMin);
+    }
+
+    if (track.RotationFormat == TrackFormat::Animated) {
+        out_q = DecodeQuaternion(src);
+        src += 3;
+    } else {
+        out_q = XMLoadFloat4(&track.ConstantRotation);
+    }
+
+    if (track.ScaleFormat == TrackFormat::Animated) {
+        out_s = XMVectorSet(
+            dequantize(src[0], track.ScaleMin.x, track.ScaleExtent.x),
+            dequantize(src[1], track.ScaleMin.y, track.ScaleExtent.y),
+            dequantize(src[2], track.ScaleMin.z, track.ScaleExtent.z),
+            0.0f
+        );
+    } else {
+        out_s = XMLoadFloat3(&track.ScaleMin);
+    }
+}
+template <typename StoreBone>
+void CompressedAnimationClip::sample (
+    float t, std::vector<UINT> & keyframe_cursors,
+    std::vector<UINT> const * bone_subset, StoreBone const & store_bone
+) const {
+    // -- uniformly sampled: all bones share the same frame index and lerp percent
+    UINT frame = 0;
+    float frame_percent = 0.0f;
+    if (sample_rate_ > 0.0f && !tracks_.empty()) {
+        UINT last_frame = tracks_[0].NumKeyframes - 1;
+        float frame_time = (MathHelper::Max(t, start_time_) - start_time_) * sample_rate_;
+
+        frame = last_frame - 1;
+        frame_percent = 1.0f;
+        if (frame_time < (float)last_frame) {
+            frame = (UINT)frame_time;
+            frame_percent = frame_time - (float)frame;
+        }
+    }
+
+    UINT num_bones = bone_subset ? (UINT)bone_subset->size() : BoneCount();
+    for (UINT n = 0; n < num_bones; ++n) {
+        UINT i = bone_subset ? (*bone_subset)[n] : n;
+        BoneTrack const & track = tracks_[i];
+
+        XMVECTOR S, P, Q;
+        if (0 == track.Stride) {
+            // -- constant or identity tracks only
+            decode_keyframe(track, 0, S, Q, P);
+        } else {
+            UINT k = frame;
+            float lerp_percent = frame_percent;
+            if (0.0f == sample_rate_) {
+                float const * time_points = time_points_.data() + track.TimeOffset;
+                UINT last = track.NumKeyframes - 1;
+                if (t <= time_points[0]) {
+                    k = 0;
+                    lerp_percent = 0.0f;
+                } else if (t >= time_points[last]) {
+                    k = last - 1;
+                    lerp_percent = 1.0f;
+                } else {
+                    k = PackedAnimationClip::FindKeyframe(time_points, track.NumKeyframes, t, keyframe_cursors[i]);
+                    lerp_percent = (t - time_points[k]) / (time_points[k + 1] - time_points[k]);
+                }
+            }
+
+            XMVECTOR s0, q0, p0, s1, q1, p1;
+            decode_keyframe(track, k, s0, q0, p0);
+            decode_keyframe(track, k + 1, s1, q1, p1);
+
+            S = XMVectorLerp(s0, s1, lerp_percent);
+            P = XMVectorLerp(p0, p1, lerp_percent);
+            Q = XMQuaternionSlerp(q0, q1, lerp_percent);
+        }
+        store_bone(i, S, Q, P);
+    }
+}
+void CompressedAnimationClip::Interpolate (
+    float t,
+    std::vector<DirectX::XMFLOAT4X4> & out_bone_transforms,
+    std::vector<UINT> & keyframe_cursors,
+    std::vector<UINT> const * bone_subset
+) const {
+    // -- rotation orgin is (0,0,0) point
+    XMVECTOR zero = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+
+    sample(t, keyframe_cursors, bone_subset, [&](UINT i, FXMVECTOR S, FXMVECTOR Q, FXMVECTOR P) {
+        XMStoreFloat4x4(&out_bone_transforms[i], XMMatrixAffineTransformation(S, zero, Q, P));
+    });
+}
+void CompressedAnimationClip::SamplePose (
+    float t,
+    std::vector<BoneTransform> & out_pose,
+    std::vector<UINT> & keyframe_cursors
+) const {
+    sample(t, keyframe_cursors, nullptr, [&](UINT i, FXMVECTOR S, FXMVECTOR Q, FXMVECTOR P) {
+        XMStoreFloat3(&out_pose[i].Scale, S);
+        XMStoreFloat4(&out_pose[i].RotationQuat, Q);
+        XMStoreFloat3(&out_pose[i].Translation, P);
+    });
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "../common/core_types.h"
+
+struct AnimationClip;
+struct BoneTransform;
+
+enum class TrackFormat : BYTE {
+    Identity = 0,   // no data, translation (0,0,0) / scale (1,1,1) / identity rotation
+    Constant,       // single full precision value stored in the track header
+    Animated        // one quantized value per keyframe
+};
+
+struct ClipCompressionSettings {
+    // -- a track whose keys all stay within tolerance of the first key is stored as constant
+    float TranslationTolerance = 1e-4f;
+    float ScaleTolerance = 1e-4f;
+    float RotationTolerance = 1e-4f;    // per quaternion component
+};
+
+//
+// -- Quantized form of an AnimationClip:
+// -- rotations use smallest-three encoding (2-bit index of the dropped component + 3 x 15-bit components),
+// -- translations and scales are range-quantized to 16 bits per component within each track's bounds,
+// -- and constant or identity tracks store no per-keyframe data at all
+class CompressedAnimationClip {
+public:
+    struct BoneTrack {
+        TrackFormat TranslationFormat = TrackFormat::Identity;
+        TrackFormat RotationFormat = TrackFormat::Identity;
+        TrackFormat ScaleFormat = TrackFormat::Identity;
+        BYTE Stride = 0;            // USHORTs per keyframe in Data
+
+        UINT NumKeyframes = 0;
+        UINT TimeOffset = 0;        // into time_points_ (unused for uniformly sampled clips)
+        UINT DataOffset = 0;        // into data_
+
+        // -- range (min, extent) of animated tracks or the value of constant tracks (in min)
+        DirectX::XMFLOAT3 TranslationMin = {0.0f, 0.0f, 0.0f};
+        DirectX::XMFLOAT3 TranslationExtent = {0.0f, 0.0f, 0.0f};
+        DirectX::XMFLOAT3 ScaleMin = {1.0f, 1.0f, 1.0f};
+        DirectX::XMFLOAT3 ScaleExtent = {0.0f, 0.0f, 0.0f};
+        DirectX::XMFLOAT4 ConstantRotation = {0.0f, 0.0f, 0.0f, 1.0f};
+    };
+
+private:
+    std::vector<BoneTrack> tracks_;
+    std::vector<float> time_points_;
+    std::vector<USHORT> data_;
+
+    float start_time_ = 0.0f;
+    float end_time_ = 0.0f;
+    float sample_rate_ = 0.0f;
+
+    void decode_keyframe (
+        BoneTrack const & track, UINT k,
+        DirectX::XMVECTOR & out_s, DirectX::XMVECTOR & out_q, DirectX::XMVECTOR & out_p
+    ) const;
+    // -- interpolates every bone (or the bones in bone_subset) at t and hands (bone, S, Q, P) to store_bone
+    template <typename StoreBone>
+    void sample (
+        float t, std::vector<UINT> & keyframe_cursors,
+        std::vector<UINT> const * bone_subset, StoreBone const & store_bone
+    ) const;
+
+public:
+    void Build (AnimationClip const & clip, ClipCompressionSettings const & settings);
+
+    float GetClipStartTime () const { return start_time_; }
+    float GetClipEndTime () const { return end_time_; }
+    UINT BoneCount () const { return (UINT)tracks_.size(); }
+    BoneTrack const & GetBoneTrack (UINT bone_index) const { return tracks_[bone_index]; }
+
+    // -- memory held by the compressed clip
+    size_t ByteSize () const;
+
+    // -- same interface as PackedAnimationClip::Interpolate
+    void Interpolate (
+        float t,
+        std::vector<DirectX::XMFLOAT4X4> & out_bone_transforms,
+        std::vector<UINT> & keyframe_cursors,
+        std::vector<UINT> const * bone_subset = nullptr
+    ) const;
+    // -- same interface as PackedAnimationClip::SamplePose
+    void SamplePose (
+        float t,
+        std::vector<BoneTransform> & out_pose,
+        std::vector<UINT> & keyframe_cursors
+    ) const;
+
+    static void EncodeQuaternion (DirectX::FXMVECTOR q, USHORT out_bits[3]);
+    static DirectX::XMVECTOR DecodeQuaternion (USHORT const bits[3]);
+};
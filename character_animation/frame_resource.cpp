@@ -1,6 +1,6 @@
 #include "frame_resource.h"
 
-FrameResource::FrameResource (ID3D12Device * dev, UINT pass_cnt, UINT obj_cnt, UINT skinned_obj_cnt, UINT mat_cnt) {
+FrameResource::FrameResource (ID3D12Device * dev, UINT pass_cnt, UINT obj_cnt, UINT palette_bone_cnt, UINT posed_vertex_cnt, UINT instance_cnt, UINT mat_cnt) {
     THROW_IF_FAILED(dev->CreateCommandAllocator(
         D3D12_COMMAND_LIST_TYPE_DIRECT,
         IID_PPV_ARGS(CmdlistAllocator.GetAddressOf())
@@ -9,7 +9,10 @@ FrameResource::FrameResource (ID3D12Device * dev, UINT pass_cnt, UINT obj_cnt, U
     SSAOCB = std::make_unique<UploadBuffer<SSAOConstants>>(dev, 1, true);
     MatBuffer = std::make_unique<UploadBuffer<MaterialData>>(dev, mat_cnt, false);
     ObjCB = std::make_unique<UploadBuffer<ObjectConstants>>(dev, obj_cnt, true);
-    SkinnedCB = std::make_unique<UploadBuffer<SkinnedConstants>>(dev, skinned_obj_cnt, true);
+    BonePalette = std::make_unique<UploadBuffer<DirectX::XMFLOAT3X4>>(dev, palette_bone_cnt, false);
+    BoneDualQuats = std::make_unique<UploadBuffer<DualQuaternion>>(dev, palette_bone_cnt, false);
+    PosedVertices = std::make_unique<UploadBuffer<PosedVertex>>(dev, posed_vertex_cnt, false);
+    InstanceBuffer = std::make_unique<UploadBuffer<InstanceData>>(dev, instance_cnt, false);
 }
 FrameResource::~FrameResource () {
 
@@ -3,6 +3,8 @@
 #include "../common/d3d12_util.h"
 #include "../common/math_helper.h"
 #include "../common/upload_buffer.h"
+#include "skinning.h"
+#include "instance_batching.h"
 
 struct ObjectConstants {
     DirectX::XMFLOAT4X4 World = MathHelper::Identity4x4();
@@ -12,9 +14,6 @@ struct ObjectConstants {
     UINT    ObjPad1;
     UINT    ObjPad2;
 };
-struct SkinnedConstants {
-    DirectX::XMFLOAT4X4 BoneTransforms[96];
-};
 struct PassConstants {
     DirectX::XMFLOAT4X4 View = MathHelper::Identity4x4();
     DirectX::XMFLOAT4X4 InvView = MathHelper::Identity4x4();
@@ -87,7 +86,7 @@ struct SkinnedVertex {
 class FrameResource
 {
 public:
-    FrameResource (ID3D12Device * dev, UINT pass_cnt, UINT obj_cnt, UINT skinned_obj_cnt, UINT mat_cnt);
+    FrameResource (ID3D12Device * dev, UINT pass_cnt, UINT obj_cnt, UINT palette_bone_cnt, UINT posed_vertex_cnt, UINT instance_cnt, UINT mat_cnt);
     FrameResource (FrameResource const & rhs) = delete;
     FrameResource & operator= (FrameResource const & rhs) = delete;
     ~FrameResource ();
@@ -98,7 +97,14 @@ public:
     // -- each frame requires its own buffers to separate gpu processing
     std::unique_ptr<UploadBuffer<PassConstants>> PassCB = nullptr;
     std::unique_ptr<UploadBuffer<ObjectConstants>> ObjCB = nullptr;
-    std::unique_ptr<UploadBuffer<SkinnedConstants>> SkinnedCB = nullptr;
+    // -- bones of all skinned instances back to back (see SkinnedModelInstance::PaletteOffset),
+    // -- 3x4 affine transforms or, for dual quaternion skinning, 8 floats per bone
+    std::unique_ptr<UploadBuffer<DirectX::XMFLOAT3X4>> BonePalette = nullptr;
+    std::unique_ptr<UploadBuffer<DualQuaternion>> BoneDualQuats = nullptr;
+    // -- vertices of all skinned instances skinned on the CPU (SkinningMode::CpuPreSkinning)
+    std::unique_ptr<UploadBuffer<PosedVertex>> PosedVertices = nullptr;
+    // -- instance data of the instanced draws, batch after batch (see InstanceBatcher)
+    std::unique_ptr<UploadBuffer<InstanceData>> InstanceBuffer = nullptr;
     std::unique_ptr<UploadBuffer<SSAOConstants>> SSAOCB = nullptr;
     std::unique_ptr<UploadBuffer<MaterialData>> MatBuffer = nullptr;
 
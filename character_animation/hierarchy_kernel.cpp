@@ -0,0 +1,138 @@
+#include "hierarchy_kernel.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || ((defined(__i386__) || defined(_M_IX86)) && (defined(__SSE2__) || _M_IX86_FP >= 2))
+#define HIERARCHY_KERNEL_X86 1
+#include "hierarchy_kernel_simd.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// -- hierarchy_kernel_avx2.cpp
+void concatenate_hierarchy_avx2 (
+    unsigned const * bone_order, unsigned num_bones, int const * parents,
+    float const * to_parent_transforms, float const * affine_offsets,
+    float * affine_to_root_transforms, float * out_transforms, bool output_affine
+);
+#endif
+
+using namespace DirectX;
+
+//
+// -- the same products as the SSE kernel on plain floats, rows of transposed affine transforms.
+// -- Results go through a local so the compiler can keep the rows in registers (out may be any of the inputs)
+static void multiply_affine (float const * a, float const * b, float * out) {
+    float rows[12];
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 4; ++c)
+            rows[4 * r + c] = a[4 * r] * b[c] + a[4 * r + 1] * b[4 + c] + a[4 * r + 2] * b[8 + c];
+        rows[4 * r + 3] += a[4 * r + 3];
+    }
+    std::copy(rows, rows + 12, out);
+}
+template <bool OutputAffine>
+static void concatenate_scalar (
+    UINT const * bone_order, UINT num_bones, int const * parents,
+    XMFLOAT4X4 const * to_parent_transforms, XMFLOAT3X4 const * affine_offsets,
+    XMFLOAT3X4 * affine_to_root_transforms, float * out_transforms
+) {
+    for (UINT n = 0; n < num_bones; ++n) {
+        UINT i = bone_order[n];
+        float to_root[12];
+        for (int r = 0; r < 3; ++r)
+            for (int c = 0; c < 4; ++c)
+                to_root[4 * r + c] = to_parent_transforms[i].m[c][r];
+        int parent = parents[i];
+        if (parent >= 0)
+            multiply_affine(&affine_to_root_transforms[parent].m[0][0], to_root, to_root);
+        std::copy(to_root, to_root + 12, &affine_to_root_transforms[i].m[0][0]);
+
+        float * final_transform = out_transforms + (OutputAffine ? 12 : 16) * i;
+        multiply_affine(to_root, &affine_offsets[i].m[0][0], final_transform);
+        if (!OutputAffine) {
+            final_transform[12] = final_transform[13] = final_transform[14] = 0.0f;
+            final_transform[15] = 1.0f;
+        }
+    }
+}
+
+//
+// -- kernel selection
+bool HierarchyKernelSupported (HierarchyKernel kernel) {
+    switch (kernel) {
+    case HierarchyKernel::Scalar:
+        return true;
+#ifdef HIERARCHY_KERNEL_X86
+    case HierarchyKernel::Sse2:
+        return true;
+    case HierarchyKernel::Avx2Fma: {
+        static bool const supported = [] {
+#ifdef _MSC_VER
+            // -- AVX and FMA (leaf 1 ecx), their registers enabled by the OS (xgetbv), AVX2 (leaf 7 ebx)
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7)
+                return false;
+            __cpuid(info, 1);
+            int const fma_osxsave_avx = (1 << 12) | (1 << 27) | (1 << 28);
+            if ((info[2] & fma_osxsave_avx) != fma_osxsave_avx || (_xgetbv(0) & 6) != 6)
+                return false;
+            __cpuidex(info, 7, 0);
+            return 0 != (info[1] & (1 << 5));
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+        }();
+        return supported;
+    }
+#endif
+    default:
+        return false;
+    }
+}
+HierarchyKernel BestHierarchyKernel () {
+    static HierarchyKernel const best =
+        HierarchyKernelSupported(HierarchyKernel::Avx2Fma) ? HierarchyKernel::Avx2Fma :
+        HierarchyKernelSupported(HierarchyKernel::Sse2) ? HierarchyKernel::Sse2 : HierarchyKernel::Scalar;
+    return best;
+}
+char const * HierarchyKernelName (HierarchyKernel kernel) {
+    static char const * const names [] = {"scalar", "sse2", "avx2_fma"};
+    return names[(UINT)kernel];
+}
+
+void ConcatenateBoneHierarchy (
+    UINT const * bone_order, UINT num_bones,
+    int const * parents,
+    DirectX::XMFLOAT4X4 const * to_parent_transforms,
+    DirectX::XMFLOAT3X4 const * affine_offsets,
+    DirectX::XMFLOAT3X4 * affine_to_root_transforms,
+    DirectX::XMFLOAT4X4 * out_transposed_transforms,
+    DirectX::XMFLOAT3X4 * out_affine_transforms,
+    HierarchyKernel kernel
+) {
+    if (0 == num_bones)
+        return;
+    bool output_affine = nullptr != out_affine_transforms;
+    float * out_transforms = output_affine ? &out_affine_transforms[0].m[0][0] : &out_transposed_transforms[0].m[0][0];
+#ifdef HIERARCHY_KERNEL_X86
+    float const * to_parent = &to_parent_transforms[0].m[0][0];
+    float const * offsets = &affine_offsets[0].m[0][0];
+    float * to_root = &affine_to_root_transforms[0].m[0][0];
+    if (HierarchyKernel::Avx2Fma == kernel) {
+        concatenate_hierarchy_avx2(bone_order, num_bones, parents, to_parent, offsets, to_root, out_transforms, output_affine);
+        return;
+    }
+    if (HierarchyKernel::Sse2 == kernel) {
+        if (output_affine)
+            concatenate_simd<true>(bone_order, num_bones, parents, to_parent, offsets, to_root, out_transforms);
+        else
+            concatenate_simd<false>(bone_order, num_bones, parents, to_parent, offsets, to_root, out_transforms);
+        return;
+    }
+#endif
+    if (output_affine)
+        concatenate_scalar<true>(bone_order, num_bones, parents, to_parent_transforms, affine_offsets, affine_to_root_transforms, out_transforms);
+    else
+        concatenate_scalar<false>(bone_order, num_bones, parents, to_parent_transforms, affine_offsets, affine_to_root_transforms, out_transforms);
+}
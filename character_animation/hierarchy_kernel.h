@@ -0,0 +1,35 @@
+#pragma once
+
+#include "../common/core_types.h"
+
+//
+// -- The hierarchy pass of SkinnedData::GetFinalTransforms in one loop over the bones, parents first:
+// -- to-root transform = to-parent transform * to-root transform of the parent, final transform = offset * to-root.
+// -- Every transform is affine, so the offsets, the to-root transforms and the 3x4 output are kept as the
+// -- first three rows of their transpose (what XMStoreFloat3x4 writes): 12 floats and 9 multiply-adds
+// -- per product instead of 16 and 16. Runs on AVX2/FMA or SSE2 when the CPU has them, on plain floats otherwise
+enum class HierarchyKernel {
+    Scalar,
+    Sse2,
+    Avx2Fma
+};
+
+bool HierarchyKernelSupported (HierarchyKernel kernel);
+// -- fastest kernel the CPU supports, detected once
+HierarchyKernel BestHierarchyKernel ();
+char const * HierarchyKernelName (HierarchyKernel kernel);
+
+// -- bone_order holds num_bones bone indices with parents before their children (e.g. the bones of a bone LOD),
+// -- to_parent_transforms are the sampled local transforms (row vector 4x4, last column (0, 0, 0, 1)).
+// -- Writes affine_to_root_transforms and exactly one of the outputs (the other is null) for the bones in bone_order,
+// -- kernel has to be supported
+void ConcatenateBoneHierarchy (
+    UINT const * bone_order, UINT num_bones,
+    int const * parents,
+    DirectX::XMFLOAT4X4 const * to_parent_transforms,
+    DirectX::XMFLOAT3X4 const * affine_offsets,
+    DirectX::XMFLOAT3X4 * affine_to_root_transforms,
+    DirectX::XMFLOAT4X4 * out_transposed_transforms,
+    DirectX::XMFLOAT3X4 * out_affine_transforms,
+    HierarchyKernel kernel = BestHierarchyKernel()
+);
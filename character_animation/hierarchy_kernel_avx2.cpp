@@ -0,0 +1,20 @@
+// -- the AVX2/FMA build of the SSE kernel, compiled with AVX2 and FMA enabled (-mavx2 -mfma, /arch:AVX2)
+// -- and only called when the CPU has them. Includes nothing but the kernel, see hierarchy_kernel_simd.h
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#if !defined(__AVX2__)
+#error "hierarchy_kernel_avx2.cpp must be compiled with AVX2 and FMA enabled"
+#endif
+
+#include "hierarchy_kernel_simd.h"
+
+void concatenate_hierarchy_avx2 (
+    unsigned const * bone_order, unsigned num_bones, int const * parents,
+    float const * to_parent_transforms, float const * affine_offsets,
+    float * affine_to_root_transforms, float * out_transforms, bool output_affine
+) {
+    if (output_affine)
+        concatenate_simd<true>(bone_order, num_bones, parents, to_parent_transforms, affine_offsets, affine_to_root_transforms, out_transforms);
+    else
+        concatenate_simd<false>(bone_order, num_bones, parents, to_parent_transforms, affine_offsets, affine_to_root_transforms, out_transforms);
+}
+#endif
@@ -0,0 +1,78 @@
+#pragma once
+
+// -- SSE body of ConcatenateBoneHierarchy, compiled once per instruction set by hierarchy_kernel.cpp (SSE2)
+// -- and hierarchy_kernel_avx2.cpp (AVX2/FMA). Only intrinsics and internal linkage in here: an inline function
+// -- shared with the rest of the program and compiled for AVX2 could be the copy the linker keeps
+#include <immintrin.h>
+
+namespace {
+
+// -- first three rows of the transpose of an affine transform, the fourth is (0, 0, 0, 1)
+struct AffineRows {
+    __m128 R0, R1, R2;
+};
+
+inline __m128 multiply_add (__m128 a, __m128 b, __m128 c) {
+#if defined(__FMA__) || defined(__AVX2__)
+    return _mm_fmadd_ps(a, b, c);
+#else
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+}
+template <int I>
+inline __m128 splat (__m128 v) {
+    return _mm_shuffle_ps(v, v, _MM_SHUFFLE(I, I, I, I));
+}
+inline AffineRows load_affine (float const * m) {
+    return {_mm_loadu_ps(m), _mm_loadu_ps(m + 4), _mm_loadu_ps(m + 8)};
+}
+// -- rows of the transpose of a row vector 4x4 with last column (0, 0, 0, 1)
+inline AffineRows load_transposed (float const * m) {
+    __m128 r0 = _mm_loadu_ps(m), r1 = _mm_loadu_ps(m + 4), r2 = _mm_loadu_ps(m + 8), r3 = _mm_loadu_ps(m + 12);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    return {r0, r1, r2};
+}
+inline void store_affine (float * m, AffineRows const & rows) {
+    _mm_storeu_ps(m, rows.R0);
+    _mm_storeu_ps(m + 4, rows.R1);
+    _mm_storeu_ps(m + 8, rows.R2);
+}
+// -- row of a * b for transposed affine a and b (the transpose of b * a in row vector form):
+// -- a_row.x * b.R0 + a_row.y * b.R1 + a_row.z * b.R2 + a_row.w * (0, 0, 0, 1)
+inline __m128 multiply_row (__m128 a_row, AffineRows const & b, __m128 w_mask) {
+    __m128 row = _mm_add_ps(_mm_mul_ps(splat<0>(a_row), b.R0), _mm_and_ps(a_row, w_mask));
+    row = multiply_add(splat<1>(a_row), b.R1, row);
+    return multiply_add(splat<2>(a_row), b.R2, row);
+}
+inline AffineRows multiply (AffineRows const & a, AffineRows const & b, __m128 w_mask) {
+    return {multiply_row(a.R0, b, w_mask), multiply_row(a.R1, b, w_mask), multiply_row(a.R2, b, w_mask)};
+}
+
+// -- OutputAffine: 12 floats per output (3x4), else 16 (transposed 4x4)
+template <bool OutputAffine>
+void concatenate_simd (
+    unsigned const * bone_order, unsigned num_bones, int const * parents,
+    float const * to_parent_transforms, float const * affine_offsets,
+    float * affine_to_root_transforms, float * out_transforms
+) {
+    __m128 const w_mask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+    __m128 const last_row = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+    for (unsigned n = 0; n < num_bones; ++n) {
+        unsigned i = bone_order[n];
+        AffineRows to_root = load_transposed(to_parent_transforms + 16 * i);
+        int parent = parents[i];
+        if (parent >= 0)
+            to_root = multiply(load_affine(affine_to_root_transforms + 12 * parent), to_root, w_mask);
+        store_affine(affine_to_root_transforms + 12 * i, to_root);
+
+        AffineRows final_transform = multiply(to_root, load_affine(affine_offsets + 12 * i), w_mask);
+        if (OutputAffine) {
+            store_affine(out_transforms + 12 * i, final_transform);
+        } else {
+            store_affine(out_transforms + 16 * i, final_transform);
+            _mm_storeu_ps(out_transforms + 16 * i + 12, last_row);
+        }
+    }
+}
+
+}
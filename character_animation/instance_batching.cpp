@@ -0,0 +1,65 @@
+#include "instance_batching.h"
+
+using namespace DirectX;
+
+size_t InstanceBatcher::BatchKeyHash::operator() (BatchKey const & key) const {
+    size_t h = std::hash<void const *>()(key.Geometry);
+    h = h * 31 + key.IndexCount;
+    h = h * 31 + key.StartIndexLocation;
+    h = h * 31 + (UINT)key.BaseVertexLocation;
+    h = h * 31 + key.IndexFormat;
+    h = h * 31 + key.MaterialIndex;
+    return h;
+}
+
+void InstanceBatcher::Build (
+    InstanceDrawItem const * items, UINT num_items,
+    std::vector<InstanceBatch> & out_batches,
+    InstanceData * out_instances
+) {
+    out_batches.clear();
+    batch_lookup_.clear();
+    item_batches_.resize(num_items);
+
+    //
+    // -- batch of every item and instance count of every batch
+    for (UINT i = 0; i < num_items; ++i) {
+        InstanceDrawItem const & item = items[i];
+        BatchKey key = {
+            item.Geometry, item.IndexCount, item.StartIndexLocation, item.BaseVertexLocation, item.IndexFormat, item.MaterialIndex
+        };
+        auto it = batch_lookup_.find(key);
+        if (batch_lookup_.end() == it) {
+            it = batch_lookup_.emplace(key, (UINT)out_batches.size()).first;
+
+            InstanceBatch batch;
+            batch.Geometry = item.Geometry;
+            batch.IndexCount = item.IndexCount;
+            batch.StartIndexLocation = item.StartIndexLocation;
+            batch.BaseVertexLocation = item.BaseVertexLocation;
+            batch.IndexFormat = item.IndexFormat;
+            batch.MaterialIndex = item.MaterialIndex;
+            out_batches.push_back(batch);
+        }
+        item_batches_[i] = it->second;
+        ++out_batches[it->second].InstanceCount;
+    }
+
+    //
+    // -- instances of batch b start where the instances of batch b - 1 end
+    UINT first_instance = 0;
+    batch_cursors_.resize(out_batches.size());
+    for (UINT b = 0; b < (UINT)out_batches.size(); ++b) {
+        out_batches[b].FirstInstance = first_instance;
+        batch_cursors_[b] = first_instance;
+        first_instance += out_batches[b].InstanceCount;
+    }
+
+    for (UINT i = 0; i < num_items; ++i) {
+        InstanceDrawItem const & item = items[i];
+        InstanceData & instance = out_instances[batch_cursors_[item_batches_[i]]++];
+        XMStoreFloat4x4(&instance.World, XMMatrixTranspose(XMLoadFloat4x4(&item.World)));
+        instance.MaterialIndex = item.MaterialIndex;
+        instance.PaletteOffset = item.PaletteOffset;
+    }
+}
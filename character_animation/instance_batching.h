@@ -0,0 +1,80 @@
+#pragma once
+
+#include "../common/core_types.h"
+
+//
+// -- Per-instance data of an instanced draw, same layout as InstanceData in common.hlsl
+struct InstanceData {
+    DirectX::XMFLOAT4X4 World = MathHelper::Identity4x4();  // transposed for the shader, like ObjectConstants::World
+    UINT MaterialIndex = 0;
+    UINT PaletteOffset = 0;     // first bone of the instance in the shared bone palette
+    UINT InstPad0;
+    UINT InstPad1;
+};
+
+//
+// -- One item to draw (e.g. one render item of a skinned model instance). Items with the same geometry,
+// -- draw arguments and material end up in one batch
+struct InstanceDrawItem {
+    void const * Geometry = nullptr;    // opaque, compared by address (e.g. a MeshGeometry *)
+    UINT IndexCount = 0;
+    UINT StartIndexLocation = 0;
+    int BaseVertexLocation = 0;
+    UINT IndexFormat = 0;               // opaque, compared by value (e.g. a DXGI_FORMAT)
+    UINT MaterialIndex = 0;
+
+    UINT PaletteOffset = 0;
+    DirectX::XMFLOAT4X4 World = MathHelper::Identity4x4();
+};
+
+// -- one DrawIndexedInstanced: InstanceCount instances starting at FirstInstance of the instance data
+struct InstanceBatch {
+    void const * Geometry = nullptr;
+    UINT IndexCount = 0;
+    UINT StartIndexLocation = 0;
+    int BaseVertexLocation = 0;
+    UINT IndexFormat = 0;
+    UINT MaterialIndex = 0;
+
+    UINT FirstInstance = 0;
+    UINT InstanceCount = 0;
+};
+
+//
+// -- Groups draw items into instanced batches and lays out their instance data batch after batch.
+// -- Batches come out in the order their first item appears and items keep their order inside a batch,
+// -- the grouping is a hash lookup and a counting sort so a build is linear in the number of items.
+// -- No graphics API dependency, the caller copies (or directly writes) the instance data to the GPU
+class InstanceBatcher {
+private:
+    struct BatchKey {
+        void const * Geometry;
+        UINT IndexCount;
+        UINT StartIndexLocation;
+        int BaseVertexLocation;
+        UINT IndexFormat;
+        UINT MaterialIndex;
+
+        bool operator== (BatchKey const & rhs) const {
+            return Geometry == rhs.Geometry && IndexCount == rhs.IndexCount &&
+                StartIndexLocation == rhs.StartIndexLocation && BaseVertexLocation == rhs.BaseVertexLocation &&
+                IndexFormat == rhs.IndexFormat && MaterialIndex == rhs.MaterialIndex;
+        }
+    };
+    struct BatchKeyHash {
+        size_t operator() (BatchKey const & key) const;
+    };
+
+    // -- scratch reused by every Build
+    std::unordered_map<BatchKey, UINT, BatchKeyHash> batch_lookup_;
+    std::vector<UINT> item_batches_;
+    std::vector<UINT> batch_cursors_;
+
+public:
+    // -- out_instances must hold num_items entries, out_batches is overwritten
+    void Build (
+        InstanceDrawItem const * items, UINT num_items,
+        std::vector<InstanceBatch> & out_batches,
+        InstanceData * out_instances
+    );
+};
@@ -0,0 +1,210 @@
+#include "inverse_kinematics.h"
+
+using namespace DirectX;
+
+constexpr UINT IkChain::MaxLinks;
+
+// -- root space transform of bone: its local transform concatenated up the hierarchy
+static XMMATRIX to_root_transform (int bone, int const * bone_hierarchy, XMFLOAT4X4 const * to_parent_transforms) {
+    XMMATRIX to_root = XMMatrixIdentity();
+    for (; bone >= 0; bone = bone_hierarchy[bone])
+        to_root = XMMatrixMultiply(to_root, XMLoadFloat4x4(&to_parent_transforms[bone]));
+    return to_root;
+}
+// -- any direction perpendicular to v
+static XMVECTOR perpendicular (FXMVECTOR v) {
+    XMVECTOR axis = fabsf(XMVectorGetX(v)) < fabsf(XMVectorGetY(v)) ?
+        XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+    return XMVector3Cross(v, axis);
+}
+// -- shortest arc rotation turning direction from onto direction to, identity if either is degenerate.
+// -- Half-way form (axis scaled by sin, |from| |to| + cos for w, then normalized): no trigonometry
+static XMVECTOR rotation_between (FXMVECTOR from, FXMVECTOR to) {
+    XMVECTOR axis = XMVector3Cross(from, to);
+    float sin_scaled = XMVectorGetX(XMVector3Length(axis));
+    float cos_scaled = XMVectorGetX(XMVector3Dot(from, to));
+    float length_product = sqrtf(XMVectorGetX(XMVector3LengthSq(from)) * XMVectorGetX(XMVector3LengthSq(to)));
+    if (sin_scaled > 1e-6f * length_product)
+        return XMQuaternionNormalize(XMVectorSetW(axis, length_product + cos_scaled));
+    if (cos_scaled < 0.0f)
+        return XMQuaternionRotationAxis(perpendicular(from), MathHelper::PI);
+    return XMQuaternionIdentity();
+}
+// -- root space rotation q about pivot
+static XMMATRIX rotation_about (FXMVECTOR q, FXMVECTOR pivot) {
+    XMMATRIX m = XMMatrixRotationQuaternion(q);
+    m.r[3] = XMVectorSetW(XMVectorSubtract(pivot, XMVector3TransformNormal(pivot, m)), 1.0f);
+    return m;
+}
+// -- inverse of an affine transform (last column (0, 0, 0, 1)): the 3x3 part inverted from cross products,
+// -- a third of the work of XMMatrixInverse
+static XMMATRIX inverse_affine (FXMMATRIX m) {
+    XMVECTOR c0 = XMVector3Cross(m.r[1], m.r[2]);
+    XMVECTOR c1 = XMVector3Cross(m.r[2], m.r[0]);
+    XMVECTOR c2 = XMVector3Cross(m.r[0], m.r[1]);
+    XMVECTOR inv_det = XMVectorReciprocal(XMVector3Dot(m.r[0], c0));
+    XMMATRIX inverse = XMMatrixTranspose(XMMATRIX(
+        XMVectorMultiply(c0, inv_det), XMVectorMultiply(c1, inv_det), XMVectorMultiply(c2, inv_det), XMVectorZero()
+    ));
+    inverse.r[3] = XMVectorSetW(XMVectorNegate(XMVector3TransformNormal(m.r[3], inverse)), 1.0f);
+    return inverse;
+}
+
+//
+// -- Solvers move the joint positions of the chain (positions[n] is the tip) and keep bone lengths,
+// -- positions[0] never moves
+static void solve_two_bone (IkChain const & chain, FXMVECTOR target, XMVECTOR positions[3]) {
+    XMVECTOR pa = positions[0];
+    XMVECTOR pb = positions[1];
+    XMVECTOR pc = positions[2];
+
+    float lab = XMVectorGetX(XMVector3Length(XMVectorSubtract(pb, pa)));
+    float lcb = XMVectorGetX(XMVector3Length(XMVectorSubtract(pc, pb)));
+    if (lab <= 0.0f || lcb <= 0.0f)
+        return;
+
+    // -- bend the middle joint so the tip ends up as far from the chain root as the target (clamped to reach)
+    float lat = XMVectorGetX(XMVector3Length(XMVectorSubtract(target, pa)));
+    lat = MathHelper::Clamp(lat, fabsf(lab - lcb) * 1.0001f, (lab + lcb) * 0.9999f);
+
+    XMVECTOR bc = XMVectorSubtract(pc, pb);
+    XMVECTOR ba = XMVectorSubtract(pa, pb);
+    float cos_b0 = XMVectorGetX(XMVector3Dot(ba, bc)) / (lab * lcb);
+    float cos_b1 = (lab * lab + lcb * lcb - lat * lat) / (2.0f * lab * lcb);
+    float bend = acosf(MathHelper::Clamp(cos_b0, -1.0f, 1.0f)) - acosf(MathHelper::Clamp(cos_b1, -1.0f, 1.0f));
+
+    // -- rotating bc about bc x ba turns it toward ba; a straight limb bends toward the pole (or any side)
+    XMVECTOR bend_axis = XMVector3Cross(bc, ba);
+    if (XMVectorGetX(XMVector3LengthSq(bend_axis)) <= 1e-12f * lab * lab * lcb * lcb) {
+        bend_axis = XMVector3Cross(bc, XMLoadFloat3(&chain.PoleVector));
+        if (XMVectorGetX(XMVector3LengthSq(bend_axis)) <= 1e-12f * lcb * lcb)
+            bend_axis = perpendicular(bc);
+    }
+    pc = XMVectorAdd(pb, XMVector3Rotate(bc, XMQuaternionRotationAxis(bend_axis, bend)));
+
+    // -- swing the whole limb about its root onto the target
+    XMVECTOR swing = rotation_between(XMVectorSubtract(pc, pa), XMVectorSubtract(target, pa));
+    pb = XMVectorAdd(pa, XMVector3Rotate(XMVectorSubtract(pb, pa), swing));
+    pc = XMVectorAdd(pa, XMVector3Rotate(XMVectorSubtract(pc, pa), swing));
+
+    // -- twist the limb about the root to tip line so the middle joint points toward the pole
+    XMVECTOR pole = XMLoadFloat3(&chain.PoleVector);
+    if (XMVectorGetX(XMVector3LengthSq(pole)) > 0.0f) {
+        XMVECTOR axis = XMVector3Normalize(XMVectorSubtract(pc, pa));
+        XMVECTOR knee = XMVectorSubtract(pb, pa);
+        float twist = atan2f(
+            XMVectorGetX(XMVector3Dot(XMVector3Cross(knee, pole), axis)),
+            XMVectorGetX(XMVector3Dot(XMVector3Cross(axis, knee), XMVector3Cross(axis, pole)))
+        );
+        pb = XMVectorAdd(pa, XMVector3Rotate(knee, XMQuaternionRotationNormal(axis, twist)));
+    }
+
+    positions[1] = pb;
+    positions[2] = pc;
+}
+// -- point at distance length from anchor on the line to toward, one square root per joint of a FABRIK pass
+static XMVECTOR place_joint (FXMVECTOR anchor, FXMVECTOR toward, float length) {
+    XMVECTOR direction = XMVectorSubtract(toward, anchor);
+    float length_sq = XMVectorGetX(XMVector3LengthSq(direction));
+    if (length_sq <= 0.0f)
+        return toward;
+    return XMVectorMultiplyAdd(direction, XMVectorReplicate(length / sqrtf(length_sq)), anchor);
+}
+static void solve_fabrik (IkChain const & chain, FXMVECTOR target, XMVECTOR * positions, UINT n) {
+    float lengths[IkChain::MaxLinks];
+    float total_length = 0.0f;
+    for (UINT k = 0; k < n; ++k) {
+        lengths[k] = XMVectorGetX(XMVector3Length(XMVectorSubtract(positions[k + 1], positions[k])));
+        total_length += lengths[k];
+    }
+
+    XMVECTOR root = positions[0];
+    XMVECTOR to_target = XMVectorSubtract(target, root);
+    if (XMVectorGetX(XMVector3Length(to_target)) >= total_length) {
+        // -- out of reach: stretch the chain toward the target
+        XMVECTOR direction = XMVector3Normalize(to_target);
+        for (UINT k = 0; k < n; ++k)
+            positions[k + 1] = XMVectorMultiplyAdd(direction, XMVectorReplicate(lengths[k]), positions[k]);
+        return;
+    }
+
+    float tolerance_sq = chain.Tolerance * chain.Tolerance;
+    for (UINT iteration = 0; iteration < chain.MaxIterations; ++iteration) {
+        if (XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(positions[n], target))) <= tolerance_sq)
+            break;
+
+        // -- backward: pin the tip to the target and pull the joints after it
+        positions[n] = target;
+        for (UINT k = n; k-- > 0; )
+            positions[k] = place_joint(positions[k + 1], positions[k], lengths[k]);
+        // -- forward: pin the chain root back in place and push the joints after it
+        positions[0] = root;
+        for (UINT k = 0; k < n; ++k)
+            positions[k + 1] = place_joint(positions[k], positions[k + 1], lengths[k]);
+    }
+}
+
+void SolveIkChain (
+    IkChain const & chain,
+    int const * bone_hierarchy,
+    DirectX::XMFLOAT4X4 * to_parent_transforms
+) {
+    if (chain.Weight <= 0.0f)
+        return;
+
+    //
+    // -- collect the chain back to front, chain_bones[0] is the topmost rotated bone and chain_bones[n] the tip
+    UINT num_links = IkSolver::TwoBone == chain.Solver ? 2 : MathHelper::Min(chain.NumLinks, IkChain::MaxLinks);
+    int bones[IkChain::MaxLinks + 1];
+    UINT n = 0;
+    bones[IkChain::MaxLinks] = (int)chain.TipBone;
+    for (int parent = bone_hierarchy[chain.TipBone]; n < num_links && parent >= 0; parent = bone_hierarchy[parent])
+        bones[IkChain::MaxLinks - ++n] = parent;
+    if (n < num_links && (IkSolver::TwoBone == chain.Solver || 0 == n))
+        return;
+    int const * chain_bones = bones + IkChain::MaxLinks - n;
+
+    //
+    // -- root space transforms of the chain
+    XMMATRIX parent_to_root = to_root_transform(bone_hierarchy[chain_bones[0]], bone_hierarchy, to_parent_transforms);
+    XMMATRIX tip_to_root = parent_to_root;
+    XMVECTOR positions[IkChain::MaxLinks + 1];
+    for (UINT k = 0; k <= n; ++k) {
+        tip_to_root = XMMatrixMultiply(XMLoadFloat4x4(&to_parent_transforms[chain_bones[k]]), tip_to_root);
+        positions[k] = tip_to_root.r[3];
+    }
+
+    XMVECTOR target = XMVectorLerp(positions[n], XMVectorSetW(XMLoadFloat3(&chain.Target), 1.0f), chain.Weight);
+    if (IkSolver::TwoBone == chain.Solver)
+        solve_two_bone(chain, target, positions);
+    else
+        solve_fabrik(chain, target, positions, n);
+
+    //
+    // -- top down, turn every bone so its child lands on the solved position and store it relative to its parent
+    XMMATRIX parent = parent_to_root;
+    // -- root space rotation the chain bones added on top of the animated pose, carried down to the tip
+    XMVECTOR chain_rotation = XMQuaternionIdentity();
+    for (UINT k = 0; k < n; ++k) {
+        XMFLOAT4X4 & to_parent = to_parent_transforms[chain_bones[k]];
+        XMMATRIX to_root = XMMatrixMultiply(XMLoadFloat4x4(&to_parent), parent);
+        XMVECTOR pivot = to_root.r[3];
+        XMVECTOR child = XMVector3Transform(XMLoadFloat3((XMFLOAT3 const *)&to_parent_transforms[chain_bones[k + 1]].m[3]), to_root);
+
+        XMVECTOR q = rotation_between(XMVectorSubtract(child, pivot), XMVectorSubtract(positions[k + 1], pivot));
+        to_root = XMMatrixMultiply(to_root, rotation_about(q, pivot));
+        XMStoreFloat4x4(&to_parent, XMMatrixMultiply(to_root, inverse_affine(parent)));
+        parent = to_root;
+        chain_rotation = XMQuaternionMultiply(chain_rotation, q);
+    }
+    if (chain.KeepTipRotation) {
+        // -- undo the rotation the tip inherited from the chain by Weight, 1 restores its animated root space rotation
+        XMFLOAT4X4 & to_parent = to_parent_transforms[chain_bones[n]];
+        XMMATRIX to_root = XMMatrixMultiply(XMLoadFloat4x4(&to_parent), parent);
+        XMVECTOR undo = XMQuaternionConjugate(chain_rotation);
+        if (chain.Weight < 1.0f)
+            undo = XMQuaternionSlerp(XMQuaternionIdentity(), undo, chain.Weight);
+        to_root = XMMatrixMultiply(to_root, rotation_about(undo, to_root.r[3]));
+        XMStoreFloat4x4(&to_parent, XMMatrixMultiply(to_root, inverse_affine(parent)));
+    }
+}
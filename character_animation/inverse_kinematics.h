@@ -0,0 +1,46 @@
+#pragma once
+
+#include "../common/core_types.h"
+
+enum class IkSolver : BYTE {
+    TwoBone = 0,    // analytic, rotates the tip's parent and grandparent (e.g. thigh and shin for a foot)
+    Fabrik          // iterative (forward and backward reaching), rotates NumLinks ancestors of the tip
+};
+
+//
+// -- One IK chain: the TipBone ancestors are rotated so that TipBone reaches Target.
+// -- Positions are in root (model) space, the space of SkinnedData::GetFinalTransforms before the world matrix
+struct IkChain {
+    // -- longest chain a FABRIK solve handles (bones above the tip)
+    static constexpr UINT MaxLinks = 15;
+
+    IkSolver Solver = IkSolver::TwoBone;
+    UINT TipBone = 0;
+    // -- bones above TipBone that rotate, TwoBone always uses 2. FABRIK costs about 0.2 us plus 0.3 us per link
+    // -- (BM_FabrikIk, converged within MaxIterations): chains of up to 4 links fit the 2 us per instance IK budget,
+    // -- longer ones (spines, tails) should run on fewer instances or at a lower animation LOD
+    UINT NumLinks = 2;
+
+    DirectX::XMFLOAT3 Target = {0.0f, 0.0f, 0.0f};
+    // -- TwoBone: root space direction the middle joint (e.g. the knee) bends toward,
+    // -- (0,0,0) keeps the bend plane of the animated pose
+    DirectX::XMFLOAT3 PoleVector = {0.0f, 0.0f, 0.0f};
+    // -- 0 keeps the animated pose, 1 moves the tip onto Target
+    float Weight = 1.0f;
+    // -- keep the animated root space rotation of TipBone instead of turning it with its parent
+    // -- (a planted foot stays flat), blended by Weight like the tip position
+    bool KeepTipRotation = true;
+
+    // -- Fabrik: stop when the tip is within Tolerance (model units) of Target or after MaxIterations
+    UINT MaxIterations = 10;
+    float Tolerance = 1e-3f;
+};
+
+// -- rewrite to_parent_transforms of the ancestors of chain.TipBone (and of TipBone itself if KeepTipRotation)
+// -- so the tip reaches chain.Target, bone_hierarchy gives the parent of every bone (-1 for roots).
+// -- Works on the stack only, a call costs a few hierarchy walks and one matrix inverse per rotated bone
+void SolveIkChain (
+    IkChain const & chain,
+    int const * bone_hierarchy,
+    DirectX::XMFLOAT4X4 * to_parent_transforms
+);
@@ -1,15 +1,81 @@
 #include "load_m3d.h"
+#include "m3d_binary.h"
+#include "../common/job_system.h"
+#include "../common/mapped_file.h"
+
+#include <limits.h>
 
 using namespace DirectX;
 
+// -- whitespace separated tokens per record of the text sections, labels included
+static UINT const material_tokens = 20;
+static UINT const subset_tokens = 10;
+static UINT const vertex_tokens = 16;
+static UINT const skinned_vertex_tokens = 26;
+static UINT const bone_offset_tokens = 17;
+static UINT const bone_parent_tokens = 2;
+static UINT const clip_min_tokens = 4;
+
+// -- fewest tokens a text file with these header counts can have after its header
+static uint64_t min_tokens (UINT num_mats, UINT num_vertices, UINT vertex_record_tokens, UINT num_tris, UINT num_bones, UINT num_clips) {
+    return (uint64_t)num_mats * (material_tokens + subset_tokens) +
+        (uint64_t)num_vertices * vertex_record_tokens + (uint64_t)num_tris * 3 +
+        (uint64_t)num_bones * (bone_offset_tokens + bone_parent_tokens) + (uint64_t)num_clips * clip_min_tokens;
+}
+
+// -- out of range bone indices become 255 so validation reports them instead of them wrapping around to a valid bone
+static BYTE bone_index_byte (int bone_index) {
+    return bone_index < 0 || bone_index > 255 ? 255 : (BYTE)bone_index;
+}
+// -- lay out the validated source indices subset by subset (see M3DLoader::Subset): rebased to the lowest vertex
+// -- of the subset, 16-bit where the rest fits, every subset and the end 4-byte aligned
+static void pack_indices (std::vector<UINT> const & indices, std::vector<M3DLoader::Subset> & subsets, std::vector<BYTE> & out_indices) {
+    out_indices.clear();
+    for (M3DLoader::Subset & subset : subsets) {
+        UINT const * first = indices.data() + (size_t)subset.FaceStart * 3;
+        UINT const * last = first + (size_t)subset.FaceCount * 3;
+        UINT min_index = 0;
+        UINT max_index = 0;
+        if (first != last) {
+            auto min_max = std::minmax_element(first, last);
+            min_index = *min_max.first;
+            max_index = *min_max.second;
+        }
+        subset.BaseVertex = min_index;
+        subset.IndexSize = max_index - min_index <= USHRT_MAX ? sizeof(USHORT) : sizeof(UINT);
+        subset.IndexByteOffset = (UINT)(out_indices.size() + 3) / 4 * 4;
+        out_indices.resize(subset.IndexByteOffset + (last - first) * subset.IndexSize);
+
+        BYTE * out = out_indices.data() + subset.IndexByteOffset;
+        if (sizeof(USHORT) == subset.IndexSize) {
+            USHORT * out_index = reinterpret_cast<USHORT *>(out);
+            for (UINT const * index = first; index != last; ++index)
+                *out_index++ = (USHORT)(*index - min_index);
+        } else {
+            UINT * out_index = reinterpret_cast<UINT *>(out);
+            for (UINT const * index = first; index != last; ++index)
+                *out_index++ = *index - min_index;
+        }
+    }
+    out_indices.resize((out_indices.size() + 3) / 4 * 4);
+}
+
 bool M3DLoader::LoadM3D (
     std::string const & filename,
     std::vector<Vertex> & out_vertices,
-    std::vector<USHORT> & out_indices,
+    std::vector<BYTE> & out_indices,
     std::vector<Subset> & out_subsets,
     std::vector<M3DMaterial> & out_mats
 ) {
-    std::ifstream fin(filename);
+    clear_results();
+
+    // -- the whole file is parsed in place from its mapping
+    MappedFile text;
+    if (!text.Open(filename)) {
+        report(nullptr, FileSection::Header, 0, 0, "cannot open " + filename);
+        return false;
+    }
+    M3DTextReader fin(reinterpret_cast<char const *>(text.Data()), (size_t)text.Size());
 
     UINT num_mats = 0;
     UINT num_vertices = 0;
@@ -17,33 +83,52 @@ bool M3DLoader::LoadM3D (
     UINT num_bones = 0;
     UINT num_anim_clips = 0;
 
-    std::string ignore;
-    if (fin) {
-        fin >> ignore; // header text
-        fin >> ignore >> num_mats;
-        fin >> ignore >> num_vertices;
-        fin >> ignore >> num_tris;
-        fin >> ignore >> num_bones;
-        fin >> ignore >> num_anim_clips;
+    M3DTextReader::Label ignore;
+    fin >> ignore; // header text
+    fin >> ignore >> num_mats;
+    fin >> ignore >> num_vertices;
+    fin >> ignore >> num_tris;
+    fin >> ignore >> num_bones;
+    fin >> ignore >> num_anim_clips;
+    if (!parsed(fin, FileSection::Header) || !counts_fit(fin, min_tokens(num_mats, num_vertices, vertex_tokens, num_tris, 0, 0)))
+        return false;
 
-        read_materials(fin, num_mats, out_mats);
-        read_subset_table(fin, num_mats, out_subsets);
-        read_vertices(fin, num_vertices, out_vertices);
-        read_triangles(fin, num_tris, out_indices);
+    read_materials(fin, num_mats, out_mats);
+    if (!parsed(fin, FileSection::Materials))
+        return false;
+    read_subset_table(fin, num_mats, out_subsets);
+    if (!parsed(fin, FileSection::Subsets))
+        return false;
+    std::vector<XMFLOAT4X4> no_bone_offsets;
+    std::vector<int> no_bone_hierarchy;
+    std::unordered_map<std::string, AnimationClip> no_animations;
+    std::vector<UINT> indices;
+    if (!read_sections(fin, num_vertices, out_vertices, num_tris, indices, 0, no_bone_offsets, no_bone_hierarchy, 0, no_animations))
+        return false;
 
-        return true;
-    }
-    return false;
+    validate_mesh(&fin, num_vertices, indices.data(), (UINT)indices.size(), out_subsets.data(), num_mats);
+    if (!Diagnostics.empty())
+        return false;
+    pack_indices(indices, out_subsets, out_indices);
+
+    return true;
 }
 bool M3DLoader::LoadM3D (
     std::string const & filename,
     std::vector<SkinnedVertex> & out_vertices,
-    std::vector<USHORT> & out_indices,
+    std::vector<BYTE> & out_indices,
     std::vector<Subset> & out_subsets,
     std::vector<M3DMaterial> & out_mats,
     SkinnedData & out_skin_info
 ) {
-    std::ifstream fin(filename);
+    clear_results();
+
+    MappedFile text;
+    if (!text.Open(filename)) {
+        report(nullptr, FileSection::Header, 0, 0, "cannot open " + filename);
+        return false;
+    }
+    M3DTextReader fin(reinterpret_cast<char const *>(text.Data()), (size_t)text.Size());
 
     UINT num_mats = 0;
     UINT num_vertices = 0;
@@ -51,35 +136,194 @@ bool M3DLoader::LoadM3D (
     UINT num_bones = 0;
     UINT num_animation_clips = 0;
 
-    std::string ignore;
-    if (fin) {
-        fin >> ignore; // header text
-        fin >> ignore >> num_mats;
-        fin >> ignore >> num_vertices;
-        fin >> ignore >> num_tris;
-        fin >> ignore >> num_bones;
-        fin >> ignore >> num_animation_clips;
-
-        std::vector<XMFLOAT4X4> bone_offsets;
-        std::vector<int> bone_hierarchy; // list of parent indices for each bone
-        std::unordered_map<std::string, AnimationClip> animations;
-
-        read_materials(fin, num_mats, out_mats);
-        read_subset_table(fin, num_mats, out_subsets);
-        read_skinned_vertices(fin, num_vertices, out_vertices);
-        read_triangles(fin, num_tris, out_indices);
-        read_bone_offsets(fin, num_bones, bone_offsets);
-        read_bone_hierarchy(fin, num_bones, bone_hierarchy);
-        read_animation_clips(fin, num_bones, num_animation_clips, animations);
-
-        out_skin_info.Set(bone_hierarchy, bone_offsets, animations);
+    M3DTextReader::Label ignore;
+    fin >> ignore; // header text
+    fin >> ignore >> num_mats;
+    fin >> ignore >> num_vertices;
+    fin >> ignore >> num_tris;
+    fin >> ignore >> num_bones;
+    fin >> ignore >> num_animation_clips;
+    if (!parsed(fin, FileSection::Header) || !counts_fit(fin, min_tokens(
+        num_mats, num_vertices, skinned_vertex_tokens, num_tris, num_bones, num_animation_clips
+    )))
+        return false;
 
-        return true;
+    std::vector<XMFLOAT4X4> bone_offsets;
+    std::vector<int> bone_hierarchy; // list of parent indices for each bone
+    std::unordered_map<std::string, AnimationClip> animations;
+    std::vector<UINT> indices;
+
+    read_materials(fin, num_mats, out_mats);
+    if (!parsed(fin, FileSection::Materials))
+        return false;
+    read_subset_table(fin, num_mats, out_subsets);
+    if (!parsed(fin, FileSection::Subsets))
+        return false;
+    if (!read_sections(
+        fin, num_vertices, out_vertices, num_tris, indices,
+        num_bones, bone_offsets, bone_hierarchy, num_animation_clips, animations
+    ))
+        return false;
+
+    // -- SkinnedData assumes what validation checks, so nothing invalid reaches it
+    validate_mesh(&fin, num_vertices, indices.data(), (UINT)indices.size(), out_subsets.data(), num_mats);
+    validate_skinned_vertices(&fin, out_vertices.data(), num_vertices, num_bones);
+    validate_skeleton(&fin, bone_hierarchy.data(), num_bones, animations);
+    if (!Diagnostics.empty())
+        return false;
+    pack_indices(indices, out_subsets, out_indices);
+    process_animations(bone_hierarchy, bone_offsets, animations, out_skin_info);
+
+    return true;
+}
+bool M3DLoader::LoadM3D (
+    M3DBinaryFile const & file,
+    std::vector<Subset> & out_subsets,
+    std::vector<M3DMaterial> & out_mats
+) {
+    clear_results();
+    if (!file.IsOpen()) {
+        report(nullptr, FileSection::Header, 0, 0, "binary file is not open");
+        return false;
     }
-    return false;
+
+    out_mats.resize(file.MaterialCount());
+    for (UINT i = 0; i < file.MaterialCount(); ++i) {
+        M3DBinaryMaterial const & mat = file.Materials()[i];
+        out_mats[i].Name = file.String(mat.Name);
+        out_mats[i].DiffuseAlbedo = mat.DiffuseAlbedo;
+        out_mats[i].FresnelR0 = mat.FresnelR0;
+        out_mats[i].Roughness = mat.Roughness;
+        out_mats[i].AlphaClip = 0 != mat.AlphaClip;
+        out_mats[i].MaterialTypeName = file.String(mat.MaterialTypeName);
+        out_mats[i].DiffuseMapName = file.String(mat.DiffuseMapName);
+        out_mats[i].NormalMapName = file.String(mat.NormalMapName);
+    }
+    out_subsets.assign(file.Subsets(), file.Subsets() + file.MaterialCount());
+
+    // -- M3DBinaryFile::Open checked the layout, this checks the values the caller uses in place
+    validate_mesh(nullptr, file.VertexCount(), nullptr, file.IndexCount(), file.Subsets(), file.MaterialCount());
+    validate_index_data(file.VertexCount(), file.Indices(), file.IndexByteSize(), file.Subsets(), file.MaterialCount());
+    return Diagnostics.empty();
+}
+bool M3DLoader::LoadM3D (
+    M3DBinaryFile const & file,
+    std::vector<Subset> & out_subsets,
+    std::vector<M3DMaterial> & out_mats,
+    SkinnedData & out_skin_info
+) {
+    if (!LoadM3D(file, out_subsets, out_mats))
+        return false;
+    if (!file.IsSkinned()) {
+        report(nullptr, FileSection::Vertices, 0, 0, "binary file has no skinned vertices");
+        return false;
+    }
+
+    UINT num_bones = file.BoneCount();
+    std::vector<XMFLOAT4X4> bone_offsets(file.BoneOffsets(), file.BoneOffsets() + num_bones);
+    std::vector<int> bone_hierarchy(file.BoneHierarchy(), file.BoneHierarchy() + num_bones);
+
+    // -- clips are the only data copied key by key, SkinnedData packs its own copy of them anyway
+    std::unordered_map<std::string, AnimationClip> animations;
+    UINT const * keyframe_starts = file.KeyframeStarts();
+    M3DBinaryKeyframe const * keyframes = file.Keyframes();
+    for (UINT clip_index = 0; clip_index < file.ClipCount(); ++clip_index) {
+        AnimationClip & clip = animations[file.String(file.Clips()[clip_index].Name)];
+        clip.BoneAnimations.resize(num_bones);
+        for (UINT bone_index = 0; bone_index < num_bones; ++bone_index) {
+            UINT track = clip_index * num_bones + bone_index;
+            std::vector<Keyframe> & out_keyframes = clip.BoneAnimations[bone_index].Keyframes;
+            out_keyframes.resize(keyframe_starts[track + 1] - keyframe_starts[track]);
+            for (UINT i = 0; i < (UINT)out_keyframes.size(); ++i) {
+                M3DBinaryKeyframe const & key = keyframes[keyframe_starts[track] + i];
+                out_keyframes[i].TimePoint = key.TimePoint;
+                out_keyframes[i].Translation = key.Translation;
+                out_keyframes[i].Scale = key.Scale;
+                out_keyframes[i].RotationQuat = key.RotationQuat;
+            }
+        }
+    }
+
+    validate_skinned_vertices(nullptr, file.SkinnedVertices(), file.VertexCount(), num_bones);
+    validate_skeleton(nullptr, bone_hierarchy.data(), num_bones, animations);
+    if (!Diagnostics.empty())
+        return false;
+    process_animations(bone_hierarchy, bone_offsets, animations, out_skin_info);
+
+    return true;
+}
+bool M3DLoader::ConvertToBinary (std::string const & m3d_filename, std::string const & binary_filename) {
+    Diagnostics.clear();
+
+    MappedFile text;
+    if (!text.Open(m3d_filename)) {
+        report(nullptr, FileSection::Header, 0, 0, "cannot open " + m3d_filename);
+        return false;
+    }
+    M3DTextReader fin(reinterpret_cast<char const *>(text.Data()), (size_t)text.Size());
+
+    UINT num_mats = 0;
+    UINT num_vertices = 0;
+    UINT num_tris = 0;
+    UINT num_bones = 0;
+    UINT num_animation_clips = 0;
+
+    M3DTextReader::Label ignore;
+    fin >> ignore; // header text
+    fin >> ignore >> num_mats;
+    fin >> ignore >> num_vertices;
+    fin >> ignore >> num_tris;
+    fin >> ignore >> num_bones;
+    fin >> ignore >> num_animation_clips;
+    if (!parsed(fin, FileSection::Header) || !counts_fit(fin, min_tokens(
+        num_mats, num_vertices, num_bones > 0 ? skinned_vertex_tokens : vertex_tokens, num_tris, num_bones, num_animation_clips
+    )))
+        return false;
+
+    M3DContents contents;
+    std::unordered_map<std::string, AnimationClip> animations;
+    std::vector<UINT> indices;
+    read_materials(fin, num_mats, contents.Materials);
+    if (!parsed(fin, FileSection::Materials))
+        return false;
+    read_subset_table(fin, num_mats, contents.Subsets);
+    if (!parsed(fin, FileSection::Subsets))
+        return false;
+    bool sections_read = num_bones > 0 ?
+        read_sections(
+            fin, num_vertices, contents.SkinnedVertices, num_tris, indices,
+            num_bones, contents.BoneOffsets, contents.BoneHierarchy, num_animation_clips, animations
+        ) :
+        read_sections(
+            fin, num_vertices, contents.Vertices, num_tris, indices,
+            0, contents.BoneOffsets, contents.BoneHierarchy, 0, animations
+        );
+    if (!sections_read)
+        return false;
+
+    // -- a binary file is loaded without parsing, so it only gets written for a valid source
+    validate_mesh(&fin, num_vertices, indices.data(), (UINT)indices.size(), contents.Subsets.data(), num_mats);
+    if (num_bones > 0) {
+        validate_skinned_vertices(&fin, contents.SkinnedVertices.data(), num_vertices, num_bones);
+        validate_skeleton(&fin, contents.BoneHierarchy.data(), num_bones, animations);
+    }
+    if (!Diagnostics.empty())
+        return false;
+
+    pack_indices(indices, contents.Subsets, contents.Indices);
+    contents.NumTriangles = num_tris;
+    contents.Clips.assign(animations.begin(), animations.end());
+    std::sort(contents.Clips.begin(), contents.Clips.end(), [](auto const & a, auto const & b) {
+        return a.first < b.first;
+    });
+    if (!WriteM3DBinary(binary_filename, contents)) {
+        report(nullptr, FileSection::Header, 0, 0, "cannot write " + binary_filename);
+        return false;
+    }
+    return true;
 }
 void M3DLoader::read_materials (StreamRef fin, UINT num_mats, VecRef<M3DMaterial> out_mats) {
-    std::string ignore;
+    M3DTextReader::Label ignore;
     out_mats.resize(num_mats);
 
     fin >> ignore; // material header text
@@ -95,7 +339,7 @@ void M3DLoader::read_materials (StreamRef fin, UINT num_mats, VecRef<M3DMaterial
     }
 }
 void M3DLoader::read_subset_table (StreamRef fin, UINT num_subsets, VecRef<Subset> out_subsets) {
-    std::string ignore;
+    M3DTextReader::Label ignore;
     out_subsets.resize(num_subsets);
 
     fin >> ignore;  // subset header text
@@ -108,10 +352,21 @@ void M3DLoader::read_subset_table (StreamRef fin, UINT num_subsets, VecRef<Subse
     }
 }
 void M3DLoader::read_vertices (StreamRef fin, UINT num_vertices, VecRef<Vertex> out_vertices) {
-    std::string ignore;
+    M3DTextReader::Label ignore;
     out_vertices.resize(num_vertices);
 
     fin >> ignore; // vertices header text
+    read_records(fin, num_vertices, out_vertices.data());
+}
+void M3DLoader::read_vertices (StreamRef fin, UINT num_vertices, VecRef<SkinnedVertex> out_vertices) {
+    M3DTextReader::Label ignore;
+    out_vertices.resize(num_vertices);
+
+    fin >> ignore; // header text
+    read_records(fin, num_vertices, out_vertices.data());
+}
+void M3DLoader::read_records (StreamRef fin, UINT num_vertices, Vertex * out_vertices) {
+    M3DTextReader::Label ignore;
     for (UINT i = 0; i < num_vertices; ++i) {
         fin >> ignore >> out_vertices[i].Pos.x >> out_vertices[i].Pos.y >> out_vertices[i].Pos.z;
         fin >> ignore >> out_vertices[i].TangentU.x >>
@@ -119,13 +374,9 @@ void M3DLoader::read_vertices (StreamRef fin, UINT num_vertices, VecRef<Vertex>
         fin >> ignore >> out_vertices[i].Normal.x >> out_vertices[i].Normal.y >> out_vertices[i].Normal.z;
         fin >> ignore >> out_vertices[i].TexC.x >> out_vertices[i].TexC.y;
     }
-
 }
-void M3DLoader::read_skinned_vertices (StreamRef fin, UINT num_vertices, VecRef<SkinnedVertex> out_vertices) {
-    std::string ignore;
-    out_vertices.resize(num_vertices);
-
-    fin >> ignore; // header text
+void M3DLoader::read_records (StreamRef fin, UINT num_vertices, SkinnedVertex * out_vertices) {
+    M3DTextReader::Label ignore;
     int bone_indices[4];
     float weights[4];
     for (UINT i = 0; i < num_vertices; ++i) {
@@ -142,22 +393,25 @@ void M3DLoader::read_skinned_vertices (StreamRef fin, UINT num_vertices, VecRef<
         out_vertices[i].BoneWeights.y = weights[1];
         out_vertices[i].BoneWeights.z = weights[2];
 
-        out_vertices[i].BoneIndices[0] = (BYTE)bone_indices[0];
-        out_vertices[i].BoneIndices[1] = (BYTE)bone_indices[1];
-        out_vertices[i].BoneIndices[2] = (BYTE)bone_indices[2];
-        out_vertices[i].BoneIndices[3] = (BYTE)bone_indices[3];
+        out_vertices[i].BoneIndices[0] = bone_index_byte(bone_indices[0]);
+        out_vertices[i].BoneIndices[1] = bone_index_byte(bone_indices[1]);
+        out_vertices[i].BoneIndices[2] = bone_index_byte(bone_indices[2]);
+        out_vertices[i].BoneIndices[3] = bone_index_byte(bone_indices[3]);
     }
 }
-void M3DLoader::read_triangles (StreamRef fin, UINT num_tris, VecRef<USHORT> out_indices) {
-    std::string ignore;
+void M3DLoader::read_triangles (StreamRef fin, UINT num_tris, VecRef<UINT> out_indices) {
+    M3DTextReader::Label ignore;
     out_indices.resize(num_tris * 3);
 
     fin >> ignore; // header text
-    for (UINT i = 0; i < num_tris; ++i)
-        fin >> out_indices[i * 3 + 0] >> out_indices[i * 3 + 1] >> out_indices[i * 3 + 2];
+    read_records(fin, num_tris * 3, out_indices.data());
+}
+void M3DLoader::read_records (StreamRef fin, UINT num_indices, UINT * out_indices) {
+    for (UINT i = 0; i < num_indices; ++i)
+        fin >> out_indices[i];
 }
 void M3DLoader::read_bone_offsets (StreamRef fin, UINT num_bones, VecRef<DirectX::XMFLOAT4X4> out_bone_offsets) {
-    std::string ignore;
+    M3DTextReader::Label ignore;
     out_bone_offsets.resize(num_bones);
 
     fin >> ignore; // bone-offset header text
@@ -170,15 +424,15 @@ void M3DLoader::read_bone_offsets (StreamRef fin, UINT num_bones, VecRef<DirectX
     }
 }
 void M3DLoader::read_bone_hierarchy (StreamRef fin, UINT num_bones, VecRef<int> out_bone_parent_indices) {
-    std::string ignore;
+    M3DTextReader::Label ignore;
     out_bone_parent_indices.resize(num_bones);
 
     fin >> ignore;  // header test
     for (UINT i = 0; i < num_bones; ++i)
         fin >> ignore >> out_bone_parent_indices[i];
 }
-void M3DLoader::read_bone_keyframes (StreamRef fin, UINT num_bones, BoneAnimation & bone_animation) {
-    std::string ignore;
+void M3DLoader::read_bone_keyframes (StreamRef fin, BoneAnimation & bone_animation) {
+    M3DTextReader::Label ignore;
     UINT num_keyframes = 0;
     fin >> ignore >> ignore >> num_keyframes;
     fin >> ignore; // {
@@ -205,21 +459,518 @@ void M3DLoader::read_animation_clips (
     UINT num_bones, UINT num_animation_clips,
     std::unordered_map<std::string, AnimationClip> & out_animations
 ) {
-    std::string ignore;
+    M3DTextReader::Label ignore;
     fin >> ignore; // header text
     for (UINT clip_index = 0; clip_index < num_animation_clips; ++clip_index) {
         std::string clip_name;
-        fin >> ignore >> clip_name;
-
-        fin >> ignore; // {
         AnimationClip clip;
-        clip.BoneAnimations.resize(num_bones);
-        for (UINT bone_index = 0; bone_index < num_bones; ++bone_index)
-            read_bone_keyframes(fin, num_bones, clip.BoneAnimations[bone_index]);
-        fin >> ignore; // }
+        read_animation_clip(fin, num_bones, clip_name, clip);
+        out_animations[clip_name] = std::move(clip);
+    }
+}
+void M3DLoader::read_animation_clip (StreamRef fin, UINT num_bones, std::string & out_clip_name, AnimationClip & out_clip) {
+    M3DTextReader::Label ignore;
+    fin >> ignore >> out_clip_name;
 
-        out_animations[clip_name] = clip;
+    fin >> ignore; // {
+    out_clip.BoneAnimations.resize(num_bones);
+    for (UINT bone_index = 0; bone_index < num_bones; ++bone_index)
+        read_bone_keyframes(fin, out_clip.BoneAnimations[bone_index]);
+    fin >> ignore; // }
+}
+//
+// -- parallel parsing: sections are located by their header text and vertices and triangles are cut into chunks
+// -- that start where a record probably starts. A chunk parses every record starting in it, if the last one ends
+// -- inside the chunk the next chunk did start at a record and the chunks together read what the serial reader reads
+struct TextChunk {
+    char const * Begin;
+    char const * End;
+};
+static size_t const chunk_bytes = 64 * 1024;
+
+// -- start of the first token in [begin, end) containing name, end if there is none
+static char const * find_section (char const * begin, char const * end, std::string const & name) {
+    // -- headers are the only '*' runs in a file, memchr gets from one candidate to the next
+    char const * found = begin;
+    for (;; ++found) {
+        found = static_cast<char const *>(memchr(found, name[0], end - found));
+        if (nullptr == found || (size_t)(end - found) < name.size())
+            return end;
+        if (0 == memcmp(found, name.data(), name.size()))
+            break;
+    }
+    while (found != begin && !M3DTextReader::IsSpace(found[-1]))
+        --found;
+    return found;
+}
+// -- start of the first token in [begin, end) that is record_start (any token if it is empty)
+static char const * find_token (char const * begin, char const * end, std::string const & record_start) {
+    for (char const * p = begin; p < end; ++p) {
+        if (!M3DTextReader::IsSpace(p[-1]) || M3DTextReader::IsSpace(*p))
+            continue;
+        if (record_start.empty())
+            return p;
+        if ((size_t)(end - p) > record_start.size() && 0 == memcmp(p, record_start.data(), record_start.size()) &&
+            M3DTextReader::IsSpace(p[record_start.size()]))
+            return p;
+    }
+    return end;
+}
+// -- [begin, end) in chunks of about chunk_bytes that start at a record_start token,
+// -- begin has to be at whitespace (e.g. right after a header token)
+static std::vector<TextChunk> split_section (char const * begin, char const * end, std::string const & record_start) {
+    std::vector<TextChunk> chunks;
+    for (char const * p = begin; p < end;) {
+        char const * chunk_end = (size_t)(end - p) > chunk_bytes ? find_token(p + chunk_bytes, end, record_start) : end;
+        chunks.push_back({p, chunk_end});
+        p = chunk_end;
     }
+    return chunks;
 }
+// -- true if a token starts in [reader.Position(), end)
+static bool token_before (M3DTextReader const & reader, char const * end) {
+    char const * p = reader.Position();
+    while (p < end && M3DTextReader::IsSpace(*p))
+        ++p;
+    return p < end;
+}
+// -- start of every "AnimationClip name { ... }" block in [begin, end), found by matching the brace tokens
+static std::vector<char const *> find_clips (char const * begin, char const * end) {
+    std::vector<char const *> starts;
+    char const * clip_start = begin;
+    int depth = 0;
+    // -- memchr skips the keyframe lines in between much faster than looking at every character
+    auto find_char = [end](char const * from, char c) {
+        void const * found = memchr(from, c, end - from);
+        return found ? static_cast<char const *>(found) : end;
+    };
+    char const * open = find_char(begin, '{');
+    char const * close = find_char(begin, '}');
+    while (depth >= 0 && (open < end || close < end)) {
+        char const * p = open < close ? open : close;
+        if (open < close)
+            open = find_char(open + 1, '{');
+        else
+            close = find_char(close + 1, '}');
+        if (!M3DTextReader::IsSpace(p[-1]) || (p + 1 < end && !M3DTextReader::IsSpace(p[1])))
+            continue;
+        if ('{' == *p) {
+            ++depth;
+        } else if (0 == --depth) {
+            starts.push_back(clip_start);
+            clip_start = p + 1;
+        }
+    }
+    return starts;
+}
+
+template <typename VertexT>
+bool M3DLoader::read_sections_parallel (
+    StreamRef fin,
+    UINT num_vertices, VecRef<VertexT> out_vertices,
+    UINT num_tris, VecRef<UINT> out_indices,
+    UINT num_bones, VecRef<DirectX::XMFLOAT4X4> out_bone_offsets, VecRef<int> out_bone_parent_indices,
+    UINT num_animation_clips, std::unordered_map<std::string, AnimationClip> & out_animations
+) {
+    //
+    // -- phase 1: section boundaries, chunks and clips. Unskinned files end with the triangles
+    char const * text_end = fin.End();
+    char const * vertices = find_section(fin.Position(), text_end, "*Vertices*");
+    char const * triangles = find_section(vertices, text_end, "*Triangles*");
+    char const * bone_offsets = text_end;
+    char const * bone_hierarchy = text_end;
+    char const * clips = text_end;
+    if (num_bones > 0) {
+        bone_offsets = find_section(triangles, text_end, "*BoneOffsets*");
+        bone_hierarchy = find_section(bone_offsets, text_end, "*BoneHierarchy*");
+        clips = find_section(bone_hierarchy, text_end, "*AnimationClips*");
+        if (clips == text_end)
+            return false;
+    } else if (triangles == text_end) {
+        return false;
+    }
+
+    // -- readers positioned right after a section's header text
+    auto section_reader = [text_end](char const * header) {
+        M3DTextReader reader(header, text_end - header);
+        reader >> M3DTextReader::Label();
+        return reader;
+    };
+    // -- vertex chunks start at the label the first vertex starts with, indices are one token each
+    M3DTextReader vertex_records = section_reader(vertices);
+    M3DTextReader first_vertex = vertex_records;
+    std::string vertex_label;
+    first_vertex >> vertex_label;
+    std::vector<TextChunk> vertex_chunks = split_section(vertex_records.Position(), triangles, vertex_label);
+    std::vector<TextChunk> index_chunks = split_section(section_reader(triangles).Position(), bone_offsets, "");
+    std::vector<char const *> clip_starts;
+    if (num_bones > 0)
+        clip_starts = find_clips(section_reader(clips).Position(), text_end);
+    if (clip_starts.size() != num_animation_clips)
+        return false;
+
+    //
+    // -- phase 2: one task per chunk, bone section and clip
+    std::vector<std::vector<VertexT>> vertex_chunk_records(vertex_chunks.size());
+    std::vector<std::vector<UINT>> index_chunk_records(index_chunks.size());
+    out_bone_offsets.resize(num_bones);
+    out_bone_parent_indices.resize(num_bones);
+    std::vector<std::string> clip_names(num_animation_clips);
+    std::vector<AnimationClip> clip_data(num_animation_clips);
+
+    std::vector<std::function<bool()>> tasks;
+    // -- every section and clip has to be read up to where the next one starts, like the serial reader does
+    for (UINT i = 0; i < num_animation_clips; ++i) {
+        char const * clip_start = clip_starts[i];
+        char const * clip_end = i + 1 < num_animation_clips ? clip_starts[i + 1] : text_end;
+        tasks.push_back([=, &clip_names, &clip_data]() {
+            M3DTextReader reader(clip_start, text_end - clip_start);
+            read_animation_clip(reader, num_bones, clip_names[i], clip_data[i]);
+            return reader && !token_before(reader, clip_end);
+        });
+    }
+    // -- the last record of a chunk may only end in the next chunk if that did not start at a record
+    auto add_chunk_tasks = [&](std::vector<TextChunk> const & chunks, char const * section_end, auto & out_chunk_records) {
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            TextChunk chunk = chunks[i];
+            auto * out_records = &out_chunk_records[i];
+            tasks.push_back([=]() {
+                M3DTextReader reader(chunk.Begin, section_end - chunk.Begin);
+                while (reader && token_before(reader, chunk.End)) {
+                    out_records->emplace_back();
+                    read_records(reader, 1, &out_records->back());
+                }
+                return reader && reader.Position() <= chunk.End;
+            });
+        }
+    };
+    add_chunk_tasks(vertex_chunks, triangles, vertex_chunk_records);
+    add_chunk_tasks(index_chunks, bone_offsets, index_chunk_records);
+    if (num_bones > 0) {
+        tasks.push_back([&]() {
+            M3DTextReader reader(bone_offsets, bone_hierarchy - bone_offsets);
+            read_bone_offsets(reader, num_bones, out_bone_offsets);
+            M3DTextReader hierarchy_reader(bone_hierarchy, clips - bone_hierarchy);
+            read_bone_hierarchy(hierarchy_reader, num_bones, out_bone_parent_indices);
+            return reader && hierarchy_reader && !token_before(reader, bone_hierarchy) && !token_before(hierarchy_reader, clips);
+        });
+    }
+
+    std::vector<char> task_ok(tasks.size(), 0);
+    Jobs->ParallelFor((unsigned)tasks.size(), 1, [&](unsigned first, unsigned last) {
+        for (unsigned i = first; i < last; ++i)
+            task_ok[i] = tasks[i]();
+    });
 
+    // -- record counts that do not match the header would make the serial reader run into the next section
+    auto concatenate = [](auto & chunk_records, size_t count, auto & out_records) {
+        size_t total = 0;
+        for (auto const & records : chunk_records)
+            total += records.size();
+        if (total != count)
+            return false;
+        out_records.clear();
+        out_records.reserve(count);
+        for (auto const & records : chunk_records)
+            out_records.insert(out_records.end(), records.begin(), records.end());
+        return true;
+    };
+    if (std::find(task_ok.begin(), task_ok.end(), 0) != task_ok.end() ||
+        !concatenate(vertex_chunk_records, num_vertices, out_vertices) ||
+        !concatenate(index_chunk_records, (size_t)num_tris * 3, out_indices)) {
+        out_vertices.clear();
+        out_indices.clear();
+        out_bone_offsets.clear();
+        out_bone_parent_indices.clear();
+        return false;
+    }
+
+    // -- in file order, so a repeated clip name keeps the last clip like the serial reader
+    for (UINT i = 0; i < num_animation_clips; ++i)
+        out_animations[clip_names[i]] = std::move(clip_data[i]);
+    return true;
+}
+template <typename VertexT>
+bool M3DLoader::read_sections (
+    StreamRef fin,
+    UINT num_vertices, VecRef<VertexT> out_vertices,
+    UINT num_tris, VecRef<UINT> out_indices,
+    UINT num_bones, VecRef<DirectX::XMFLOAT4X4> out_bone_offsets, VecRef<int> out_bone_parent_indices,
+    UINT num_animation_clips, std::unordered_map<std::string, AnimationClip> & out_animations
+) {
+    if (nullptr != Jobs && read_sections_parallel(
+        fin, num_vertices, out_vertices, num_tris, out_indices,
+        num_bones, out_bone_offsets, out_bone_parent_indices, num_animation_clips, out_animations
+    ))
+        return true;
+
+    read_vertices(fin, num_vertices, out_vertices);
+    if (!parsed(fin, FileSection::Vertices))
+        return false;
+    read_triangles(fin, num_tris, out_indices);
+    if (!parsed(fin, FileSection::Triangles))
+        return false;
+    if (0 == num_bones)
+        return true;
+    read_bone_offsets(fin, num_bones, out_bone_offsets);
+    if (!parsed(fin, FileSection::BoneOffsets))
+        return false;
+    read_bone_hierarchy(fin, num_bones, out_bone_parent_indices);
+    if (!parsed(fin, FileSection::BoneHierarchy))
+        return false;
+    read_animation_clips(fin, num_bones, num_animation_clips, out_animations);
+    return parsed(fin, FileSection::AnimationClips);
+}
+
+//
+// -- diagnostics
+char const * M3DLoader::SectionName (FileSection section) {
+    static char const * const names [] = {
+        "Header", "Materials", "SubsetTable", "Vertices", "Triangles", "BoneOffsets", "BoneHierarchy", "AnimationClips"
+    };
+    return names[(UINT)section];
+}
+// -- 1-based line of the first token at or after p
+static UINT line_at (M3DTextReader const & text, char const * p) {
+    while (p < text.End() && M3DTextReader::IsSpace(*p))
+        ++p;
+    return 1 + (UINT)std::count(text.Begin(), p, '\n');
+}
+// -- 1-based line of the item-th record of a section with tokens_per_item tokens per record, counted from the
+// -- section header. Slow but only needed for reported problems
+static UINT record_line (M3DTextReader const & text, M3DLoader::FileSection section, UINT tokens_per_item, UINT item) {
+    std::string header = std::string("*") + M3DLoader::SectionName(section) + "*";
+    char const * section_start = find_section(text.Begin(), text.End(), header);
+    M3DTextReader reader(section_start, text.End() - section_start);
+    reader >> M3DTextReader::Label();
+    for (uint64_t i = 0; i < (uint64_t)tokens_per_item * item && reader; ++i)
+        reader >> M3DTextReader::Label();
+    return line_at(text, reader.Position());
+}
+static UINT clip_line (M3DTextReader const & text, std::string const & clip_name) {
+    char const * section_start = find_section(text.Begin(), text.End(), "*AnimationClips*");
+    M3DTextReader reader(section_start, text.End() - section_start);
+    reader >> M3DTextReader::Label();
+    for (char const * clip_start : find_clips(reader.Position(), text.End())) {
+        M3DTextReader clip(clip_start, text.End() - clip_start);
+        std::string name;
+        clip >> M3DTextReader::Label() >> name;
+        if (name == clip_name)
+            return line_at(text, clip_start);
+    }
+    return 0;
+}
+
+void M3DLoader::clear_results () {
+    Diagnostics.clear();
+    ResampleReports.clear();
+    NumReducedKeyframes = 0;
+}
+bool M3DLoader::parsed (StreamRef fin, FileSection section) {
+    if (fin)
+        return true;
 
+    // -- a failed extraction stops at (or inside) the token it could not read
+    char const * token = fin.Position();
+    while (token < fin.End() && M3DTextReader::IsSpace(*token))
+        ++token;
+    char const * token_end = token;
+    while (token_end < fin.End() && !M3DTextReader::IsSpace(*token_end) && token_end - token < 32)
+        ++token_end;
+
+    Diagnostic diagnostic;
+    diagnostic.Section = section;
+    diagnostic.Line = line_at(fin, token);
+    diagnostic.Reason = token == fin.End() ? "unexpected end of file" : "cannot read \"" + std::string(token, token_end) + "\"";
+    Diagnostics.push_back(diagnostic);
+    return false;
+}
+bool M3DLoader::counts_fit (StreamRef fin, uint64_t min_tokens) {
+    // -- every token but the last one is followed by whitespace, this keeps a corrupt count from allocating
+    // -- gigabytes before the parser runs out of text
+    uint64_t max_tokens = ((uint64_t)(fin.End() - fin.Position()) + 1) / 2;
+    if (min_tokens <= max_tokens)
+        return true;
+    report(&fin, FileSection::Header, 0, 0,
+        "the header counts need at least " + std::to_string(min_tokens) + " tokens, the rest of the file has at most " +
+        std::to_string(max_tokens));
+    return false;
+}
+bool M3DLoader::report (M3DTextReader const * text, FileSection section, UINT tokens_per_item, UINT item, std::string const & reason) {
+    Diagnostic diagnostic;
+    diagnostic.Section = section;
+    if (nullptr != text)
+        diagnostic.Line = FileSection::Header == section ? 1 : record_line(*text, section, tokens_per_item, item);
+    diagnostic.Reason = reason;
+    Diagnostics.push_back(diagnostic);
+    return Diagnostics.size() < MaxDiagnostics;
+}
+bool M3DLoader::report_clip (M3DTextReader const * text, std::string const & clip_name, std::string const & reason) {
+    Diagnostic diagnostic;
+    diagnostic.Section = FileSection::AnimationClips;
+    if (nullptr != text)
+        diagnostic.Line = clip_line(*text, clip_name);
+    diagnostic.Reason = "clip " + clip_name + ": " + reason;
+    Diagnostics.push_back(diagnostic);
+    return Diagnostics.size() < MaxDiagnostics;
+}
+
+//
+// -- validation, one pass over every record. Checks are written so NaNs fail them
+void M3DLoader::validate_mesh (
+    M3DTextReader const * text, UINT num_vertices,
+    UINT const * indices, UINT num_indices, Subset const * subsets, UINT num_subsets
+) {
+    for (UINT i = 0; i < num_subsets; ++i) {
+        Subset const & subset = subsets[i];
+        if ((uint64_t)subset.VertexStart + subset.VertexCount > num_vertices &&
+            !report(text, FileSection::Subsets, subset_tokens, i,
+                "subset " + std::to_string(i) + " uses vertices up to " +
+                std::to_string((uint64_t)subset.VertexStart + subset.VertexCount) + " of " + std::to_string(num_vertices)))
+            return;
+        if (((uint64_t)subset.FaceStart + subset.FaceCount) * 3 > num_indices &&
+            !report(text, FileSection::Subsets, subset_tokens, i,
+                "subset " + std::to_string(i) + " uses triangles up to " +
+                std::to_string((uint64_t)subset.FaceStart + subset.FaceCount) + " of " + std::to_string(num_indices / 3)))
+            return;
+    }
+    for (UINT i = 0; nullptr != indices && i < num_indices; ++i) {
+        if (indices[i] >= num_vertices &&
+            !report(text, FileSection::Triangles, 1, i,
+                "triangle " + std::to_string(i / 3) + " uses vertex " + std::to_string(indices[i]) +
+                " of " + std::to_string(num_vertices)))
+            return;
+    }
+}
+void M3DLoader::validate_index_data (
+    UINT num_vertices, BYTE const * index_data, UINT index_byte_size, Subset const * subsets, UINT num_subsets
+) {
+    for (UINT i = 0; i < num_subsets; ++i) {
+        Subset const & subset = subsets[i];
+        uint64_t num_indices = (uint64_t)subset.FaceCount * 3;
+        if ((sizeof(USHORT) != subset.IndexSize && sizeof(UINT) != subset.IndexSize) || 0 != subset.IndexByteOffset % 4 ||
+            subset.IndexByteOffset + num_indices * subset.IndexSize > index_byte_size) {
+            if (!report(nullptr, FileSection::Subsets, 0, 0,
+                "subset " + std::to_string(i) + " has " + std::to_string(num_indices) + " indices of " +
+                std::to_string(subset.IndexSize) + " bytes at byte " + std::to_string(subset.IndexByteOffset) +
+                " of " + std::to_string(index_byte_size)))
+                return;
+            continue;
+        }
+        auto short_indices = reinterpret_cast<USHORT const *>(index_data + subset.IndexByteOffset);
+        auto long_indices = reinterpret_cast<UINT const *>(index_data + subset.IndexByteOffset);
+        for (UINT k = 0; k < (UINT)num_indices; ++k) {
+            uint64_t index = (uint64_t)subset.BaseVertex + (sizeof(USHORT) == subset.IndexSize ? short_indices[k] : long_indices[k]);
+            if (index >= num_vertices &&
+                !report(nullptr, FileSection::Triangles, 0, 0,
+                    "subset " + std::to_string(i) + " triangle " + std::to_string(k / 3) + " uses vertex " +
+                    std::to_string(index) + " of " + std::to_string(num_vertices)))
+                return;
+        }
+    }
+}
+void M3DLoader::validate_skinned_vertices (M3DTextReader const * text, SkinnedVertex const * vertices, UINT num_vertices, UINT num_bones) {
+    // -- the fourth weight is not stored but derived as 1 - the others by the skinning code,
+    // -- so weights summing to 1 means the three stored weights are non-negative and sum to at most 1
+    float const weight_tolerance = 1e-3f;
+    for (UINT i = 0; i < num_vertices; ++i) {
+        SkinnedVertex const & vertex = vertices[i];
+        BYTE max_bone = MathHelper::Max(
+            MathHelper::Max(vertex.BoneIndices[0], vertex.BoneIndices[1]),
+            MathHelper::Max(vertex.BoneIndices[2], vertex.BoneIndices[3])
+        );
+        if (max_bone >= num_bones &&
+            !report(text, FileSection::Vertices, skinned_vertex_tokens, i,
+                "vertex " + std::to_string(i) + " uses bone " + std::to_string(max_bone) + " of " + std::to_string(num_bones)))
+            return;
+
+        XMFLOAT3 const & w = vertex.BoneWeights;
+        bool weights_valid = w.x >= -weight_tolerance && w.y >= -weight_tolerance && w.z >= -weight_tolerance &&
+            w.x + w.y + w.z <= 1.0f + weight_tolerance;
+        if (!weights_valid &&
+            !report(text, FileSection::Vertices, skinned_vertex_tokens, i,
+                "vertex " + std::to_string(i) + " has weights " + std::to_string(w.x) + " " + std::to_string(w.y) + " " +
+                std::to_string(w.z) + " that do not sum to 1 with a non-negative fourth weight"))
+            return;
+    }
+}
+void M3DLoader::validate_skeleton (
+    M3DTextReader const * text, int const * bone_hierarchy, UINT num_bones,
+    std::unordered_map<std::string, AnimationClip> const & animations
+) {
+    // -- SkinnedData::GetFinalTransforms and the bone LODs visit bones in index order and expect parents first
+    for (UINT i = 0; i < num_bones; ++i) {
+        if ((bone_hierarchy[i] < -1 || bone_hierarchy[i] >= (int)i) &&
+            !report(text, FileSection::BoneHierarchy, bone_parent_tokens, i,
+                "parent " + std::to_string(bone_hierarchy[i]) + " of bone " + std::to_string(i) + " does not precede it"))
+            return;
+    }
+    // -- interpolation expects at least one key per bone and keys sorted by time
+    for (auto const & clip : animations) {
+        for (UINT bone = 0; bone < (UINT)clip.second.BoneAnimations.size(); ++bone) {
+            std::vector<Keyframe> const & keys = clip.second.BoneAnimations[bone].Keyframes;
+            if (keys.empty() && !report_clip(text, clip.first, "bone " + std::to_string(bone) + " has no keyframes"))
+                return;
+            for (UINT k = 0; k < (UINT)keys.size(); ++k) {
+                bool sorted = 0 == k ? keys[k].TimePoint == keys[k].TimePoint : keys[k].TimePoint >= keys[k - 1].TimePoint;
+                if (!sorted) {
+                    if (!report_clip(text, clip.first,
+                        "keyframe " + std::to_string(k) + " of bone " + std::to_string(bone) + " is out of time order"))
+                        return;
+                    break;
+                }
+            }
+        }
+    }
+}
+void M3DLoader::make_additive_clips (UINT num_bones, std::unordered_map<std::string, AnimationClip> & animations) {
+    // -- take every reference pose before changing any clip, a reference clip may be additive itself
+    std::unordered_map<std::string, std::vector<Keyframe>> reference_poses;
+    for (auto const & additive : AdditiveClips) {
+        auto clip = animations.find(additive.first);
+        auto reference = animations.find(additive.second);
+        if (clip == animations.end() || reference == animations.end())
+            continue;
+
+        std::vector<Keyframe> & reference_pose = reference_poses[additive.first];
+        reference_pose.resize(num_bones);
+        reference->second.Interpolate(reference->second.GetClipStartTime(), reference_pose);
+    }
+
+    for (auto const & reference_pose : reference_poses)
+        animations[reference_pose.first].MakeAdditive(reference_pose.second);
+}
+void M3DLoader::process_animations (
+    std::vector<int> & bone_hierarchy,
+    std::vector<DirectX::XMFLOAT4X4> & bone_offsets,
+    std::unordered_map<std::string, AnimationClip> & animations,
+    SkinnedData & out_skin_info
+) {
+    if (AnimationSampleRate > 0.0f) {
+        for (auto & clip : animations) {
+            ClipResampleReport report;
+            report.ClipName = clip.first;
+            report.Error = clip.second.Resample(AnimationSampleRate);
+            report.WithinTolerance =
+                report.Error.MaxTranslation <= ResampleTolerance &&
+                report.Error.MaxRotation <= ResampleTolerance &&
+                report.Error.MaxScale <= ResampleTolerance;
+            ResampleReports.push_back(report);
+        }
+    }
+
+    make_additive_clips((UINT)bone_hierarchy.size(), animations);
+    if (ExtractRootMotion)
+        for (auto & clip : animations)
+            if (AdditiveClips.find(clip.first) == AdditiveClips.end())
+                clip.second.ExtractRootMotion(bone_hierarchy);
+
+    if (KeyframeReductionTolerance > 0.0f)
+        for (auto & clip : animations)
+            NumReducedKeyframes += clip.second.ReduceKeyframes(bone_hierarchy, KeyframeReductionTolerance);
+
+    out_skin_info.Set(
+        bone_hierarchy, bone_offsets, animations,
+        CompressAnimations ? &CompressionSettings : nullptr
+    );
+}
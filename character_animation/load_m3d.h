@@ -1,6 +1,10 @@
 #pragma once
 
 #include "skinned_data.h"
+#include "m3d_text_reader.h"
+
+class M3DBinaryFile;
+class JobSystem;
 
 class M3DLoader {
 public:
@@ -24,6 +28,13 @@ public:
         UINT VertexCount = 0;
         UINT FaceStart = 0;
         UINT FaceCount = 0;
+
+        // -- where the subset's FaceCount * 3 indices are in the index data LoadM3D returns: IndexSize bytes each
+        // -- (2 if the vertices the subset uses span at most 65536, 4 otherwise) starting at IndexByteOffset,
+        // -- relative to BaseVertex (the lowest vertex the subset uses). Set by the loader, not read from text files
+        UINT IndexSize = sizeof(USHORT);
+        UINT IndexByteOffset = 0;
+        UINT BaseVertex = 0;
     };
     struct M3DMaterial {
         std::string Name;
@@ -37,38 +48,168 @@ public:
         std::string DiffuseMapName;
         std::string NormalMapName;
     };
+    struct ClipResampleReport {
+        std::string ClipName;
+        ResampleError Error;
+        bool WithinTolerance = true;
+    };
+    // -- sections of a .m3d file in file order
+    enum class FileSection {
+        Header, Materials, Subsets, Vertices, Triangles, BoneOffsets, BoneHierarchy, AnimationClips
+    };
+    // -- a problem found while reading or validating a file
+    struct Diagnostic {
+        FileSection Section = FileSection::Header;
+        UINT Line = 0;  // 1-based line of the offending token or record in text files, 0 for binary files
+        std::string Reason;
+    };
+    // -- name of the section as it appears in the header text of text files
+    static char const * SectionName (FileSection section);
+
+    // -- optional: resample animation clips to a uniform rate (keys per second) after reading them,
+    // -- 0 keeps the source keyframes
+    float AnimationSampleRate = 0.0f;
+    // -- translation/scale tolerance in model units and rotation tolerance in radians
+    float ResampleTolerance = 1e-3f;
+    // -- one entry per resampled clip of the last LoadM3D call
+    std::vector<ClipResampleReport> ResampleReports;
+
+    // -- optional: remove keyframes that keep every joint within this distance (model units)
+    // -- of its original position at the original keyframe times, 0 keeps all keyframes
+    float KeyframeReductionTolerance = 0.0f;
+    // -- keyframes removed by the last LoadM3D call
+    UINT NumReducedKeyframes = 0;
+
+    // -- optional: clips turned into additive clips after reading them, clip name -> reference clip name.
+    // -- The reference pose is the first frame of the reference clip (a clip can be its own reference)
+    std::unordered_map<std::string, std::string> AdditiveClips;
+
+    // -- optional: move the horizontal root translation and yaw of every non-additive clip into a
+    // -- root motion track (see AnimationClip::ExtractRootMotion, SkinnedModelInstance::RootMotionDelta)
+    bool ExtractRootMotion = false;
+
+    // -- optional: store animation clips quantized (see CompressedAnimationClip)
+    bool CompressAnimations = false;
+    ClipCompressionSettings CompressionSettings;
+
+    // -- filled by LoadM3D and ConvertToBinary, which fail if there are any. Reading stops at the first parse error,
+    // -- what was read is then validated in one linear pass: index and subset ranges, bone indices and weights,
+    // -- parents preceding their children and keyframes of every bone sorted by time
+    std::vector<Diagnostic> Diagnostics;
+    // -- validation stops after this many problems
+    UINT MaxDiagnostics = 32;
+
+    // -- optional: parse text files on these threads. The sections are located first, then vertices and
+    // -- triangles are parsed in chunks alongside the bone sections and every animation clip
+    JobSystem * Jobs = nullptr;
+
+    // -- out_indices holds the indices of every subset one after another, in the subset's index size and at
+    // -- 4-byte aligned offsets (see Subset), so it can be viewed as 16-bit or as 32-bit indices
     bool LoadM3D (
         std::string const & filename,
         std::vector<Vertex> & out_vertices,
-        std::vector<USHORT> & out_indices,
+        std::vector<BYTE> & out_indices,
         std::vector<Subset> & out_subsets,
         std::vector<M3DMaterial> & out_mats
     );
     bool LoadM3D (
         std::string const & filename,
         std::vector<SkinnedVertex> & out_vertices,
-        std::vector<USHORT> & out_indices,
+        std::vector<BYTE> & out_indices,
         std::vector<Subset> & out_subsets,
         std::vector<M3DMaterial> & out_mats,
         SkinnedData & out_skin_info
     );
+    // -- materials and subsets of a binary file (see M3DBinaryFile), vertices and indices are used in place
+    bool LoadM3D (
+        M3DBinaryFile const & file,
+        std::vector<Subset> & out_subsets,
+        std::vector<M3DMaterial> & out_mats
+    );
+    // -- same as above plus the skinning data, the options above are applied to the clips of the file
+    bool LoadM3D (
+        M3DBinaryFile const & file,
+        std::vector<Subset> & out_subsets,
+        std::vector<M3DMaterial> & out_mats,
+        SkinnedData & out_skin_info
+    );
+
+    // -- offline conversion of a text .m3d to the binary format (see M3DBinaryFile).
+    // -- The options above are ignored, the binary file keeps the source keyframes
+    bool ConvertToBinary (std::string const & m3d_filename, std::string const & binary_filename);
 
 private:
-    using StreamRef = std::ifstream &;
+    using StreamRef = M3DTextReader &;
     template <typename T>
     using VecRef = std::vector<T> &;
     void read_materials (StreamRef fin, UINT num_mats, VecRef<M3DMaterial> out_mats);
     void read_subset_table (StreamRef fin, UINT num_subsets, VecRef<Subset> out_subsets);
     void read_vertices (StreamRef fin, UINT num_vertices, VecRef<Vertex> out_vertices);
-    void read_skinned_vertices (StreamRef fin, UINT num_vertices, VecRef<SkinnedVertex> out_vertices);
-    void read_triangles (StreamRef fin, UINT num_tris, VecRef<USHORT> out_indices);
+    void read_vertices (StreamRef fin, UINT num_vertices, VecRef<SkinnedVertex> out_vertices);
+    void read_triangles (StreamRef fin, UINT num_tris, VecRef<UINT> out_indices);
+    // -- records only (no section header), shared by the serial readers and the parallel chunks
+    void read_records (StreamRef fin, UINT num_vertices, Vertex * out_vertices);
+    void read_records (StreamRef fin, UINT num_vertices, SkinnedVertex * out_vertices);
+    void read_records (StreamRef fin, UINT num_indices, UINT * out_indices);
     void read_bone_offsets (StreamRef fin, UINT num_bones, VecRef<DirectX::XMFLOAT4X4> out_bone_offsets);
     void read_bone_hierarchy (StreamRef fin, UINT num_bones, VecRef<int> out_bone_parent_indices);
-    void read_bone_keyframes (StreamRef fin, UINT num_bones, BoneAnimation & bone_animation);
+    void read_bone_keyframes (StreamRef fin, BoneAnimation & bone_animation);
+    void read_animation_clip (StreamRef fin, UINT num_bones, std::string & out_clip_name, AnimationClip & out_clip);
     void read_animation_clips (
         StreamRef fin,
         UINT num_bones, UINT num_animation_clips,
         std::unordered_map<std::string, AnimationClip> & out_animations
     );
+    // -- everything after the subset table (bones and clips only if num_bones > 0), on Jobs if they are set.
+    // -- False with a diagnostic at the first parse error
+    template <typename VertexT>
+    bool read_sections (
+        StreamRef fin,
+        UINT num_vertices, VecRef<VertexT> out_vertices,
+        UINT num_tris, VecRef<UINT> out_indices,
+        UINT num_bones, VecRef<DirectX::XMFLOAT4X4> out_bone_offsets, VecRef<int> out_bone_parent_indices,
+        UINT num_animation_clips, std::unordered_map<std::string, AnimationClip> & out_animations
+    );
+    // -- read_sections on Jobs: false (and the outputs cleared) if a section cannot be located or does not parse,
+    // -- read_sections then reads fin serially so malformed files behave as before
+    template <typename VertexT>
+    bool read_sections_parallel (
+        StreamRef fin,
+        UINT num_vertices, VecRef<VertexT> out_vertices,
+        UINT num_tris, VecRef<UINT> out_indices,
+        UINT num_bones, VecRef<DirectX::XMFLOAT4X4> out_bone_offsets, VecRef<int> out_bone_parent_indices,
+        UINT num_animation_clips, std::unordered_map<std::string, AnimationClip> & out_animations
+    );
+
+    // -- reset everything LoadM3D fills before loading another file
+    void clear_results ();
+    // -- diagnostics: false if fin failed (with a diagnostic at the failing token) or once MaxDiagnostics are reported
+    bool parsed (StreamRef fin, FileSection section);
+    // -- false (with a diagnostic) if the header counts need more tokens than are left in fin
+    bool counts_fit (StreamRef fin, uint64_t min_tokens);
+    // -- text is the source file (nullptr for binary files) to find the line of the item-th record of a section
+    bool report (M3DTextReader const * text, FileSection section, UINT tokens_per_item, UINT item, std::string const & reason);
+    bool report_clip (M3DTextReader const * text, std::string const & clip_name, std::string const & reason);
+    // -- validation, record pointers are read in place so binary files are checked without copies.
+    // -- indices are the source indices of text files, nullptr for binary files which validate_index_data checks
+    void validate_mesh (
+        M3DTextReader const * text, UINT num_vertices,
+        UINT const * indices, UINT num_indices, Subset const * subsets, UINT num_subsets
+    );
+    void validate_index_data (UINT num_vertices, BYTE const * index_data, UINT index_byte_size, Subset const * subsets, UINT num_subsets);
+    void validate_skinned_vertices (M3DTextReader const * text, SkinnedVertex const * vertices, UINT num_vertices, UINT num_bones);
+    void validate_skeleton (
+        M3DTextReader const * text, int const * bone_hierarchy, UINT num_bones,
+        std::unordered_map<std::string, AnimationClip> const & animations
+    );
+
+    void make_additive_clips (UINT num_bones, std::unordered_map<std::string, AnimationClip> & animations);
+    // -- apply the options above to the source clips, then set out_skin_info
+    void process_animations (
+        std::vector<int> & bone_hierarchy,
+        std::vector<DirectX::XMFLOAT4X4> & bone_offsets,
+        std::unordered_map<std::string, AnimationClip> & animations,
+        SkinnedData & out_skin_info
+    );
 };
 
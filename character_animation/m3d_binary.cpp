@@ -0,0 +1,164 @@
+#include "m3d_binary.h"
+
+using namespace DirectX;
+
+constexpr UINT M3DBinaryHeader::CurrentVersion;
+constexpr UINT M3DBinaryHeader::SectionAlignment;
+
+// -- append a section at the next aligned offset of file
+static void append_section (
+    std::vector<BYTE> & file, M3DBinaryHeader & header,
+    M3DSection s, void const * data, size_t byte_size
+) {
+    size_t offset = (file.size() + M3DBinaryHeader::SectionAlignment - 1) / M3DBinaryHeader::SectionAlignment *
+        M3DBinaryHeader::SectionAlignment;
+    file.resize(offset + byte_size);
+    if (byte_size > 0)
+        memcpy(file.data() + offset, data, byte_size);
+
+    header.Sections[(UINT)s].Offset = offset;
+    header.Sections[(UINT)s].ByteSize = byte_size;
+}
+template <typename T>
+static void append_section (std::vector<BYTE> & file, M3DBinaryHeader & header, M3DSection s, std::vector<T> const & data) {
+    append_section(file, header, s, data.data(), data.size() * sizeof(T));
+}
+static UINT add_string (std::vector<char> & strings, std::string const & str) {
+    UINT offset = (UINT)strings.size();
+    strings.insert(strings.end(), str.c_str(), str.c_str() + str.size() + 1);
+    return offset;
+}
+
+bool WriteM3DBinary (std::string const & filename, M3DContents const & contents) {
+    bool skinned = !contents.SkinnedVertices.empty();
+    UINT num_bones = (UINT)contents.BoneHierarchy.size();
+
+    M3DBinaryHeader header;
+    header.VertexStride = skinned ? sizeof(M3DLoader::SkinnedVertex) : sizeof(M3DLoader::Vertex);
+    header.NumMaterials = (UINT)contents.Materials.size();
+    header.NumVertices = (UINT)(skinned ? contents.SkinnedVertices.size() : contents.Vertices.size());
+    header.NumTriangles = contents.NumTriangles;
+    header.NumBones = num_bones;
+    header.NumAnimationClips = (UINT)contents.Clips.size();
+
+    std::vector<char> strings;
+    std::vector<M3DBinaryMaterial> materials(contents.Materials.size());
+    for (size_t i = 0; i < materials.size(); ++i) {
+        M3DLoader::M3DMaterial const & src = contents.Materials[i];
+        M3DBinaryMaterial & mat = materials[i];
+        mat.DiffuseAlbedo = src.DiffuseAlbedo;
+        mat.FresnelR0 = src.FresnelR0;
+        mat.Roughness = src.Roughness;
+        mat.AlphaClip = src.AlphaClip ? 1 : 0;
+        mat.Name = add_string(strings, src.Name);
+        mat.MaterialTypeName = add_string(strings, src.MaterialTypeName);
+        mat.DiffuseMapName = add_string(strings, src.DiffuseMapName);
+        mat.NormalMapName = add_string(strings, src.NormalMapName);
+    }
+
+    std::vector<M3DBinaryClip> clips(contents.Clips.size());
+    std::vector<UINT> keyframe_starts(1, 0);
+    std::vector<M3DBinaryKeyframe> keyframes;
+    for (size_t c = 0; c < clips.size(); ++c) {
+        AnimationClip const & clip = contents.Clips[c].second;
+        if (clip.BoneAnimations.size() != num_bones)
+            return false;
+
+        clips[c].Name = add_string(strings, contents.Clips[c].first);
+        for (BoneAnimation const & bone_animation : clip.BoneAnimations) {
+            for (Keyframe const & key : bone_animation.Keyframes) {
+                M3DBinaryKeyframe out_key;
+                out_key.TimePoint = key.TimePoint;
+                out_key.Translation = key.Translation;
+                out_key.Scale = key.Scale;
+                out_key.RotationQuat = key.RotationQuat;
+                keyframes.push_back(out_key);
+            }
+            keyframe_starts.push_back((UINT)keyframes.size());
+        }
+    }
+
+    std::vector<BYTE> file(sizeof(M3DBinaryHeader));
+    append_section(file, header, M3DSection::Strings, strings);
+    append_section(file, header, M3DSection::Materials, materials);
+    append_section(file, header, M3DSection::Subsets, contents.Subsets);
+    if (skinned)
+        append_section(file, header, M3DSection::Vertices, contents.SkinnedVertices);
+    else
+        append_section(file, header, M3DSection::Vertices, contents.Vertices);
+    append_section(file, header, M3DSection::Indices, contents.Indices);
+    append_section(file, header, M3DSection::BoneOffsets, contents.BoneOffsets);
+    append_section(file, header, M3DSection::BoneHierarchy, contents.BoneHierarchy);
+    append_section(file, header, M3DSection::Clips, clips);
+    append_section(file, header, M3DSection::KeyframeStarts, keyframe_starts);
+    append_section(file, header, M3DSection::Keyframes, keyframes);
+    memcpy(file.data(), &header, sizeof(header));
+
+    std::ofstream fout(filename, std::ios::binary | std::ios::trunc);
+    fout.write(reinterpret_cast<char const *>(file.data()), file.size());
+    return (bool)fout;
+}
+
+bool M3DBinaryFile::Open (std::string const & filename) {
+    Close();
+    if (!file_.Open(filename))
+        return false;
+
+    uint64_t file_size = file_.Size();
+    auto header = reinterpret_cast<M3DBinaryHeader const *>(file_.Data());
+    if (file_size < sizeof(M3DBinaryHeader) || 0 != memcmp(header->Magic, "M3DB", 4) ||
+        M3DBinaryHeader::CurrentVersion != header->Version ||
+        (sizeof(M3DLoader::Vertex) != header->VertexStride && sizeof(M3DLoader::SkinnedVertex) != header->VertexStride)) {
+        file_.Close();
+        return false;
+    }
+
+    // -- every section but the strings, indices and keyframes has a size implied by the header counts
+    uint64_t num_tracks = (uint64_t)header->NumAnimationClips * header->NumBones;
+    uint64_t expected_sizes [(UINT)M3DSection::Count] = {
+        header->Sections[(UINT)M3DSection::Strings].ByteSize,
+        (uint64_t)header->NumMaterials * sizeof(M3DBinaryMaterial),
+        (uint64_t)header->NumMaterials * sizeof(M3DLoader::Subset),
+        (uint64_t)header->NumVertices * header->VertexStride,
+        header->Sections[(UINT)M3DSection::Indices].ByteSize,
+        (uint64_t)header->NumBones * sizeof(XMFLOAT4X4),
+        (uint64_t)header->NumBones * sizeof(int),
+        (uint64_t)header->NumAnimationClips * sizeof(M3DBinaryClip),
+        (num_tracks + 1) * sizeof(UINT),
+        header->Sections[(UINT)M3DSection::Keyframes].ByteSize
+    };
+    for (UINT s = 0; s < (UINT)M3DSection::Count; ++s) {
+        M3DSectionEntry const & entry = header->Sections[s];
+        if (expected_sizes[s] != entry.ByteSize || 0 != entry.Offset % M3DBinaryHeader::SectionAlignment ||
+            entry.Offset > file_size || entry.ByteSize > file_size - entry.Offset) {
+            file_.Close();
+            return false;
+        }
+    }
+    header_ = header;
+
+    // -- keyframe ranges and names have to stay inside their sections
+    UINT const * keyframe_starts = KeyframeStarts();
+    bool valid = 0 == keyframe_starts[0] &&
+        (uint64_t)keyframe_starts[num_tracks] * sizeof(M3DBinaryKeyframe) == header->Sections[(UINT)M3DSection::Keyframes].ByteSize;
+    for (uint64_t i = 0; i < num_tracks && valid; ++i)
+        valid = keyframe_starts[i] <= keyframe_starts[i + 1];
+
+    uint64_t strings_size = header->Sections[(UINT)M3DSection::Strings].ByteSize;
+    valid = valid && (0 == strings_size || '\0' == String((UINT)strings_size - 1)[0]);
+    for (UINT i = 0; i < header->NumMaterials && valid; ++i) {
+        M3DBinaryMaterial const & mat = Materials()[i];
+        valid = mat.Name < strings_size && mat.MaterialTypeName < strings_size &&
+            mat.DiffuseMapName < strings_size && mat.NormalMapName < strings_size;
+    }
+    for (UINT i = 0; i < header->NumAnimationClips && valid; ++i)
+        valid = Clips()[i].Name < strings_size;
+
+    if (!valid)
+        Close();
+    return valid;
+}
+void M3DBinaryFile::Close () {
+    header_ = nullptr;
+    file_.Close();
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "load_m3d.h"
+#include "../common/mapped_file.h"
+
+//
+// -- Binary .m3d container (.m3db): a header with a section table, then one 16-byte aligned section per table
+// -- entry. Vertices, indices, bone offsets and keyframes are stored in their in-memory layout, so an opened file
+// -- hands out pointers straight into the mapping (e.g. to copy to an upload buffer) instead of parsing values.
+// -- Files are written by M3DLoader::ConvertToBinary and hold the source keyframes, loader options
+// -- (resampling, compression, ...) are applied when loading them
+enum class M3DSection : UINT {
+    Strings = 0,        // null-terminated names, referenced by byte offset
+    Materials,          // M3DBinaryMaterial[NumMaterials]
+    Subsets,            // M3DLoader::Subset[NumMaterials]
+    Vertices,           // M3DLoader::Vertex or M3DLoader::SkinnedVertex [NumVertices]
+    Indices,            // indices of every subset in its own format (see M3DLoader::Subset), a multiple of 4 bytes
+    BoneOffsets,        // XMFLOAT4X4[NumBones]
+    BoneHierarchy,      // int[NumBones], parent index of every bone
+    Clips,              // M3DBinaryClip[NumAnimationClips]
+    KeyframeStarts,     // UINT[NumAnimationClips * NumBones + 1], keyframes of bone b of clip c start at [c * NumBones + b]
+    Keyframes,          // M3DBinaryKeyframe[KeyframeStarts[NumAnimationClips * NumBones]]
+    Count
+};
+struct M3DSectionEntry {
+    uint64_t Offset = 0;    // from the start of the file
+    uint64_t ByteSize = 0;
+};
+struct M3DBinaryHeader {
+    static constexpr UINT CurrentVersion = 2;
+    static constexpr UINT SectionAlignment = 16;
+
+    char Magic[4] = {'M', '3', 'D', 'B'};
+    UINT Version = CurrentVersion;
+    UINT VertexStride = 0;  // sizeof(M3DLoader::SkinnedVertex) for skinned files, sizeof(M3DLoader::Vertex) otherwise
+    UINT NumMaterials = 0;
+    UINT NumVertices = 0;
+    UINT NumTriangles = 0;
+    UINT NumBones = 0;
+    UINT NumAnimationClips = 0;
+    M3DSectionEntry Sections[(UINT)M3DSection::Count];
+};
+struct M3DBinaryMaterial {
+    DirectX::XMFLOAT4 DiffuseAlbedo;
+    DirectX::XMFLOAT3 FresnelR0;
+    float Roughness;
+    UINT AlphaClip;
+    // -- offsets into the string section
+    UINT Name;
+    UINT MaterialTypeName;
+    UINT DiffuseMapName;
+    UINT NormalMapName;
+};
+struct M3DBinaryClip {
+    UINT Name;  // offset into the string section
+};
+// -- same members as Keyframe
+struct M3DBinaryKeyframe {
+    float TimePoint;
+    DirectX::XMFLOAT3 Translation;
+    DirectX::XMFLOAT3 Scale;
+    DirectX::XMFLOAT4 RotationQuat;
+};
+
+//
+// -- Contents of a .m3d file as M3DLoader::ConvertToBinary reads it, clips sorted by name
+struct M3DContents {
+    std::vector<M3DLoader::M3DMaterial> Materials;
+    std::vector<M3DLoader::Subset> Subsets;
+    std::vector<M3DLoader::Vertex> Vertices;                // unskinned files
+    std::vector<M3DLoader::SkinnedVertex> SkinnedVertices;  // skinned files
+    std::vector<BYTE> Indices;  // laid out per subset like M3DLoader::LoadM3D returns them
+    UINT NumTriangles = 0;
+    std::vector<DirectX::XMFLOAT4X4> BoneOffsets;
+    std::vector<int> BoneHierarchy;
+    std::vector<std::pair<std::string, AnimationClip>> Clips;
+};
+bool WriteM3DBinary (std::string const & filename, M3DContents const & contents);
+
+//
+// -- Memory mapped .m3db file. Open checks the header and that every section lies in the file with the size
+// -- its counts imply, after that the accessors only do pointer arithmetic.
+// -- Returned pointers stay valid until the file is closed
+class M3DBinaryFile {
+private:
+    MappedFile file_;
+    M3DBinaryHeader const * header_ = nullptr;
+
+    template <typename T>
+    T const * section (M3DSection s) const {
+        return reinterpret_cast<T const *>(file_.Data() + header_->Sections[(UINT)s].Offset);
+    }
+
+public:
+    // -- false if the file is missing, was written by another version or is truncated
+    bool Open (std::string const & filename);
+    void Close ();
+    bool IsOpen () const { return nullptr != header_; }
+
+    bool IsSkinned () const { return sizeof(M3DLoader::SkinnedVertex) == header_->VertexStride; }
+
+    UINT MaterialCount () const { return header_->NumMaterials; }
+    M3DBinaryMaterial const * Materials () const { return section<M3DBinaryMaterial>(M3DSection::Materials); }
+    char const * String (UINT offset) const { return section<char>(M3DSection::Strings) + offset; }
+    M3DLoader::Subset const * Subsets () const { return section<M3DLoader::Subset>(M3DSection::Subsets); }
+
+    UINT VertexCount () const { return header_->NumVertices; }
+    UINT VertexByteSize () const { return header_->NumVertices * header_->VertexStride; }
+    // -- nullptr if the file holds the other vertex type
+    M3DLoader::Vertex const * Vertices () const {
+        return IsSkinned() ? nullptr : section<M3DLoader::Vertex>(M3DSection::Vertices);
+    }
+    M3DLoader::SkinnedVertex const * SkinnedVertices () const {
+        return IsSkinned() ? section<M3DLoader::SkinnedVertex>(M3DSection::Vertices) : nullptr;
+    }
+    // -- indices of the source triangles, the index data holds those of the subsets (see M3DLoader::Subset)
+    UINT IndexCount () const { return header_->NumTriangles * 3; }
+    UINT IndexByteSize () const { return (UINT)header_->Sections[(UINT)M3DSection::Indices].ByteSize; }
+    BYTE const * Indices () const { return section<BYTE>(M3DSection::Indices); }
+
+    UINT BoneCount () const { return header_->NumBones; }
+    DirectX::XMFLOAT4X4 const * BoneOffsets () const { return section<DirectX::XMFLOAT4X4>(M3DSection::BoneOffsets); }
+    int const * BoneHierarchy () const { return section<int>(M3DSection::BoneHierarchy); }
+
+    UINT ClipCount () const { return header_->NumAnimationClips; }
+    M3DBinaryClip const * Clips () const { return section<M3DBinaryClip>(M3DSection::Clips); }
+    UINT const * KeyframeStarts () const { return section<UINT>(M3DSection::KeyframeStarts); }
+    M3DBinaryKeyframe const * Keyframes () const { return section<M3DBinaryKeyframe>(M3DSection::Keyframes); }
+};
@@ -0,0 +1,194 @@
+#include "m3d_text_reader.h"
+
+#include <float.h>
+#include <limits.h>
+#include <stdlib.h>
+
+static bool is_digit (char c) {
+    return '0' <= c && c <= '9';
+}
+
+bool M3DTextReader::skip_whitespace () {
+    while (pos_ < end_ && IsSpace(*pos_))
+        ++pos_;
+    if (pos_ == end_)
+        failed_ = true;
+    return !failed_;
+}
+bool M3DTextReader::read_integer (bool & out_negative, uint64_t & out_magnitude, bool & out_overflow) {
+    char const * p = pos_;
+    out_negative = false;
+    if (p < end_ && ('+' == *p || '-' == *p))
+        out_negative = '-' == *p++;
+
+    out_magnitude = 0;
+    out_overflow = false;
+    char const * digits = p;
+    for (; p < end_ && is_digit(*p); ++p) {
+        if (out_magnitude > (UINT64_MAX - 9) / 10)
+            out_overflow = true;
+        else
+            out_magnitude = out_magnitude * 10 + (*p - '0');
+    }
+    pos_ = p;
+    return p != digits;
+}
+template <typename T>
+void M3DTextReader::read_unsigned (T & out) {
+    T const max_value = (T)-1;
+    bool negative, overflow;
+    uint64_t magnitude;
+    if (failed_ || !skip_whitespace())
+        return;
+    if (!read_integer(negative, magnitude, overflow)) {
+        failed_ = true;
+        out = 0;
+    } else if (overflow || magnitude > max_value) {
+        failed_ = true;
+        out = max_value;
+    } else {
+        // -- like strtoul, a negative value wraps around
+        out = negative ? (T)(0 - (T)magnitude) : (T)magnitude;
+    }
+}
+
+M3DTextReader & M3DTextReader::operator>> (Label) {
+    if (failed_ || !skip_whitespace())
+        return *this;
+    while (pos_ < end_ && !IsSpace(*pos_))
+        ++pos_;
+    return *this;
+}
+M3DTextReader & M3DTextReader::operator>> (std::string & out) {
+    if (failed_ || !skip_whitespace())
+        return *this;
+    char const * begin = pos_;
+    while (pos_ < end_ && !IsSpace(*pos_))
+        ++pos_;
+    out.assign(begin, pos_);
+    return *this;
+}
+M3DTextReader & M3DTextReader::operator>> (float & out) {
+    if (failed_ || !skip_whitespace())
+        return *this;
+
+    //
+    // -- [sign] digits [. digits] [(e|E) [sign] digits] as mantissa * 10^exponent,
+    // -- up to 19 significant digits are kept exactly
+    char const * begin = pos_;
+    char const * p = pos_;
+    bool negative = false;
+    if (p < end_ && ('+' == *p || '-' == *p))
+        negative = '-' == *p++;
+
+    uint64_t mantissa = 0;
+    int num_digits = 0;
+    int exponent = 0;
+    bool any_digits = false;
+    bool truncated = false;
+    for (; p < end_ && is_digit(*p); ++p) {
+        any_digits = true;
+        if (num_digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            num_digits += 0 != mantissa;
+        } else {
+            ++exponent;
+            truncated |= '0' != *p;
+        }
+    }
+    if (p < end_ && '.' == *p) {
+        for (++p; p < end_ && is_digit(*p); ++p) {
+            any_digits = true;
+            if (num_digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                num_digits += 0 != mantissa;
+                --exponent;
+            } else {
+                truncated |= '0' != *p;
+            }
+        }
+    }
+    if (!any_digits) {
+        pos_ = p;
+        failed_ = true;
+        out = 0.0f;
+        return *this;
+    }
+    // -- an exponent needs at least one digit, otherwise the 'e' is not part of the number
+    if (p < end_ && ('e' == *p || 'E' == *p)) {
+        char const * e = p + 1;
+        bool exp_negative = false;
+        if (e < end_ && ('+' == *e || '-' == *e))
+            exp_negative = '-' == *e++;
+        if (e < end_ && is_digit(*e)) {
+            int exp_value = 0;
+            for (; e < end_ && is_digit(*e); ++e)
+                exp_value = MathHelper::Min(exp_value * 10 + (*e - '0'), 100000);
+            exponent += exp_negative ? -exp_value : exp_value;
+            p = e;
+        }
+    }
+    pos_ = p;
+
+    //
+    // -- fast path: mantissa and 10^|exponent| are exact doubles, so one division or multiplication
+    // -- gives the correctly rounded double. Rounding that to float is only off when the double landed
+    // -- exactly on the midpoint between two floats, those (and subnormals, overflows) go to strtof
+    static double const powers_of_ten [] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    if (!truncated && mantissa < (1ull << 53) && -22 <= exponent && exponent <= 22) {
+        double d = exponent < 0 ? (double)mantissa / powers_of_ten[-exponent] : (double)mantissa * powers_of_ten[exponent];
+        uint64_t bits;
+        memcpy(&bits, &d, sizeof(bits));
+        bool float_midpoint = (1ull << 28) == (bits & ((1ull << 29) - 1));
+        if (0.0 == d || (FLT_MIN <= d && d <= FLT_MAX && !float_midpoint)) {
+            out = negative ? -(float)d : (float)d;
+            return *this;
+        }
+    }
+
+    std::string number(begin, p);
+    float value = strtof(number.c_str(), nullptr);
+    if (value > FLT_MAX || value < -FLT_MAX) {
+        failed_ = true;
+        value = value > 0.0f ? FLT_MAX : -FLT_MAX;
+    }
+    out = value;
+    return *this;
+}
+M3DTextReader & M3DTextReader::operator>> (int & out) {
+    bool negative, overflow;
+    uint64_t magnitude;
+    if (failed_ || !skip_whitespace())
+        return *this;
+    if (!read_integer(negative, magnitude, overflow)) {
+        failed_ = true;
+        out = 0;
+    } else if (overflow || magnitude > (uint64_t)INT_MAX + negative) {
+        failed_ = true;
+        out = negative ? INT_MIN : INT_MAX;
+    } else {
+        out = negative ? (int)(0 - magnitude) : (int)magnitude;
+    }
+    return *this;
+}
+M3DTextReader & M3DTextReader::operator>> (UINT & out) {
+    read_unsigned(out);
+    return *this;
+}
+M3DTextReader & M3DTextReader::operator>> (USHORT & out) {
+    read_unsigned(out);
+    return *this;
+}
+M3DTextReader & M3DTextReader::operator>> (bool & out) {
+    UINT value = 0;
+    read_unsigned(value);
+    if (failed_)
+        return *this;
+    if (value > 1)
+        failed_ = true;
+    out = 0 != value;
+    return *this;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "../common/core_types.h"
+
+//
+// -- Tokenizer over a whole text .m3d file in memory. Extraction behaves like std::istream's operator>>
+// -- (skip whitespace, read as many characters as the value's syntax allows, fail for good on the first error)
+// -- with the same results, but labels are skipped without being copied
+// -- and numbers are converted in place without locale lookups or allocations.
+// -- Floats are correctly rounded like strtof, most of them without calling it
+class M3DTextReader {
+public:
+    // -- extracting a Label skips one whitespace separated token (e.g. "Pos:")
+    struct Label {};
+
+private:
+    char const * begin_;
+    char const * pos_;
+    char const * end_;
+    bool failed_ = false;
+
+    // -- false (and failed) if only whitespace is left
+    bool skip_whitespace ();
+    // -- [sign] digits, false if there are no digits
+    bool read_integer (bool & out_negative, uint64_t & out_magnitude, bool & out_overflow);
+    template <typename T>
+    void read_unsigned (T & out);
+
+public:
+    M3DTextReader (char const * text, size_t size) : begin_(text), pos_(text), end_(text + size) {}
+
+    explicit operator bool () const { return !failed_; }
+    // -- the text is [Begin(), End()), its not yet read part [Position(), End())
+    char const * Begin () const { return begin_; }
+    char const * Position () const { return pos_; }
+    char const * End () const { return end_; }
+
+    // -- whitespace as operator>> sees it in the "C" locale
+    static bool IsSpace (char c) { return ' ' == c || ('\t' <= c && c <= '\r'); }
+
+    M3DTextReader & operator>> (Label);
+    M3DTextReader & operator>> (std::string & out);
+    M3DTextReader & operator>> (float & out);
+    M3DTextReader & operator>> (int & out);
+    M3DTextReader & operator>> (UINT & out);
+    M3DTextReader & operator>> (USHORT & out);
+    // -- 0 or 1
+    M3DTextReader & operator>> (bool & out);
+};
@@ -0,0 +1,49 @@
+#include "pose_cache.h"
+
+using namespace DirectX;
+
+PoseCache::PoseCache (SkinnedData const & skinned_info, UINT num_entries, float time_quantum)
+    : skinned_info_(&skinned_info),
+    time_quantum_(time_quantum),
+    num_entries_(MathHelper::Max(num_entries, 1u)),
+    entries_(new Entry[MathHelper::Max(num_entries, 1u)]),
+    transforms_((size_t)MathHelper::Max(num_entries, 1u) * skinned_info.BoneCount())
+{
+}
+void PoseCache::GetFinalTransforms (
+    SkinnedData::ClipHandle clip,
+    float time_point,
+    DirectX::XMFLOAT4X4 * final_transforms,
+    PoseWorkspace & workspace,
+    UINT bone_lod
+) {
+    UINT frame = (UINT)(MathHelper::Max(time_point, 0.0f) / time_quantum_ + 0.5f);
+
+    // -- consecutive frames of a clip land in consecutive entries
+    Entry & entry = entries_[(frame + clip * 97u + bone_lod * 31u) % num_entries_];
+    UINT num_bones = skinned_info_->BoneCount();
+    XMFLOAT4X4 * cached = transforms_.data() + (size_t)(&entry - entries_.get()) * num_bones;
+
+    std::lock_guard<std::mutex> lock(entry.Lock);
+    if (entry.Clip == clip && entry.Frame == frame && entry.BoneLod == bone_lod) {
+        hits_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        // -- computed under the entry lock so instances asking for the same pose wait for it instead of recomputing
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        skinned_info_->GetFinalTransforms(clip, frame * time_quantum_, cached, workspace, bone_lod);
+        entry.Clip = clip;
+        entry.Frame = frame;
+        entry.BoneLod = bone_lod;
+    }
+    std::copy(cached, cached + num_bones, final_transforms);
+}
+void PoseCache::ResetCounters () {
+    hits_.store(0, std::memory_order_relaxed);
+    misses_.store(0, std::memory_order_relaxed);
+}
+void PoseCache::Clear () {
+    for (UINT i = 0; i < num_entries_; ++i) {
+        std::lock_guard<std::mutex> lock(entries_[i].Lock);
+        entries_[i].Clip = SkinnedData::InvalidClip;
+    }
+}
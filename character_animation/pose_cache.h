@@ -0,0 +1,53 @@
+#pragma once
+
+#include "skinned_data.h"
+
+#include <atomic>
+#include <mutex>
+
+//
+// -- Bounded cache of final transforms shared by the instances of one SkinnedData.
+// -- Entries are keyed by (clip, time point quantized to time_quantum, bone LOD) and direct mapped,
+// -- so a new key evicts whatever occupied its entry. Instances playing a clip in phase
+// -- (e.g. a crowd) compute a pose once per quantum and copy it on every other request.
+// -- Safe to use from several threads, every entry has its own lock.
+// -- skinned_info must be Set before the cache is created
+class PoseCache {
+    struct Entry {
+        std::mutex Lock;
+        SkinnedData::ClipHandle Clip = SkinnedData::InvalidClip;
+        UINT Frame = 0;
+        UINT BoneLod = 0;
+    };
+
+    SkinnedData const * skinned_info_ = nullptr;
+    float time_quantum_ = 0.0f;
+    UINT num_entries_ = 0;
+    std::unique_ptr<Entry[]> entries_;
+    // -- BoneCount transforms per entry
+    std::vector<DirectX::XMFLOAT4X4> transforms_;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+
+public:
+    PoseCache (SkinnedData const & skinned_info, UINT num_entries, float time_quantum = 1.0f / 60.0f);
+    PoseCache (PoseCache const & rhs) = delete;
+    PoseCache & operator= (PoseCache const & rhs) = delete;
+
+    // -- same as SkinnedData::GetFinalTransforms but samples at time_point rounded to the time quantum
+    // -- and only computes the pose (using workspace) if it is not in the cache
+    void GetFinalTransforms (
+        SkinnedData::ClipHandle clip,
+        float time_point,
+        DirectX::XMFLOAT4X4 * final_transforms,
+        PoseWorkspace & workspace,
+        UINT bone_lod = 0
+    );
+
+    uint64_t HitCount () const { return hits_.load(std::memory_order_relaxed); }
+    uint64_t MissCount () const { return misses_.load(std::memory_order_relaxed); }
+    void ResetCounters ();
+    // -- drop all cached poses
+    void Clear ();
+};
@@ -45,9 +45,55 @@ cbuffer PerObjCB : register(b0) {
     uint ObjPad1;
     uint ObjPad2;
 };
-cbuffer SkinnedCB : register(b1) {
-    float4x4 g_bone_transforms[96];
+//
+// -- bone palette of the skinned instance being drawn, sized per rig (bound at the instance's first bone)
+#ifdef DUAL_QUATERNION
+// -- (real, dual) unit dual quaternion per bone
+StructuredBuffer<float4> g_bone_dual_quats : register(t1, space1);
+#else
+// -- 3 rows of the transposed affine transform per bone
+StructuredBuffer<float4> g_bone_palette : register(t1, space1);
+
+float3x4 LoadBoneTransform (uint bone_index) {
+    return float3x4(g_bone_palette[3 * bone_index], g_bone_palette[3 * bone_index + 1], g_bone_palette[3 * bone_index + 2]);
+}
+#endif
+#ifdef INSTANCED
+// -- instances of the batch being drawn (bound at its first instance), replaces PerObjCB
+struct InstanceData {
+    float4x4 World;
+    uint MaterialIndex;
+    uint PaletteOffset;
+    uint InstPad0;
+    uint InstPad1;
 };
+StructuredBuffer<InstanceData> g_instance_data : register(t3, space1);
+#endif
+//
+// -- per object data of what a vertex shader draws: PerObjCB, or the instance when drawing instanced
+// -- (instances have no texture transform, and index the bone palette from its start)
+struct ObjectData {
+    float4x4 World;
+    float4x4 TexTransform;
+    uint MaterialIndex;
+    uint PaletteOffset;
+};
+ObjectData LoadObjectData (uint instance_id) {
+    ObjectData obj;
+#ifdef INSTANCED
+    InstanceData inst = g_instance_data[instance_id];
+    obj.World = inst.World;
+    obj.TexTransform = float4x4(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+    obj.MaterialIndex = inst.MaterialIndex;
+    obj.PaletteOffset = inst.PaletteOffset;
+#else
+    obj.World = g_world;
+    obj.TexTransform = g_tex_transform;
+    obj.MaterialIndex = g_mat_index;
+    obj.PaletteOffset = 0;
+#endif
+    return obj;
+}
 cbuffer PerPassCB : register(b2) {
     float4x4 g_view;
     float4x4 g_inv_view;
@@ -115,3 +161,29 @@ float CalcShadowFactor (float4 shadow_pos_h) {
 
     return percent_lit / 9.0f;
 }
+#ifdef DUAL_QUATERNION
+//
+// -- blend the dual quaternions of the bones of a vertex, q and -q are the same rotation
+// -- so every bone is taken in the hemisphere of the first one before normalizing
+float2x4 BlendBoneDualQuats (float4 weights, uint4 bone_indices) {
+    float4 first_real = g_bone_dual_quats[2 * bone_indices[0]];
+    float4 real = float4(0.0f, 0.0f, 0.0f, 0.0f);
+    float4 dual = float4(0.0f, 0.0f, 0.0f, 0.0f);
+    [unroll]
+    for (int i = 0; i < 4; ++i) {
+        float4 bone_real = g_bone_dual_quats[2 * bone_indices[i]];
+        float w = dot(bone_real, first_real) < 0.0f ? -weights[i] : weights[i];
+        real += w * bone_real;
+        dual += w * g_bone_dual_quats[2 * bone_indices[i] + 1];
+    }
+    float inv_length = rcp(length(real));
+    return float2x4(real * inv_length, dual * inv_length);
+}
+float3 DualQuatRotate (float2x4 dq, float3 v) {
+    return v + 2.0f * cross(dq[0].xyz, cross(dq[0].xyz, v) + dq[0].w * v);
+}
+float3 DualQuatTransformPoint (float2x4 dq, float3 p) {
+    float3 translation = 2.0f * (dq[0].w * dq[1].xyz - dq[1].w * dq[0].xyz + cross(dq[0].xyz, dq[1].xyz));
+    return DualQuatRotate(dq, p) + translation;
+}
+#endif
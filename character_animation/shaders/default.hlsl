@@ -20,6 +20,7 @@ struct VertexIn {
     float3 BoneWeights : WEIGHTS;
     uint4 BoneIndices : BONEINDICES;
 #endif
+    uint InstanceID : SV_InstanceID;
 };
 struct VertexOut {
     float4 PosH : SV_POSITION;
@@ -29,11 +30,14 @@ struct VertexOut {
     float3 NormalW : NORMAL;
     float3 TangentW : TANGENT;
     float2 TexC : TEXCOORD;
+    nointerpolation uint MatIndex : MATINDEX;
 };
 VertexOut VS (VertexIn vin) {
     VertexOut vout = (VertexOut)0.0f;
 
-    MaterialData matdata = g_matdata[g_mat_index];
+    ObjectData obj = LoadObjectData(vin.InstanceID);
+    vout.MatIndex = obj.MaterialIndex;
+    MaterialData matdata = g_matdata[obj.MaterialIndex];
 
 #ifdef SKINNED
     float weights[4] = {0.0f, 0.0f, 0.0f, 0.0f};
@@ -41,31 +45,40 @@ VertexOut VS (VertexIn vin) {
     weights[1] = vin.BoneWeights.y;
     weights[2] = vin.BoneWeights.z;
     weights[3] = 1.0f - weights[0] - weights[1] - weights[2];
-
+    vin.BoneIndices += obj.PaletteOffset;
+
+#ifdef DUAL_QUATERNION
+    float2x4 dq = BlendBoneDualQuats(float4(weights[0], weights[1], weights[2], weights[3]), vin.BoneIndices);
+    vin.PosL = DualQuatTransformPoint(dq, vin.PosL);
+    vin.NormalL = DualQuatRotate(dq, vin.NormalL);
+    vin.TangentL = DualQuatRotate(dq, vin.TangentL);
+#else
     float3 pos_local = float3(0.0f, 0.0f, 0.0f);
     float3 normal_local = float3(0.0f, 0.0f, 0.0f);
     float3 tangent_local = float3(0.0f, 0.0f, 0.0f);
     for (int i = 0; i < 4; ++i) {
+        float3x4 bone_transform = LoadBoneTransform(vin.BoneIndices[i]);
         // -- assume no nonuniform scaling, otherwise inverse-transpose needed
         pos_local +=
-            weights[i] * mul(float4(vin.PosL, 1.0f), g_bone_transforms[vin.BoneIndices[i]]).xyz;
+            weights[i] * mul(bone_transform, float4(vin.PosL, 1.0f));
         normal_local +=
-            weights[i] * mul(vin.NormalL, (float3x3)g_bone_transforms[vin.BoneIndices[i]]);
+            weights[i] * mul((float3x3)bone_transform, vin.NormalL);
         tangent_local +=
-            weights[i] * mul(vin.TangentL.xyz, (float3x3)g_bone_transforms[vin.BoneIndices[i]]);
+            weights[i] * mul((float3x3)bone_transform, vin.TangentL.xyz);
     }
     vin.PosL = pos_local;
     vin.NormalL = normal_local;
     vin.TangentL = tangent_local;
+#endif
 #endif
     // -- transform to world space
-    float4 pos_world = mul(float4(vin.PosL, 1.0f), g_world);
+    float4 pos_world = mul(float4(vin.PosL, 1.0f), obj.World);
     vout.PosW = pos_world.xyz;
 
     // -- assume nonuniform scaling
-    vout.NormalW = mul(vin.NormalL, (float3x3)g_world);
+    vout.NormalW = mul(vin.NormalL, (float3x3)obj.World);
 
-    vout.TangentW = mul(vin.TangentL, (float3x3)g_world);
+    vout.TangentW = mul(vin.TangentL, (float3x3)obj.World);
 
     // -- transform to homogenous clip space
     vout.PosH = mul(pos_world, g_view_proj);
@@ -74,7 +87,7 @@ VertexOut VS (VertexIn vin) {
     vout.SSAOPosH = mul(pos_world, g_view_proj_tex);
 
     // -- output vertex attributes for interpolation across triangle
-    float4 texc = mul(float4(vin.TexC, 0.0f, 1.0f), g_tex_transform);
+    float4 texc = mul(float4(vin.TexC, 0.0f, 1.0f), obj.TexTransform);
     vout.TexC = mul(texc, matdata.MatTransform).xy;
 
     // -- generate projectiv tex coords for projecting shadow map onto scene
@@ -83,7 +96,7 @@ VertexOut VS (VertexIn vin) {
     return vout;
 }
 float4 PS (VertexOut pin) : SV_TARGET {
-    MaterialData matdata = g_matdata[g_mat_index];
+    MaterialData matdata = g_matdata[pin.MatIndex];
     float4 diffuse_albedo = matdata.DiffuseAlbedo;
     float3 fresnelr0 = matdata.FresnelR0;
     float roughness = matdata.Roughness;
@@ -0,0 +1,64 @@
+#include "common.hlsl"
+
+//
+// -- Skins the vertices of one skinned instance once per frame, every pass then draws the posed vertices
+// -- with the unskinned shaders instead of skinning them again in its vertex shader
+#define PRE_SKINNING_GROUP_SIZE 64
+
+// -- same layout as SkinnedVertex (BoneIndices are 4 bytes packed in one uint)
+struct SkinnedVertexIn {
+    float3 Pos;
+    float3 Normal;
+    float2 TexC;
+    float3 TangentU;
+    float3 BoneWeights;
+    uint BoneIndices;
+};
+// -- same layout as Vertex, matches the unskinned input layout
+struct PosedVertexOut {
+    float3 Pos;
+    float3 Normal;
+    float2 TexC;
+    float3 TangentU;
+};
+
+cbuffer PreSkinningCB : register(b3) {
+    uint g_num_vertices;
+};
+StructuredBuffer<SkinnedVertexIn> g_skinned_vertices : register(t2, space1);
+RWStructuredBuffer<PosedVertexOut> g_posed_vertices : register(u0, space1);
+
+[numthreads(PRE_SKINNING_GROUP_SIZE, 1, 1)]
+void CS (uint3 dispatch_id : SV_DispatchThreadID) {
+    uint vertex_index = dispatch_id.x;
+    if (vertex_index >= g_num_vertices)
+        return;
+
+    SkinnedVertexIn vin = g_skinned_vertices[vertex_index];
+    uint4 bone_indices = uint4(
+        vin.BoneIndices & 0xff, (vin.BoneIndices >> 8) & 0xff, (vin.BoneIndices >> 16) & 0xff, vin.BoneIndices >> 24
+    );
+    float4 weights = float4(vin.BoneWeights, 1.0f - vin.BoneWeights.x - vin.BoneWeights.y - vin.BoneWeights.z);
+
+    PosedVertexOut vout;
+#ifdef DUAL_QUATERNION
+    float2x4 dq = BlendBoneDualQuats(weights, bone_indices);
+    vout.Pos = DualQuatTransformPoint(dq, vin.Pos);
+    vout.Normal = DualQuatRotate(dq, vin.Normal);
+    vout.TangentU = DualQuatRotate(dq, vin.TangentU);
+#else
+    // -- skinning is linear in the bone transforms: blend them first, then transform once
+    float3x4 blended = weights[0] * LoadBoneTransform(bone_indices[0]);
+    [unroll]
+    for (int i = 1; i < 4; ++i)
+        blended += weights[i] * LoadBoneTransform(bone_indices[i]);
+
+    // -- assume no nonuniform scaling, otherwise inverse-transpose needed
+    vout.Pos = mul(blended, float4(vin.Pos, 1.0f));
+    vout.Normal = mul((float3x3)blended, vin.Normal);
+    vout.TangentU = mul((float3x3)blended, vin.TangentU);
+#endif
+    vout.TexC = vin.TexC;
+
+    g_posed_vertices[vertex_index] = vout;
+}
@@ -7,34 +7,44 @@ struct VertexIn {
     float3 BoneWeights : WEIGHTS;
     uint4 BoneIndices : BONEINDICES;
 #endif
+    uint InstanceID : SV_InstanceID;
 };
 struct VertexOut {
     float4 PosH : SV_POSITION;
     float2 TexC : TEXCOORD;
+    nointerpolation uint MatIndex : MATINDEX;
 };
 
 VertexOut VS (VertexIn vin) {
     VertexOut vout = (VertexOut)0.0f;
 
-    MaterialData matdata = g_matdata[g_mat_index];
+    ObjectData obj = LoadObjectData(vin.InstanceID);
+    vout.MatIndex = obj.MaterialIndex;
+    MaterialData matdata = g_matdata[obj.MaterialIndex];
 #ifdef SKINNED
     float weights[4] = {0.0f, 0.0f, 0.0f, 0.0f};
     weights[0] = vin.BoneWeights.x;
     weights[1] = vin.BoneWeights.y;
     weights[2] = vin.BoneWeights.z;
     weights[3] = 1.0f - weights[0] - weights[1] - weights[2];
+    vin.BoneIndices += obj.PaletteOffset;
 
+#ifdef DUAL_QUATERNION
+    float2x4 dq = BlendBoneDualQuats(float4(weights[0], weights[1], weights[2], weights[3]), vin.BoneIndices);
+    vin.PosL = DualQuatTransformPoint(dq, vin.PosL);
+#else
     float3 pos_local = float3(0.0f, 0.0f, 0.0f);
     for (int i = 0; i < 4; ++i) {
-        pos_local += weights[i] * mul(float4(vin.PosL, 1.0f), g_bone_transforms[vin.BoneIndices[i]]).xyz;
+        pos_local += weights[i] * mul(LoadBoneTransform(vin.BoneIndices[i]), float4(vin.PosL, 1.0f));
     }
     vin.PosL = pos_local;
 #endif
-    float4 pos_world = mul(float4(vin.PosL, 1.0f), g_world);
+#endif
+    float4 pos_world = mul(float4(vin.PosL, 1.0f), obj.World);
 
     vout.PosH = mul(pos_world, g_view_proj);
 
-    float4 texc = mul(float4(vin.TexC, 0.0f, 1.0f), g_tex_transform);
+    float4 texc = mul(float4(vin.TexC, 0.0f, 1.0f), obj.TexTransform);
     vout.TexC = mul(texc, matdata.MatTransform).xy;
 
     return vout;
@@ -42,7 +52,7 @@ VertexOut VS (VertexIn vin) {
 // -- This PS is only for alpha cut out geometry so shadows are correct
 // -- For other ordinary geometry we could use a NULL pass-through PS
 void PS (VertexOut pin) {
-    MaterialData matdata = g_matdata[g_mat_index];
+    MaterialData matdata = g_matdata[pin.MatIndex];
     float4 albedo = matdata.DiffuseAlbedo;
     uint index = matdata.DiffuseMapIndex;
     albedo *= g_texmaps[index].Sample(g_sam_anisotropic_wrap, pin.TexC);
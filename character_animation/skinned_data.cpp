@@ -1,4 +1,7 @@
 #include "skinned_data.h"
+#include "pose_cache.h"
+#include "hierarchy_kernel.h"
+#include "../common/job_system.h"
 
 using namespace DirectX;
 
@@ -12,13 +15,76 @@ Keyframe::Keyframe ()
 Keyframe::~Keyframe () {
 }
 
+XMMATRIX RootMotion::ToMatrix () const {
+    return XMMatrixMultiply(XMMatrixRotationY(Yaw), XMMatrixTranslation(Translation.x, Translation.y, Translation.z));
+}
+// -- motion that takes a model from placement a to placement b
+static RootMotion relative_motion (RootMotion const & a, RootMotion const & b) {
+    RootMotion motion;
+    motion.Yaw = b.Yaw - a.Yaw;
+    XMVECTOR translation = XMVectorSubtract(XMLoadFloat3(&b.Translation), XMLoadFloat3(&a.Translation));
+    XMStoreFloat3(&motion.Translation, XMVector3TransformNormal(translation, XMMatrixRotationY(-a.Yaw)));
+    return motion;
+}
+// -- motion first followed by motion second
+static RootMotion concatenate_motion (RootMotion const & first, RootMotion const & second) {
+    RootMotion motion;
+    motion.Yaw = first.Yaw + second.Yaw;
+    XMVECTOR translation = XMVector3TransformNormal(XMLoadFloat3(&second.Translation), XMMatrixRotationY(first.Yaw));
+    XMStoreFloat3(&motion.Translation, XMVectorAdd(translation, XMLoadFloat3(&first.Translation)));
+    return motion;
+}
+static RootMotion sample_root_motion (std::vector<RootMotionKey> const & track, float t) {
+    if (t <= track.front().TimePoint)
+        return track.front().Placement;
+    if (t >= track.back().TimePoint)
+        return track.back().Placement;
+
+    auto upper = std::upper_bound(track.begin(), track.end(), t,
+        [](float t, RootMotionKey const & key) { return t < key.TimePoint; }
+    );
+    RootMotionKey const & k0 = *(upper - 1);
+    RootMotionKey const & k1 = *upper;
+    float lerp_percent = (t - k0.TimePoint) / (k1.TimePoint - k0.TimePoint);
+
+    RootMotion placement;
+    XMStoreFloat3(&placement.Translation, XMVectorLerp(
+        XMLoadFloat3(&k0.Placement.Translation), XMLoadFloat3(&k1.Placement.Translation), lerp_percent
+    ));
+    placement.Yaw = MathHelper::Lerp(k0.Placement.Yaw, k1.Placement.Yaw, lerp_percent);
+    return placement;
+}
+
 float BoneAnimation::GetStartTime () const {
     return Keyframes.front().TimePoint;
 }
 float BoneAnimation::GetEndTime () const {
     return Keyframes.back().TimePoint;
 }
+UINT BoneAnimation::FindKeyframe (float t, UINT & cursor) const {
+    UINT const last_segment = (UINT)Keyframes.size() - 2;
+
+    // -- monotonic playback: t is usually in the cached segment or the next one
+    if (cursor <= last_segment && t >= Keyframes[cursor].TimePoint) {
+        if (t < Keyframes[cursor + 1].TimePoint)
+            return cursor;
+        if (cursor < last_segment && t < Keyframes[cursor + 2].TimePoint)
+            return ++cursor;
+    }
+
+    // -- random access: binary search for the first inner keyframe later than t
+    auto upper = std::upper_bound(
+        Keyframes.begin() + 1, Keyframes.end() - 1, t,
+        [](float time_point, Keyframe const & k) { return time_point < k.TimePoint; }
+    );
+    cursor = (UINT)(upper - Keyframes.begin()) - 1;
+    return cursor;
+}
 void BoneAnimation::Interpolate (float t, XMFLOAT4X4 & out_mat) const {
+    UINT cursor = 0;
+    Interpolate(t, out_mat, cursor);
+}
+void BoneAnimation::Interpolate (float t, XMFLOAT4X4 & out_mat, UINT & cursor) const {
     if (t <= Keyframes.front().TimePoint) {
         XMVECTOR S = XMLoadFloat3(&Keyframes.front().Scale);
         XMVECTOR P = XMLoadFloat3(&Keyframes.front().Translation);
@@ -34,31 +100,57 @@ void BoneAnimation::Interpolate (float t, XMFLOAT4X4 & out_mat) const {
         XMVECTOR zero = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
         XMStoreFloat4x4(&out_mat, XMMatrixAffineTransformation(S, zero, Q, P));
     } else {
-        for (UINT i = 0; i < Keyframes.size() - 1; ++i) {
-            // -- find the upper and lower time points
-            if (t >= Keyframes[i].TimePoint && t <= Keyframes[i + 1].TimePoint) {
-                float lerp_percent =
-                    (t - Keyframes[i].TimePoint) / (Keyframes[i + 1].TimePoint - Keyframes[i].TimePoint);
+        // -- find the upper and lower time points
+        UINT i = FindKeyframe(t, cursor);
 
-                XMVECTOR s0 = XMLoadFloat3(&Keyframes[i].Scale);
-                XMVECTOR s1 = XMLoadFloat3(&Keyframes[i + 1].Scale);
+        float lerp_percent =
+            (t - Keyframes[i].TimePoint) / (Keyframes[i + 1].TimePoint - Keyframes[i].TimePoint);
 
-                XMVECTOR p0 = XMLoadFloat3(&Keyframes[i].Translation);
-                XMVECTOR p1 = XMLoadFloat3(&Keyframes[i + 1].Translation);
+        XMVECTOR s0 = XMLoadFloat3(&Keyframes[i].Scale);
+        XMVECTOR s1 = XMLoadFloat3(&Keyframes[i + 1].Scale);
 
-                XMVECTOR q0 = XMLoadFloat4(&Keyframes[i].RotationQuat);
-                XMVECTOR q1 = XMLoadFloat4(&Keyframes[i + 1].RotationQuat);
+        XMVECTOR p0 = XMLoadFloat3(&Keyframes[i].Translation);
+        XMVECTOR p1 = XMLoadFloat3(&Keyframes[i + 1].Translation);
 
-                XMVECTOR S = XMVectorLerp(s0, s1, lerp_percent);
-                XMVECTOR P = XMVectorLerp(p0, p1, lerp_percent);
-                XMVECTOR Q = XMQuaternionSlerp(q0, q1, lerp_percent);
-                // -- rotation orgin is (0,0,0) point
-                XMVECTOR zero = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
-                XMStoreFloat4x4(&out_mat, XMMatrixAffineTransformation(S, zero, Q, P));
+        XMVECTOR q0 = XMLoadFloat4(&Keyframes[i].RotationQuat);
+        XMVECTOR q1 = XMLoadFloat4(&Keyframes[i + 1].RotationQuat);
 
-                break;
-            }
-        }
+        XMVECTOR S = XMVectorLerp(s0, s1, lerp_percent);
+        XMVECTOR P = XMVectorLerp(p0, p1, lerp_percent);
+        XMVECTOR Q = XMQuaternionSlerp(q0, q1, lerp_percent);
+        // -- rotation orgin is (0,0,0) point
+        XMVECTOR zero = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+        XMStoreFloat4x4(&out_mat, XMMatrixAffineTransformation(S, zero, Q, P));
+    }
+}
+void BoneAnimation::Interpolate (float t, Keyframe & out_key, UINT & cursor) const {
+    out_key.TimePoint = t;
+    if (t <= Keyframes.front().TimePoint) {
+        out_key.Translation = Keyframes.front().Translation;
+        out_key.Scale = Keyframes.front().Scale;
+        out_key.RotationQuat = Keyframes.front().RotationQuat;
+    } else if (t >= Keyframes.back().TimePoint) {
+        out_key.Translation = Keyframes.back().Translation;
+        out_key.Scale = Keyframes.back().Scale;
+        out_key.RotationQuat = Keyframes.back().RotationQuat;
+    } else {
+        UINT i = FindKeyframe(t, cursor);
+
+        float lerp_percent =
+            (t - Keyframes[i].TimePoint) / (Keyframes[i + 1].TimePoint - Keyframes[i].TimePoint);
+
+        XMVECTOR s0 = XMLoadFloat3(&Keyframes[i].Scale);
+        XMVECTOR s1 = XMLoadFloat3(&Keyframes[i + 1].Scale);
+
+        XMVECTOR p0 = XMLoadFloat3(&Keyframes[i].Translation);
+        XMVECTOR p1 = XMLoadFloat3(&Keyframes[i + 1].Translation);
+
+        XMVECTOR q0 = XMLoadFloat4(&Keyframes[i].RotationQuat);
+        XMVECTOR q1 = XMLoadFloat4(&Keyframes[i + 1].RotationQuat);
+
+        XMStoreFloat3(&out_key.Scale, XMVectorLerp(s0, s1, lerp_percent));
+        XMStoreFloat3(&out_key.Translation, XMVectorLerp(p0, p1, lerp_percent));
+        XMStoreFloat4(&out_key.RotationQuat, XMQuaternionSlerp(q0, q1, lerp_percent));
     }
 }
 float AnimationClip::GetClipStartTime () const {
@@ -82,64 +174,971 @@ void AnimationClip::Interpolate (
     for (UINT i = 0; i < BoneAnimations.size(); ++i)
         BoneAnimations[i].Interpolate(t, out_bone_transforms[i]);
 }
+void AnimationClip::Interpolate (
+    float t,
+    std::vector<DirectX::XMFLOAT4X4> & out_bone_transforms,
+    std::vector<UINT> & keyframe_cursors
+) const {
+    for (UINT i = 0; i < BoneAnimations.size(); ++i)
+        BoneAnimations[i].Interpolate(t, out_bone_transforms[i], keyframe_cursors[i]);
+}
+void AnimationClip::Interpolate (float t, std::vector<Keyframe> & out_pose) const {
+    for (UINT i = 0; i < BoneAnimations.size(); ++i) {
+        UINT cursor = 0;
+        BoneAnimations[i].Interpolate(t, out_pose[i], cursor);
+    }
+}
+void AnimationClip::MakeAdditive (std::vector<Keyframe> const & reference_pose) {
+    for (UINT i = 0; i < BoneAnimations.size(); ++i) {
+        Keyframe const & ref = reference_pose[i];
+        XMVECTOR ref_p = XMLoadFloat3(&ref.Translation);
+        XMVECTOR ref_q_inv = XMQuaternionConjugate(XMLoadFloat4(&ref.RotationQuat));
+        // -- a zero reference scale component can't be divided out, keep the key's own scale there
+        XMVECTOR ref_s = XMLoadFloat3(&ref.Scale);
+        ref_s = XMVectorSelect(ref_s, XMVectorSplatOne(), XMVectorEqual(ref_s, XMVectorZero()));
+
+        for (Keyframe & key : BoneAnimations[i].Keyframes) {
+            // -- reference rotation followed by the difference gives back the key: q = ref_q * diff_q
+            XMVECTOR q = XMQuaternionNormalize(XMQuaternionMultiply(XMLoadFloat4(&key.RotationQuat), ref_q_inv));
+
+            XMStoreFloat3(&key.Translation, XMVectorSubtract(XMLoadFloat3(&key.Translation), ref_p));
+            XMStoreFloat4(&key.RotationQuat, q);
+            XMStoreFloat3(&key.Scale, XMVectorDivide(XMLoadFloat3(&key.Scale), ref_s));
+        }
+    }
+}
+// -- grow max_error by the difference between two keyframes
+static void accumulate_error (Keyframe const & a, Keyframe const & b, ResampleError & max_error) {
+    XMVECTOR dp = XMVectorSubtract(XMLoadFloat3(&a.Translation), XMLoadFloat3(&b.Translation));
+    XMVECTOR ds = XMVectorAbs(XMVectorSubtract(XMLoadFloat3(&a.Scale), XMLoadFloat3(&b.Scale)));
+    // -- rotation angle from the chord between unit quaternions (acos is too imprecise near 1)
+    XMVECTOR q0 = XMQuaternionNormalize(XMLoadFloat4(&a.RotationQuat));
+    XMVECTOR q1 = XMQuaternionNormalize(XMLoadFloat4(&b.RotationQuat));
+    float chord = MathHelper::Min(
+        XMVectorGetX(XMVector4Length(XMVectorSubtract(q0, q1))),
+        XMVectorGetX(XMVector4Length(XMVectorAdd(q0, q1)))
+    );
+
+    max_error.MaxTranslation = MathHelper::Max(max_error.MaxTranslation, XMVectorGetX(XMVector3Length(dp)));
+    max_error.MaxScale = MathHelper::Max(max_error.MaxScale, XMVectorGetX(ds));
+    max_error.MaxScale = MathHelper::Max(max_error.MaxScale, XMVectorGetY(ds));
+    max_error.MaxScale = MathHelper::Max(max_error.MaxScale, XMVectorGetZ(ds));
+    max_error.MaxRotation = MathHelper::Max(max_error.MaxRotation, 4.0f * asinf(MathHelper::Min(0.5f * chord, 1.0f)));
+}
+
+UINT BoneAnimation::Reduce (ResampleError const & tolerance) {
+    if (Keyframes.size() <= 2)
+        return 0;
+
+    std::vector<Keyframe> reduced;
+    reduced.push_back(Keyframes.front());
+
+    // -- greedily stretch a segment from the last kept keyframe while it still reproduces
+    // -- every skipped keyframe within tolerance
+    UINT anchor = 0;
+    for (UINT candidate = 2; candidate < Keyframes.size(); ++candidate) {
+        BoneAnimation segment;
+        segment.Keyframes = {Keyframes[anchor], Keyframes[candidate]};
+
+        ResampleError error;
+        UINT cursor = 0;
+        for (UINT j = anchor + 1; j < candidate; ++j) {
+            Keyframe k;
+            segment.Interpolate(Keyframes[j].TimePoint, k, cursor);
+            accumulate_error(k, Keyframes[j], error);
+        }
+
+        bool fits =
+            error.MaxTranslation <= tolerance.MaxTranslation &&
+            error.MaxRotation <= tolerance.MaxRotation &&
+            error.MaxScale <= tolerance.MaxScale;
+        if (!fits) {
+            anchor = candidate - 1;
+            reduced.push_back(Keyframes[anchor]);
+        }
+    }
+    reduced.push_back(Keyframes.back());
+
+    UINT num_removed = (UINT)(Keyframes.size() - reduced.size());
+    Keyframes = std::move(reduced);
+    return num_removed;
+}
+
+void AnimationClip::ExtractRootMotion (std::vector<int> const & bone_hierarchy) {
+    auto root = std::find(bone_hierarchy.begin(), bone_hierarchy.end(), -1);
+    if (root == bone_hierarchy.end())
+        return;
+
+    //
+    // -- placement of the first root: its translation in the xz-plane and the twist about +y
+    // -- of its rotation relative to the first keyframe (unwrapped so yaw is continuous)
+    std::vector<Keyframe> const & root_keys = BoneAnimations[root - bone_hierarchy.begin()].Keyframes;
+    XMVECTOR first_q_inv = XMQuaternionConjugate(XMLoadFloat4(&root_keys.front().RotationQuat));
+
+    RootMotionTrack.resize(root_keys.size());
+    for (UINT k = 0; k < root_keys.size(); ++k) {
+        XMFLOAT4 twist;
+        XMStoreFloat4(&twist, XMQuaternionMultiply(first_q_inv, XMLoadFloat4(&root_keys[k].RotationQuat)));
+        float yaw = 2.0f * atan2f(twist.y, twist.w);
+        if (k > 0) {
+            float prev_yaw = RootMotionTrack[k - 1].Placement.Yaw;
+            yaw -= 2.0f * MathHelper::PI * floorf((yaw - prev_yaw) / (2.0f * MathHelper::PI) + 0.5f);
+        }
+
+        RootMotionTrack[k].TimePoint = root_keys[k].TimePoint;
+        RootMotionTrack[k].Placement.Translation = XMFLOAT3(root_keys[k].Translation.x, 0.0f, root_keys[k].Translation.z);
+        RootMotionTrack[k].Placement.Yaw = yaw;
+    }
+
+    //
+    // -- remove the placement from every root: rotate by -yaw after moving back to the model origin
+    for (UINT i = 0; i < bone_hierarchy.size(); ++i) {
+        if (bone_hierarchy[i] >= 0)
+            continue;
+        for (Keyframe & key : BoneAnimations[i].Keyframes) {
+            RootMotion placement = sample_root_motion(RootMotionTrack, key.TimePoint);
+            XMMATRIX unrotate = XMMatrixRotationY(-placement.Yaw);
+
+            XMVECTOR p = XMVectorSubtract(XMLoadFloat3(&key.Translation), XMLoadFloat3(&placement.Translation));
+            XMVECTOR q = XMQuaternionMultiply(
+                XMLoadFloat4(&key.RotationQuat), XMQuaternionRotationNormal(XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), -placement.Yaw)
+            );
+            XMStoreFloat3(&key.Translation, XMVector3TransformNormal(p, unrotate));
+            XMStoreFloat4(&key.RotationQuat, XMQuaternionNormalize(q));
+        }
+    }
+}
+ResampleError AnimationClip::Resample (float sample_rate) {
+    ResampleError error;
+
+    float start_time = GetClipStartTime();
+    float end_time = GetClipEndTime();
+
+    // -- the rate is rounded up so whole frames span the clip: the first frame lands on start time
+    // -- and the last one on end time, and frame f stays at start time + f / rate for O(1) indexing
+    float duration = end_time - start_time;
+    UINT num_frames = (UINT)ceilf(duration * sample_rate) + 1;
+    num_frames = MathHelper::Max(num_frames, 2u);
+    if (duration > 0.0f)
+        sample_rate = (float)(num_frames - 1) / duration;
+
+    for (UINT i = 0; i < BoneAnimations.size(); ++i) {
+        BoneAnimation resampled;
+        resampled.Keyframes.resize(num_frames);
+
+        UINT cursor = 0;
+        for (UINT f = 0; f < num_frames; ++f) {
+            float t = f + 1 < num_frames ? start_time + f / sample_rate : end_time;
+            BoneAnimations[i].Interpolate(t, resampled.Keyframes[f], cursor);
+        }
+
+        // -- measure error of the resampled animation at every source keyframe
+        cursor = 0;
+        for (Keyframe const & src : BoneAnimations[i].Keyframes) {
+            Keyframe k;
+            resampled.Interpolate(src.TimePoint, k, cursor);
+
+            accumulate_error(k, src, error);
+        }
+
+        BoneAnimations[i] = std::move(resampled);
+    }
+
+    SampleRate = sample_rate;
+    return error;
+}
+UINT AnimationClip::ReduceKeyframes (std::vector<int> const & bone_hierarchy, float tolerance) {
+    UINT num_bones = (UINT)BoneAnimations.size();
+    if (0 == num_bones)
+        return 0;
+
+    //
+    // -- bones in any order: count the ancestors of every bone, visiting by that count puts parents first
+    // -- (like SkinnedData::Set orders them)
+    std::vector<UINT> ancestors(num_bones, 0);
+    for (UINT i = 0; i < num_bones; ++i)
+        for (int p = bone_hierarchy[i]; p >= 0 && ancestors[i] < num_bones; p = bone_hierarchy[p])
+            ++ancestors[i];
+    std::vector<UINT> order(num_bones);
+    for (UINT i = 0; i < num_bones; ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&ancestors](UINT a, UINT b) { return ancestors[a] < ancestors[b]; });
+
+    //
+    // -- an end effector accumulates the error of every bone on its chain, so split the tolerance
+    // -- evenly over the longest chain
+    std::vector<bool> is_leaf(num_bones, true);
+    UINT max_depth = 1;
+    for (UINT i = 0; i < num_bones; ++i) {
+        if (bone_hierarchy[i] >= 0)
+            is_leaf[bone_hierarchy[i]] = false;
+        max_depth = MathHelper::Max(max_depth, ancestors[i] + 1);
+    }
+    // -- the translation, rotation and scale errors of a bone add up at its joints, each gets a third
+    float channel_tolerance = tolerance / max_depth / 3.0f;
+
+    //
+    // -- rotation/scale error of a bone is amplified by the distance to its farthest descendant joint,
+    // -- leaf bones have no descendants so assume their skin extends about as far as the bone itself.
+    // -- The translation of a root is its displacement in the model, not a bone, so it never adds to reach
+    std::vector<float> bone_length(num_bones, 0.0f);
+    for (UINT i = 0; i < num_bones; ++i)
+        if (bone_hierarchy[i] >= 0)
+            for (Keyframe const & k : BoneAnimations[i].Keyframes)
+                bone_length[i] = MathHelper::Max(bone_length[i], XMVectorGetX(XMVector3Length(XMLoadFloat3(&k.Translation))));
+
+    // -- children before parents
+    std::vector<float> reach(num_bones, 0.0f);
+    for (UINT i = 0; i < num_bones; ++i)
+        if (is_leaf[i])
+            reach[i] = bone_length[i];
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+        int parent = bone_hierarchy[*it];
+        if (parent >= 0)
+            reach[parent] = MathHelper::Max(reach[parent], reach[*it] + bone_length[*it]);
+    }
+
+    UINT num_removed = 0;
+    for (UINT i = 0; i < num_bones; ++i) {
+        ResampleError bone_error;
+        bone_error.MaxTranslation = channel_tolerance;
+        bone_error.MaxRotation = channel_tolerance / MathHelper::Max(reach[i], channel_tolerance);
+        bone_error.MaxScale = channel_tolerance / MathHelper::Max(reach[i], channel_tolerance);
+        num_removed += BoneAnimations[i].Reduce(bone_error);
+    }
+
+    // -- remaining keyframes are no longer evenly spaced
+    if (num_removed > 0)
+        SampleRate = 0.0f;
+    return num_removed;
+}
+
+void PackedAnimationClip::Build (AnimationClip const & clip) {
+    UINT num_bones = (UINT)clip.BoneAnimations.size();
+
+    KeyframeOffsets.resize(num_bones + 1);
+    KeyframeOffsets[0] = 0;
+    for (UINT i = 0; i < num_bones; ++i)
+        KeyframeOffsets[i + 1] = KeyframeOffsets[i] + (UINT)clip.BoneAnimations[i].Keyframes.size();
+
+    // -- 1 float time point + 3 translation + 4 rotation + 3 scale per keyframe
+    UINT num_keyframes = KeyframeCount();
+    Data.resize(num_keyframes * 11);
+
+    float * time_points = Data.data();
+    XMFLOAT3 * translations = reinterpret_cast<XMFLOAT3 *>(Data.data() + num_keyframes);
+    XMFLOAT4 * rotations = reinterpret_cast<XMFLOAT4 *>(Data.data() + num_keyframes * 4);
+    XMFLOAT3 * scales = reinterpret_cast<XMFLOAT3 *>(Data.data() + num_keyframes * 8);
+
+    for (UINT i = 0; i < num_bones; ++i) {
+        auto const & keyframes = clip.BoneAnimations[i].Keyframes;
+        for (UINT k = 0; k < keyframes.size(); ++k) {
+            UINT dst = KeyframeOffsets[i] + k;
+            time_points[dst] = keyframes[k].TimePoint;
+            translations[dst] = keyframes[k].Translation;
+            rotations[dst] = keyframes[k].RotationQuat;
+            scales[dst] = keyframes[k].Scale;
+        }
+    }
+
+    start_time_ = clip.GetClipStartTime();
+    end_time_ = clip.GetClipEndTime();
+
+    // -- direct frame indexing needs every bone to share the same uniform keyframes
+    sample_rate_ = clip.SampleRate;
+    for (UINT i = 0; i < num_bones; ++i) {
+        UINT num_bone_keyframes = KeyframeOffsets[i + 1] - KeyframeOffsets[i];
+        if (num_bone_keyframes < 2 || num_bone_keyframes != KeyframeOffsets[1])
+            sample_rate_ = 0.0f;
+    }
+}
+UINT PackedAnimationClip::FindKeyframe (float const * time_points, UINT num_keyframes, float t, UINT & cursor) {
+    UINT const last_segment = num_keyframes - 2;
+
+    if (cursor <= last_segment && t >= time_points[cursor]) {
+        if (t < time_points[cursor + 1])
+            return cursor;
+        if (cursor < last_segment && t < time_points[cursor + 2])
+            return ++cursor;
+    }
+
+    float const * upper = std::upper_bound(time_points + 1, time_points + num_keyframes - 1, t);
+    cursor = (UINT)(upper - time_points) - 1;
+    return cursor;
+}
+template <typename StoreBone>
+void PackedAnimationClip::sample (
+    float t, std::vector<UINT> & keyframe_cursors,
+    std::vector<UINT> const * bone_subset, StoreBone const & store_bone
+) const {
+    float const * time_points = TimePoints();
+    XMFLOAT3 const * translations = Translations();
+    XMFLOAT4 const * rotations = RotationQuats();
+    XMFLOAT3 const * scales = Scales();
+
+    UINT num_bones = bone_subset ? (UINT)bone_subset->size() : BoneCount();
+    UINT const * bones = bone_subset ? bone_subset->data() : nullptr;
+
+    if (sample_rate_ > 0.0f && num_bones > 0) {
+        // -- uniformly sampled: all bones share the same frame index and lerp percent
+        UINT last_frame = KeyframeOffsets[1] - 1;
+        float frame_time = (MathHelper::Max(t, start_time_) - start_time_) * sample_rate_;
+
+        UINT frame = last_frame - 1;
+        float lerp_percent = 1.0f;
+        if (frame_time < (float)last_frame) {
+            frame = (UINT)frame_time;
+            lerp_percent = frame_time - (float)frame;
+        }
+
+        for (UINT n = 0; n < num_bones; ++n) {
+            UINT i = bones ? bones[n] : n;
+            UINT k = KeyframeOffsets[i] + frame;
+
+            XMVECTOR S = XMVectorLerp(XMLoadFloat3(&scales[k]), XMLoadFloat3(&scales[k + 1]), lerp_percent);
+            XMVECTOR P = XMVectorLerp(XMLoadFloat3(&translations[k]), XMLoadFloat3(&translations[k + 1]), lerp_percent);
+            XMVECTOR Q = XMQuaternionSlerp(XMLoadFloat4(&rotations[k]), XMLoadFloat4(&rotations[k + 1]), lerp_percent);
+
+            store_bone(i, S, Q, P);
+        }
+        return;
+    }
+
+    for (UINT n = 0; n < num_bones; ++n) {
+        UINT i = bones ? bones[n] : n;
+        UINT first = KeyframeOffsets[i];
+        UINT last = KeyframeOffsets[i + 1] - 1;
+
+        XMVECTOR S, P, Q;
+        if (t <= time_points[first]) {
+            S = XMLoadFloat3(&scales[first]);
+            P = XMLoadFloat3(&translations[first]);
+            Q = XMLoadFloat4(&rotations[first]);
+        } else if (t >= time_points[last]) {
+            S = XMLoadFloat3(&scales[last]);
+            P = XMLoadFloat3(&translations[last]);
+            Q = XMLoadFloat4(&rotations[last]);
+        } else {
+            UINT k = first + FindKeyframe(time_points + first, last - first + 1, t, keyframe_cursors[i]);
+
+            float lerp_percent = (t - time_points[k]) / (time_points[k + 1] - time_points[k]);
+
+            S = XMVectorLerp(XMLoadFloat3(&scales[k]), XMLoadFloat3(&scales[k + 1]), lerp_percent);
+            P = XMVectorLerp(XMLoadFloat3(&translations[k]), XMLoadFloat3(&translations[k + 1]), lerp_percent);
+            Q = XMQuaternionSlerp(XMLoadFloat4(&rotations[k]), XMLoadFloat4(&rotations[k + 1]), lerp_percent);
+        }
+        store_bone(i, S, Q, P);
+    }
+}
+void PackedAnimationClip::Interpolate (
+    float t,
+    std::vector<DirectX::XMFLOAT4X4> & out_bone_transforms,
+    std::vector<UINT> & keyframe_cursors,
+    std::vector<UINT> const * bone_subset
+) const {
+    // -- rotation orgin is (0,0,0) point
+    XMVECTOR zero = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
 
+    sample(t, keyframe_cursors, bone_subset, [&](UINT i, FXMVECTOR S, FXMVECTOR Q, FXMVECTOR P) {
+        XMStoreFloat4x4(&out_bone_transforms[i], XMMatrixAffineTransformation(S, zero, Q, P));
+    });
+}
+void PackedAnimationClip::SamplePose (
+    float t,
+    std::vector<BoneTransform> & out_pose,
+    std::vector<UINT> & keyframe_cursors
+) const {
+    sample(t, keyframe_cursors, nullptr, [&](UINT i, FXMVECTOR S, FXMVECTOR Q, FXMVECTOR P) {
+        XMStoreFloat3(&out_pose[i].Scale, S);
+        XMStoreFloat4(&out_pose[i].RotationQuat, Q);
+        XMStoreFloat3(&out_pose[i].Translation, P);
+    });
+}
+
+void PoseWorkspace::Resize (UINT num_bones) {
+    ToParentTransforms.resize(num_bones);
+    ToRootTransforms.resize(num_bones);
+    for (auto & cursors : KeyframeCursors)
+        cursors.resize(num_bones, 0);
+    for (auto & cursors : LayerCursors)
+        cursors.resize(num_bones, 0);
+    LocalPose.resize(num_bones);
+    ClipPose.resize(num_bones);
+}
+
+constexpr UINT PoseWorkspace::MaxBlendInputs;
+constexpr UINT PoseWorkspace::MaxLayers;
+constexpr SkinnedData::ClipHandle SkinnedData::InvalidClip;
+constexpr UINT SkinnedModelInstance::MaxFades;
+
+SkinnedData::ClipHandle SkinnedData::FindClip (std::string const & clip_name) const {
+    auto clip = clip_handles_.find(clip_name);
+    return clip != clip_handles_.end() ? clip->second : InvalidClip;
+}
 float SkinnedData::GetClipStartTime (std::string const & clip_name) const {
-    auto clip = animations_.find(clip_name);
-    return clip->second.GetClipStartTime();
+    return GetClipStartTime(FindClip(clip_name));
 }
 float SkinnedData::GetClipEndTime (std::string const & clip_name) const {
-    auto clip = animations_.find(clip_name);
-    return clip->second.GetClipEndTime();
+    return GetClipEndTime(FindClip(clip_name));
+}
+float SkinnedData::LoopTimePoint (ClipHandle clip, float time_point) const {
+    float start_time = clip_start_times_[clip];
+    float end_time = clip_end_times_[clip];
+    if (time_point <= end_time)
+        return time_point;
+
+    float duration = end_time - start_time;
+    return duration > 0.0f ? start_time + fmodf(time_point - start_time, duration) : start_time;
+}
+RootMotion SkinnedData::GetRootMotion (ClipHandle clip, float time_point0, float time_point1) const {
+    std::vector<RootMotionKey> const & track = root_motion_tracks_[clip];
+    if (track.empty())
+        return RootMotion();
+
+    RootMotion placement0 = sample_root_motion(track, time_point0);
+    RootMotion placement1 = sample_root_motion(track, time_point1);
+    if (time_point1 >= time_point0)
+        return relative_motion(placement0, placement1);
+
+    // -- looped: play to the clip end, then continue from the clip start where the end left off
+    RootMotion to_end = relative_motion(placement0, sample_root_motion(track, clip_end_times_[clip]));
+    RootMotion from_start = relative_motion(sample_root_motion(track, clip_start_times_[clip]), placement1);
+    return concatenate_motion(to_end, from_start);
+}
+void SkinnedData::BuildBoneLods (UINT num_levels) {
+    UINT num_bones = BoneCount();
+
+    // -- height of a bone is the number of links to the deepest leaf below it
+    std::vector<UINT> height(num_bones, 0);
+    for (auto it = bone_order_.rbegin(); it != bone_order_.rend(); ++it) {
+        int parent_index = bone_hierarchy_[*it];
+        if (parent_index >= 0)
+            height[parent_index] = MathHelper::Max(height[parent_index], height[*it] + 1);
+    }
+
+    bone_lods_.resize(MathHelper::Max(num_levels, 1u));
+    for (UINT level = 1; level < bone_lods_.size(); ++level) {
+        BoneLod & lod = bone_lods_[level];
+        lod.Bones.clear();
+        lod.DroppedBones.clear();
+        lod.DroppedSources.clear();
+
+        // -- children of a dropped bone are lower and dropped as well
+        std::vector<UINT> source(num_bones);
+        for (UINT i : bone_order_) {
+            int parent_index = bone_hierarchy_[i];
+            if (parent_index < 0 || height[i] >= level) {
+                lod.Bones.push_back(i);
+                source[i] = i;
+            } else {
+                source[i] = source[parent_index];
+                lod.DroppedBones.push_back(i);
+                lod.DroppedSources.push_back(source[i]);
+            }
+        }
+    }
+}
+void SkinnedData::BuildSubtreeMask (UINT root_bone, std::vector<float> & out_mask, float weight) const {
+    std::vector<bool> in_subtree(BoneCount(), false);
+    out_mask.assign(BoneCount(), 0.0f);
+
+    // -- parents come first in bone_order_, so a bone is in the subtree if its parent already is
+    for (UINT i : bone_order_) {
+        int parent_index = bone_hierarchy_[i];
+        in_subtree[i] = i == root_bone || (parent_index >= 0 && in_subtree[parent_index]);
+        if (in_subtree[i])
+            out_mask[i] = weight;
+    }
 }
 void SkinnedData::Set (
     std::vector<int> & bone_hierarchy,
     std::vector<DirectX::XMFLOAT4X4> & bone_offsets,
-    std::unordered_map<std::string, AnimationClip> & animations
+    std::unordered_map<std::string, AnimationClip> & animations,
+    ClipCompressionSettings const * compression
 ) {
     bone_hierarchy_ = bone_hierarchy;
     bone_offsets_ = bone_offsets;
-    animations_ = animations;
+    affine_bone_offsets_.resize(bone_offsets_.size());
+    for (size_t i = 0; i < bone_offsets_.size(); ++i)
+        XMStoreFloat3x4(&affine_bone_offsets_[i], XMLoadFloat4x4(&bone_offsets_[i]));
+
+    // -- order bones by depth so every parent is visited before its children
+    UINT num_bones = (UINT)bone_hierarchy_.size();
+    std::vector<UINT> depth(num_bones, 0);
+    for (UINT i = 0; i < num_bones; ++i)
+        for (int p = bone_hierarchy_[i]; p >= 0 && depth[i] < num_bones; p = bone_hierarchy_[p])
+            ++depth[i];
+    bone_order_.resize(num_bones);
+    for (UINT i = 0; i < num_bones; ++i)
+        bone_order_[i] = i;
+    std::stable_sort(bone_order_.begin(), bone_order_.end(),
+        [&depth](UINT a, UINT b) { return depth[a] < depth[b]; }
+    );
+    bone_lods_.assign(1, BoneLod());
+    bone_lods_[0].Bones = bone_order_;
+
+    animations_.clear();
+    compressed_animations_.clear();
+    clip_handles_.clear();
+    clip_start_times_.clear();
+    clip_end_times_.clear();
+    root_motion_tracks_.clear();
+
+    for (auto const & clip : animations) {
+        clip_handles_[clip.first] = (ClipHandle)clip_start_times_.size();
+        root_motion_tracks_.push_back(clip.second.RootMotionTrack);
+        if (compression) {
+            compressed_animations_.emplace_back();
+            compressed_animations_.back().Build(clip.second, *compression);
+            clip_start_times_.push_back(compressed_animations_.back().GetClipStartTime());
+            clip_end_times_.push_back(compressed_animations_.back().GetClipEndTime());
+        } else {
+            animations_.emplace_back();
+            animations_.back().Build(clip.second);
+            clip_start_times_.push_back(animations_.back().GetClipStartTime());
+            clip_end_times_.push_back(animations_.back().GetClipEndTime());
+        }
+    }
 }
-// TODO(omid): for optimization, you might cache the result if there was a chance
-// that you were calling this several times with same clip_name at same time_point
 void SkinnedData::GetFinalTransforms (
     std::string const & clip_name,
     float time_point,
     std::vector<DirectX::XMFLOAT4X4> & fianl_transforms
 ) const {
-    UINT num_bones = (UINT)bone_offsets_.size();
-
-    std::vector<XMFLOAT4X4> to_parent_transforms(num_bones);
-
+    PoseWorkspace workspace;
+    workspace.Resize(BoneCount());
+    GetFinalTransforms(FindClip(clip_name), time_point, fianl_transforms.data(), workspace);
+}
+void SkinnedData::GetFinalTransforms (
+    ClipHandle clip,
+    float time_point,
+    DirectX::XMFLOAT4X4 * final_transforms,
+    PoseWorkspace & workspace,
+    UINT bone_lod
+) const {
+    sample_clip(clip, time_point, workspace, workspace.KeyframeCursors[0], bone_lod ? &bone_lods_[bone_lod].Bones : nullptr);
+    concatenate_hierarchy(workspace, final_transforms, nullptr, bone_lod);
+}
+void SkinnedData::GetFinalTransforms (
+    ClipHandle clip,
+    float time_point,
+    DirectX::XMFLOAT3X4 * final_transforms,
+    PoseWorkspace & workspace,
+    UINT bone_lod
+) const {
+    sample_clip(clip, time_point, workspace, workspace.KeyframeCursors[0], bone_lod ? &bone_lods_[bone_lod].Bones : nullptr);
+    concatenate_hierarchy(workspace, nullptr, final_transforms, bone_lod);
+}
+void SkinnedData::GetFinalTransforms (
+    BlendInput const * inputs, UINT num_inputs,
+    DirectX::XMFLOAT4X4 * final_transforms,
+    PoseWorkspace & workspace,
+    AnimationLayer const * layers, UINT num_layers,
+    UINT bone_lod,
+    IkChain const * ik_chains, UINT num_ik_chains
+) const {
+    blend_clips(inputs, num_inputs, layers, num_layers, workspace, bone_lod);
+    apply_ik(ik_chains, num_ik_chains, workspace, bone_lod);
+    concatenate_hierarchy(workspace, final_transforms, nullptr, bone_lod);
+}
+void SkinnedData::GetFinalTransforms (
+    BlendInput const * inputs, UINT num_inputs,
+    DirectX::XMFLOAT3X4 * final_transforms,
+    PoseWorkspace & workspace,
+    AnimationLayer const * layers, UINT num_layers,
+    UINT bone_lod,
+    IkChain const * ik_chains, UINT num_ik_chains
+) const {
+    blend_clips(inputs, num_inputs, layers, num_layers, workspace, bone_lod);
+    apply_ik(ik_chains, num_ik_chains, workspace, bone_lod);
+    concatenate_hierarchy(workspace, nullptr, final_transforms, bone_lod);
+}
+void SkinnedData::sample_clip (
+    ClipHandle clip, float time_point,
+    PoseWorkspace & workspace, std::vector<UINT> & keyframe_cursors,
+    std::vector<UINT> const * bone_subset
+) const {
     // -- interpolate all the bones of this clip at the given time
-    auto clip = animations_.find(clip_name);
-    clip->second.Interpolate(time_point, to_parent_transforms);
+    if (compressed_animations_.empty())
+        animations_[clip].Interpolate(time_point, workspace.ToParentTransforms, keyframe_cursors, bone_subset);
+    else
+        compressed_animations_[clip].Interpolate(time_point, workspace.ToParentTransforms, keyframe_cursors, bone_subset);
+}
+void SkinnedData::sample_pose (
+    ClipHandle clip, float time_point,
+    std::vector<BoneTransform> & out_pose, std::vector<UINT> & keyframe_cursors
+) const {
+    if (compressed_animations_.empty())
+        animations_[clip].SamplePose(time_point, out_pose, keyframe_cursors);
+    else
+        compressed_animations_[clip].SamplePose(time_point, out_pose, keyframe_cursors);
+}
+void SkinnedData::blend_clips (
+    BlendInput const * inputs, UINT num_inputs,
+    AnimationLayer const * layers, UINT num_layers,
+    PoseWorkspace & workspace, UINT bone_lod
+) const {
+    assert(num_inputs > 0 && num_inputs <= PoseWorkspace::MaxBlendInputs);
+    assert(num_layers <= PoseWorkspace::MaxLayers);
 
-    //
-    // -- traverse the hierarchy and transform all bones to the root space:
-    //
+    float total_weight = 0.0f;
+    UINT num_weighted = 0;
+    UINT last_weighted = 0;
+    for (UINT n = 0; n < num_inputs; ++n) {
+        if (inputs[n].Weight > 0.0f) {
+            total_weight += inputs[n].Weight;
+            ++num_weighted;
+            last_weighted = n;
+        }
+    }
 
-    std::vector<XMFLOAT4X4> to_root_transforms(num_bones);
+    UINT num_bones = BoneCount();
+    BoneTransform * blended = workspace.LocalPose.data();
+    BoneTransform const * pose = workspace.ClipPose.data();
 
-    // -- root bone has index 0, has no parent and its to_root_transform is its local transform
-    to_root_transforms[0] = to_parent_transforms[0];
+    if (num_weighted <= 1) {
+        // -- a single contributing clip needs no blending (e.g. before and after a crossfade)
+        BlendInput const & input = inputs[last_weighted];
+        if (0 == num_layers) {
+            sample_clip(
+                input.Clip, input.TimePoint, workspace, workspace.KeyframeCursors[last_weighted],
+                bone_lod ? &bone_lods_[bone_lod].Bones : nullptr
+            );
+            return;
+        }
+        sample_pose(input.Clip, input.TimePoint, workspace.LocalPose, workspace.KeyframeCursors[last_weighted]);
+    } else {
+        bool first = true;
+        for (UINT n = 0; n < num_inputs; ++n) {
+            if (inputs[n].Weight <= 0.0f)
+                continue;
 
-    for (UINT i = 1; i < num_bones; ++i) {
-        XMMATRIX to_parent = XMLoadFloat4x4(&to_parent_transforms[i]);
+            sample_pose(inputs[n].Clip, inputs[n].TimePoint, workspace.ClipPose, workspace.KeyframeCursors[n]);
 
-        int parent_index = bone_hierarchy_[i];
-        XMMATRIX parent_to_root = XMLoadFloat4x4(&to_root_transforms[parent_index]);
+            float w = inputs[n].Weight / total_weight;
+            for (UINT i = 0; i < num_bones; ++i) {
+                XMVECTOR P = XMVectorScale(XMLoadFloat3(&pose[i].Translation), w);
+                XMVECTOR S = XMVectorScale(XMLoadFloat3(&pose[i].Scale), w);
+                XMVECTOR Q = XMLoadFloat4(&pose[i].RotationQuat);
+                if (!first) {
+                    // -- q and -q are the same rotation, blend along the shorter arc
+                    XMVECTOR blended_q = XMLoadFloat4(&blended[i].RotationQuat);
+                    if (XMVectorGetX(XMVector4Dot(blended_q, Q)) < 0.0f)
+                        Q = XMVectorNegate(Q);
+                    P = XMVectorAdd(P, XMLoadFloat3(&blended[i].Translation));
+                    S = XMVectorAdd(S, XMLoadFloat3(&blended[i].Scale));
+                    Q = XMVectorMultiplyAdd(Q, XMVectorReplicate(w), blended_q);
+                } else {
+                    Q = XMVectorScale(Q, w);
+                }
+                XMStoreFloat3(&blended[i].Translation, P);
+                XMStoreFloat3(&blended[i].Scale, S);
+                XMStoreFloat4(&blended[i].RotationQuat, Q);
+            }
+            first = false;
+        }
 
-        XMMATRIX to_root = XMMatrixMultiply(to_parent, parent_to_root);
+        // -- layers blend against unit rotations, nlerp the weighted sum first
+        if (num_layers > 0)
+            for (UINT i = 0; i < num_bones; ++i)
+                XMStoreFloat4(
+                    &blended[i].RotationQuat, XMQuaternionNormalize(XMLoadFloat4(&blended[i].RotationQuat))
+                );
+    }
 
-        XMStoreFloat4x4(&to_root_transforms[i], to_root);
+    for (UINT l = 0; l < num_layers; ++l) {
+        if (layers[l].Weight <= 0.0f)
+            continue;
+        sample_pose(layers[l].Clip, layers[l].TimePoint, workspace.ClipPose, workspace.LayerCursors[l]);
+        apply_layer(layers[l], workspace);
     }
 
-    // -- premultiply by the bone offset transform to get the final transform
+    // -- rotation orgin is (0,0,0) point
+    XMVECTOR zero = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+
+    // -- nlerp: normalize the blended rotations and build the to-parent transforms
     for (UINT i = 0; i < num_bones; ++i) {
-        XMMATRIX offset = XMLoadFloat4x4(&bone_offsets_[i]);
-        XMMATRIX to_root = XMLoadFloat4x4(&to_root_transforms[i]);
-        XMMATRIX final_transform = XMMatrixMultiply(offset, to_root);
-        XMStoreFloat4x4(&fianl_transforms[i], XMMatrixTranspose(final_transform));
+        XMVECTOR S = XMLoadFloat3(&blended[i].Scale);
+        XMVECTOR P = XMLoadFloat3(&blended[i].Translation);
+        XMVECTOR Q = XMQuaternionNormalize(XMLoadFloat4(&blended[i].RotationQuat));
+        XMStoreFloat4x4(&workspace.ToParentTransforms[i], XMMatrixAffineTransformation(S, zero, Q, P));
+    }
+}
+void SkinnedData::apply_layer (AnimationLayer const & layer, PoseWorkspace & workspace) const {
+    BoneTransform * blended = workspace.LocalPose.data();
+    BoneTransform const * pose = workspace.ClipPose.data();
+    XMVECTOR identity = XMQuaternionIdentity();
+    XMVECTOR one = XMVectorSplatOne();
+
+    for (UINT i = 0; i < BoneCount(); ++i) {
+        float w = layer.BoneMask ? layer.Weight * layer.BoneMask[i] : layer.Weight;
+        if (w <= 0.0f)
+            continue;
+
+        XMVECTOR P = XMLoadFloat3(&blended[i].Translation);
+        XMVECTOR S = XMLoadFloat3(&blended[i].Scale);
+        XMVECTOR Q = XMLoadFloat4(&blended[i].RotationQuat);
+        XMVECTOR layer_p = XMLoadFloat3(&pose[i].Translation);
+        XMVECTOR layer_s = XMLoadFloat3(&pose[i].Scale);
+        XMVECTOR layer_q = XMLoadFloat4(&pose[i].RotationQuat);
+
+        if (layer.Additive) {
+            // -- scale the difference by w and apply it after the base: q = base_q * diff_q
+            P = XMVectorAdd(P, XMVectorScale(layer_p, w));
+            S = XMVectorMultiply(S, XMVectorLerp(one, layer_s, w));
+            if (w < 1.0f)
+                layer_q = XMQuaternionSlerp(identity, layer_q, w);
+            Q = XMQuaternionMultiply(layer_q, Q);
+        } else {
+            if (XMVectorGetX(XMVector4Dot(Q, layer_q)) < 0.0f)
+                layer_q = XMVectorNegate(layer_q);
+            P = XMVectorLerp(P, layer_p, w);
+            S = XMVectorLerp(S, layer_s, w);
+            Q = XMQuaternionNormalize(XMVectorLerp(Q, layer_q, w));
+        }
+
+        XMStoreFloat3(&blended[i].Translation, P);
+        XMStoreFloat3(&blended[i].Scale, S);
+        XMStoreFloat4(&blended[i].RotationQuat, Q);
+    }
+}
+void SkinnedData::apply_ik (IkChain const * ik_chains, UINT num_ik_chains, PoseWorkspace & workspace, UINT bone_lod) const {
+    std::vector<UINT> const & dropped_bones = bone_lods_[bone_lod].DroppedBones;
+    for (UINT n = 0; n < num_ik_chains; ++n) {
+        // -- the ancestors of an evaluated bone are evaluated too
+        if (std::find(dropped_bones.begin(), dropped_bones.end(), ik_chains[n].TipBone) != dropped_bones.end())
+            continue;
+        SolveIkChain(ik_chains[n], bone_hierarchy_.data(), workspace.ToParentTransforms.data());
+    }
+}
+void SkinnedData::concatenate_hierarchy (
+    PoseWorkspace & workspace,
+    DirectX::XMFLOAT4X4 * out_transposed_transforms,
+    DirectX::XMFLOAT3X4 * out_affine_transforms,
+    UINT bone_lod
+) const {
+    BoneLod const & lod = bone_lods_[bone_lod];
+    ConcatenateBoneHierarchy(
+        lod.Bones.data(), (UINT)lod.Bones.size(), bone_hierarchy_.data(),
+        workspace.ToParentTransforms.data(), affine_bone_offsets_.data(), workspace.ToRootTransforms.data(),
+        out_transposed_transforms, out_affine_transforms
+    );
+
+    // -- a dropped bone stays in bind pose relative to its evaluated ancestor, its offset cancels
+    // -- the bind pose and it is skinned exactly like that ancestor
+    if (out_affine_transforms) {
+        for (UINT n = 0; n < lod.DroppedBones.size(); ++n)
+            out_affine_transforms[lod.DroppedBones[n]] = out_affine_transforms[lod.DroppedSources[n]];
+    } else {
+        for (UINT n = 0; n < lod.DroppedBones.size(); ++n)
+            out_transposed_transforms[lod.DroppedBones[n]] = out_transposed_transforms[lod.DroppedSources[n]];
+    }
+}
+
+void SkinnedModelInstance::CrossfadeTo (std::string const & clip_name, float fade_duration) {
+    if (fade_duration <= 0.0f || SkinnedData::InvalidClip == Clip) {
+        SetClip(clip_name);
+        return;
+    }
+
+    // -- the fades in flight go one down (the oldest one is dropped when all are in use)
+    NumFades = MathHelper::Min(NumFades + 1, MaxFades);
+    std::copy_backward(Fades, Fades + NumFades - 1, Fades + NumFades);
+    Fades[0].FadeOutClip = Clip;
+    Fades[0].FadeOutTimePoint = TimePoint;
+    Fades[0].FadeTime = 0.0f;
+    Fades[0].FadeDuration = fade_duration;
+
+    ClipName = clip_name;
+    Clip = SkinnedInfo->FindClip(clip_name);
+    TimePoint = 0.0f;
+
+    // -- blend input k + 1 samples Fades[k].FadeOutClip: the keyframe cursors move down along with the clips
+    // -- and the new clip starts with the ones of the dropped input
+    std::rotate(Workspace.KeyframeCursors, Workspace.KeyframeCursors + NumFades, Workspace.KeyframeCursors + NumFades + 1);
+}
+void SkinnedModelInstance::fade_weights (float * weights) const {
+    float remaining = 1.0f;
+    for (UINT k = 0; k < NumFades; ++k) {
+        float fade_in = Fades[k].FadeTime / Fades[k].FadeDuration;
+        weights[k] = remaining * fade_in;
+        remaining *= 1.0f - fade_in;
+    }
+    weights[NumFades] = remaining;
+}
+void SkinnedModelInstance::SetLod (AnimationLod const & lod) {
+    BoneLod = MathHelper::Min(lod.BoneLod, SkinnedInfo->BoneLodCount() - 1);
+
+    UINT update_interval = MathHelper::Max(lod.UpdateInterval, 1u);
+    if (update_interval == UpdateInterval)
+        return;
+
+    UpdateInterval = update_interval;
+    FramesSinceUpdate %= UpdateInterval;
+    HasPoseHistory = false;
+    if (UpdateInterval > 1 && NextTransforms.size() != SkinnedInfo->BoneCount()) {
+        NextTransforms.resize(SkinnedInfo->BoneCount());
+        PrevPose.resize(SkinnedInfo->BoneCount());
+        NextPose.resize(SkinnedInfo->BoneCount());
+    }
+}
+void SkinnedModelInstance::UpdateSkinnedAnimation (float dt, DirectX::XMFLOAT4X4 * out_final_transforms) {
+    // -- loop animation
+    float prev_time_point = TimePoint;
+    TimePoint = SkinnedInfo->LoopTimePoint(Clip, TimePoint + dt);
+    RootMotionDelta = SkinnedInfo->GetRootMotion(Clip, prev_time_point, TimePoint);
+    for (auto & layer : Layers)
+        layer.TimePoint = SkinnedInfo->LoopTimePoint(layer.Clip, layer.TimePoint + dt);
+
+    // -- a finished fade leaves no weight to the clips it faded out of (and the fades they were part of)
+    for (UINT k = 0; k < NumFades; ++k) {
+        Fades[k].FadeTime += dt;
+        if (Fades[k].FadeTime >= Fades[k].FadeDuration) {
+            NumFades = k;
+            break;
+        }
     }
+    if (NumFades > 0) {
+        // -- root motion crossfades along with the pose
+        float weights[MaxFades + 1];
+        fade_weights(weights);
+        XMVECTOR translation = XMVectorScale(XMLoadFloat3(&RootMotionDelta.Translation), weights[0]);
+        float yaw = RootMotionDelta.Yaw * weights[0];
+        for (UINT k = 0; k < NumFades; ++k) {
+            prev_time_point = Fades[k].FadeOutTimePoint;
+            Fades[k].FadeOutTimePoint = SkinnedInfo->LoopTimePoint(Fades[k].FadeOutClip, prev_time_point + dt);
+            RootMotion fade_out_motion = SkinnedInfo->GetRootMotion(Fades[k].FadeOutClip, prev_time_point, Fades[k].FadeOutTimePoint);
+            translation = XMVectorMultiplyAdd(XMLoadFloat3(&fade_out_motion.Translation), XMVectorReplicate(weights[k + 1]), translation);
+            yaw += fade_out_motion.Yaw * weights[k + 1];
+        }
+        XMStoreFloat3(&RootMotionDelta.Translation, translation);
+        RootMotionDelta.Yaw = yaw;
+    }
+
+    if (UpdateInterval <= 1) {
+        evaluate(out_final_transforms);
+        return;
+    }
+
+    // -- throttled: evaluate every UpdateInterval-th frame and move from the previous evaluated pose
+    // -- to the latest one in between, so the displayed pose trails by up to UpdateInterval - 1 frames
+    if (0 == FramesSinceUpdate || !HasPoseHistory) {
+        std::swap(PrevPose, NextPose);
+        evaluate(NextTransforms.data());
+        for (UINT i = 0; i < NextTransforms.size(); ++i) {
+            XMVECTOR S, Q, P;
+            XMMatrixDecompose(&S, &Q, &P, XMMatrixTranspose(XMLoadFloat4x4(&NextTransforms[i])));
+            XMStoreFloat3(&NextPose[i].Scale, S);
+            XMStoreFloat4(&NextPose[i].RotationQuat, Q);
+            XMStoreFloat3(&NextPose[i].Translation, P);
+        }
+        if (!HasPoseHistory) {
+            PrevPose = NextPose;
+            HasPoseHistory = true;
+        }
+    }
+    FramesSinceUpdate = (FramesSinceUpdate + 1) % UpdateInterval;
+
+    // -- the last frame of the interval shows the evaluated pose as is
+    if (0 == FramesSinceUpdate) {
+        if (out_final_transforms != NextTransforms.data())
+            std::copy(NextTransforms.begin(), NextTransforms.end(), out_final_transforms);
+        return;
+    }
+
+    float lerp_percent = (float)FramesSinceUpdate / (float)UpdateInterval;
+    XMVECTOR zero = XMVectorZero();
+    for (UINT i = 0; i < NextTransforms.size(); ++i) {
+        XMVECTOR prev_q = XMLoadFloat4(&PrevPose[i].RotationQuat);
+        XMVECTOR next_q = XMLoadFloat4(&NextPose[i].RotationQuat);
+        if (XMVectorGetX(XMVector4Dot(prev_q, next_q)) < 0.0f)
+            next_q = XMVectorNegate(next_q);
+
+        XMVECTOR S = XMVectorLerp(XMLoadFloat3(&PrevPose[i].Scale), XMLoadFloat3(&NextPose[i].Scale), lerp_percent);
+        XMVECTOR Q = XMQuaternionNormalize(XMVectorLerp(prev_q, next_q, lerp_percent));
+        XMVECTOR P = XMVectorLerp(XMLoadFloat3(&PrevPose[i].Translation), XMLoadFloat3(&NextPose[i].Translation), lerp_percent);
+        XMStoreFloat4x4(&out_final_transforms[i], XMMatrixTranspose(XMMatrixAffineTransformation(S, zero, Q, P)));
+    }
+}
+void SkinnedModelInstance::evaluate (DirectX::XMFLOAT4X4 * out_final_transforms) {
+    // -- compute final transforms for the given time point
+    if (0 == NumFades && Layers.empty() && IkChains.empty()) {
+        if (Cache)
+            Cache->GetFinalTransforms(Clip, TimePoint, out_final_transforms, Workspace, BoneLod);
+        else
+            SkinnedInfo->GetFinalTransforms(Clip, TimePoint, out_final_transforms, Workspace, BoneLod);
+        return;
+    }
+
+    SkinnedData::BlendInput inputs[PoseWorkspace::MaxBlendInputs];
+    float weights[MaxFades + 1];
+    fade_weights(weights);
+    inputs[0].Clip = Clip;
+    inputs[0].TimePoint = TimePoint;
+    inputs[0].Weight = weights[0];
+    for (UINT k = 0; k < NumFades; ++k) {
+        inputs[k + 1].Clip = Fades[k].FadeOutClip;
+        inputs[k + 1].TimePoint = Fades[k].FadeOutTimePoint;
+        inputs[k + 1].Weight = weights[k + 1];
+    }
+    SkinnedInfo->GetFinalTransforms(
+        inputs, NumFades + 1, out_final_transforms, Workspace,
+        Layers.data(), (UINT)Layers.size(), BoneLod,
+        IkChains.data(), (UINT)IkChains.size()
+    );
+}
+
+UINT SelectAnimationLod (AnimationLod const * lods, UINT num_lods, float screen_size) {
+    for (UINT i = 0; i < num_lods; ++i)
+        if (screen_size >= lods[i].MinScreenSize)
+            return i;
+    return num_lods - 1;
+}
+
+void UpdateSkinnedInstances (
+    JobSystem & jobs,
+    SkinnedModelInstance * instances, UINT num_instances,
+    float dt,
+    BYTE * out_palettes, UINT palette_byte_stride
+) {
+    // -- a few instances per chunk keeps stealing cheap relative to one 50-100 bone update
+    UINT const instances_per_chunk = 4;
+
+    jobs.ParallelFor(num_instances, instances_per_chunk, [=](unsigned begin, unsigned end) {
+        for (UINT i = begin; i < end; ++i) {
+            if (out_palettes)
+                instances[i].UpdateSkinnedAnimation(
+                    dt, reinterpret_cast<XMFLOAT4X4 *>(out_palettes + (size_t)i * palette_byte_stride)
+                );
+            else
+                instances[i].UpdateSkinnedAnimation(dt);
+        }
+    });
+}
+void UpdateSkinnedInstances (
+    JobSystem & jobs,
+    SkinnedModelInstance * instances, UINT num_instances,
+    float dt,
+    DirectX::XMFLOAT3X4 * out_bone_palette
+) {
+    UINT const instances_per_chunk = 4;
+
+    jobs.ParallelFor(num_instances, instances_per_chunk, [=](unsigned begin, unsigned end) {
+        for (UINT i = begin; i < end; ++i) {
+            SkinnedModelInstance & instance = instances[i];
+            instance.UpdateSkinnedAnimation(dt);
+            PackBonePalette(
+                instance.FinalTransforms.data(), (UINT)instance.FinalTransforms.size(),
+                out_bone_palette + instance.PaletteOffset
+            );
+        }
+    });
+}
+void PackBonePalette (
+    DirectX::XMFLOAT4X4 const * transposed_transforms, UINT num_bones,
+    DirectX::XMFLOAT3X4 * out_palette
+) {
+    // -- rows are contiguous, so the first three rows of a 4x4 are exactly the 12 floats of a 3x4
+    for (UINT i = 0; i < num_bones; ++i)
+        memcpy(&out_palette[i], &transposed_transforms[i], sizeof(XMFLOAT3X4));
 }
@@ -1,7 +1,8 @@
 #pragma once
 
-#include "../common/d3d12_util.h"
-#include "../common/math_helper.h"
+#include "../common/core_types.h"
+#include "clip_compression.h"
+#include "inverse_kinematics.h"
 
 struct Keyframe {
     Keyframe ();
@@ -13,12 +14,46 @@ struct Keyframe {
     DirectX::XMFLOAT4 RotationQuat;
 };
 //
+// -- largest deviation between two versions of an animation (e.g. resampled vs source keyframes)
+struct ResampleError {
+    float MaxTranslation = 0.0f;    // distance
+    float MaxRotation = 0.0f;       // angle in radians
+    float MaxScale = 0.0f;          // largest per-axis difference
+};
+//
+// -- Horizontal motion of a model: a yaw about the model's +y axis followed by a translation in its xz-plane
+struct RootMotion {
+    DirectX::XMFLOAT3 Translation = {0.0f, 0.0f, 0.0f};
+    float Yaw = 0.0f;
+
+    // -- world = ToMatrix() * world moves a model by this motion
+    DirectX::XMMATRIX ToMatrix () const;
+};
+// -- placement of the root bone at a point in time (see AnimationClip::ExtractRootMotion)
+struct RootMotionKey {
+    float TimePoint = 0.0f;
+    RootMotion Placement;
+};
+//
 // -- An animation is a list of keyframes sorted by time
 struct BoneAnimation {
     float GetStartTime () const;
     float GetEndTime () const;
 
+    // -- index i of the segment [Keyframes[i], Keyframes[i + 1]) containing t (start < t < end)
+    // -- cursor caches the last segment so monotonic playback resolves in O(1),
+    // -- otherwise (seek, loop wrap) it falls back to a binary search
+    UINT FindKeyframe (float t, UINT & cursor) const;
+
     void Interpolate (float t, DirectX::XMFLOAT4X4 & out_mat) const;
+    void Interpolate (float t, DirectX::XMFLOAT4X4 & out_mat, UINT & cursor) const;
+    // -- interpolated scale/translation/rotation at t (TimePoint of out_key is set to t)
+    void Interpolate (float t, Keyframe & out_key, UINT & cursor) const;
+
+    // -- remove keyframes that interpolating their neighbors reproduces within tolerance,
+    // -- first and last keyframes are always kept. The error is only measured at the time points of
+    // -- the original keyframes, not in between them. Returns number of removed keyframes
+    UINT Reduce (ResampleError const & tolerance);
 
     std::vector<Keyframe> Keyframes;
 };
@@ -30,38 +65,416 @@ struct AnimationClip {
     float GetClipEndTime () const;
 
     void Interpolate (float t, std::vector<DirectX::XMFLOAT4X4> & out_bone_transforms) const;
+    // -- one keyframe cursor per bone, owned by the caller (e.g. per model instance)
+    void Interpolate (
+        float t,
+        std::vector<DirectX::XMFLOAT4X4> & out_bone_transforms,
+        std::vector<UINT> & keyframe_cursors
+    ) const;
+    // -- decomposed pose of every bone at t (TimePoint of every key is set to t)
+    void Interpolate (float t, std::vector<Keyframe> & out_pose) const;
+
+    // -- turn the clip into an additive clip: every keyframe stores its difference from reference_pose
+    // -- (one key per bone), i.e. translation offset, rotation relative to the reference rotation and scale ratio
+    void MakeAdditive (std::vector<Keyframe> const & reference_pose);
+
+    // -- replace every bone animation with keyframes at a shared uniform rate (keys per second)
+    // -- from clip start time to clip end time, so the keyframe at t is floor((t - start) * rate) with no search.
+    // -- sample_rate is rounded up to fit a whole number of frames in the clip, SampleRate holds the rate used
+    ResampleError Resample (float sample_rate);
+
+    // -- remove redundant keyframes of every bone while keeping the position error of any joint
+    // -- (accumulated down the bone hierarchy) within tolerance. Like BoneAnimation::Reduce, the error
+    // -- is only bounded at the time points of the original keyframes. Bones can be in any order (parents need
+    // -- not precede their children). Returns number of removed keyframes
+    UINT ReduceKeyframes (std::vector<int> const & bone_hierarchy, float tolerance);
+
+    // -- move the horizontal translation and the yaw (about +y) of the first root bone out of the pose
+    // -- into RootMotionTrack, the root stays above the model origin facing its initial direction.
+    // -- Other root bones are moved along with it
+    void ExtractRootMotion (std::vector<int> const & bone_hierarchy);
 
     std::vector<BoneAnimation> BoneAnimations;
+    // -- placement of the root over time, empty if root motion was not extracted
+    std::vector<RootMotionKey> RootMotionTrack;
+
+    // -- non-zero if all bone animations are uniformly sampled at this rate
+    float SampleRate = 0.0f;
+};
+//
+// -- Decomposed local (to parent) transform of a bone, the form poses are blended in
+struct BoneTransform {
+    DirectX::XMFLOAT3 Translation;
+    DirectX::XMFLOAT4 RotationQuat;
+    DirectX::XMFLOAT3 Scale;
+};
+//
+// -- Structure-of-arrays form of an AnimationClip used for sampling:
+// -- one contiguous block holding all time points, then all translations, rotations and scales.
+// -- Keyframes of bone i are [KeyframeOffsets[i], KeyframeOffsets[i + 1]) in every array
+struct PackedAnimationClip {
+    void Build (AnimationClip const & clip);
+
+    float GetClipStartTime () const { return start_time_; }
+    float GetClipEndTime () const { return end_time_; }
+    float GetSampleRate () const { return sample_rate_; }
+    UINT BoneCount () const { return (UINT)KeyframeOffsets.size() - 1; }
+    UINT KeyframeCount () const { return KeyframeOffsets.back(); }
+
+    float const * TimePoints () const { return Data.data(); }
+    DirectX::XMFLOAT3 const * Translations () const {
+        return reinterpret_cast<DirectX::XMFLOAT3 const *>(Data.data() + KeyframeCount());
+    }
+    DirectX::XMFLOAT4 const * RotationQuats () const {
+        return reinterpret_cast<DirectX::XMFLOAT4 const *>(Data.data() + KeyframeCount() * 4);
+    }
+    DirectX::XMFLOAT3 const * Scales () const {
+        return reinterpret_cast<DirectX::XMFLOAT3 const *>(Data.data() + KeyframeCount() * 8);
+    }
+
+    // -- same lookup as BoneAnimation::FindKeyframe over a bone's time array
+    static UINT FindKeyframe (float const * time_points, UINT num_keyframes, float t, UINT & cursor);
+
+    // -- bone_subset limits sampling to the listed bones, others are left untouched
+    void Interpolate (
+        float t,
+        std::vector<DirectX::XMFLOAT4X4> & out_bone_transforms,
+        std::vector<UINT> & keyframe_cursors,
+        std::vector<UINT> const * bone_subset = nullptr
+    ) const;
+    // -- same sampling as Interpolate but keeps the local transforms decomposed (for blending)
+    void SamplePose (
+        float t,
+        std::vector<BoneTransform> & out_pose,
+        std::vector<UINT> & keyframe_cursors
+    ) const;
+
+    std::vector<UINT> KeyframeOffsets;
+    std::vector<float> Data;
+
+private:
+    float start_time_ = 0.0f;
+    float end_time_ = 0.0f;
+    float sample_rate_ = 0.0f;
+
+    // -- interpolates every bone (or the bones in bone_subset) at t and hands (bone, S, Q, P) to store_bone
+    template <typename StoreBone>
+    void sample (
+        float t, std::vector<UINT> & keyframe_cursors,
+        std::vector<UINT> const * bone_subset, StoreBone const & store_bone
+    ) const;
+};
+
+//
+// -- Per-instance scratch memory for SkinnedData::GetFinalTransforms,
+// -- sized once so the per-frame animation update does not touch the heap
+struct PoseWorkspace {
+    // -- most clips and layers SkinnedData::GetFinalTransforms blends in one call
+    static constexpr UINT MaxBlendInputs = 4;
+    static constexpr UINT MaxLayers = 4;
+
+    void Resize (UINT num_bones);
+
+    std::vector<DirectX::XMFLOAT4X4> ToParentTransforms;
+    // -- transposed 3x4 like the affine final transforms (see ConcatenateBoneHierarchy)
+    std::vector<DirectX::XMFLOAT3X4> ToRootTransforms;
+    // -- last sampled keyframe segment of each bone (playback is monotonic so lookups are O(1)),
+    // -- one set per blend input so blended clips don't invalidate each other's cursors
+    std::vector<UINT> KeyframeCursors[MaxBlendInputs];
+    std::vector<UINT> LayerCursors[MaxLayers];
+    // -- blended local pose and the pose of the clip being blended into it
+    std::vector<BoneTransform> LocalPose;
+    std::vector<BoneTransform> ClipPose;
 };
 
 class SkinnedData {
+public:
+    // -- dense index of a clip, resolve clip names once with FindClip and sample by handle
+    using ClipHandle = UINT;
+    static constexpr ClipHandle InvalidClip = (ClipHandle)-1;
+
+    // -- one clip of a blended pose, weights are normalized over all inputs
+    struct BlendInput {
+        ClipHandle Clip = InvalidClip;
+        float TimePoint = 0.0f;
+        float Weight = 0.0f;
+    };
+    // -- clip applied on top of the blended pose, bone i is affected with Weight * BoneMask[i]
+    // -- (BoneMask has BoneCount entries, nullptr affects all bones)
+    struct AnimationLayer {
+        ClipHandle Clip = InvalidClip;
+        float TimePoint = 0.0f;
+        float Weight = 1.0f;
+        float const * BoneMask = nullptr;
+        // -- adds an additive clip (see AnimationClip::MakeAdditive), otherwise blends toward the clip
+        bool Additive = false;
+    };
+
 private:
+    // -- bones evaluated at one bone LOD level, every other bone keeps its bind pose relative to
+    // -- its parent, so its final transform equals the one of its nearest evaluated ancestor
+    struct BoneLod {
+        std::vector<UINT> Bones;            // parents first
+        std::vector<UINT> DroppedBones;     // parents first
+        std::vector<UINT> DroppedSources;   // nearest evaluated ancestor of each dropped bone
+    };
+
     // -- gives parent index of i-th bone
     std::vector<int> bone_hierarchy_;
+    // -- bones sorted so that parents come before their children
+    std::vector<UINT> bone_order_;
     // -- skin (bind space) offset for every bone
     std::vector<DirectX::XMFLOAT4X4> bone_offsets_;
-    // -- access animation clips by name
-    std::unordered_map<std::string, AnimationClip> animations_;
+    // -- bone_offsets_ as the hierarchy kernel reads them
+    std::vector<DirectX::XMFLOAT3X4> affine_bone_offsets_;
+    // -- animation clips indexed by ClipHandle (packed at Set time)
+    std::vector<PackedAnimationClip> animations_;
+    // -- used instead of animations_ when clips are compressed at Set time
+    std::vector<CompressedAnimationClip> compressed_animations_;
+    // -- clip name to handle, only used when resolving handles
+    std::unordered_map<std::string, ClipHandle> clip_handles_;
+    // -- cached per clip so the per-frame loop check does not scan the bones
+    std::vector<float> clip_start_times_;
+    std::vector<float> clip_end_times_;
+    // -- level 0 evaluates all bones
+    std::vector<BoneLod> bone_lods_;
+    // -- root motion track of every clip (empty for clips without root motion)
+    std::vector<std::vector<RootMotionKey>> root_motion_tracks_;
+
+    void sample_clip (
+        ClipHandle clip, float time_point,
+        PoseWorkspace & workspace, std::vector<UINT> & keyframe_cursors,
+        std::vector<UINT> const * bone_subset = nullptr
+    ) const;
+    void sample_pose (
+        ClipHandle clip, float time_point,
+        std::vector<BoneTransform> & out_pose, std::vector<UINT> & keyframe_cursors
+    ) const;
+    // -- sample the inputs and layers into workspace.ToParentTransforms, blending decomposed local poses
+    // -- only when more than one input has a non-zero weight or there are layers
+    void blend_clips (
+        BlendInput const * inputs, UINT num_inputs,
+        AnimationLayer const * layers, UINT num_layers,
+        PoseWorkspace & workspace, UINT bone_lod
+    ) const;
+    void apply_layer (AnimationLayer const & layer, PoseWorkspace & workspace) const;
+    // -- solve ik_chains in order on workspace.ToParentTransforms, chains whose tip bone_lod drops are skipped
+    void apply_ik (IkChain const * ik_chains, UINT num_ik_chains, PoseWorkspace & workspace, UINT bone_lod) const;
+    // -- ConcatenateBoneHierarchy over the bones of bone_lod into exactly one of the two outputs,
+    // -- then copy final transforms of the dropped bones
+    void concatenate_hierarchy (
+        PoseWorkspace & workspace,
+        DirectX::XMFLOAT4X4 * out_transposed_transforms,
+        DirectX::XMFLOAT3X4 * out_affine_transforms,
+        UINT bone_lod = 0
+    ) const;
 
 public:
     UINT BoneCount () const { return (UINT)bone_hierarchy_.size(); }
+    UINT ClipCount () const { return (UINT)clip_start_times_.size(); }
+    UINT BoneLodCount () const { return (UINT)bone_lods_.size(); }
+    // -- number of bones evaluated at a bone LOD level
+    UINT BoneLodBoneCount (UINT bone_lod) const { return (UINT)bone_lods_[bone_lod].Bones.size(); }
+
+    // -- InvalidClip if there is no clip with that name
+    ClipHandle FindClip (std::string const & clip_name) const;
 
+    float GetClipStartTime (ClipHandle clip) const { return clip_start_times_[clip]; }
+    float GetClipEndTime (ClipHandle clip) const { return clip_end_times_[clip]; }
     float GetClipStartTime (std::string const & clip_name) const;
     float GetClipEndTime (std::string const & clip_name) const;
 
+    // -- wrap a time point that ran past the clip end back into the clip, keeping the overshoot
+    float LoopTimePoint (ClipHandle clip, float time_point) const;
+
+    bool HasRootMotion (ClipHandle clip) const { return !root_motion_tracks_[clip].empty(); }
+    // -- root motion of clip from time_point0 to time_point1 (identity for clips without root motion),
+    // -- time_point1 < time_point0 means the clip looped in between
+    RootMotion GetRootMotion (ClipHandle clip, float time_point0, float time_point1) const;
+
+    // -- per-bone mask with weight for root_bone and all its descendants and 0 for other bones
+    // -- (e.g. an upper body mask from the spine bone)
+    void BuildSubtreeMask (UINT root_bone, std::vector<float> & out_mask, float weight = 1.0f) const;
+
+    // -- precompute num_levels bone LOD levels (level 0 evaluates every bone): level k drops the bones
+    // -- within k - 1 links of a leaf (finger tips, face and toe bones first), root bones are always kept
+    void BuildBoneLods (UINT num_levels);
+
     void Set (
         std::vector<int> & bone_hierarchy,
         std::vector<DirectX::XMFLOAT4X4> & bone_offsets,
-        std::unordered_map<std::string, AnimationClip> & animations
+        std::unordered_map<std::string, AnimationClip> & animations,
+        ClipCompressionSettings const * compression = nullptr  // nullptr keeps full precision clips
     );
 
-    // TODO(omid): for optimization, you might cache the result if there was a chance
-    // that you were calling this several times with same clip_name at same time_point
+    // -- PoseCache caches results when several callers sample the same clip at the same time point
     void GetFinalTransforms (
         std::string const & clip_name,
         float time_point,
         std::vector<DirectX::XMFLOAT4X4> & fianl_transforms
     ) const;
+    // -- allocation free version of the above, workspace must be sized to BoneCount
+    // -- and final_transforms must have room for BoneCount matrices
+    // -- bone_lod < BoneLodCount limits evaluation to the bones of that level
+    void GetFinalTransforms (
+        ClipHandle clip,
+        float time_point,
+        DirectX::XMFLOAT4X4 * final_transforms,
+        PoseWorkspace & workspace,
+        UINT bone_lod = 0
+    ) const;
+    // -- same as above but writes 3x4 affine matrices (transposed 4x4 without the constant last column)
+    void GetFinalTransforms (
+        ClipHandle clip,
+        float time_point,
+        DirectX::XMFLOAT3X4 * final_transforms,
+        PoseWorkspace & workspace,
+        UINT bone_lod = 0
+    ) const;
+    // -- blend up to PoseWorkspace::MaxBlendInputs clips (translation/scale lerp, rotation nlerp)
+    // -- in local space, apply up to PoseWorkspace::MaxLayers layers in order on top,
+    // -- solve the IK chains in order on the resulting local pose (see SolveIkChain),
+    // -- then run the hierarchy pass once for the final pose (over the bones of bone_lod).
+    // -- Input i keeps its keyframe cursors in workspace.KeyframeCursors[i], layer i in workspace.LayerCursors[i]
+    void GetFinalTransforms (
+        BlendInput const * inputs, UINT num_inputs,
+        DirectX::XMFLOAT4X4 * final_transforms,
+        PoseWorkspace & workspace,
+        AnimationLayer const * layers = nullptr, UINT num_layers = 0,
+        UINT bone_lod = 0,
+        IkChain const * ik_chains = nullptr, UINT num_ik_chains = 0
+    ) const;
+    void GetFinalTransforms (
+        BlendInput const * inputs, UINT num_inputs,
+        DirectX::XMFLOAT3X4 * final_transforms,
+        PoseWorkspace & workspace,
+        AnimationLayer const * layers = nullptr, UINT num_layers = 0,
+        UINT bone_lod = 0,
+        IkChain const * ik_chains = nullptr, UINT num_ik_chains = 0
+    ) const;
 
     std::vector<int> GetBoneHierarchy () const { return bone_hierarchy_; }
 };
+
+class PoseCache;
+
+//
+// -- Animation level of detail of an instance, chosen by its projected size on screen
+struct AnimationLod {
+    // -- smallest projected height (fraction of the screen height) this LOD is used for
+    float MinScreenSize = 0.0f;
+    // -- SkinnedData bone LOD level (see SkinnedData::BuildBoneLods)
+    UINT BoneLod = 0;
+    // -- evaluate the animation every UpdateInterval-th frame and interpolate final transforms in between
+    UINT UpdateInterval = 1;
+};
+// -- index of the first of lods (sorted by decreasing MinScreenSize) that screen_size reaches, the last one otherwise
+UINT SelectAnimationLod (AnimationLod const * lods, UINT num_lods, float screen_size);
+
+struct SkinnedModelInstance {
+    SkinnedData * SkinnedInfo = nullptr;
+    std::vector<DirectX::XMFLOAT4X4> FinalTransforms;
+    // -- scratch memory reused every frame so the update does not allocate
+    PoseWorkspace Workspace;
+    std::string ClipName;
+    // -- ClipName resolved once, sampling is done by handle
+    SkinnedData::ClipHandle Clip = SkinnedData::InvalidClip;
+    float TimePoint = 0.0f;
+
+    // -- crossfades started by CrossfadeTo, most recent first: Clip fades in over Fades[0].FadeOutClip, which was
+    // -- fading in over Fades[1].FadeOutClip when Fades[0] started, and so on. Blend weights (see fade_weights):
+    // -- Clip f0, Fades[k].FadeOutClip (1 - f0) ... (1 - fk) f(k+1) with fk = FadeTime / FadeDuration of Fades[k]
+    // -- and f(NumFades) = 1. A crossfade started mid-fade keeps the pose continuous, up to
+    // -- PoseWorkspace::MaxBlendInputs - 1 fades are kept (the oldest one ends early beyond that)
+    struct ClipFade {
+        SkinnedData::ClipHandle FadeOutClip = SkinnedData::InvalidClip;
+        float FadeOutTimePoint = 0.0f;
+        float FadeTime = 0.0f;
+        float FadeDuration = 0.0f;
+    };
+    static constexpr UINT MaxFades = PoseWorkspace::MaxBlendInputs - 1;
+    ClipFade Fades[MaxFades];
+    UINT NumFades = 0;
+
+    // -- applied on top of the (cross faded) clip, layer time points advance and loop with the clip
+    std::vector<SkinnedData::AnimationLayer> Layers;
+    // -- solved after sampling every evaluation, targets are in root space (e.g. feet planted on the ground).
+    // -- Set targets before UpdateSkinnedAnimation
+    std::vector<IkChain> IkChains;
+    // -- optional cache shared with other instances of SkinnedInfo, used while a single clip plays
+    // -- without layers or IK chains
+    PoseCache * Cache = nullptr;
+
+    // -- root motion of the last update, move the model with world = RootMotionDelta.ToMatrix() * world
+    RootMotion RootMotionDelta;
+
+    // -- first bone of this instance in a bone palette shared by several instances (see UpdateSkinnedInstances)
+    UINT PaletteOffset = 0;
+
+    // -- animation LOD (see SetLod)
+    UINT BoneLod = 0;
+    UINT UpdateInterval = 1;
+    // -- frames since the last evaluation, can be preset to spread instances over the update interval
+    UINT FramesSinceUpdate = 0;
+    // -- when UpdateInterval > 1: final transforms of the last evaluation, and the last two evaluations decomposed
+    // -- (scale, rotation, translation of every final transform) to interpolate in between (lerp, nlerp, lerp),
+    // -- so bones turn rigidly instead of shrinking like lerped matrix rows do
+    std::vector<DirectX::XMFLOAT4X4> NextTransforms;
+    std::vector<BoneTransform> PrevPose;
+    std::vector<BoneTransform> NextPose;
+    bool HasPoseHistory = false;
+
+    void SetClip (std::string const & clip_name) {
+        ClipName = clip_name;
+        Clip = SkinnedInfo->FindClip(clip_name);
+        TimePoint = 0.0f;
+        NumFades = 0;
+    }
+    // -- start clip_name from its beginning and fade it in over fade_duration seconds
+    // -- while the current clip (or crossfade) keeps playing and fades out
+    void CrossfadeTo (std::string const & clip_name, float fade_duration);
+
+    void SetLod (AnimationLod const & lod);
+
+    // -- called every frame, increments time,
+    // -- interpolates animation data for each bone based on current anim clip, and
+    // -- generates final transforms which are set to the effect for processing in the vertex shader
+    void UpdateSkinnedAnimation (float dt) {
+        UpdateSkinnedAnimation(dt, FinalTransforms.data());
+    }
+    // -- same as above but writes final transforms straight to out_final_transforms (e.g. a mapped constant buffer)
+    void UpdateSkinnedAnimation (float dt, DirectX::XMFLOAT4X4 * out_final_transforms);
+
+private:
+    // -- final transforms of the current clip(s) and layers at their current time points
+    void evaluate (DirectX::XMFLOAT4X4 * out_final_transforms);
+    // -- blend weights of Clip (weights[0]) and of the faded out clips (weights[k + 1]), they sum to 1
+    void fade_weights (float * weights) const;
+};
+
+class JobSystem;
+
+// -- update instances in parallel, instance i writes its final transforms to
+// -- out_palettes + i * palette_byte_stride (nullptr keeps them in FinalTransforms).
+// -- Every instance is updated independently so results do not depend on the thread count
+void UpdateSkinnedInstances (
+    JobSystem & jobs,
+    SkinnedModelInstance * instances, UINT num_instances,
+    float dt,
+    BYTE * out_palettes = nullptr, UINT palette_byte_stride = 0
+);
+// -- same as above but every instance packs its final transforms into a shared 3x4 bone palette
+// -- starting at out_bone_palette + PaletteOffset (see PackBonePalette)
+void UpdateSkinnedInstances (
+    JobSystem & jobs,
+    SkinnedModelInstance * instances, UINT num_instances,
+    float dt,
+    DirectX::XMFLOAT3X4 * out_bone_palette
+);
+
+// -- 3x4 affine form of final transforms as SkinnedData::GetFinalTransforms stores them (transposed 4x4):
+// -- the first three rows, the last one is always (0, 0, 0, 1). Same result as the XMFLOAT3X4 overloads
+void PackBonePalette (
+    DirectX::XMFLOAT4X4 const * transposed_transforms, UINT num_bones,
+    DirectX::XMFLOAT3X4 * out_palette
+);
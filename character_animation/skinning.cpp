@@ -0,0 +1,136 @@
+#include "skinning.h"
+
+using namespace DirectX;
+
+DualQuaternion MakeDualQuaternion (DirectX::FXMMATRIX transform) {
+    // -- normalized rows drop the (uniform) scale before extracting the rotation
+    XMMATRIX rotation = transform;
+    rotation.r[0] = XMVector3Normalize(transform.r[0]);
+    rotation.r[1] = XMVector3Normalize(transform.r[1]);
+    rotation.r[2] = XMVector3Normalize(transform.r[2]);
+    rotation.r[3] = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+    XMVECTOR real = XMQuaternionNormalize(XMQuaternionRotationMatrix(rotation));
+    XMVECTOR translation = XMVectorSetW(transform.r[3], 0.0f);
+
+    // -- XMQuaternionMultiply(q1, q2) is the product q2 * q1
+    DualQuaternion dq;
+    XMStoreFloat4(&dq.Real, real);
+    XMStoreFloat4(&dq.Dual, XMVectorScale(XMQuaternionMultiply(real, translation), 0.5f));
+    return dq;
+}
+void ToDualQuaternions (
+    DirectX::XMFLOAT4X4 const * transposed_transforms, UINT num_bones,
+    DualQuaternion * out_dual_quaternions
+) {
+    for (UINT i = 0; i < num_bones; ++i)
+        out_dual_quaternions[i] = MakeDualQuaternion(XMMatrixTranspose(XMLoadFloat4x4(&transposed_transforms[i])));
+}
+
+static void load_weights (M3DLoader::SkinnedVertex const & vertex, float weights[4]) {
+    weights[0] = vertex.BoneWeights.x;
+    weights[1] = vertex.BoneWeights.y;
+    weights[2] = vertex.BoneWeights.z;
+    weights[3] = 1.0f - weights[0] - weights[1] - weights[2];
+}
+// -- v rotated by the unit quaternion real
+static XMVECTOR rotate (FXMVECTOR real, FXMVECTOR v) {
+    XMVECTOR t = XMVectorMultiplyAdd(XMVectorSplatW(real), v, XMVector3Cross(real, v));
+    return XMVectorAdd(v, XMVectorScale(XMVector3Cross(real, t), 2.0f));
+}
+// -- translation of a unit dual quaternion, 2 * dual * conjugate(real)
+static XMVECTOR translation (FXMVECTOR real, FXMVECTOR dual) {
+    XMVECTOR t = XMVectorMultiply(XMVectorSplatW(real), dual);
+    t = XMVectorSubtract(t, XMVectorMultiply(XMVectorSplatW(dual), real));
+    t = XMVectorAdd(t, XMVector3Cross(real, dual));
+    return XMVectorScale(t, 2.0f);
+}
+
+void SkinVerticesLinear (
+    M3DLoader::SkinnedVertex const * vertices, UINT num_vertices,
+    DirectX::XMFLOAT4X4 const * transposed_transforms,
+    PosedVertex * out_vertices
+) {
+    for (UINT v = 0; v < num_vertices; ++v) {
+        M3DLoader::SkinnedVertex const & vertex = vertices[v];
+        float weights[4];
+        load_weights(vertex, weights);
+
+        // -- skinning is linear in the bone matrices: blend the 3 affine rows of the 4 bones first,
+        // -- then transform position, normal and tangent once by the blended matrix
+        XMMATRIX blended;
+        blended.r[0] = XMVectorZero();
+        blended.r[1] = XMVectorZero();
+        blended.r[2] = XMVectorZero();
+        blended.r[3] = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+        for (int i = 0; i < 4; ++i) {
+            XMFLOAT4X4 const & bone = transposed_transforms[vertex.BoneIndices[i]];
+            XMVECTOR w = XMVectorReplicate(weights[i]);
+            blended.r[0] = XMVectorMultiplyAdd(w, XMLoadFloat4((XMFLOAT4 const *)bone.m[0]), blended.r[0]);
+            blended.r[1] = XMVectorMultiplyAdd(w, XMLoadFloat4((XMFLOAT4 const *)bone.m[1]), blended.r[1]);
+            blended.r[2] = XMVectorMultiplyAdd(w, XMLoadFloat4((XMFLOAT4 const *)bone.m[2]), blended.r[2]);
+        }
+        blended = XMMatrixTranspose(blended);
+
+        PosedVertex & out = out_vertices[v];
+        XMStoreFloat3(&out.Pos, XMVector3Transform(XMLoadFloat3(&vertex.Pos), blended));
+        XMStoreFloat3(&out.Normal, XMVector3TransformNormal(XMLoadFloat3(&vertex.Normal), blended));
+        XMStoreFloat3(&out.TangentU, XMVector3TransformNormal(XMLoadFloat3(&vertex.TangentU), blended));
+        out.TexC = vertex.TexC;
+    }
+}
+void SkinVerticesDualQuaternion (
+    M3DLoader::SkinnedVertex const * vertices, UINT num_vertices,
+    DualQuaternion const * dual_quaternions,
+    PosedVertex * out_vertices
+) {
+    for (UINT v = 0; v < num_vertices; ++v) {
+        M3DLoader::SkinnedVertex const & vertex = vertices[v];
+        float weights[4];
+        load_weights(vertex, weights);
+
+        // -- q and -q are the same rotation, blend every bone in the hemisphere of the first one
+        XMVECTOR first_real = XMLoadFloat4(&dual_quaternions[vertex.BoneIndices[0]].Real);
+        XMVECTOR real = XMVectorZero();
+        XMVECTOR dual = XMVectorZero();
+        for (int i = 0; i < 4; ++i) {
+            DualQuaternion const & dq = dual_quaternions[vertex.BoneIndices[i]];
+            XMVECTOR bone_real = XMLoadFloat4(&dq.Real);
+            float w = XMVectorGetX(XMVector4Dot(bone_real, first_real)) < 0.0f ? -weights[i] : weights[i];
+            real = XMVectorMultiplyAdd(XMVectorReplicate(w), bone_real, real);
+            dual = XMVectorMultiplyAdd(XMVectorReplicate(w), XMLoadFloat4(&dq.Dual), dual);
+        }
+        XMVECTOR inv_length = XMVectorReciprocal(XMVector4Length(real));
+        real = XMVectorMultiply(real, inv_length);
+        dual = XMVectorMultiply(dual, inv_length);
+
+        PosedVertex & out = out_vertices[v];
+        XMStoreFloat3(&out.Pos, XMVectorAdd(rotate(real, XMLoadFloat3(&vertex.Pos)), translation(real, dual)));
+        XMStoreFloat3(&out.Normal, rotate(real, XMLoadFloat3(&vertex.Normal)));
+        XMStoreFloat3(&out.TangentU, rotate(real, XMLoadFloat3(&vertex.TangentU)));
+        out.TexC = vertex.TexC;
+    }
+}
+
+// -- enough vertices per job that the hand-off cost stays small next to the skinning
+static UINT const vertices_per_job = 512;
+
+void SkinVerticesParallel (
+    JobSystem & jobs,
+    M3DLoader::SkinnedVertex const * vertices, UINT num_vertices,
+    DirectX::XMFLOAT4X4 const * transposed_transforms,
+    PosedVertex * out_vertices
+) {
+    jobs.ParallelFor(num_vertices, vertices_per_job, [=](unsigned begin, unsigned end) {
+        SkinVerticesLinear(vertices + begin, end - begin, transposed_transforms, out_vertices + begin);
+    });
+}
+void SkinVerticesParallel (
+    JobSystem & jobs,
+    M3DLoader::SkinnedVertex const * vertices, UINT num_vertices,
+    DualQuaternion const * dual_quaternions,
+    PosedVertex * out_vertices
+) {
+    jobs.ParallelFor(num_vertices, vertices_per_job, [=](unsigned begin, unsigned end) {
+        SkinVerticesDualQuaternion(vertices + begin, end - begin, dual_quaternions, out_vertices + begin);
+    });
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "load_m3d.h"
+#include "../common/job_system.h"
+
+//
+// -- Rigid bone transform as a unit dual quaternion: Real is the rotation, Dual = 0.5 * t * Real
+// -- (quaternion product with t = (x, y, z, 0)). 8 floats per bone instead of the 16 of a 4x4 matrix,
+// -- and blending them does not collapse the volume around twisting joints the way blended matrices do
+struct DualQuaternion {
+    DirectX::XMFLOAT4 Real = {0.0f, 0.0f, 0.0f, 1.0f};
+    DirectX::XMFLOAT4 Dual = {0.0f, 0.0f, 0.0f, 0.0f};
+};
+
+// -- rotation and translation of an affine transform (row vector convention), scale is dropped
+DualQuaternion MakeDualQuaternion (DirectX::FXMMATRIX transform);
+// -- convert final transforms as SkinnedData::GetFinalTransforms stores them (transposed for the shader)
+void ToDualQuaternions (
+    DirectX::XMFLOAT4X4 const * transposed_transforms, UINT num_bones,
+    DualQuaternion * out_dual_quaternions
+);
+
+//
+// -- Skinned vertex in model space, same layout as an unskinned vertex (POSITION, NORMAL, TEXCOORD, TANGENT)
+struct PosedVertex {
+    DirectX::XMFLOAT3 Pos;
+    DirectX::XMFLOAT3 Normal;
+    DirectX::XMFLOAT2 TexC;
+    DirectX::XMFLOAT3 TangentU;
+};
+
+//
+// -- CPU version of the skinning done by the skinned vertex and pre-skinning shaders: every vertex is skinned by
+// -- up to 4 bones, the 4th weight is 1 - (sum of the stored 3)
+void SkinVerticesLinear (
+    M3DLoader::SkinnedVertex const * vertices, UINT num_vertices,
+    DirectX::XMFLOAT4X4 const * transposed_transforms,
+    PosedVertex * out_vertices
+);
+// -- blend dual quaternions (signs aligned to the first bone, then normalized) instead of matrices
+void SkinVerticesDualQuaternion (
+    M3DLoader::SkinnedVertex const * vertices, UINT num_vertices,
+    DualQuaternion const * dual_quaternions,
+    PosedVertex * out_vertices
+);
+
+//
+// -- Same as above with the vertices split over the threads of jobs, for skinning once per frame on the CPU
+// -- (e.g. when pre-skinned vertices are uploaded for every pass instead of skinned in each pass's vertex shader)
+void SkinVerticesParallel (
+    JobSystem & jobs,
+    M3DLoader::SkinnedVertex const * vertices, UINT num_vertices,
+    DirectX::XMFLOAT4X4 const * transposed_transforms,
+    PosedVertex * out_vertices
+);
+void SkinVerticesParallel (
+    JobSystem & jobs,
+    M3DLoader::SkinnedVertex const * vertices, UINT num_vertices,
+    DualQuaternion const * dual_quaternions,
+    PosedVertex * out_vertices
+);
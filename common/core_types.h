@@ -0,0 +1,24 @@
+#pragma once
+
+//
+// -- Platform independent base for code that has no business with windows.h or Direct3D
+// -- (animation sampling, skinning math, .m3d parsing). Only needs DirectXMath and the standard library,
+// -- so that code also builds headless and off Windows.
+#include <DirectXMath.h>
+#include <string>
+#include <memory>
+#include <algorithm>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <fstream>
+#include <sstream>
+#include "math_helper.h"
+
+// -- same types as the windows.h typedefs, so redeclaring them next to windows.h is harmless
+typedef unsigned char BYTE;
+typedef unsigned short USHORT;
+typedef unsigned int UINT;
@@ -98,6 +98,8 @@ struct SubmeshGeometry {
     UINT IndexCount = 0;
     UINT StartIndexLocation = 0;
     INT BaseVertexLocation = 0;
+    // -- DXGI_FORMAT_UNKNOWN uses the geometry's IndexFormat, otherwise StartIndexLocation counts indices of this format
+    DXGI_FORMAT IndexFormat = DXGI_FORMAT_UNKNOWN;
 
     DirectX::BoundingBox Bounds;
 };
@@ -131,10 +133,11 @@ struct MeshGeometry {
         return vbv;
     }
 
-    D3D12_INDEX_BUFFER_VIEW IndexBufferView () const {
+    // -- the whole index buffer viewed as indices of format (DXGI_FORMAT_UNKNOWN for IndexFormat)
+    D3D12_INDEX_BUFFER_VIEW IndexBufferView (DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN) const {
         D3D12_INDEX_BUFFER_VIEW ibv;
         ibv.BufferLocation = IndexBufferGpu->GetGPUVirtualAddress();
-        ibv.Format = IndexFormat;
+        ibv.Format = DXGI_FORMAT_UNKNOWN == format ? IndexFormat : format;
         ibv.SizeInBytes = IndexBufferByteSize;
         return ibv;
     }
@@ -0,0 +1,93 @@
+#include "job_system.h"
+
+JobSystem::JobSystem (unsigned num_threads) {
+    if (0 == num_threads)
+        num_threads = std::thread::hardware_concurrency();
+    if (0 == num_threads)
+        num_threads = 1;
+
+    ranges_ = std::vector<ChunkRange>(num_threads);
+    for (unsigned i = 1; i < num_threads; ++i)
+        workers_.emplace_back(&JobSystem::worker_main, this, i);
+}
+JobSystem::~JobSystem () {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    work_cv_.notify_all();
+    for (auto & w : workers_)
+        w.join();
+}
+void JobSystem::worker_main (unsigned thread_index) {
+    unsigned seen_generation = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_cv_.wait(lock, [&] { return quit_ || generation_ != seen_generation; });
+            if (quit_)
+                return;
+            seen_generation = generation_;
+        }
+
+        run_chunks(thread_index);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (0 == --busy_workers_)
+                done_cv_.notify_one();
+        }
+    }
+}
+void JobSystem::run_chunks (unsigned thread_index) {
+    unsigned num_threads = ThreadCount();
+
+    // -- drain own chunks first, then steal from the other threads
+    for (unsigned k = 0; k < num_threads; ++k) {
+        ChunkRange & range = ranges_[(thread_index + k) % num_threads];
+        for (;;) {
+            unsigned chunk = range.Next.fetch_add(1, std::memory_order_relaxed);
+            if (chunk >= range.End)
+                break;
+
+            unsigned begin = chunk * chunk_size_;
+            unsigned end = begin + chunk_size_ < count_ ? begin + chunk_size_ : count_;
+            (*job_)(begin, end);
+        }
+    }
+}
+void JobSystem::ParallelFor (unsigned count, unsigned chunk_size, Job const & job) {
+    if (0 == count)
+        return;
+    if (0 == chunk_size)
+        chunk_size = 1;
+
+    unsigned num_chunks = (count + chunk_size - 1) / chunk_size;
+    unsigned num_threads = ThreadCount();
+    if (1 == num_threads || 1 == num_chunks) {
+        job(0, count);
+        return;
+    }
+
+    // -- every thread starts with its own contiguous run of chunks
+    for (unsigned t = 0; t < num_threads; ++t) {
+        ranges_[t].Next.store((unsigned)((unsigned long long)num_chunks * t / num_threads), std::memory_order_relaxed);
+        ranges_[t].End = (unsigned)((unsigned long long)num_chunks * (t + 1) / num_threads);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = &job;
+        count_ = count;
+        chunk_size_ = chunk_size;
+        busy_workers_ = (unsigned)workers_.size();
+        ++generation_;
+    }
+    work_cv_.notify_all();
+
+    run_chunks(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [&] { return 0 == busy_workers_; });
+    job_ = nullptr;
+}
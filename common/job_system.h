@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//
+// -- Small fork-join job system for data parallel loops.
+// -- ParallelFor splits [0, count) into chunks, gives every thread its own contiguous run of chunks
+// -- and lets threads that finish early steal remaining chunks from the others.
+// -- The calling thread works too, so a JobSystem of N threads spawns N - 1 workers
+class JobSystem {
+public:
+    // -- job (begin, end) processes items [begin, end)
+    using Job = std::function<void(unsigned, unsigned)>;
+
+private:
+    // -- chunks of one thread, padded so threads popping their own chunks don't share cache lines
+    struct ChunkRange {
+        std::atomic<unsigned> Next;
+        unsigned End;
+        char Pad[56];
+    };
+
+    std::vector<std::thread> workers_;
+    std::vector<ChunkRange> ranges_;
+
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    unsigned generation_ = 0;
+    unsigned busy_workers_ = 0;
+    bool quit_ = false;
+
+    // -- current ParallelFor call
+    Job const * job_ = nullptr;
+    unsigned count_ = 0;
+    unsigned chunk_size_ = 0;
+
+    void worker_main (unsigned thread_index);
+    void run_chunks (unsigned thread_index);
+
+public:
+    // -- 0 uses one thread per hardware thread
+    explicit JobSystem (unsigned num_threads = 0);
+    JobSystem (JobSystem const & rhs) = delete;
+    JobSystem & operator= (JobSystem const & rhs) = delete;
+    ~JobSystem ();
+
+    unsigned ThreadCount () const { return (unsigned)workers_.size() + 1; }
+
+    // -- blocks until job has run over every item, must not be called from inside a job
+    void ParallelFor (unsigned count, unsigned chunk_size, Job const & job);
+};
@@ -0,0 +1,86 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile () {
+    Close();
+}
+#ifdef _WIN32
+bool MappedFile::Open (std::string const & filename) {
+    Close();
+
+    HANDLE file = CreateFileA(
+        filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr
+    );
+    if (INVALID_HANDLE_VALUE == file)
+        return false;
+    file_ = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || 0 == size.QuadPart) {
+        Close();
+        return false;
+    }
+    mapping_ = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (nullptr == mapping_) {
+        Close();
+        return false;
+    }
+    data_ = static_cast<BYTE const *>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    if (nullptr == data_) {
+        Close();
+        return false;
+    }
+    size_ = (uint64_t)size.QuadPart;
+    return true;
+}
+void MappedFile::Close () {
+    if (nullptr != data_)
+        UnmapViewOfFile(data_);
+    if (nullptr != mapping_)
+        CloseHandle(mapping_);
+    if (nullptr != file_)
+        CloseHandle(file_);
+    file_ = nullptr;
+    mapping_ = nullptr;
+    data_ = nullptr;
+    size_ = 0;
+}
+#else
+bool MappedFile::Open (std::string const & filename) {
+    Close();
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (0 != fstat(fd, &st) || 0 == st.st_size) {
+        close(fd);
+        return false;
+    }
+    void * data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // -- the mapping keeps its own reference to the file
+    close(fd);
+    if (MAP_FAILED == data)
+        return false;
+
+    data_ = static_cast<BYTE const *>(data);
+    size_ = (uint64_t)st.st_size;
+    return true;
+}
+void MappedFile::Close () {
+    if (nullptr != data_)
+        munmap(const_cast<BYTE *>(data_), (size_t)size_);
+    data_ = nullptr;
+    size_ = 0;
+}
+#endif
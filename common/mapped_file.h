@@ -0,0 +1,29 @@
+#pragma once
+
+#include "core_types.h"
+
+//
+// -- Read-only memory mapping of a whole file. The view stays valid until Close or destruction,
+// -- pages are brought in by the OS on first touch instead of being copied through a stream
+class MappedFile {
+private:
+    // -- file and file mapping HANDLEs on windows, unused elsewhere (the mapping outlives the descriptor)
+    void * file_ = nullptr;
+    void * mapping_ = nullptr;
+    BYTE const * data_ = nullptr;
+    uint64_t size_ = 0;
+
+public:
+    MappedFile () = default;
+    ~MappedFile ();
+    MappedFile (MappedFile const &) = delete;
+    MappedFile & operator= (MappedFile const &) = delete;
+
+    // -- false if the file cannot be opened or mapped (an empty file cannot be mapped either)
+    bool Open (std::string const & filename);
+    void Close ();
+
+    bool IsOpen () const { return nullptr != data_; }
+    BYTE const * Data () const { return data_; }
+    uint64_t Size () const { return size_; }
+};
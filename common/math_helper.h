@@ -1,8 +1,9 @@
 #pragma once
 
-#include <windows.h>
 #include <DirectXMath.h>
 #include <stdint.h>
+#include <float.h>
+#include <stdlib.h>
 
 // NOTE(omid):
 // The rand function returns a pseudorandom integer in the range 0 to RAND_MAX (32767).
@@ -105,7 +106,6 @@ struct MathHelper {
 
     static DirectX::XMVECTOR RandUnitVec3 () {
         DirectX::XMVECTOR one = DirectX::XMVectorSet(1.0f, 1.0f, 1.0f, 1.0f);
-        DirectX::XMVECTOR zero = DirectX::XMVectorZero();
 
         // -- keep trying til we get a vector inside the hemisphere
         while (true) {
@@ -43,5 +43,9 @@ public:
     void CopyData (int element_index, T const & data) {
         memcpy(&mapped_data_[element_index * element_byte_size_], &data, sizeof(T));
     }
+
+    // -- for writing elements in place (e.g. from several threads) instead of through CopyData
+    BYTE * GetMappedData () const { return mapped_data_; }
+    UINT GetElementByteSize () const { return element_byte_size_; }
 };
 
@@ -0,0 +1,585 @@
+#pragma once
+
+//
+// -- Portable scalar subset of DirectXMath (https://github.com/microsoft/DirectXMath), used by the CMake build
+// -- of the animation core when neither the upstream headers (externals/DirectXMath/Inc) nor an installed
+// -- directxmath package are found. Same names, types and semantics as upstream built with _XM_NO_INTRINSICS_:
+// -- row vectors, XMQuaternionMultiply(Q1, Q2) rotates by Q1 then Q2, XMStoreFloat3x4 stores the transpose.
+// -- Only what the platform independent code (core_types.h and up) and its tests use is provided
+#include <math.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define XM_CALLCONV
+#define DIRECTX_MATH_PORTABLE_SUBSET 1
+
+namespace DirectX {
+
+constexpr float XM_PI = 3.141592654f;
+constexpr float XM_2PI = 6.283185307f;
+constexpr float XM_PIDIV2 = 1.570796327f;
+
+inline constexpr float XMConvertToRadians (float degrees) { return degrees * (XM_PI / 180.0f); }
+inline constexpr float XMConvertToDegrees (float radians) { return radians * (180.0f / XM_PI); }
+
+//
+// -- Types
+struct XMVECTOR {
+    float f[4];
+};
+typedef const XMVECTOR FXMVECTOR;
+typedef const XMVECTOR GXMVECTOR;
+typedef const XMVECTOR & HXMVECTOR;
+typedef const XMVECTOR & CXMVECTOR;
+
+struct XMMATRIX {
+    XMVECTOR r[4];
+
+    XMMATRIX () = default;
+    XMMATRIX (FXMVECTOR r0, FXMVECTOR r1, FXMVECTOR r2, CXMVECTOR r3) : r{r0, r1, r2, r3} {}
+    XMMATRIX (
+        float m00, float m01, float m02, float m03,
+        float m10, float m11, float m12, float m13,
+        float m20, float m21, float m22, float m23,
+        float m30, float m31, float m32, float m33
+    ) : r{{{m00, m01, m02, m03}}, {{m10, m11, m12, m13}}, {{m20, m21, m22, m23}}, {{m30, m31, m32, m33}}} {}
+};
+typedef const XMMATRIX & FXMMATRIX;
+typedef const XMMATRIX & CXMMATRIX;
+
+struct XMFLOAT2 {
+    float x;
+    float y;
+
+    XMFLOAT2 () = default;
+    constexpr XMFLOAT2 (float _x, float _y) : x(_x), y(_y) {}
+};
+struct XMFLOAT3 {
+    float x;
+    float y;
+    float z;
+
+    XMFLOAT3 () = default;
+    constexpr XMFLOAT3 (float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+};
+struct XMFLOAT4 {
+    float x;
+    float y;
+    float z;
+    float w;
+
+    XMFLOAT4 () = default;
+    constexpr XMFLOAT4 (float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+};
+// -- 3x4 row-major storage of the transpose of an affine matrix (3 rows of 4 columns, as shaders read it)
+struct XMFLOAT3X4 {
+    float m[3][4];
+
+    XMFLOAT3X4 () = default;
+    constexpr XMFLOAT3X4 (
+        float m00, float m01, float m02, float m03,
+        float m10, float m11, float m12, float m13,
+        float m20, float m21, float m22, float m23
+    ) : m{{m00, m01, m02, m03}, {m10, m11, m12, m13}, {m20, m21, m22, m23}} {}
+
+    float operator() (size_t row, size_t column) const { return m[row][column]; }
+    float & operator() (size_t row, size_t column) { return m[row][column]; }
+};
+struct XMFLOAT4X4 {
+    union {
+        struct {
+            float _11, _12, _13, _14;
+            float _21, _22, _23, _24;
+            float _31, _32, _33, _34;
+            float _41, _42, _43, _44;
+        };
+        float m[4][4];
+    };
+
+    XMFLOAT4X4 () = default;
+    constexpr XMFLOAT4X4 (
+        float m00, float m01, float m02, float m03,
+        float m10, float m11, float m12, float m13,
+        float m20, float m21, float m22, float m23,
+        float m30, float m31, float m32, float m33
+    ) : m{{m00, m01, m02, m03}, {m10, m11, m12, m13}, {m20, m21, m22, m23}, {m30, m31, m32, m33}} {}
+
+    float operator() (size_t row, size_t column) const { return m[row][column]; }
+    float & operator() (size_t row, size_t column) { return m[row][column]; }
+};
+
+//
+// -- Load and store
+inline XMVECTOR XM_CALLCONV XMLoadFloat2 (XMFLOAT2 const * source) { return {{source->x, source->y, 0.0f, 0.0f}}; }
+inline XMVECTOR XM_CALLCONV XMLoadFloat3 (XMFLOAT3 const * source) { return {{source->x, source->y, source->z, 0.0f}}; }
+inline XMVECTOR XM_CALLCONV XMLoadFloat4 (XMFLOAT4 const * source) { return {{source->x, source->y, source->z, source->w}}; }
+inline XMMATRIX XM_CALLCONV XMLoadFloat4x4 (XMFLOAT4X4 const * source) {
+    XMMATRIX m;
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            m.r[i].f[j] = source->m[i][j];
+    return m;
+}
+inline XMMATRIX XM_CALLCONV XMLoadFloat3x4 (XMFLOAT3X4 const * source) {
+    XMMATRIX m;
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 3; ++j)
+            m.r[i].f[j] = source->m[j][i];
+        m.r[i].f[3] = 3 == i ? 1.0f : 0.0f;
+    }
+    return m;
+}
+inline void XM_CALLCONV XMStoreFloat2 (XMFLOAT2 * destination, FXMVECTOR v) {
+    destination->x = v.f[0];
+    destination->y = v.f[1];
+}
+inline void XM_CALLCONV XMStoreFloat3 (XMFLOAT3 * destination, FXMVECTOR v) {
+    destination->x = v.f[0];
+    destination->y = v.f[1];
+    destination->z = v.f[2];
+}
+inline void XM_CALLCONV XMStoreFloat4 (XMFLOAT4 * destination, FXMVECTOR v) {
+    destination->x = v.f[0];
+    destination->y = v.f[1];
+    destination->z = v.f[2];
+    destination->w = v.f[3];
+}
+inline void XM_CALLCONV XMStoreFloat4x4 (XMFLOAT4X4 * destination, FXMMATRIX m) {
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            destination->m[i][j] = m.r[i].f[j];
+}
+inline void XM_CALLCONV XMStoreFloat3x4 (XMFLOAT3X4 * destination, FXMMATRIX m) {
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 4; ++j)
+            destination->m[i][j] = m.r[j].f[i];
+}
+
+//
+// -- Vector
+inline XMVECTOR XM_CALLCONV XMVectorSet (float x, float y, float z, float w) { return {{x, y, z, w}}; }
+inline XMVECTOR XM_CALLCONV XMVectorZero () { return {{0.0f, 0.0f, 0.0f, 0.0f}}; }
+inline XMVECTOR XM_CALLCONV XMVectorSplatOne () { return {{1.0f, 1.0f, 1.0f, 1.0f}}; }
+inline XMVECTOR XM_CALLCONV XMVectorReplicate (float value) { return {{value, value, value, value}}; }
+inline XMVECTOR XM_CALLCONV XMVectorSplatX (FXMVECTOR v) { return XMVectorReplicate(v.f[0]); }
+inline XMVECTOR XM_CALLCONV XMVectorSplatY (FXMVECTOR v) { return XMVectorReplicate(v.f[1]); }
+inline XMVECTOR XM_CALLCONV XMVectorSplatZ (FXMVECTOR v) { return XMVectorReplicate(v.f[2]); }
+inline XMVECTOR XM_CALLCONV XMVectorSplatW (FXMVECTOR v) { return XMVectorReplicate(v.f[3]); }
+inline float XM_CALLCONV XMVectorGetX (FXMVECTOR v) { return v.f[0]; }
+inline float XM_CALLCONV XMVectorGetY (FXMVECTOR v) { return v.f[1]; }
+inline float XM_CALLCONV XMVectorGetZ (FXMVECTOR v) { return v.f[2]; }
+inline float XM_CALLCONV XMVectorGetW (FXMVECTOR v) { return v.f[3]; }
+inline XMVECTOR XM_CALLCONV XMVectorSetX (FXMVECTOR v, float x) { return {{x, v.f[1], v.f[2], v.f[3]}}; }
+inline XMVECTOR XM_CALLCONV XMVectorSetY (FXMVECTOR v, float y) { return {{v.f[0], y, v.f[2], v.f[3]}}; }
+inline XMVECTOR XM_CALLCONV XMVectorSetZ (FXMVECTOR v, float z) { return {{v.f[0], v.f[1], z, v.f[3]}}; }
+inline XMVECTOR XM_CALLCONV XMVectorSetW (FXMVECTOR v, float w) { return {{v.f[0], v.f[1], v.f[2], w}}; }
+
+inline XMVECTOR XM_CALLCONV XMVectorAdd (FXMVECTOR v1, FXMVECTOR v2) {
+    return {{v1.f[0] + v2.f[0], v1.f[1] + v2.f[1], v1.f[2] + v2.f[2], v1.f[3] + v2.f[3]}};
+}
+inline XMVECTOR XM_CALLCONV XMVectorSubtract (FXMVECTOR v1, FXMVECTOR v2) {
+    return {{v1.f[0] - v2.f[0], v1.f[1] - v2.f[1], v1.f[2] - v2.f[2], v1.f[3] - v2.f[3]}};
+}
+inline XMVECTOR XM_CALLCONV XMVectorMultiply (FXMVECTOR v1, FXMVECTOR v2) {
+    return {{v1.f[0] * v2.f[0], v1.f[1] * v2.f[1], v1.f[2] * v2.f[2], v1.f[3] * v2.f[3]}};
+}
+inline XMVECTOR XM_CALLCONV XMVectorDivide (FXMVECTOR v1, FXMVECTOR v2) {
+    return {{v1.f[0] / v2.f[0], v1.f[1] / v2.f[1], v1.f[2] / v2.f[2], v1.f[3] / v2.f[3]}};
+}
+// -- v1 * v2 + v3
+inline XMVECTOR XM_CALLCONV XMVectorMultiplyAdd (FXMVECTOR v1, FXMVECTOR v2, FXMVECTOR v3) {
+    return XMVectorAdd(XMVectorMultiply(v1, v2), v3);
+}
+// -- v3 - v1 * v2
+inline XMVECTOR XM_CALLCONV XMVectorNegativeMultiplySubtract (FXMVECTOR v1, FXMVECTOR v2, FXMVECTOR v3) {
+    return XMVectorSubtract(v3, XMVectorMultiply(v1, v2));
+}
+inline XMVECTOR XM_CALLCONV XMVectorScale (FXMVECTOR v, float scale) {
+    return {{v.f[0] * scale, v.f[1] * scale, v.f[2] * scale, v.f[3] * scale}};
+}
+inline XMVECTOR XM_CALLCONV XMVectorNegate (FXMVECTOR v) { return {{-v.f[0], -v.f[1], -v.f[2], -v.f[3]}}; }
+inline XMVECTOR XM_CALLCONV XMVectorAbs (FXMVECTOR v) {
+    return {{fabsf(v.f[0]), fabsf(v.f[1]), fabsf(v.f[2]), fabsf(v.f[3])}};
+}
+inline XMVECTOR XM_CALLCONV XMVectorMin (FXMVECTOR v1, FXMVECTOR v2) {
+    XMVECTOR result;
+    for (int i = 0; i < 4; ++i)
+        result.f[i] = v1.f[i] < v2.f[i] ? v1.f[i] : v2.f[i];
+    return result;
+}
+inline XMVECTOR XM_CALLCONV XMVectorMax (FXMVECTOR v1, FXMVECTOR v2) {
+    XMVECTOR result;
+    for (int i = 0; i < 4; ++i)
+        result.f[i] = v1.f[i] > v2.f[i] ? v1.f[i] : v2.f[i];
+    return result;
+}
+inline XMVECTOR XM_CALLCONV XMVectorSqrt (FXMVECTOR v) {
+    return {{sqrtf(v.f[0]), sqrtf(v.f[1]), sqrtf(v.f[2]), sqrtf(v.f[3])}};
+}
+inline XMVECTOR XM_CALLCONV XMVectorReciprocal (FXMVECTOR v) {
+    return {{1.0f / v.f[0], 1.0f / v.f[1], 1.0f / v.f[2], 1.0f / v.f[3]}};
+}
+inline XMVECTOR XM_CALLCONV XMVectorLerp (FXMVECTOR v0, FXMVECTOR v1, float t) {
+    return XMVectorMultiplyAdd(XMVectorReplicate(t), XMVectorSubtract(v1, v0), v0);
+}
+
+//
+// -- Comparison masks are 0xFFFFFFFF (true) or 0 per component, XMVectorSelect takes v2 where control is set
+namespace Internal {
+inline XMVECTOR Mask (bool x, bool y, bool z, bool w) {
+    uint32_t bits[4] = {x ? 0xFFFFFFFFu : 0u, y ? 0xFFFFFFFFu : 0u, z ? 0xFFFFFFFFu : 0u, w ? 0xFFFFFFFFu : 0u};
+    XMVECTOR result;
+    memcpy(result.f, bits, sizeof(bits));
+    return result;
+}
+} // namespace Internal
+inline XMVECTOR XM_CALLCONV XMVectorEqual (FXMVECTOR v1, FXMVECTOR v2) {
+    return Internal::Mask(v1.f[0] == v2.f[0], v1.f[1] == v2.f[1], v1.f[2] == v2.f[2], v1.f[3] == v2.f[3]);
+}
+inline XMVECTOR XM_CALLCONV XMVectorLess (FXMVECTOR v1, FXMVECTOR v2) {
+    return Internal::Mask(v1.f[0] < v2.f[0], v1.f[1] < v2.f[1], v1.f[2] < v2.f[2], v1.f[3] < v2.f[3]);
+}
+inline XMVECTOR XM_CALLCONV XMVectorGreater (FXMVECTOR v1, FXMVECTOR v2) {
+    return Internal::Mask(v1.f[0] > v2.f[0], v1.f[1] > v2.f[1], v1.f[2] > v2.f[2], v1.f[3] > v2.f[3]);
+}
+inline XMVECTOR XM_CALLCONV XMVectorSelect (FXMVECTOR v1, FXMVECTOR v2, FXMVECTOR control) {
+    uint32_t a[4], b[4], c[4];
+    memcpy(a, v1.f, sizeof(a));
+    memcpy(b, v2.f, sizeof(b));
+    memcpy(c, control.f, sizeof(c));
+    for (int i = 0; i < 4; ++i)
+        a[i] = (a[i] & ~c[i]) | (b[i] & c[i]);
+    XMVECTOR result;
+    memcpy(result.f, a, sizeof(a));
+    return result;
+}
+
+//
+// -- 3D and 4D vector, dot products and lengths are replicated into every component
+inline XMVECTOR XM_CALLCONV XMVector3Dot (FXMVECTOR v1, FXMVECTOR v2) {
+    return XMVectorReplicate(v1.f[0] * v2.f[0] + v1.f[1] * v2.f[1] + v1.f[2] * v2.f[2]);
+}
+inline XMVECTOR XM_CALLCONV XMVector3Cross (FXMVECTOR v1, FXMVECTOR v2) {
+    return {{
+        v1.f[1] * v2.f[2] - v1.f[2] * v2.f[1],
+        v1.f[2] * v2.f[0] - v1.f[0] * v2.f[2],
+        v1.f[0] * v2.f[1] - v1.f[1] * v2.f[0],
+        0.0f
+    }};
+}
+inline XMVECTOR XM_CALLCONV XMVector3LengthSq (FXMVECTOR v) { return XMVector3Dot(v, v); }
+inline XMVECTOR XM_CALLCONV XMVector3Length (FXMVECTOR v) { return XMVectorSqrt(XMVector3Dot(v, v)); }
+// -- zero length vectors normalize to zero
+inline XMVECTOR XM_CALLCONV XMVector3Normalize (FXMVECTOR v) {
+    float length = sqrtf(XMVectorGetX(XMVector3Dot(v, v)));
+    return length > 0.0f ? XMVectorScale(v, 1.0f / length) : XMVectorZero();
+}
+inline bool XM_CALLCONV XMVector3Equal (FXMVECTOR v1, FXMVECTOR v2) {
+    return v1.f[0] == v2.f[0] && v1.f[1] == v2.f[1] && v1.f[2] == v2.f[2];
+}
+inline bool XM_CALLCONV XMVector3Greater (FXMVECTOR v1, FXMVECTOR v2) {
+    return v1.f[0] > v2.f[0] && v1.f[1] > v2.f[1] && v1.f[2] > v2.f[2];
+}
+inline bool XM_CALLCONV XMVector3Less (FXMVECTOR v1, FXMVECTOR v2) {
+    return v1.f[0] < v2.f[0] && v1.f[1] < v2.f[1] && v1.f[2] < v2.f[2];
+}
+inline bool XM_CALLCONV XMVector3NearEqual (FXMVECTOR v1, FXMVECTOR v2, FXMVECTOR epsilon) {
+    return fabsf(v1.f[0] - v2.f[0]) <= epsilon.f[0] &&
+        fabsf(v1.f[1] - v2.f[1]) <= epsilon.f[1] &&
+        fabsf(v1.f[2] - v2.f[2]) <= epsilon.f[2];
+}
+// -- (x, y, z, 1) * m, w included
+inline XMVECTOR XM_CALLCONV XMVector3Transform (FXMVECTOR v, FXMMATRIX m) {
+    XMVECTOR result;
+    for (int j = 0; j < 4; ++j)
+        result.f[j] = v.f[0] * m.r[0].f[j] + v.f[1] * m.r[1].f[j] + v.f[2] * m.r[2].f[j] + m.r[3].f[j];
+    return result;
+}
+// -- (x, y, z, 0) * m
+inline XMVECTOR XM_CALLCONV XMVector3TransformNormal (FXMVECTOR v, FXMMATRIX m) {
+    XMVECTOR result;
+    for (int j = 0; j < 4; ++j)
+        result.f[j] = v.f[0] * m.r[0].f[j] + v.f[1] * m.r[1].f[j] + v.f[2] * m.r[2].f[j];
+    return result;
+}
+inline XMVECTOR XM_CALLCONV XMVector4Dot (FXMVECTOR v1, FXMVECTOR v2) {
+    return XMVectorReplicate(v1.f[0] * v2.f[0] + v1.f[1] * v2.f[1] + v1.f[2] * v2.f[2] + v1.f[3] * v2.f[3]);
+}
+inline XMVECTOR XM_CALLCONV XMVector4LengthSq (FXMVECTOR v) { return XMVector4Dot(v, v); }
+inline XMVECTOR XM_CALLCONV XMVector4Length (FXMVECTOR v) { return XMVectorSqrt(XMVector4Dot(v, v)); }
+inline XMVECTOR XM_CALLCONV XMVector4Normalize (FXMVECTOR v) {
+    float length = sqrtf(XMVectorGetX(XMVector4Dot(v, v)));
+    return length > 0.0f ? XMVectorScale(v, 1.0f / length) : XMVectorZero();
+}
+inline bool XM_CALLCONV XMVector4Equal (FXMVECTOR v1, FXMVECTOR v2) {
+    return v1.f[0] == v2.f[0] && v1.f[1] == v2.f[1] && v1.f[2] == v2.f[2] && v1.f[3] == v2.f[3];
+}
+inline bool XM_CALLCONV XMVector4NearEqual (FXMVECTOR v1, FXMVECTOR v2, FXMVECTOR epsilon) {
+    return XMVector3NearEqual(v1, v2, epsilon) && fabsf(v1.f[3] - v2.f[3]) <= epsilon.f[3];
+}
+
+//
+// -- Quaternion (x, y, z, w), w is the scalar part
+inline XMVECTOR XM_CALLCONV XMQuaternionIdentity () { return {{0.0f, 0.0f, 0.0f, 1.0f}}; }
+inline XMVECTOR XM_CALLCONV XMQuaternionDot (FXMVECTOR q1, FXMVECTOR q2) { return XMVector4Dot(q1, q2); }
+inline XMVECTOR XM_CALLCONV XMQuaternionLength (FXMVECTOR q) { return XMVector4Length(q); }
+inline XMVECTOR XM_CALLCONV XMQuaternionNormalize (FXMVECTOR q) { return XMVector4Normalize(q); }
+inline XMVECTOR XM_CALLCONV XMQuaternionConjugate (FXMVECTOR q) { return {{-q.f[0], -q.f[1], -q.f[2], q.f[3]}}; }
+inline XMVECTOR XM_CALLCONV XMQuaternionInverse (FXMVECTOR q) {
+    float length_sq = XMVectorGetX(XMVector4Dot(q, q));
+    return length_sq > 0.0f ? XMVectorScale(XMQuaternionConjugate(q), 1.0f / length_sq) : XMVectorZero();
+}
+// -- the product q2 * q1: rotating by the result rotates by q1, then by q2
+inline XMVECTOR XM_CALLCONV XMQuaternionMultiply (FXMVECTOR q1, FXMVECTOR q2) {
+    return {{
+        q2.f[3] * q1.f[0] + q2.f[0] * q1.f[3] + q2.f[1] * q1.f[2] - q2.f[2] * q1.f[1],
+        q2.f[3] * q1.f[1] - q2.f[0] * q1.f[2] + q2.f[1] * q1.f[3] + q2.f[2] * q1.f[0],
+        q2.f[3] * q1.f[2] + q2.f[0] * q1.f[1] - q2.f[1] * q1.f[0] + q2.f[2] * q1.f[3],
+        q2.f[3] * q1.f[3] - q2.f[0] * q1.f[0] - q2.f[1] * q1.f[1] - q2.f[2] * q1.f[2]
+    }};
+}
+// -- normal_axis must be normalized
+inline XMVECTOR XM_CALLCONV XMQuaternionRotationNormal (FXMVECTOR normal_axis, float angle) {
+    float s = sinf(0.5f * angle);
+    return {{normal_axis.f[0] * s, normal_axis.f[1] * s, normal_axis.f[2] * s, cosf(0.5f * angle)}};
+}
+inline XMVECTOR XM_CALLCONV XMQuaternionRotationAxis (FXMVECTOR axis, float angle) {
+    return XMQuaternionRotationNormal(XMVector3Normalize(axis), angle);
+}
+// -- roll about z, then pitch about x, then yaw about y
+inline XMVECTOR XM_CALLCONV XMQuaternionRotationRollPitchYaw (float pitch, float yaw, float roll) {
+    XMVECTOR qx = XMQuaternionRotationNormal(XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f), pitch);
+    XMVECTOR qy = XMQuaternionRotationNormal(XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), yaw);
+    XMVECTOR qz = XMQuaternionRotationNormal(XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), roll);
+    return XMQuaternionMultiply(XMQuaternionMultiply(qz, qx), qy);
+}
+// -- shortest path, falls back to a normalized lerp when q0 and q1 are nearly the same rotation
+inline XMVECTOR XM_CALLCONV XMQuaternionSlerp (FXMVECTOR q0, FXMVECTOR q1, float t) {
+    float cos_omega = XMVectorGetX(XMVector4Dot(q0, q1));
+    float sign = 1.0f;
+    if (cos_omega < 0.0f) {
+        cos_omega = -cos_omega;
+        sign = -1.0f;
+    }
+    float s0 = 1.0f - t;
+    float s1 = t;
+    if (cos_omega < 1.0f - 1e-5f) {
+        float omega = acosf(cos_omega);
+        float inv_sin_omega = 1.0f / sinf(omega);
+        s0 = sinf(s0 * omega) * inv_sin_omega;
+        s1 = sinf(s1 * omega) * inv_sin_omega;
+    }
+    return XMVectorAdd(XMVectorScale(q0, s0), XMVectorScale(q1, sign * s1));
+}
+
+//
+// -- Matrix, row vector convention (v * m) with the translation in r[3]
+inline XMMATRIX XM_CALLCONV XMMatrixIdentity () {
+    return XMMATRIX(
+        1.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 1.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 1.0f, 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f
+    );
+}
+inline XMMATRIX XM_CALLCONV XMMatrixMultiply (FXMMATRIX m1, CXMMATRIX m2) {
+    XMMATRIX result;
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            result.r[i].f[j] =
+                m1.r[i].f[0] * m2.r[0].f[j] + m1.r[i].f[1] * m2.r[1].f[j] +
+                m1.r[i].f[2] * m2.r[2].f[j] + m1.r[i].f[3] * m2.r[3].f[j];
+    return result;
+}
+inline XMMATRIX XM_CALLCONV XMMatrixTranspose (FXMMATRIX m) {
+    XMMATRIX result;
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            result.r[i].f[j] = m.r[j].f[i];
+    return result;
+}
+inline XMMATRIX XM_CALLCONV XMMatrixTranslation (float x, float y, float z) {
+    XMMATRIX m = XMMatrixIdentity();
+    m.r[3] = XMVectorSet(x, y, z, 1.0f);
+    return m;
+}
+inline XMMATRIX XM_CALLCONV XMMatrixTranslationFromVector (FXMVECTOR offset) {
+    return XMMatrixTranslation(offset.f[0], offset.f[1], offset.f[2]);
+}
+inline XMMATRIX XM_CALLCONV XMMatrixScaling (float x, float y, float z) {
+    XMMATRIX m = XMMatrixIdentity();
+    m.r[0].f[0] = x;
+    m.r[1].f[1] = y;
+    m.r[2].f[2] = z;
+    return m;
+}
+inline XMMATRIX XM_CALLCONV XMMatrixScalingFromVector (FXMVECTOR scale) {
+    return XMMatrixScaling(scale.f[0], scale.f[1], scale.f[2]);
+}
+inline XMMATRIX XM_CALLCONV XMMatrixRotationQuaternion (FXMVECTOR q) {
+    float x = q.f[0], y = q.f[1], z = q.f[2], w = q.f[3];
+    return XMMATRIX(
+        1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w), 2.0f * (x * z - y * w), 0.0f,
+        2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w), 0.0f,
+        2.0f * (x * z + y * w), 2.0f * (y * z - x * w), 1.0f - 2.0f * (x * x + y * y), 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f
+    );
+}
+inline XMMATRIX XM_CALLCONV XMMatrixRotationX (float angle) {
+    float s = sinf(angle), c = cosf(angle);
+    return XMMATRIX(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, c, s, 0.0f, 0.0f, -s, c, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+}
+inline XMMATRIX XM_CALLCONV XMMatrixRotationY (float angle) {
+    float s = sinf(angle), c = cosf(angle);
+    return XMMATRIX(c, 0.0f, -s, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, s, 0.0f, c, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+}
+inline XMMATRIX XM_CALLCONV XMMatrixRotationZ (float angle) {
+    float s = sinf(angle), c = cosf(angle);
+    return XMMATRIX(c, s, 0.0f, 0.0f, -s, c, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+}
+inline XMMATRIX XM_CALLCONV XMMatrixRotationRollPitchYaw (float pitch, float yaw, float roll) {
+    return XMMatrixRotationQuaternion(XMQuaternionRotationRollPitchYaw(pitch, yaw, roll));
+}
+// -- scaling, then rotation about rotation_origin, then translation
+inline XMMATRIX XM_CALLCONV XMMatrixAffineTransformation (
+    FXMVECTOR scaling, FXMVECTOR rotation_origin, FXMVECTOR rotation_quaternion, GXMVECTOR translation
+) {
+    XMMATRIX m = XMMatrixMultiply(XMMatrixScalingFromVector(scaling), XMMatrixRotationQuaternion(rotation_quaternion));
+    XMVECTOR origin = XMVectorSetW(rotation_origin, 0.0f);
+    XMVECTOR offset = XMVectorSubtract(origin, XMVector3TransformNormal(origin, XMMatrixRotationQuaternion(rotation_quaternion)));
+    m.r[3] = XMVectorSetW(XMVectorAdd(offset, translation), 1.0f);
+    return m;
+}
+
+// -- cofactor expansion along the first row, the determinant is replicated into every component
+inline XMVECTOR XM_CALLCONV XMMatrixDeterminant (FXMMATRIX m) {
+    float const (*a)[4] = reinterpret_cast<float const (*)[4]>(m.r);
+    float s0 = a[2][2] * a[3][3] - a[2][3] * a[3][2];
+    float s1 = a[2][1] * a[3][3] - a[2][3] * a[3][1];
+    float s2 = a[2][1] * a[3][2] - a[2][2] * a[3][1];
+    float s3 = a[2][0] * a[3][3] - a[2][3] * a[3][0];
+    float s4 = a[2][0] * a[3][2] - a[2][2] * a[3][0];
+    float s5 = a[2][0] * a[3][1] - a[2][1] * a[3][0];
+    float det =
+        a[0][0] * (a[1][1] * s0 - a[1][2] * s1 + a[1][3] * s2) -
+        a[0][1] * (a[1][0] * s0 - a[1][2] * s3 + a[1][3] * s4) +
+        a[0][2] * (a[1][0] * s1 - a[1][1] * s3 + a[1][3] * s5) -
+        a[0][3] * (a[1][0] * s2 - a[1][1] * s4 + a[1][2] * s5);
+    return XMVectorReplicate(det);
+}
+// -- adjugate over determinant, *determinant (if given) receives the determinant.
+// -- A singular matrix gives infinities like upstream
+inline XMMATRIX XM_CALLCONV XMMatrixInverse (XMVECTOR * determinant, FXMMATRIX m) {
+    float const (*a)[4] = reinterpret_cast<float const (*)[4]>(m.r);
+    float c0 = a[0][0] * a[1][1] - a[0][1] * a[1][0];
+    float c1 = a[0][0] * a[1][2] - a[0][2] * a[1][0];
+    float c2 = a[0][0] * a[1][3] - a[0][3] * a[1][0];
+    float c3 = a[0][1] * a[1][2] - a[0][2] * a[1][1];
+    float c4 = a[0][1] * a[1][3] - a[0][3] * a[1][1];
+    float c5 = a[0][2] * a[1][3] - a[0][3] * a[1][2];
+    float s0 = a[2][0] * a[3][1] - a[2][1] * a[3][0];
+    float s1 = a[2][0] * a[3][2] - a[2][2] * a[3][0];
+    float s2 = a[2][0] * a[3][3] - a[2][3] * a[3][0];
+    float s3 = a[2][1] * a[3][2] - a[2][2] * a[3][1];
+    float s4 = a[2][1] * a[3][3] - a[2][3] * a[3][1];
+    float s5 = a[2][2] * a[3][3] - a[2][3] * a[3][2];
+
+    float det = c0 * s5 - c1 * s4 + c2 * s3 + c3 * s2 - c4 * s1 + c5 * s0;
+    if (determinant)
+        *determinant = XMVectorReplicate(det);
+    float inv_det = 1.0f / det;
+
+    return XMMATRIX(
+        ( a[1][1] * s5 - a[1][2] * s4 + a[1][3] * s3) * inv_det,
+        (-a[0][1] * s5 + a[0][2] * s4 - a[0][3] * s3) * inv_det,
+        ( a[3][1] * c5 - a[3][2] * c4 + a[3][3] * c3) * inv_det,
+        (-a[2][1] * c5 + a[2][2] * c4 - a[2][3] * c3) * inv_det,
+
+        (-a[1][0] * s5 + a[1][2] * s2 - a[1][3] * s1) * inv_det,
+        ( a[0][0] * s5 - a[0][2] * s2 + a[0][3] * s1) * inv_det,
+        (-a[3][0] * c5 + a[3][2] * c2 - a[3][3] * c1) * inv_det,
+        ( a[2][0] * c5 - a[2][2] * c2 + a[2][3] * c1) * inv_det,
+
+        ( a[1][0] * s4 - a[1][1] * s2 + a[1][3] * s0) * inv_det,
+        (-a[0][0] * s4 + a[0][1] * s2 - a[0][3] * s0) * inv_det,
+        ( a[3][0] * c4 - a[3][1] * c2 + a[3][3] * c0) * inv_det,
+        (-a[2][0] * c4 + a[2][1] * c2 - a[2][3] * c0) * inv_det,
+
+        (-a[1][0] * s3 + a[1][1] * s1 - a[1][2] * s0) * inv_det,
+        ( a[0][0] * s3 - a[0][1] * s1 + a[0][2] * s0) * inv_det,
+        (-a[3][0] * c3 + a[3][1] * c1 - a[3][2] * c0) * inv_det,
+        ( a[2][0] * c3 - a[2][1] * c1 + a[2][2] * c0) * inv_det
+    );
+}
+
+// -- rotation of a pure rotation matrix (orthonormal upper 3x3)
+inline XMVECTOR XM_CALLCONV XMQuaternionRotationMatrix (FXMMATRIX m) {
+    float m00 = m.r[0].f[0], m01 = m.r[0].f[1], m02 = m.r[0].f[2];
+    float m10 = m.r[1].f[0], m11 = m.r[1].f[1], m12 = m.r[1].f[2];
+    float m20 = m.r[2].f[0], m21 = m.r[2].f[1], m22 = m.r[2].f[2];
+    float trace = m00 + m11 + m22;
+    XMVECTOR q;
+    if (trace > 0.0f) {
+        float s = 2.0f * sqrtf(trace + 1.0f);
+        q = XMVectorSet((m12 - m21) / s, (m20 - m02) / s, (m01 - m10) / s, 0.25f * s);
+    } else if (m00 > m11 && m00 > m22) {
+        float s = 2.0f * sqrtf(1.0f + m00 - m11 - m22);
+        q = XMVectorSet(0.25f * s, (m01 + m10) / s, (m20 + m02) / s, (m12 - m21) / s);
+    } else if (m11 > m22) {
+        float s = 2.0f * sqrtf(1.0f + m11 - m00 - m22);
+        q = XMVectorSet((m01 + m10) / s, 0.25f * s, (m12 + m21) / s, (m20 - m02) / s);
+    } else {
+        float s = 2.0f * sqrtf(1.0f + m22 - m00 - m11);
+        q = XMVectorSet((m20 + m02) / s, (m12 + m21) / s, 0.25f * s, (m01 - m10) / s);
+    }
+    return q;
+}
+// -- scale, rotation and translation of an affine matrix, false if a scale is zero.
+// -- A negative determinant is put in the x scale
+inline bool XM_CALLCONV XMMatrixDecompose (
+    XMVECTOR * out_scale, XMVECTOR * out_rotation_quaternion, XMVECTOR * out_translation, FXMMATRIX m
+) {
+    *out_translation = XMVectorSetW(m.r[3], 0.0f);
+
+    float scale[3];
+    XMMATRIX rotation = XMMatrixIdentity();
+    for (int i = 0; i < 3; ++i) {
+        scale[i] = XMVectorGetX(XMVector3Length(m.r[i]));
+        if (scale[i] < 1e-6f) {
+            *out_scale = XMVectorSet(scale[0], i > 0 ? scale[1] : 0.0f, i > 1 ? scale[2] : 0.0f, 0.0f);
+            *out_rotation_quaternion = XMQuaternionIdentity();
+            return false;
+        }
+        rotation.r[i] = XMVectorSetW(XMVectorScale(m.r[i], 1.0f / scale[i]), 0.0f);
+    }
+    if (XMVectorGetX(XMMatrixDeterminant(rotation)) < 0.0f) {
+        scale[0] = -scale[0];
+        rotation.r[0] = XMVectorNegate(rotation.r[0]);
+    }
+    *out_scale = XMVectorSet(scale[0], scale[1], scale[2], 0.0f);
+    *out_rotation_quaternion = XMQuaternionNormalize(XMQuaternionRotationMatrix(rotation));
+    return true;
+}
+// -- v rotated by the unit quaternion q
+inline XMVECTOR XM_CALLCONV XMVector3Rotate (FXMVECTOR v, FXMVECTOR q) {
+    XMVECTOR t = XMVectorScale(XMVector3Cross(q, v), 2.0f);
+    return XMVectorSetW(XMVectorAdd(XMVectorAdd(v, XMVectorScale(t, q.f[3])), XMVector3Cross(q, t)), 0.0f);
+}
+
+//
+// -- Operators
+inline XMVECTOR XM_CALLCONV operator+ (FXMVECTOR v) { return v; }
+inline XMVECTOR XM_CALLCONV operator- (FXMVECTOR v) { return XMVectorNegate(v); }
+inline XMVECTOR XM_CALLCONV operator+ (FXMVECTOR v1, FXMVECTOR v2) { return XMVectorAdd(v1, v2); }
+inline XMVECTOR XM_CALLCONV operator- (FXMVECTOR v1, FXMVECTOR v2) { return XMVectorSubtract(v1, v2); }
+inline XMVECTOR XM_CALLCONV operator* (FXMVECTOR v1, FXMVECTOR v2) { return XMVectorMultiply(v1, v2); }
+inline XMVECTOR XM_CALLCONV operator/ (FXMVECTOR v1, FXMVECTOR v2) { return XMVectorDivide(v1, v2); }
+inline XMVECTOR XM_CALLCONV operator* (FXMVECTOR v, float s) { return XMVectorScale(v, s); }
+inline XMVECTOR XM_CALLCONV operator* (float s, FXMVECTOR v) { return XMVectorScale(v, s); }
+inline XMVECTOR & XM_CALLCONV operator+= (XMVECTOR & v1, FXMVECTOR v2) { return v1 = XMVectorAdd(v1, v2); }
+inline XMVECTOR & XM_CALLCONV operator-= (XMVECTOR & v1, FXMVECTOR v2) { return v1 = XMVectorSubtract(v1, v2); }
+inline XMVECTOR & XM_CALLCONV operator*= (XMVECTOR & v, float s) { return v = XMVectorScale(v, s); }
+inline XMMATRIX XM_CALLCONV operator* (FXMMATRIX m1, CXMMATRIX m2) { return XMMatrixMultiply(m1, m2); }
+
+} // namespace DirectX
@@ -72,6 +72,7 @@ private:
     Camera camera_;
 
     float anim_time_point_ = 0.0f;
+    UINT anim_keyframe_cursor_ = 0;
     BoneAnimation skull_animation_;
 
     POINT last_mouse_pos_;
@@ -328,7 +329,7 @@ void QuatApp::Update (GameTimer const & gt) {
     anim_time_point_ += gt.DeltaTime();
     if (anim_time_point_ >= skull_animation_.GetEndTime())
         anim_time_point_ = 0.0f;
-    skull_animation_.Interpolate(anim_time_point_, skull_world_);
+    skull_animation_.Interpolate(anim_time_point_, skull_world_, anim_keyframe_cursor_);
     skull_ritem_->World = skull_world_;
     skull_ritem_->NumFramesDirty = g_num_frame_resources;
 #pragma endregion
@@ -19,7 +19,27 @@ float BoneAnimation::GetStartTime () const {
 float BoneAnimation::GetEndTime () const {
     return Keyframes.back().TimePoint;
 }
+UINT BoneAnimation::FindKeyframe (float t, UINT & cursor) const {
+    UINT const last_segment = (UINT)Keyframes.size() - 2;
+    if (cursor <= last_segment && t >= Keyframes[cursor].TimePoint) {
+        if (t < Keyframes[cursor + 1].TimePoint)
+            return cursor;
+        if (cursor < last_segment && t < Keyframes[cursor + 2].TimePoint)
+            return ++cursor;
+    }
+    // -- cursor missed (seek or loop wrap), binary search for the first inner keyframe later than t
+    auto upper = std::upper_bound(
+        Keyframes.begin() + 1, Keyframes.end() - 1, t,
+        [](float time_point, Keyframe const & k) { return time_point < k.TimePoint; }
+    );
+    cursor = (UINT)(upper - Keyframes.begin()) - 1;
+    return cursor;
+}
 void BoneAnimation::Interpolate (float t, DirectX::XMFLOAT4X4 & out_mat) const {
+    UINT cursor = 0;
+    Interpolate(t, out_mat, cursor);
+}
+void BoneAnimation::Interpolate (float t, DirectX::XMFLOAT4X4 & out_mat, UINT & cursor) const {
     if (t <= Keyframes.front().TimePoint) {
         XMVECTOR S = XMLoadFloat3(&Keyframes.front().Scale);
         XMVECTOR P = XMLoadFloat3(&Keyframes.front().Translation);
@@ -33,27 +53,23 @@ void BoneAnimation::Interpolate (float t, DirectX::XMFLOAT4X4 & out_mat) const {
         XMVECTOR zero = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
         XMStoreFloat4x4(&out_mat, XMMatrixAffineTransformation(S, zero, Q, P));
     } else /* interpolate */ {
-        for (UINT i = 0; i < Keyframes.size() - 1; ++i) {
-            if (t >= Keyframes[i].TimePoint && t <= Keyframes[i + 1].TimePoint) {
-                float lerp_percent =
-                    (t - Keyframes[i].TimePoint) / (Keyframes[i + 1].TimePoint - Keyframes[i].TimePoint);
-                XMVECTOR s0 = XMLoadFloat3(&Keyframes[i].Scale);
-                XMVECTOR s1 = XMLoadFloat3(&Keyframes[i + 1].Scale);
+        UINT i = FindKeyframe(t, cursor);
+        float lerp_percent =
+            (t - Keyframes[i].TimePoint) / (Keyframes[i + 1].TimePoint - Keyframes[i].TimePoint);
+        XMVECTOR s0 = XMLoadFloat3(&Keyframes[i].Scale);
+        XMVECTOR s1 = XMLoadFloat3(&Keyframes[i + 1].Scale);
 
-                XMVECTOR p0 = XMLoadFloat3(&Keyframes[i].Translation);
-                XMVECTOR p1 = XMLoadFloat3(&Keyframes[i + 1].Translation);
+        XMVECTOR p0 = XMLoadFloat3(&Keyframes[i].Translation);
+        XMVECTOR p1 = XMLoadFloat3(&Keyframes[i + 1].Translation);
 
-                XMVECTOR q0 = XMLoadFloat4(&Keyframes[i].RotationQuat);
-                XMVECTOR q1 = XMLoadFloat4(&Keyframes[i + 1].RotationQuat);
+        XMVECTOR q0 = XMLoadFloat4(&Keyframes[i].RotationQuat);
+        XMVECTOR q1 = XMLoadFloat4(&Keyframes[i + 1].RotationQuat);
 
-                XMVECTOR S = XMVectorLerp(s0, s1, lerp_percent);
-                XMVECTOR P = XMVectorLerp(p0, p1, lerp_percent);
-                XMVECTOR Q = XMQuaternionSlerp(q0, q1, lerp_percent);
+        XMVECTOR S = XMVectorLerp(s0, s1, lerp_percent);
+        XMVECTOR P = XMVectorLerp(p0, p1, lerp_percent);
+        XMVECTOR Q = XMQuaternionSlerp(q0, q1, lerp_percent);
 
-                XMVECTOR zero = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
-                XMStoreFloat4x4(&out_mat, XMMatrixAffineTransformation(S, zero, Q, P));
-                break;
-            } // end if
-        } // end for
+        XMVECTOR zero = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+        XMStoreFloat4x4(&out_mat, XMMatrixAffineTransformation(S, zero, Q, P));
     } // end if
 } // end function
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "../common/d3d12_util.h"
+#include "../common/core_types.h"
 
 // -- a keyframe defines a transformation at a point in time
 struct Keyframe {
@@ -18,7 +18,11 @@ struct BoneAnimation {
 
     float GetStartTime () const;
     float GetEndTime () const;
+    // -- index i of the segment [Keyframes[i], Keyframes[i + 1]) containing t (start < t < end)
+    // -- cursor caches the last segment so monotonic playback resolves in O(1)
+    UINT FindKeyframe (float t, UINT & cursor) const;
     void Interpolate (float t, DirectX::XMFLOAT4X4 & out_mat) const;
+    void Interpolate (float t, DirectX::XMFLOAT4X4 & out_mat, UINT & cursor) const;
 };
 
 
@@ -0,0 +1,138 @@
+#include "test_util.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace DirectX;
+
+//
+// -- every heap allocation of this test binary goes through here, so a test can assert that
+// -- the steady state of an animation update never touches the heap
+static std::atomic<size_t> g_num_allocations(0);
+
+// -- the replacements pair malloc with free, GCC inlining them into a sanitizer build cannot tell
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void * operator new (size_t size) {
+    g_num_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void * p = malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void * operator new[] (size_t size) {
+    return operator new(size);
+}
+void * operator new (size_t size, std::nothrow_t const &) noexcept {
+    g_num_allocations.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+void * operator new[] (size_t size, std::nothrow_t const & tag) noexcept {
+    return operator new(size, tag);
+}
+void operator delete (void * p) noexcept { free(p); }
+void operator delete[] (void * p) noexcept { free(p); }
+void operator delete (void * p, size_t) noexcept { free(p); }
+void operator delete[] (void * p, size_t) noexcept { free(p); }
+void operator delete (void * p, std::nothrow_t const &) noexcept { free(p); }
+void operator delete[] (void * p, std::nothrow_t const &) noexcept { free(p); }
+
+//
+// -- instance playing the soldier clip, sized the way the demo sizes its instances
+static SkinnedModelInstance make_instance () {
+    SoldierModel & soldier = Soldier();
+    SkinnedModelInstance instance;
+    instance.SkinnedInfo = &soldier.SkinnedInfo;
+    instance.FinalTransforms.resize(soldier.SkinnedInfo.BoneCount());
+    instance.Workspace.Resize(soldier.SkinnedInfo.BoneCount());
+    instance.SetClip("Take1");
+    return instance;
+}
+// -- deepest bone of the soldier, the tip of the IK chains
+static UINT deepest_bone () {
+    std::vector<int> hierarchy = Soldier().SkinnedInfo.GetBoneHierarchy();
+    std::vector<UINT> depth(hierarchy.size(), 0);
+    UINT deepest = 0;
+    for (UINT i = 0; i < hierarchy.size(); ++i) {
+        if (hierarchy[i] >= 0)
+            depth[i] = depth[hierarchy[i]] + 1;
+        if (depth[i] > depth[deepest])
+            deepest = i;
+    }
+    return deepest;
+}
+// -- heap allocations made by num_frames updates of a warmed up instance
+static size_t allocations_per_frames (SkinnedModelInstance & instance, UINT num_frames) {
+    float const dt = 1.0f / 60.0f;
+    for (UINT f = 0; f < 8; ++f)
+        instance.UpdateSkinnedAnimation(dt);
+
+    size_t before = g_num_allocations.load();
+    for (UINT f = 0; f < num_frames; ++f)
+        instance.UpdateSkinnedAnimation(dt);
+    return g_num_allocations.load() - before;
+}
+
+UINT const NumFrames = 240;
+
+TEST(AllocationFree, CountsAllocations) {
+    size_t before = g_num_allocations.load();
+    std::vector<int> * v = new std::vector<int>(16);
+    delete v;
+    EXPECT_GT(g_num_allocations.load() - before, 0u);
+}
+TEST(AllocationFree, SingleClip) {
+    ASSERT_TRUE(Soldier().Loaded);
+    SkinnedModelInstance instance = make_instance();
+    EXPECT_EQ(0u, allocations_per_frames(instance, NumFrames));
+}
+TEST(AllocationFree, CrossfadeWithLayers) {
+    ASSERT_TRUE(Soldier().Loaded);
+    SkinnedData & skinned_info = Soldier().SkinnedInfo;
+    std::vector<float> mask;
+    skinned_info.BuildSubtreeMask(deepest_bone(), mask, 0.5f);
+
+    SkinnedModelInstance instance = make_instance();
+    SkinnedData::AnimationLayer layer;
+    layer.Clip = instance.Clip;
+    layer.TimePoint = 0.3f;
+    layer.BoneMask = mask.data();
+    instance.Layers.push_back(layer);
+    // -- long enough for the fade to last through the warm up and every measured frame
+    instance.CrossfadeTo("Take1", 100.0f);
+
+    EXPECT_EQ(0u, allocations_per_frames(instance, NumFrames));
+    EXPECT_EQ(1u, instance.NumFades);
+}
+TEST(AllocationFree, IkChains) {
+    ASSERT_TRUE(Soldier().Loaded);
+    SkinnedModelInstance instance = make_instance();
+
+    IkChain two_bone;
+    two_bone.TipBone = deepest_bone();
+    two_bone.Target = XMFLOAT3(0.2f, 0.5f, 0.1f);
+    IkChain fabrik = two_bone;
+    fabrik.Solver = IkSolver::Fabrik;
+    fabrik.NumLinks = 4;
+    fabrik.Weight = 0.5f;
+    instance.IkChains.push_back(two_bone);
+    instance.IkChains.push_back(fabrik);
+
+    EXPECT_EQ(0u, allocations_per_frames(instance, NumFrames));
+}
+TEST(AllocationFree, ThrottledWithBoneLod) {
+    ASSERT_TRUE(Soldier().Loaded);
+    SkinnedData & skinned_info = Soldier().SkinnedInfo;
+    if (skinned_info.BoneLodCount() < 3)
+        skinned_info.BuildBoneLods(3);
+
+    SkinnedModelInstance instance = make_instance();
+    AnimationLod lod;
+    lod.BoneLod = 2;
+    lod.UpdateInterval = 3;
+    instance.SetLod(lod);
+
+    EXPECT_EQ(0u, allocations_per_frames(instance, NumFrames));
+}
@@ -0,0 +1,167 @@
+#include "test_util.h"
+
+using namespace DirectX;
+
+//
+// -- two bones (bone 1 hangs off bone 0, identity offsets), pose of bone i in clip c at t
+struct BonePose {
+    XMFLOAT3 Translation;
+    XMFLOAT3 Axis;
+    float Angle;
+    XMFLOAT3 Scale;
+};
+static BonePose pose_at (char const * clip, UINT bone, float t) {
+    std::string name = clip;
+    if ("Base" == name)
+        return 0 == bone ?
+            BonePose{XMFLOAT3(0.2f * t, 1.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), 0.3f * t, XMFLOAT3(1.0f, 1.0f, 1.0f)} :
+            BonePose{XMFLOAT3(0.0f, 0.5f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), 0.4f + 0.2f * t, XMFLOAT3(1.0f, 1.0f, 1.0f)};
+    // -- reference pose of the additive clips, held still
+    BonePose reference = 0 == bone ?
+        BonePose{XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), 0.2f, XMFLOAT3(1.0f, 1.0f, 1.0f)} :
+        BonePose{XMFLOAT3(0.0f, 0.5f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), 0.5f, XMFLOAT3(1.0f, 1.0f, 1.0f)};
+    if ("Reference" == name)
+        return reference;
+    // -- "Lean": the reference with bone 1 leaning over about x, moved and stretched
+    if (0 == bone)
+        return reference;
+    return BonePose{XMFLOAT3(0.1f, 0.5f, 0.0f), XMFLOAT3(0.0f, 0.6f, 0.8f), 0.9f, XMFLOAT3(1.2f, 1.0f, 1.0f)};
+}
+static XMVECTOR rotation (BonePose const & pose) {
+    return XMQuaternionRotationNormal(XMLoadFloat3(&pose.Axis), pose.Angle);
+}
+// -- local (to-parent) transform as SkinnedData builds it
+static XMFLOAT4X4 local_transform (FXMVECTOR S, FXMVECTOR Q, FXMVECTOR P) {
+    XMFLOAT4X4 m;
+    XMStoreFloat4x4(&m, XMMatrixAffineTransformation(S, XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), Q, P));
+    return m;
+}
+static XMFLOAT4X4 local_transform (BonePose const & pose) {
+    return local_transform(XMLoadFloat3(&pose.Scale), rotation(pose), XMLoadFloat3(&pose.Translation));
+}
+
+class AnimationLayers : public testing::Test {
+protected:
+    void SetUp () override {
+        std::vector<int> hierarchy = {-1, 0};
+        std::vector<XMFLOAT4X4> offsets(2);
+        XMStoreFloat4x4(&offsets[0], XMMatrixIdentity());
+        offsets[1] = offsets[0];
+
+        std::unordered_map<std::string, AnimationClip> clips;
+        for (char const * name : {"Base", "Reference", "Lean"}) {
+            AnimationClip & clip = clips[name];
+            clip.BoneAnimations.resize(2);
+            for (UINT i = 0; i < 2; ++i) {
+                for (UINT k = 0; k <= 4; ++k) {
+                    BonePose pose = pose_at(name, i, 0.5f * k);
+                    Keyframe key;
+                    key.TimePoint = 0.5f * k;
+                    key.Translation = pose.Translation;
+                    key.Scale = pose.Scale;
+                    XMStoreFloat4(&key.RotationQuat, rotation(pose));
+                    clip.BoneAnimations[i].Keyframes.push_back(key);
+                }
+            }
+        }
+        std::vector<Keyframe> reference_pose(2);
+        clips["Reference"].Interpolate(0.0f, reference_pose);
+        for (char const * name : {"Reference", "Lean"}) {
+            AnimationClip & additive = clips[std::string(name) + "Additive"];
+            additive = clips[name];
+            additive.MakeAdditive(reference_pose);
+        }
+        skinned_info_.Set(hierarchy, offsets, clips);
+        workspace_.Resize(2);
+    }
+    // -- local transforms of clip at time_point with layer on top (layer.Clip by name)
+    std::vector<XMFLOAT4X4> local_transforms (
+        char const * clip, float time_point, char const * layer_clip = nullptr, float weight = 1.0f,
+        bool additive = false, float const * bone_mask = nullptr
+    ) {
+        SkinnedData::BlendInput input;
+        input.Clip = skinned_info_.FindClip(clip);
+        input.TimePoint = time_point;
+        input.Weight = 1.0f;
+        SkinnedData::AnimationLayer layer;
+        if (layer_clip) {
+            layer.Clip = skinned_info_.FindClip(layer_clip);
+            layer.TimePoint = time_point;
+            layer.Weight = weight;
+            layer.BoneMask = bone_mask;
+            layer.Additive = additive;
+        }
+        XMFLOAT4X4 final_transforms[2];
+        skinned_info_.GetFinalTransforms(&input, 1, final_transforms, workspace_, &layer, layer_clip ? 1 : 0);
+        return workspace_.ToParentTransforms;
+    }
+
+    SkinnedData skinned_info_;
+    PoseWorkspace workspace_;
+};
+
+TEST_F(AnimationLayers, AdditiveReferencePoseIsIdentity) {
+    // -- the difference of the reference pose from itself: no offset, no rotation, unit scale
+    for (float t : {0.0f, 1.5f, 2.0f}) {
+        std::vector<XMFLOAT4X4> base = local_transforms("Base", t);
+        for (float weight : {0.5f, 1.0f}) {
+            std::vector<XMFLOAT4X4> layered = local_transforms("Base", t, "ReferenceAdditive", weight, true);
+            EXPECT_LE(MaxDifference(base.data(), layered.data(), 2), 1e-5f) << "t " << t << ", weight " << weight;
+        }
+    }
+}
+TEST_F(AnimationLayers, AdditiveFullWeightAppliesTheDelta) {
+    // -- on top of the reference pose the lean additive gives back the lean pose
+    std::vector<XMFLOAT4X4> lean = local_transforms("Lean", 1.0f);
+    std::vector<XMFLOAT4X4> layered = local_transforms("Reference", 1.0f, "LeanAdditive", 1.0f, true);
+    EXPECT_LE(MaxDifference(lean.data(), layered.data(), 2), 1e-5f);
+
+    // -- on top of another pose: offset added, rotation and scale applied after the base (q = base_q * diff_q)
+    float const t = 1.5f;
+    layered = local_transforms("Base", t, "LeanAdditive", 1.0f, true);
+    BonePose base = pose_at("Base", 1, t), reference = pose_at("Reference", 1, t), lean_pose = pose_at("Lean", 1, t);
+    XMVECTOR diff_q = XMQuaternionMultiply(rotation(lean_pose), XMQuaternionConjugate(rotation(reference)));
+    XMFLOAT4X4 expected = local_transform(
+        XMVectorMultiply(XMLoadFloat3(&base.Scale), XMVectorDivide(XMLoadFloat3(&lean_pose.Scale), XMLoadFloat3(&reference.Scale))),
+        XMQuaternionMultiply(diff_q, rotation(base)),
+        XMVectorAdd(XMLoadFloat3(&base.Translation), XMVectorSubtract(XMLoadFloat3(&lean_pose.Translation), XMLoadFloat3(&reference.Translation)))
+    );
+    EXPECT_LE(MaxDifference(&expected, &layered[1], 1), 1e-5f);
+    XMFLOAT4X4 base_root = local_transform(pose_at("Base", 0, t));
+    EXPECT_LE(MaxDifference(&base_root, &layered[0], 1), 1e-5f);
+
+    // -- half weight: half the offset and half the rotation
+    layered = local_transforms("Reference", t, "LeanAdditive", 0.5f, true);
+    expected = local_transform(
+        XMVectorLerp(XMLoadFloat3(&reference.Scale), XMLoadFloat3(&lean_pose.Scale), 0.5f),
+        XMQuaternionMultiply(XMQuaternionSlerp(XMQuaternionIdentity(), diff_q, 0.5f), rotation(reference)),
+        XMVectorLerp(XMLoadFloat3(&reference.Translation), XMLoadFloat3(&lean_pose.Translation), 0.5f)
+    );
+    EXPECT_LE(MaxDifference(&expected, &layered[1], 1), 1e-5f);
+}
+TEST_F(AnimationLayers, MaskedOutBonesAreUntouched) {
+    // -- base pose through the same path as the layered poses (a layer of weight 0 is skipped), so untouched is exact
+    float const t = 0.5f;
+    std::vector<XMFLOAT4X4> base = local_transforms("Base", t, "Lean", 0.0f);
+    std::vector<XMFLOAT4X4> lean = local_transforms("Lean", t);
+
+    // -- override layer on bone 0 only: bone 0 takes the layer pose, bone 1 keeps the base pose exactly
+    float const root_only [] = {1.0f, 0.0f};
+    std::vector<XMFLOAT4X4> layered = local_transforms("Base", t, "Lean", 1.0f, false, root_only);
+    EXPECT_LE(MaxDifference(&lean[0], &layered[0], 1), 1e-5f);
+    EXPECT_EQ(0.0f, MaxDifference(&base[1], &layered[1], 1));
+
+    // -- additive layer on bone 1 only
+    float const child_only [] = {0.0f, 1.0f};
+    std::vector<XMFLOAT4X4> additive = local_transforms("Base", t, "LeanAdditive", 1.0f, true);
+    layered = local_transforms("Base", t, "LeanAdditive", 1.0f, true, child_only);
+    EXPECT_EQ(0.0f, MaxDifference(&base[0], &layered[0], 1));
+    EXPECT_LE(MaxDifference(&additive[1], &layered[1], 1), 1e-6f);
+
+    // -- the mask scales the layer weight
+    float const half_child [] = {0.0f, 0.5f};
+    std::vector<XMFLOAT4X4> half_weight = local_transforms("Base", t, "LeanAdditive", 0.5f, true);
+    layered = local_transforms("Base", t, "LeanAdditive", 1.0f, true, half_child);
+    EXPECT_EQ(0.0f, MaxDifference(&base[0], &layered[0], 1));
+    EXPECT_LE(MaxDifference(&half_weight[1], &layered[1], 1), 1e-6f);
+}
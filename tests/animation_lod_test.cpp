@@ -0,0 +1,155 @@
+#include "test_util.h"
+#include "pose_cache.h"
+
+using namespace DirectX;
+
+//
+// -- one bone turning about z at 180 degrees per second while moving along x at unit speed, keys every 0.25 s
+static void make_turning_bone (SkinnedData & out_skinned_info) {
+    std::vector<int> hierarchy = {-1};
+    std::vector<XMFLOAT4X4> offsets(1);
+    XMStoreFloat4x4(&offsets[0], XMMatrixIdentity());
+
+    std::unordered_map<std::string, AnimationClip> clips;
+    AnimationClip & clip = clips["Turn"];
+    clip.BoneAnimations.resize(1);
+    for (UINT k = 0; k <= 16; ++k) {
+        Keyframe key;
+        key.TimePoint = 0.25f * k;
+        key.Translation = XMFLOAT3(key.TimePoint, 0.0f, 0.0f);
+        XMStoreFloat4(&key.RotationQuat, XMQuaternionRotationRollPitchYaw(0.0f, 0.0f, XM_PI * key.TimePoint));
+        clip.BoneAnimations[0].Keyframes.push_back(key);
+    }
+    out_skinned_info.Set(hierarchy, offsets, clips);
+}
+// -- final transform (transposed, as GetFinalTransforms stores it) of the turning bone at t
+static XMFLOAT4X4 turning_bone_at (float t) {
+    XMFLOAT4X4 m;
+    XMStoreFloat4x4(&m, XMMatrixTranspose(XMMatrixMultiply(XMMatrixRotationZ(XM_PI * t), XMMatrixTranslation(t, 0.0f, 0.0f))));
+    return m;
+}
+
+TEST(ThrottledUpdate, InterpolatesRigidly) {
+    SkinnedData skinned_info;
+    make_turning_bone(skinned_info);
+
+    SkinnedModelInstance instance;
+    instance.SkinnedInfo = &skinned_info;
+    instance.FinalTransforms.resize(1);
+    instance.Workspace.Resize(1);
+    instance.SetClip("Turn");
+    AnimationLod lod;
+    lod.UpdateInterval = 2;
+    instance.SetLod(lod);
+
+    // -- evaluated at 0.25 (frame 1) and 0.75 (frame 3), 90 degrees apart: frame 3 is halfway between them
+    float const dt = 0.25f;
+    instance.UpdateSkinnedAnimation(dt);
+    XMFLOAT4X4 expected = turning_bone_at(0.25f);
+    EXPECT_LE(MaxDifference(&expected, instance.FinalTransforms.data(), 1), 1e-5f);
+    instance.UpdateSkinnedAnimation(dt);
+    EXPECT_LE(MaxDifference(&expected, instance.FinalTransforms.data(), 1), 1e-5f);
+
+    instance.UpdateSkinnedAnimation(dt);
+    expected = turning_bone_at(0.5f);
+    EXPECT_LE(MaxDifference(&expected, instance.FinalTransforms.data(), 1), 1e-5f);
+    // -- a lerp of the matrix rows would have shrunk the bone to cos(45 degrees)
+    XMMATRIX m = XMLoadFloat4x4(&instance.FinalTransforms[0]);
+    EXPECT_NEAR(1.0f, XMVectorGetX(XMMatrixDeterminant(m)), 1e-5f);
+
+    instance.UpdateSkinnedAnimation(dt);
+    expected = turning_bone_at(0.75f);
+    EXPECT_LE(MaxDifference(&expected, instance.FinalTransforms.data(), 1), 1e-5f);
+}
+TEST(ThrottledUpdate, SoldierStaysCloseToFullRateUpdates) {
+    SoldierModel & soldier = Soldier();
+    ASSERT_TRUE(soldier.Loaded);
+    UINT num_bones = soldier.SkinnedInfo.BoneCount();
+
+    SkinnedModelInstance full_rate, throttled;
+    for (SkinnedModelInstance * instance : {&full_rate, &throttled}) {
+        instance->SkinnedInfo = &soldier.SkinnedInfo;
+        instance->FinalTransforms.resize(num_bones);
+        instance->Workspace.Resize(num_bones);
+        instance->SetClip("Take1");
+    }
+    AnimationLod lod;
+    lod.UpdateInterval = 3;
+    throttled.SetLod(lod);
+
+    // -- the throttled pose trails by up to two frames, compare against the full rate pose two frames back
+    std::vector<std::vector<XMFLOAT4X4>> history;
+    for (UINT frame = 0; frame < 30; ++frame) {
+        full_rate.UpdateSkinnedAnimation(1.0f / 60.0f);
+        throttled.UpdateSkinnedAnimation(1.0f / 60.0f);
+        history.push_back(full_rate.FinalTransforms);
+        if (frame % 3 == 2) {
+            // -- the evaluation two frames back is shown as is at the end of every interval
+            EXPECT_LE(MaxDifference(history[frame - 2].data(), throttled.FinalTransforms.data(), num_bones), 1e-4f)
+                << "frame " << frame;
+        }
+        for (UINT i = 0; i < num_bones; ++i) {
+            XMMATRIX m = XMLoadFloat4x4(&throttled.FinalTransforms[i]);
+            XMMATRIX reference = XMLoadFloat4x4(&history[frame].at(i));
+            EXPECT_NEAR(XMVectorGetX(XMMatrixDeterminant(reference)), XMVectorGetX(XMMatrixDeterminant(m)), 1e-3f)
+                << "frame " << frame << ", bone " << i;
+        }
+    }
+}
+
+//
+// -- instances at different bone LODs sharing a cache must each get the pose of their own LOD
+TEST(PoseCache, KeysEntriesByBoneLod) {
+    SoldierModel & soldier = Soldier();
+    ASSERT_TRUE(soldier.Loaded);
+    SkinnedData & skinned_info = soldier.SkinnedInfo;
+    if (skinned_info.BoneLodCount() < 3)
+        skinned_info.BuildBoneLods(3);
+    UINT num_bones = skinned_info.BoneCount();
+    SkinnedData::ClipHandle clip = skinned_info.FindClip("Take1");
+
+    PoseCache cache(skinned_info, 16, 0.25f);
+    PoseWorkspace workspace;
+    workspace.Resize(num_bones);
+    std::vector<XMFLOAT4X4> cached(num_bones);
+    std::vector<XMFLOAT4X4> direct(num_bones);
+    std::vector<XMFLOAT4X4> full(num_bones);
+
+    skinned_info.GetFinalTransforms(clip, 0.5f, full.data(), workspace, 0);
+    for (UINT bone_lod : {0u, 2u, 0u, 2u}) {
+        PoseWorkspace direct_workspace;
+        direct_workspace.Resize(num_bones);
+        skinned_info.GetFinalTransforms(clip, 0.5f, direct.data(), direct_workspace, bone_lod);
+        cache.GetFinalTransforms(clip, 0.5f, cached.data(), workspace, bone_lod);
+        EXPECT_EQ(0.0f, MaxDifference(direct.data(), cached.data(), num_bones)) << "bone LOD " << bone_lod;
+    }
+    EXPECT_GT(MaxDifference(full.data(), direct.data(), num_bones), 0.0f);
+    EXPECT_EQ(2u, cache.MissCount());
+    EXPECT_EQ(2u, cache.HitCount());
+}
+TEST(PoseCache, InstanceUsesItsBoneLod) {
+    SoldierModel & soldier = Soldier();
+    ASSERT_TRUE(soldier.Loaded);
+    SkinnedData & skinned_info = soldier.SkinnedInfo;
+    if (skinned_info.BoneLodCount() < 3)
+        skinned_info.BuildBoneLods(3);
+    UINT num_bones = skinned_info.BoneCount();
+
+    PoseCache cache(skinned_info, 16, 0.25f);
+    SkinnedModelInstance cached, uncached;
+    for (SkinnedModelInstance * instance : {&cached, &uncached}) {
+        instance->SkinnedInfo = &skinned_info;
+        instance->FinalTransforms.resize(num_bones);
+        instance->Workspace.Resize(num_bones);
+        instance->SetClip("Take1");
+        AnimationLod lod;
+        lod.BoneLod = 2;
+        instance->SetLod(lod);
+    }
+    cached.Cache = &cache;
+
+    // -- both sample at 0.5, a multiple of the time quantum
+    cached.UpdateSkinnedAnimation(0.5f);
+    uncached.UpdateSkinnedAnimation(0.5f);
+    EXPECT_EQ(0.0f, MaxDifference(uncached.FinalTransforms.data(), cached.FinalTransforms.data(), num_bones));
+}
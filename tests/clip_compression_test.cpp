@@ -0,0 +1,84 @@
+#include "test_util.h"
+
+using namespace DirectX;
+
+//
+// -- num_bones bones swinging about different axes, the root also translates and the last bone scales
+static AnimationClip make_clip (UINT num_bones, UINT num_keyframes, float sample_rate) {
+    AnimationClip clip;
+    clip.BoneAnimations.resize(num_bones);
+    for (UINT i = 0; i < num_bones; ++i) {
+        clip.BoneAnimations[i].Keyframes.resize(num_keyframes);
+        for (UINT k = 0; k < num_keyframes; ++k) {
+            Keyframe & key = clip.BoneAnimations[i].Keyframes[k];
+            key.TimePoint = k / sample_rate;
+            float phase = key.TimePoint * 3.0f + i;
+            key.Translation = XMFLOAT3(0.0f == i ? sinf(phase) : 0.0f, 0.25f, 0.0f);
+            if (i + 1 == num_bones)
+                key.Scale = XMFLOAT3(1.0f + 0.1f * sinf(phase), 1.0f, 1.0f);
+            XMVECTOR axis = XMVectorSet(cosf((float)i), 1.0f, sinf((float)i), 0.0f);
+            XMStoreFloat4(&key.RotationQuat, XMQuaternionRotationAxis(axis, 1.5f * sinf(phase)));
+        }
+    }
+    return clip;
+}
+static void expect_close_poses (PackedAnimationClip const & packed, CompressedAnimationClip const & compressed) {
+    UINT num_bones = packed.BoneCount();
+    std::vector<XMFLOAT4X4> expected(num_bones), actual(num_bones);
+    std::vector<UINT> packed_cursors(num_bones, 0), compressed_cursors(num_bones, 0);
+    for (float t = packed.GetClipStartTime() - 0.1f; t <= packed.GetClipEndTime() + 0.1f; t += 0.01f) {
+        packed.Interpolate(t, expected, packed_cursors);
+        compressed.Interpolate(t, actual, compressed_cursors);
+        ASSERT_LE(MaxDifference(expected.data(), actual.data(), num_bones), 2e-4f) << "t = " << t;
+    }
+}
+
+TEST(ClipCompression, KeyframedClipStaysWithinQuantization) {
+    AnimationClip clip = make_clip(8, 40, 30.0f);
+    PackedAnimationClip packed;
+    packed.Build(clip);
+    CompressedAnimationClip compressed;
+    compressed.Build(clip, ClipCompressionSettings());
+
+    expect_close_poses(packed, compressed);
+    EXPECT_LT(compressed.ByteSize(), packed.Data.size() * sizeof(float));
+    EXPECT_EQ(TrackFormat::Constant, compressed.GetBoneTrack(1).TranslationFormat);
+    EXPECT_EQ(TrackFormat::Identity, compressed.GetBoneTrack(1).ScaleFormat);
+    EXPECT_EQ(TrackFormat::Animated, compressed.GetBoneTrack(0).TranslationFormat);
+}
+TEST(ClipCompression, UniformClipStaysWithinQuantization) {
+    AnimationClip clip = make_clip(8, 40, 30.0f);
+    clip.Resample(30.0f);
+    PackedAnimationClip packed;
+    packed.Build(clip);
+    CompressedAnimationClip compressed;
+    compressed.Build(clip, ClipCompressionSettings());
+
+    expect_close_poses(packed, compressed);
+}
+TEST(ClipCompression, UniformClipWithoutBones) {
+    AnimationClip clip;
+    clip.SampleRate = 30.0f;
+    CompressedAnimationClip compressed;
+    compressed.Build(clip, ClipCompressionSettings());
+
+    std::vector<XMFLOAT4X4> transforms;
+    std::vector<UINT> cursors;
+    compressed.Interpolate(0.5f, transforms, cursors);
+    std::vector<BoneTransform> pose;
+    compressed.SamplePose(0.5f, pose, cursors);
+    EXPECT_EQ(0u, compressed.BoneCount());
+}
+TEST(ClipCompression, QuaternionRoundTrip) {
+    for (int i = 0; i < 64; ++i) {
+        XMVECTOR axis = XMVectorSet(sinf(i * 0.7f), cosf(i * 1.3f), sinf(i * 2.1f) + 0.1f, 0.0f);
+        XMVECTOR q = XMQuaternionRotationAxis(axis, i * 0.2f - 6.0f);
+        USHORT bits[3];
+        CompressedAnimationClip::EncodeQuaternion(q, bits);
+        XMVECTOR decoded = CompressedAnimationClip::DecodeQuaternion(bits);
+        if (XMVectorGetX(XMQuaternionDot(q, decoded)) < 0.0f)
+            decoded = XMVectorNegate(decoded);
+        // -- 15 bits over +-1/sqrt(2) per component
+        EXPECT_TRUE(XMVector4NearEqual(q, decoded, XMVectorReplicate(5e-5f))) << "i = " << i;
+    }
+}
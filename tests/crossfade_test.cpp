@@ -0,0 +1,185 @@
+#include "test_util.h"
+
+using namespace DirectX;
+
+//
+// -- one bone (identity offset) moving and turning at a constant rate in each clip, keys every 0.25 s for 4 s.
+// -- Updates step by 0.25 s so every sampled time point is a key and the pose is exact
+struct ClipMotion {
+    char const * Name;
+    XMFLOAT3 Start;
+    XMFLOAT3 Velocity;
+    XMFLOAT3 Axis;
+    float Angle;
+    float AngularVelocity;
+};
+static ClipMotion const Motions [] = {
+    {"A", XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), 0.0f, 0.5f},
+    {"B", XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), 2.0f, -0.5f},
+    {"C", XMFLOAT3(0.0f, 2.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, -1.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), 0.0f, 0.3f},
+};
+float const Step = 0.25f;
+
+static void pose_at (ClipMotion const & motion, float t, XMVECTOR & out_translation, XMVECTOR & out_rotation) {
+    out_translation = XMVectorMultiplyAdd(XMLoadFloat3(&motion.Velocity), XMVectorReplicate(t), XMLoadFloat3(&motion.Start));
+    out_rotation = XMQuaternionRotationNormal(XMLoadFloat3(&motion.Axis), motion.Angle + motion.AngularVelocity * t);
+}
+static void make_clips (SkinnedData & out_skinned_info) {
+    std::vector<int> hierarchy = {-1};
+    std::vector<XMFLOAT4X4> offsets(1);
+    XMStoreFloat4x4(&offsets[0], XMMatrixIdentity());
+
+    std::unordered_map<std::string, AnimationClip> clips;
+    for (ClipMotion const & motion : Motions) {
+        AnimationClip & clip = clips[motion.Name];
+        clip.BoneAnimations.resize(1);
+        for (UINT k = 0; k <= 16; ++k) {
+            Keyframe key;
+            key.TimePoint = Step * k;
+            XMVECTOR P, Q;
+            pose_at(motion, key.TimePoint, P, Q);
+            XMStoreFloat3(&key.Translation, P);
+            XMStoreFloat4(&key.RotationQuat, Q);
+            clip.BoneAnimations[0].Keyframes.push_back(key);
+        }
+    }
+    out_skinned_info.Set(hierarchy, offsets, clips);
+}
+// -- final transform of clips[n] at time_points[n] blended with weights[n]: translations lerped,
+// -- rotations summed on the hemisphere of the first one and normalized (nlerp)
+static XMFLOAT4X4 blended_at (
+    std::initializer_list<int> clips, std::initializer_list<float> time_points, std::initializer_list<float> weights
+) {
+    XMVECTOR P = XMVectorZero(), Q = XMVectorZero(), first_q = XMVectorZero();
+    for (size_t n = 0; n < clips.size(); ++n) {
+        float w = weights.begin()[n];
+        XMVECTOR clip_p, clip_q;
+        pose_at(Motions[clips.begin()[n]], time_points.begin()[n], clip_p, clip_q);
+        if (0 == n)
+            first_q = clip_q;
+        else if (XMVectorGetX(XMVector4Dot(first_q, clip_q)) < 0.0f)
+            clip_q = XMVectorNegate(clip_q);
+        P = XMVectorMultiplyAdd(clip_p, XMVectorReplicate(w), P);
+        Q = XMVectorMultiplyAdd(clip_q, XMVectorReplicate(w), Q);
+    }
+    XMMATRIX m = XMMatrixAffineTransformation(XMVectorSplatOne(), XMVectorZero(), XMQuaternionNormalize(Q), P);
+    XMFLOAT4X4 transposed;
+    XMStoreFloat4x4(&transposed, XMMatrixTranspose(m));
+    return transposed;
+}
+
+class Crossfade : public testing::Test {
+protected:
+    void SetUp () override {
+        make_clips(skinned_info_);
+        instance_.SkinnedInfo = &skinned_info_;
+        instance_.FinalTransforms.resize(1);
+        instance_.Workspace.Resize(1);
+        instance_.SetClip("A");
+    }
+    void update (UINT num_steps) {
+        for (UINT n = 0; n < num_steps; ++n)
+            instance_.UpdateSkinnedAnimation(Step);
+    }
+    float difference (XMFLOAT4X4 const & expected) const {
+        return MaxDifference(&expected, instance_.FinalTransforms.data(), 1);
+    }
+
+    SkinnedData skinned_info_;
+    SkinnedModelInstance instance_;
+};
+
+TEST_F(Crossfade, StartMiddleAndEnd) {
+    update(2);
+    XMFLOAT4X4 before = instance_.FinalTransforms[0];
+    EXPECT_LE(difference(blended_at({0}, {0.5f}, {1.0f})), 1e-5f);
+
+    // -- the fade starts from the pose shown before it
+    instance_.CrossfadeTo("B", 1.0f);
+    EXPECT_EQ(1u, instance_.NumFades);
+    instance_.UpdateSkinnedAnimation(0.0f);
+    EXPECT_LE(difference(before), 1e-6f);
+
+    update(1);
+    EXPECT_LE(difference(blended_at({1, 0}, {0.25f, 0.75f}, {0.25f, 0.75f})), 1e-5f);
+    update(1);
+    EXPECT_LE(difference(blended_at({1, 0}, {0.5f, 1.0f}, {0.5f, 0.5f})), 1e-5f);
+    update(1);
+    EXPECT_LE(difference(blended_at({1, 0}, {0.75f, 1.25f}, {0.75f, 0.25f})), 1e-5f);
+
+    // -- and ends on the new clip alone
+    update(1);
+    EXPECT_EQ(0u, instance_.NumFades);
+    EXPECT_LE(difference(blended_at({1}, {1.0f}, {1.0f})), 1e-5f);
+}
+TEST_F(Crossfade, NlerpWeights) {
+    // -- B starts a quarter turn from A about the same axis: the blend turns by the angle nlerp gives, not the lerped angle
+    instance_.CrossfadeTo("B", 1.0f);
+    update(1);
+    XMVECTOR P, Q, S;
+    XMMatrixDecompose(&S, &Q, &P, XMMatrixTranspose(XMLoadFloat4x4(&instance_.FinalTransforms[0])));
+    float angle_a = 0.5f * Step, angle_b = 2.0f - 0.5f * Step;
+    float half_angle = atan2f(
+        0.75f * sinf(0.5f * angle_a) + 0.25f * sinf(0.5f * angle_b),
+        0.75f * cosf(0.5f * angle_a) + 0.25f * cosf(0.5f * angle_b)
+    );
+    EXPECT_NEAR(sinf(half_angle), XMVectorGetZ(Q), 1e-5f);
+    EXPECT_NEAR(cosf(half_angle), XMVectorGetW(Q), 1e-5f);
+    EXPECT_GT(fabsf(2.0f * half_angle - (0.75f * angle_a + 0.25f * angle_b)), 1e-3f);
+    EXPECT_NEAR(1.0f, XMVectorGetX(XMVector3Length(S)) / sqrtf(3.0f), 1e-5f);
+}
+TEST_F(Crossfade, CrossfadeMidFade) {
+    instance_.CrossfadeTo("B", 1.0f);
+    update(2);
+    XMFLOAT4X4 before = instance_.FinalTransforms[0];
+    EXPECT_LE(difference(blended_at({1, 0}, {0.5f, 0.5f}, {0.5f, 0.5f})), 1e-5f);
+
+    // -- the fade from A to B goes on underneath the fade to C, nothing pops
+    instance_.CrossfadeTo("C", 1.0f);
+    EXPECT_EQ(2u, instance_.NumFades);
+    instance_.UpdateSkinnedAnimation(0.0f);
+    EXPECT_LE(difference(before), 1e-6f);
+
+    // -- C 0.25, B (1 - 0.25) * 0.75, A (1 - 0.25) * (1 - 0.75)
+    update(1);
+    EXPECT_LE(difference(blended_at({2, 1, 0}, {0.25f, 0.75f, 0.75f}, {0.25f, 0.5625f, 0.1875f})), 1e-5f);
+    // -- B is fully faded in underneath, A is gone
+    update(1);
+    EXPECT_EQ(1u, instance_.NumFades);
+    EXPECT_LE(difference(blended_at({2, 1}, {0.5f, 1.0f}, {0.5f, 0.5f})), 1e-5f);
+    update(2);
+    EXPECT_EQ(0u, instance_.NumFades);
+    EXPECT_LE(difference(blended_at({2}, {1.0f}, {1.0f})), 1e-5f);
+}
+TEST_F(Crossfade, OldestFadeEndsEarly) {
+    char const * const clips [] = {"B", "C", "A", "B", "C"};
+    for (char const * clip : clips) {
+        instance_.CrossfadeTo(clip, 1.0f);
+        update(1);
+    }
+    EXPECT_EQ(SkinnedModelInstance::MaxFades, instance_.NumFades);
+    // -- C 0.25, then 0.75 * 0.5, 0.75 * 0.5 * 0.75 and the rest for the clip the oldest fade started from
+    EXPECT_LE(difference(blended_at(
+        {2, 1, 0, 2}, {0.25f, 0.5f, 0.75f, 1.0f}, {0.25f, 0.375f, 0.28125f, 0.09375f}
+    )), 1e-5f);
+}
+TEST_F(Crossfade, KeyframeCursorsMoveWithTheirClips) {
+    // -- every blend input keeps the cursors of the clip it samples
+    update(6);
+    std::vector<UINT> cursors_a = instance_.Workspace.KeyframeCursors[0];
+    EXPECT_EQ(std::vector<UINT>{6}, cursors_a);
+
+    instance_.CrossfadeTo("B", 1.0f);
+    EXPECT_EQ(cursors_a, instance_.Workspace.KeyframeCursors[1]);
+    update(2);
+    std::vector<UINT> cursors_b = instance_.Workspace.KeyframeCursors[0];
+    cursors_a = instance_.Workspace.KeyframeCursors[1];
+    EXPECT_EQ(std::vector<UINT>{2}, cursors_b);
+    EXPECT_EQ(std::vector<UINT>{8}, cursors_a);
+
+    instance_.CrossfadeTo("C", 1.0f);
+    EXPECT_EQ(cursors_b, instance_.Workspace.KeyframeCursors[1]);
+    EXPECT_EQ(cursors_a, instance_.Workspace.KeyframeCursors[2]);
+    update(1);
+    EXPECT_LE(difference(blended_at({2, 1, 0}, {0.25f, 0.75f, 2.25f}, {0.25f, 0.5625f, 0.1875f})), 1e-5f);
+}
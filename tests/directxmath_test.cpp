@@ -0,0 +1,102 @@
+#include "test_util.h"
+
+using namespace DirectX;
+
+//
+// -- DirectXMath conventions the animation core relies on, checked against whichever DirectXMath the build uses
+static void expect_near (FXMVECTOR a, FXMVECTOR b, float tolerance = 1e-5f) {
+    EXPECT_TRUE(XMVector4NearEqual(a, b, XMVectorReplicate(tolerance)))
+        << "(" << XMVectorGetX(a) << ", " << XMVectorGetY(a) << ", " << XMVectorGetZ(a) << ", " << XMVectorGetW(a) << ") vs ("
+        << XMVectorGetX(b) << ", " << XMVectorGetY(b) << ", " << XMVectorGetZ(b) << ", " << XMVectorGetW(b) << ")";
+}
+static void expect_near (CXMMATRIX a, CXMMATRIX b, float tolerance = 1e-5f) {
+    for (int r = 0; r < 4; ++r)
+        expect_near(a.r[r], b.r[r], tolerance);
+}
+static XMMATRIX some_affine_matrix () {
+    XMVECTOR q = XMQuaternionRotationAxis(XMVectorSet(1.0f, 2.0f, -0.5f, 0.0f), 0.8f);
+    return XMMatrixAffineTransformation(
+        XMVectorSet(1.5f, 0.5f, 2.0f, 0.0f), XMVectorZero(), q, XMVectorSet(3.0f, -1.0f, 4.0f, 0.0f)
+    );
+}
+
+TEST(DirectXMath, RowVectorsTranslateLast) {
+    XMMATRIX m = XMMatrixMultiply(XMMatrixRotationY(0.5f * XM_PI), XMMatrixTranslation(1.0f, 2.0f, 3.0f));
+    // -- +x turns to -z about +y, then moves
+    expect_near(XMVector3Transform(XMVectorSet(1.0f, 0.0f, 0.0f, 1.0f), m), XMVectorSet(1.0f, 2.0f, 2.0f, 1.0f));
+    expect_near(XMVector3TransformNormal(XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f), m), XMVectorSet(0.0f, 0.0f, -1.0f, 0.0f));
+}
+TEST(DirectXMath, QuaternionMultiplyRotatesByFirstThenSecond) {
+    XMVECTOR q1 = XMQuaternionRotationAxis(XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), 0.5f * XM_PI);
+    XMVECTOR q2 = XMQuaternionRotationAxis(XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f), 0.5f * XM_PI);
+    XMVECTOR v = XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f);
+    expect_near(XMVector3Rotate(v, XMQuaternionMultiply(q1, q2)), XMVector3Rotate(XMVector3Rotate(v, q1), q2));
+    expect_near(
+        XMMatrixRotationQuaternion(XMQuaternionMultiply(q1, q2)),
+        XMMatrixMultiply(XMMatrixRotationQuaternion(q1), XMMatrixRotationQuaternion(q2))
+    );
+}
+TEST(DirectXMath, QuaternionMatrixRoundTrip) {
+    // -- one rotation per branch of the matrix to quaternion conversion (trace > 0 and each largest diagonal)
+    XMVECTOR axes[] = {
+        XMVectorSet(0.3f, 0.2f, 0.9f, 0.0f), XMVectorSet(1.0f, 0.1f, 0.0f, 0.0f),
+        XMVectorSet(0.1f, 1.0f, 0.2f, 0.0f), XMVectorSet(0.0f, 0.2f, 1.0f, 0.0f)
+    };
+    float angles[] = {0.4f, 3.0f, 3.0f, 3.0f};
+    for (int i = 0; i < 4; ++i) {
+        XMVECTOR q = XMQuaternionRotationAxis(axes[i], angles[i]);
+        XMVECTOR back = XMQuaternionRotationMatrix(XMMatrixRotationQuaternion(q));
+        if (XMVectorGetX(XMQuaternionDot(q, back)) < 0.0f)
+            back = XMVectorNegate(back);
+        expect_near(back, q);
+    }
+}
+TEST(DirectXMath, InverseAndDeterminant) {
+    XMMATRIX m = some_affine_matrix();
+    XMVECTOR determinant;
+    XMMATRIX inverse = XMMatrixInverse(&determinant, m);
+    expect_near(XMMatrixMultiply(m, inverse), XMMatrixIdentity());
+    expect_near(XMMatrixMultiply(inverse, m), XMMatrixIdentity());
+    // -- a rotation keeps volume, the scale multiplies it
+    EXPECT_NEAR(1.5f * 0.5f * 2.0f, XMVectorGetX(determinant), 1e-5f);
+    EXPECT_NEAR(1.5f * 0.5f * 2.0f, XMVectorGetX(XMMatrixDeterminant(m)), 1e-5f);
+    EXPECT_NEAR(-1.0f, XMVectorGetX(XMMatrixDeterminant(XMMatrixScaling(-1.0f, 1.0f, 1.0f))), 1e-6f);
+}
+TEST(DirectXMath, DecomposeAffine) {
+    XMVECTOR q = XMQuaternionRotationAxis(XMVectorSet(1.0f, 2.0f, -0.5f, 0.0f), 0.8f);
+    XMVECTOR scale, rotation, translation;
+    ASSERT_TRUE(XMMatrixDecompose(&scale, &rotation, &translation, some_affine_matrix()));
+    expect_near(XMVectorSetW(scale, 0.0f), XMVectorSet(1.5f, 0.5f, 2.0f, 0.0f));
+    if (XMVectorGetX(XMQuaternionDot(q, rotation)) < 0.0f)
+        rotation = XMVectorNegate(rotation);
+    expect_near(rotation, q);
+    expect_near(XMVectorSetW(translation, 0.0f), XMVectorSet(3.0f, -1.0f, 4.0f, 0.0f));
+}
+TEST(DirectXMath, Float3x4StoresTheTranspose) {
+    XMMATRIX m = some_affine_matrix();
+    XMFLOAT3X4 affine;
+    XMStoreFloat3x4(&affine, m);
+    XMFLOAT4X4 transposed;
+    XMStoreFloat4x4(&transposed, XMMatrixTranspose(m));
+    for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 4; ++c)
+            EXPECT_EQ(transposed.m[r][c], affine.m[r][c]);
+    expect_near(XMLoadFloat3x4(&affine), m);
+}
+TEST(DirectXMath, SlerpTakesTheShortestPath) {
+    XMVECTOR q0 = XMQuaternionRotationAxis(XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), 0.2f);
+    XMVECTOR q1 = XMVectorNegate(XMQuaternionRotationAxis(XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), 0.6f));
+    XMVECTOR half = XMQuaternionSlerp(q0, q1, 0.5f);
+    XMVECTOR expected = XMQuaternionRotationAxis(XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), 0.4f);
+    if (XMVectorGetX(XMQuaternionDot(half, expected)) < 0.0f)
+        half = XMVectorNegate(half);
+    expect_near(half, expected);
+}
+TEST(DirectXMath, SelectAndCompare) {
+    XMVECTOR a = XMVectorSet(1.0f, 2.0f, 3.0f, 4.0f);
+    XMVECTOR b = XMVectorSet(1.0f, 0.0f, 3.0f, 0.0f);
+    expect_near(XMVectorSelect(XMVectorZero(), XMVectorSplatOne(), XMVectorEqual(a, b)), XMVectorSet(1.0f, 0.0f, 1.0f, 0.0f));
+    EXPECT_TRUE(XMVector3Greater(a, XMVectorZero()));
+    EXPECT_FALSE(XMVector3Less(b, a));
+    expect_near(XMVector3Normalize(XMVectorZero()), XMVectorZero());
+}
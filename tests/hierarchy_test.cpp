@@ -0,0 +1,92 @@
+#include "test_util.h"
+#include "synthetic_skeleton.h"
+#include "hierarchy_kernel.h"
+
+using namespace DirectX;
+
+//
+// -- the fused hierarchy pass of GetFinalTransforms against the two passes it replaced,
+// -- on the sampled local pose it leaves in the workspace. Parameter: bone count, reversed bone indices
+class FusedHierarchy : public testing::TestWithParam<std::tuple<UINT, bool>> {};
+
+TEST_P(FusedHierarchy, MatchesTwoPasses) {
+    UINT num_bones = std::get<0>(GetParam());
+    bool reverse_order = std::get<1>(GetParam());
+    SyntheticSkeleton skeleton = MakeSyntheticSkeleton(num_bones, 61, reverse_order);
+    std::vector<UINT> order = SyntheticBoneOrder(num_bones, reverse_order);
+
+    SkinnedData skinned_info;
+    std::vector<int> hierarchy = skeleton.Hierarchy;
+    std::vector<XMFLOAT4X4> offsets = skeleton.Offsets;
+    skinned_info.Set(hierarchy, offsets, skeleton.Clips);
+    SkinnedData::ClipHandle clip = skinned_info.FindClip("Swing");
+
+    PoseWorkspace workspace;
+    workspace.Resize(num_bones);
+    std::vector<XMFLOAT4X4> fused(num_bones);
+    std::vector<XMFLOAT3X4> fused_affine(num_bones);
+    std::vector<XMFLOAT4X4> to_root(num_bones);
+    std::vector<XMFLOAT3X4> affine_to_root(num_bones);
+    std::vector<XMFLOAT4X4> two_pass(num_bones);
+    std::vector<XMFLOAT3X4> two_pass_affine(num_bones);
+
+    for (float t : {0.0f, 0.37f, 1.0f, 1.99f, 2.0f}) {
+        skinned_info.GetFinalTransforms(clip, t, fused.data(), workspace);
+        TwoPassFinalTransforms(
+            skeleton.Hierarchy, skeleton.Offsets, order, workspace.ToParentTransforms.data(), to_root.data(), two_pass.data()
+        );
+        EXPECT_LE(MaxDifference(two_pass.data(), fused.data(), num_bones), 1e-6f) << "t = " << t;
+        for (UINT i = 0; i < num_bones; ++i)
+            XMStoreFloat3x4(&affine_to_root[i], XMLoadFloat4x4(&to_root[i]));
+        EXPECT_LE(MaxDifference(affine_to_root.data(), workspace.ToRootTransforms.data(), num_bones), 1e-6f) << "t = " << t;
+
+        skinned_info.GetFinalTransforms(clip, t, fused_affine.data(), workspace);
+        PackBonePalette(two_pass.data(), num_bones, two_pass_affine.data());
+        EXPECT_LE(MaxDifference(two_pass_affine.data(), fused_affine.data(), num_bones), 1e-6f) << "t = " << t;
+    }
+}
+//
+// -- every kernel the CPU supports against the two passes, on the same sampled pose
+TEST_P(FusedHierarchy, EveryKernelMatchesTwoPasses) {
+    UINT num_bones = std::get<0>(GetParam());
+    bool reverse_order = std::get<1>(GetParam());
+    SyntheticSkeleton skeleton = MakeSyntheticSkeleton(num_bones, 61, reverse_order);
+    std::vector<UINT> order = SyntheticBoneOrder(num_bones, reverse_order);
+
+    PackedAnimationClip clip;
+    clip.Build(skeleton.Clips["Swing"]);
+    PoseWorkspace workspace;
+    workspace.Resize(num_bones);
+    clip.Interpolate(0.37f, workspace.ToParentTransforms, workspace.KeyframeCursors[0]);
+
+    std::vector<XMFLOAT4X4> to_root(num_bones);
+    std::vector<XMFLOAT4X4> two_pass(num_bones);
+    std::vector<XMFLOAT3X4> two_pass_affine(num_bones);
+    TwoPassFinalTransforms(skeleton.Hierarchy, skeleton.Offsets, order, workspace.ToParentTransforms.data(), to_root.data(), two_pass.data());
+    PackBonePalette(two_pass.data(), num_bones, two_pass_affine.data());
+    std::vector<XMFLOAT3X4> affine_offsets(num_bones);
+    for (UINT i = 0; i < num_bones; ++i)
+        XMStoreFloat3x4(&affine_offsets[i], XMLoadFloat4x4(&skeleton.Offsets[i]));
+
+    for (HierarchyKernel kernel : {HierarchyKernel::Scalar, HierarchyKernel::Sse2, HierarchyKernel::Avx2Fma}) {
+        if (!HierarchyKernelSupported(kernel))
+            continue;
+        std::vector<XMFLOAT3X4> affine_to_root(num_bones);
+        std::vector<XMFLOAT4X4> transposed(num_bones);
+        std::vector<XMFLOAT3X4> affine(num_bones);
+        ConcatenateBoneHierarchy(
+            order.data(), num_bones, skeleton.Hierarchy.data(), workspace.ToParentTransforms.data(), affine_offsets.data(),
+            affine_to_root.data(), transposed.data(), nullptr, kernel
+        );
+        EXPECT_LE(MaxDifference(two_pass.data(), transposed.data(), num_bones), 1e-6f) << HierarchyKernelName(kernel);
+        ConcatenateBoneHierarchy(
+            order.data(), num_bones, skeleton.Hierarchy.data(), workspace.ToParentTransforms.data(), affine_offsets.data(),
+            affine_to_root.data(), nullptr, affine.data(), kernel
+        );
+        EXPECT_LE(MaxDifference(two_pass_affine.data(), affine.data(), num_bones), 1e-6f) << HierarchyKernelName(kernel);
+    }
+}
+INSTANTIATE_TEST_SUITE_P(
+    BoneCounts, FusedHierarchy,
+    testing::Combine(testing::Values(1u, 64u, 96u, 256u), testing::Bool())
+);
@@ -0,0 +1,130 @@
+#include "test_util.h"
+#include "instance_batching.h"
+
+using namespace DirectX;
+
+//
+// -- stand-ins for two meshes and their index formats (DXGI_FORMAT_R16_UINT, DXGI_FORMAT_R32_UINT)
+static char const body_mesh = 'b';
+static char const head_mesh = 'h';
+static UINT const r16_uint = 57;
+static UINT const r32_uint = 42;
+
+// -- item drawing subset (index_count, start_index) of geometry, tagged by its palette offset
+static InstanceDrawItem make_item (void const * geometry, UINT index_count, UINT start_index, UINT material, UINT palette_offset) {
+    InstanceDrawItem item;
+    item.Geometry = geometry;
+    item.IndexCount = index_count;
+    item.StartIndexLocation = start_index;
+    item.IndexFormat = r16_uint;
+    item.MaterialIndex = material;
+    item.PaletteOffset = palette_offset;
+    XMStoreFloat4x4(&item.World, XMMatrixTranslation((float)palette_offset, 0.0f, 0.0f));
+    return item;
+}
+// -- every batch is a contiguous run of the instance data, the runs follow each other and cover every item
+static void expect_contiguous (std::vector<InstanceBatch> const & batches, UINT num_items) {
+    UINT first_instance = 0;
+    for (size_t b = 0; b < batches.size(); ++b) {
+        EXPECT_EQ(first_instance, batches[b].FirstInstance) << "batch " << b;
+        EXPECT_GT(batches[b].InstanceCount, 0u) << "batch " << b;
+        first_instance += batches[b].InstanceCount;
+    }
+    EXPECT_EQ(num_items, first_instance);
+}
+
+TEST(InstanceBatcher, GroupsItemsByKey) {
+    // -- the same draw as item 0 except for one key member each, then item 0 again
+    std::vector<InstanceDrawItem> items(8, make_item(&body_mesh, 300, 0, 1, 0));
+    items[1].Geometry = &head_mesh;
+    items[2].IndexCount = 120;
+    items[3].StartIndexLocation = 300;
+    items[4].BaseVertexLocation = 64;
+    items[5].IndexFormat = r32_uint;
+    items[6].MaterialIndex = 2;
+    for (UINT i = 0; i < items.size(); ++i)
+        items[i].PaletteOffset = i;
+
+    InstanceBatcher batcher;
+    std::vector<InstanceBatch> batches;
+    std::vector<InstanceData> instances(items.size());
+    batcher.Build(items.data(), (UINT)items.size(), batches, instances.data());
+
+    ASSERT_EQ(7u, batches.size());
+    expect_contiguous(batches, (UINT)items.size());
+    EXPECT_EQ(2u, batches[0].InstanceCount);
+    EXPECT_EQ(0u, instances[0].PaletteOffset);
+    EXPECT_EQ(7u, instances[1].PaletteOffset);
+    for (UINT b = 1; b < 7; ++b) {
+        InstanceBatch const & batch = batches[b];
+        InstanceDrawItem const & item = items[b];
+        EXPECT_EQ(1u, batch.InstanceCount) << "batch " << b;
+        EXPECT_EQ(item.Geometry, batch.Geometry) << "batch " << b;
+        EXPECT_EQ(item.IndexCount, batch.IndexCount) << "batch " << b;
+        EXPECT_EQ(item.StartIndexLocation, batch.StartIndexLocation) << "batch " << b;
+        EXPECT_EQ(item.BaseVertexLocation, batch.BaseVertexLocation) << "batch " << b;
+        EXPECT_EQ(item.IndexFormat, batch.IndexFormat) << "batch " << b;
+        EXPECT_EQ(item.MaterialIndex, batch.MaterialIndex) << "batch " << b;
+        EXPECT_EQ(b, instances[batch.FirstInstance].PaletteOffset) << "batch " << b;
+    }
+}
+TEST(InstanceBatcher, LaysOutInstancesBatchAfterBatch) {
+    // -- 3 instances of a model with 4 subsets, interleaved as a scene walk emits them
+    UINT const num_models = 3;
+    UINT const num_subsets = 4;
+    std::vector<InstanceDrawItem> items;
+    for (UINT m = 0; m < num_models; ++m) {
+        for (UINT s = 0; s < num_subsets; ++s)
+            items.push_back(make_item(&body_mesh, 100 + s, 1000 * s, s, 60 * m));
+    }
+
+    InstanceBatcher batcher;
+    std::vector<InstanceBatch> batches;
+    std::vector<InstanceData> instances(items.size());
+    batcher.Build(items.data(), (UINT)items.size(), batches, instances.data());
+
+    ASSERT_EQ(num_subsets, batches.size());
+    expect_contiguous(batches, (UINT)items.size());
+    for (UINT s = 0; s < num_subsets; ++s) {
+        EXPECT_EQ(s * num_models, batches[s].FirstInstance) << "subset " << s;
+        EXPECT_EQ(num_models, batches[s].InstanceCount) << "subset " << s;
+        EXPECT_EQ(1000 * s, batches[s].StartIndexLocation) << "subset " << s;
+        // -- the models keep their order inside the batch, with their palette, material and transposed world
+        for (UINT m = 0; m < num_models; ++m) {
+            InstanceData const & instance = instances[batches[s].FirstInstance + m];
+            EXPECT_EQ(60 * m, instance.PaletteOffset) << "subset " << s << ", model " << m;
+            EXPECT_EQ(s, instance.MaterialIndex) << "subset " << s << ", model " << m;
+            EXPECT_EQ((float)(60 * m), instance.World(0, 3)) << "subset " << s << ", model " << m;
+        }
+    }
+
+    // -- the scratch is reused: a smaller build starts over
+    batcher.Build(items.data(), 2, batches, instances.data());
+    ASSERT_EQ(2u, batches.size());
+    expect_contiguous(batches, 2);
+}
+TEST(InstanceBatcher, NeverMixesIndexFormats) {
+    // -- the index buffer view of a batch has one format: items only differing by it must not share a draw
+    std::vector<InstanceDrawItem> items;
+    for (UINT i = 0; i < 64; ++i) {
+        InstanceDrawItem item = make_item(i % 3 ? &body_mesh : &head_mesh, 300, 0, i % 2, i);
+        item.IndexFormat = (i / 2) % 2 ? r32_uint : r16_uint;
+        items.push_back(item);
+    }
+
+    InstanceBatcher batcher;
+    std::vector<InstanceBatch> batches;
+    std::vector<InstanceData> instances(items.size());
+    batcher.Build(items.data(), (UINT)items.size(), batches, instances.data());
+
+    expect_contiguous(batches, (UINT)items.size());
+    EXPECT_EQ(8u, batches.size());
+    for (InstanceBatch const & batch : batches) {
+        for (UINT k = 0; k < batch.InstanceCount; ++k) {
+            InstanceDrawItem const & item = items[instances[batch.FirstInstance + k].PaletteOffset];
+            EXPECT_EQ(batch.IndexFormat, item.IndexFormat) << "item " << item.PaletteOffset;
+            EXPECT_EQ(batch.Geometry, item.Geometry) << "item " << item.PaletteOffset;
+            EXPECT_EQ(batch.MaterialIndex, item.MaterialIndex) << "item " << item.PaletteOffset;
+        }
+    }
+}
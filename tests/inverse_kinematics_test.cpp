@@ -0,0 +1,166 @@
+#include "test_util.h"
+#include "synthetic_skeleton.h"
+
+using namespace DirectX;
+
+//
+// -- chain of unit length bones bent by 0.3 radians at every joint, see MakeSyntheticChain
+struct IkFixture {
+    std::vector<int> Hierarchy;
+    std::vector<XMFLOAT4X4> AnimatedPose;
+    std::vector<XMFLOAT4X4> Pose;
+
+    explicit IkFixture (UINT num_bones) {
+        MakeSyntheticChain(num_bones, 0.3f, Hierarchy, AnimatedPose);
+        Pose = AnimatedPose;
+    }
+    void Solve (IkChain const & chain) {
+        Pose = AnimatedPose;
+        SolveIkChain(chain, Hierarchy.data(), Pose.data());
+    }
+    XMVECTOR Position (UINT bone, std::vector<XMFLOAT4X4> const & pose) const {
+        return SyntheticToRoot(bone, Hierarchy, pose).r[3];
+    }
+    XMVECTOR Position (UINT bone) const { return Position(bone, Pose); }
+    XMVECTOR Rotation (UINT bone, std::vector<XMFLOAT4X4> const & pose) const {
+        return XMQuaternionRotationMatrix(SyntheticToRoot(bone, Hierarchy, pose));
+    }
+    float Distance (FXMVECTOR a, FXMVECTOR b) const { return XMVectorGetX(XMVector3Length(XMVectorSubtract(a, b))); }
+    // -- every rotated link keeps its length
+    void ExpectLinkLengths (UINT first_bone, UINT tip_bone) const {
+        for (UINT i = first_bone; i < tip_bone; ++i)
+            EXPECT_NEAR(1.0f, Distance(Position(i), Position(i + 1)), 1e-4f) << "link " << i;
+    }
+};
+// -- angle between two rotations
+static float rotation_angle (FXMVECTOR a, FXMVECTOR b) {
+    XMVECTOR d = XMQuaternionMultiply(XMQuaternionConjugate(XMQuaternionNormalize(a)), XMQuaternionNormalize(b));
+    return 2.0f * asinf(MathHelper::Min(XMVectorGetX(XMVector3Length(d)), 1.0f));
+}
+// -- targets around the chain root at the given distances
+static std::vector<XMFLOAT3> targets_around (FXMVECTOR center, std::initializer_list<float> distances) {
+    std::vector<XMFLOAT3> targets;
+    for (float distance : distances) {
+        for (UINT k = 0; k < 8; ++k) {
+            XMVECTOR direction = XMVector3Normalize(XMVectorSet(cosf(k * 0.8f), sinf(k * 1.7f), 0.4f * k - 1.5f, 0.0f));
+            XMFLOAT3 target;
+            XMStoreFloat3(&target, XMVectorMultiplyAdd(direction, XMVectorReplicate(distance), center));
+            targets.push_back(target);
+        }
+    }
+    return targets;
+}
+
+TEST(SolveIkChain, TwoBoneReachesReachableTargets) {
+    IkFixture fixture(4);
+    XMVECTOR chain_root = fixture.Position(1);
+
+    IkChain chain;
+    chain.TipBone = 3;
+    for (XMFLOAT3 const & target : targets_around(chain_root, {0.3f, 1.0f, 1.5f, 1.99f})) {
+        chain.Target = target;
+        fixture.Solve(chain);
+        EXPECT_LE(fixture.Distance(fixture.Position(3), XMLoadFloat3(&target)), 1e-4f);
+        EXPECT_LE(fixture.Distance(fixture.Position(1), chain_root), 1e-5f);
+        fixture.ExpectLinkLengths(1, 3);
+    }
+}
+TEST(SolveIkChain, TwoBoneStretchesTowardUnreachableTargets) {
+    IkFixture fixture(4);
+    XMVECTOR chain_root = fixture.Position(1);
+
+    IkChain chain;
+    chain.TipBone = 3;
+    for (XMFLOAT3 const & target : targets_around(chain_root, {2.5f, 10.0f})) {
+        chain.Target = target;
+        fixture.Solve(chain);
+        XMVECTOR to_tip = XMVectorSubtract(fixture.Position(3), chain_root);
+        XMVECTOR to_target = XMVectorSubtract(XMLoadFloat3(&target), chain_root);
+        EXPECT_NEAR(2.0f, XMVectorGetX(XMVector3Length(to_tip)), 1e-3f);
+        EXPECT_LE(fixture.Distance(XMVector3Normalize(to_tip), XMVector3Normalize(to_target)), 1e-3f);
+        fixture.ExpectLinkLengths(1, 3);
+    }
+}
+TEST(SolveIkChain, FabrikReachesReachableTargets) {
+    IkFixture fixture(8);
+    XMVECTOR chain_root = fixture.Position(2);
+
+    IkChain chain;
+    chain.Solver = IkSolver::Fabrik;
+    chain.TipBone = 7;
+    chain.NumLinks = 5;
+    chain.MaxIterations = 64;
+    for (XMFLOAT3 const & target : targets_around(chain_root, {0.5f, 2.0f, 3.5f, 4.9f})) {
+        chain.Target = target;
+        fixture.Solve(chain);
+        EXPECT_LE(fixture.Distance(fixture.Position(7), XMLoadFloat3(&target)), chain.Tolerance + 1e-4f);
+        EXPECT_LE(fixture.Distance(fixture.Position(2), chain_root), 1e-5f);
+        fixture.ExpectLinkLengths(2, 7);
+    }
+}
+TEST(SolveIkChain, FabrikStretchesTowardUnreachableTargets) {
+    IkFixture fixture(8);
+    XMVECTOR chain_root = fixture.Position(2);
+
+    IkChain chain;
+    chain.Solver = IkSolver::Fabrik;
+    chain.TipBone = 7;
+    chain.NumLinks = 5;
+    for (XMFLOAT3 const & target : targets_around(chain_root, {5.5f, 50.0f})) {
+        chain.Target = target;
+        fixture.Solve(chain);
+        XMVECTOR direction = XMVector3Normalize(XMVectorSubtract(XMLoadFloat3(&target), chain_root));
+        for (UINT i = 3; i <= 7; ++i) {
+            XMVECTOR expected = XMVectorMultiplyAdd(direction, XMVectorReplicate((float)(i - 2)), chain_root);
+            EXPECT_LE(fixture.Distance(fixture.Position(i), expected), 1e-4f) << "bone " << i;
+        }
+    }
+}
+TEST(SolveIkChain, WeightMovesTheTipPartway) {
+    IkFixture fixture(4);
+    XMVECTOR animated_tip = fixture.Position(3, fixture.AnimatedPose);
+
+    IkChain chain;
+    chain.TipBone = 3;
+    chain.Target = XMFLOAT3(0.8f, 1.5f, 0.6f);
+    chain.Weight = 0.5f;
+    fixture.Solve(chain);
+    XMVECTOR expected = XMVectorLerp(animated_tip, XMVectorSetW(XMLoadFloat3(&chain.Target), 1.0f), 0.5f);
+    EXPECT_LE(fixture.Distance(fixture.Position(3), expected), 1e-4f);
+
+    chain.Weight = 0.0f;
+    fixture.Solve(chain);
+    EXPECT_EQ(0.0f, MaxDifference(fixture.AnimatedPose.data(), fixture.Pose.data(), 4));
+}
+TEST(SolveIkChain, KeepTipRotationIsWeighted) {
+    for (IkSolver solver : {IkSolver::TwoBone, IkSolver::Fabrik}) {
+        IkFixture fixture(5);
+        XMVECTOR animated_rotation = fixture.Rotation(4, fixture.AnimatedPose);
+
+        IkChain chain;
+        chain.Solver = solver;
+        chain.TipBone = 4;
+        chain.NumLinks = 3;
+        chain.Target = XMFLOAT3(1.2f, 2.0f, 0.7f);
+        for (float weight : {1.0f, 0.75f, 0.5f, 0.25f}) {
+            chain.Weight = weight;
+            chain.KeepTipRotation = false;
+            fixture.Solve(chain);
+            XMVECTOR followed_rotation = fixture.Rotation(4, fixture.Pose);
+            XMVECTOR followed_tip = fixture.Position(4);
+
+            chain.KeepTipRotation = true;
+            fixture.Solve(chain);
+            XMVECTOR kept_rotation = fixture.Rotation(4, fixture.Pose);
+
+            // -- the tip turns back toward its animated rotation by weight, its position does not change
+            float followed_angle = rotation_angle(animated_rotation, followed_rotation);
+            ASSERT_GT(followed_angle, 0.05f);
+            EXPECT_NEAR((1.0f - weight) * followed_angle, rotation_angle(animated_rotation, kept_rotation), 1e-3f)
+                << "weight " << weight;
+            EXPECT_NEAR(weight * followed_angle, rotation_angle(followed_rotation, kept_rotation), 1e-3f)
+                << "weight " << weight;
+            EXPECT_LE(fixture.Distance(fixture.Position(4), followed_tip), 1e-5f);
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#include "test_util.h"
+#include "job_system.h"
+
+#include <cstring>
+
+using namespace DirectX;
+
+//
+// -- ParallelFor must run the job over every item exactly once, whatever the thread count, the chunk size and
+// -- the chunks stolen between threads. Parameter: thread count
+class ParallelFor : public testing::TestWithParam<unsigned> {};
+
+TEST_P(ParallelFor, CoversEveryIndexExactlyOnce) {
+    JobSystem jobs(GetParam());
+    ASSERT_EQ(GetParam(), jobs.ThreadCount());
+
+    for (unsigned count : {0u, 1u, 2u, 7u, 64u, 1000u, 100003u}) {
+        for (unsigned chunk_size : {0u, 1u, 3u, 64u, 100003u}) {
+            std::vector<std::atomic<unsigned>> visits(count);
+            for (auto & v : visits)
+                v.store(0);
+            std::atomic<unsigned> num_bad_ranges(0);
+
+            jobs.ParallelFor(count, chunk_size, [&](unsigned begin, unsigned end) {
+                if (begin >= end || end > count)
+                    num_bad_ranges.fetch_add(1);
+                for (unsigned i = begin; i < end && i < count; ++i)
+                    visits[i].fetch_add(1, std::memory_order_relaxed);
+            });
+
+            EXPECT_EQ(0u, num_bad_ranges.load()) << "count " << count << ", chunk size " << chunk_size;
+            unsigned num_wrong = 0;
+            for (unsigned i = 0; i < count; ++i)
+                num_wrong += 1 != visits[i].load() ? 1 : 0;
+            EXPECT_EQ(0u, num_wrong) << "count " << count << ", chunk size " << chunk_size;
+        }
+    }
+}
+TEST_P(ParallelFor, BackToBackCallsDoNotMixUp) {
+    JobSystem jobs(GetParam());
+    std::vector<unsigned> sums(200, 0);
+    for (unsigned call = 0; call < sums.size(); ++call) {
+        std::atomic<unsigned> sum(0);
+        jobs.ParallelFor(call + 1, 2, [&](unsigned begin, unsigned end) {
+            for (unsigned i = begin; i < end; ++i)
+                sum.fetch_add(i + 1, std::memory_order_relaxed);
+        });
+        sums[call] = sum.load();
+    }
+    for (unsigned call = 0; call < sums.size(); ++call)
+        EXPECT_EQ((call + 1) * (call + 2) / 2, sums[call]) << "call " << call;
+}
+INSTANTIATE_TEST_SUITE_P(ThreadCounts, ParallelFor, testing::Values(1u, 2u, 3u, 4u, 8u, 16u));
+
+//
+// -- every instance is updated on its own, so the final transforms are bit identical for any thread count
+TEST(UpdateSkinnedInstances, SameResultOnAnyThreadCount) {
+    SoldierModel & soldier = Soldier();
+    ASSERT_TRUE(soldier.Loaded);
+    UINT num_bones = soldier.SkinnedInfo.BoneCount();
+    UINT const num_instances = 37;
+
+    std::vector<std::vector<XMFLOAT3X4>> palettes;
+    for (unsigned num_threads : {1u, 2u, 4u, 7u}) {
+        std::vector<SkinnedModelInstance> instances(num_instances);
+        for (UINT i = 0; i < num_instances; ++i) {
+            SkinnedModelInstance & instance = instances[i];
+            instance.SkinnedInfo = &soldier.SkinnedInfo;
+            instance.FinalTransforms.resize(num_bones);
+            instance.Workspace.Resize(num_bones);
+            instance.SetClip("Take1");
+            instance.TimePoint = 0.05f * i;
+            instance.PaletteOffset = i * num_bones;
+        }
+
+        JobSystem jobs(num_threads);
+        std::vector<XMFLOAT3X4> palette(num_instances * num_bones);
+        for (UINT frame = 0; frame < 10; ++frame)
+            UpdateSkinnedInstances(jobs, instances.data(), num_instances, 1.0f / 60.0f, palette.data());
+        palettes.push_back(palette);
+    }
+    for (size_t n = 1; n < palettes.size(); ++n)
+        EXPECT_EQ(0, memcmp(palettes[0].data(), palettes[n].data(), palettes[0].size() * sizeof(XMFLOAT3X4)));
+}
@@ -0,0 +1,91 @@
+#include "test_util.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+//
+// -- root with a chain of two 0.5 long bones below it: every bone rotates about z, wobbles its length and
+// -- scale a little, the root is placed at root_offset. Keys at 30 per second over 2 s
+static AnimationClip make_chain_clip (XMFLOAT3 root_offset, float rotation_noise) {
+    UINT const num_keys = 61;
+    AnimationClip clip;
+    clip.BoneAnimations.resize(3);
+    for (UINT b = 0; b < 3; ++b) {
+        for (UINT k = 0; k < num_keys; ++k) {
+            float t = k / 30.0f;
+            float noise = (k % 2 ? 1.0f : -1.0f) * rotation_noise;
+            Keyframe key;
+            key.TimePoint = t;
+            key.Translation = b == 0 ? root_offset : XMFLOAT3(0.5f + 0.05f * sinf(3.0f * t), 0.0f, 0.0f);
+            float s = 1.0f + 0.1f * sinf(2.0f * t + b);
+            key.Scale = XMFLOAT3(s, s, s);
+            XMStoreFloat4(&key.RotationQuat, XMQuaternionRotationRollPitchYaw(0.0f, 0.0f, 0.8f * sinf(t + b) + noise));
+            clip.BoneAnimations[b].Keyframes.push_back(key);
+        }
+    }
+    return clip;
+}
+//
+// -- model space position of every joint at t
+static std::vector<XMFLOAT3> joint_positions (AnimationClip const & clip, std::vector<int> const & hierarchy, float t) {
+    std::vector<XMFLOAT4X4> local(hierarchy.size());
+    clip.Interpolate(t, local);
+
+    std::vector<XMMATRIX> to_root(hierarchy.size());
+    std::vector<XMFLOAT3> positions(hierarchy.size());
+    for (UINT i = 0; i < hierarchy.size(); ++i) {
+        to_root[i] = XMLoadFloat4x4(&local[i]);
+        if (hierarchy[i] >= 0)
+            to_root[i] = XMMatrixMultiply(to_root[i], to_root[hierarchy[i]]);
+        XMStoreFloat3(&positions[i], to_root[i].r[3]);
+    }
+    return positions;
+}
+
+TEST(ReduceKeyframes, JointsStayWithinToleranceAtTheKeyframeTimes) {
+    std::vector<int> const hierarchy = {-1, 0, 1};
+    float const tolerance = 0.01f;
+    AnimationClip const source = make_chain_clip(XMFLOAT3(0.0f, 1.0f, 0.0f), 0.0f);
+    AnimationClip reduced = source;
+
+    UINT num_removed = reduced.ReduceKeyframes(hierarchy, tolerance);
+    EXPECT_GT(num_removed, 0u);
+
+    // -- translation, rotation and scale of all three bones move the tip joint at once
+    for (Keyframe const & key : source.BoneAnimations[0].Keyframes) {
+        std::vector<XMFLOAT3> expected = joint_positions(source, hierarchy, key.TimePoint);
+        std::vector<XMFLOAT3> actual = joint_positions(reduced, hierarchy, key.TimePoint);
+        for (UINT i = 0; i < hierarchy.size(); ++i) {
+            float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&actual[i]) - XMLoadFloat3(&expected[i])));
+            EXPECT_LE(distance, tolerance) << "joint " << i << " at t = " << key.TimePoint;
+        }
+    }
+}
+TEST(ReduceKeyframes, RootDisplacementDoesNotTightenTheRootRotation) {
+    std::vector<int> const hierarchy = {-1, 0, 1};
+    // -- rotation noise far below what moves the 1 unit long chain by the tolerance
+    AnimationClip at_origin = make_chain_clip(XMFLOAT3(0.0f, 0.0f, 0.0f), 2e-5f);
+    AnimationClip far_away = make_chain_clip(XMFLOAT3(100.0f, 0.0f, 50.0f), 2e-5f);
+
+    UINT removed_at_origin = at_origin.ReduceKeyframes(hierarchy, 0.01f);
+    UINT removed_far_away = far_away.ReduceKeyframes(hierarchy, 0.01f);
+    EXPECT_GT(removed_at_origin, 0u);
+    EXPECT_EQ(removed_at_origin, removed_far_away);
+    EXPECT_EQ(at_origin.BoneAnimations[0].Keyframes.size(), far_away.BoneAnimations[0].Keyframes.size());
+}
+TEST(ReduceKeyframes, AnyBoneOrder) {
+    // -- the same chain stored tip first, root last: every bone keeps the keyframes it keeps in parent first order
+    std::vector<int> const hierarchy = {-1, 0, 1};
+    std::vector<int> const reversed_hierarchy = {1, 2, -1};
+    AnimationClip forward = make_chain_clip(XMFLOAT3(0.0f, 1.0f, 0.0f), 0.0f);
+    AnimationClip reversed = forward;
+    std::reverse(reversed.BoneAnimations.begin(), reversed.BoneAnimations.end());
+
+    UINT removed_forward = forward.ReduceKeyframes(hierarchy, 0.01f);
+    EXPECT_GT(removed_forward, 0u);
+    EXPECT_EQ(removed_forward, reversed.ReduceKeyframes(reversed_hierarchy, 0.01f));
+    for (UINT i = 0; i < 3; ++i)
+        EXPECT_EQ(forward.BoneAnimations[i].Keyframes.size(), reversed.BoneAnimations[2 - i].Keyframes.size()) << "bone " << i;
+}
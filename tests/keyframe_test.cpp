@@ -0,0 +1,131 @@
+#include "test_util.h"
+
+#include <random>
+
+using namespace DirectX;
+
+//
+// -- num_keyframes keys at irregular, increasing time points with distinct poses
+static BoneAnimation make_bone_animation (UINT num_keyframes, unsigned seed) {
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> step(0.01f, 0.1f);
+    std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+
+    BoneAnimation animation;
+    animation.Keyframes.resize(num_keyframes);
+    float t = value(random);
+    for (Keyframe & key : animation.Keyframes) {
+        key.TimePoint = t;
+        t += step(random);
+        key.Translation = XMFLOAT3(value(random), value(random), value(random));
+        key.Scale = XMFLOAT3(1.0f + 0.1f * value(random), 1.0f, 1.0f);
+        XMVECTOR q = XMQuaternionRotationAxis(XMVectorSet(value(random), 1.0f, value(random), 0.0f), value(random));
+        XMStoreFloat4(&key.RotationQuat, q);
+    }
+    return animation;
+}
+// -- segment the original linear scan picked: the first one whose end is not before t
+static UINT linear_scan (BoneAnimation const & animation, float t) {
+    for (UINT i = 0; i + 1 < animation.Keyframes.size(); ++i)
+        if (t >= animation.Keyframes[i].TimePoint && t <= animation.Keyframes[i + 1].TimePoint)
+            return i;
+    return t < animation.GetStartTime() ? 0 : (UINT)animation.Keyframes.size() - 2;
+}
+// -- the original BoneAnimation::Interpolate: clamp outside the keys, linear scan inside
+static XMFLOAT4X4 linear_scan_interpolate (BoneAnimation const & animation, float t) {
+    std::vector<Keyframe> const & keys = animation.Keyframes;
+    Keyframe const * k0 = &keys.front();
+    Keyframe const * k1 = k0;
+    float lerp_percent = 0.0f;
+    if (t >= keys.back().TimePoint) {
+        k0 = k1 = &keys.back();
+    } else if (t > keys.front().TimePoint) {
+        UINT i = linear_scan(animation, t);
+        k0 = &keys[i];
+        k1 = &keys[i + 1];
+        lerp_percent = (t - k0->TimePoint) / (k1->TimePoint - k0->TimePoint);
+    }
+    XMVECTOR S = XMVectorLerp(XMLoadFloat3(&k0->Scale), XMLoadFloat3(&k1->Scale), lerp_percent);
+    XMVECTOR P = XMVectorLerp(XMLoadFloat3(&k0->Translation), XMLoadFloat3(&k1->Translation), lerp_percent);
+    XMVECTOR Q = XMQuaternionSlerp(XMLoadFloat4(&k0->RotationQuat), XMLoadFloat4(&k1->RotationQuat), lerp_percent);
+    XMFLOAT4X4 m;
+    XMStoreFloat4x4(&m, XMMatrixAffineTransformation(S, XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), Q, P));
+    return m;
+}
+// -- time points to look up: every key, midpoints, both clip ends and beyond, in the given order
+static std::vector<float> lookup_times (BoneAnimation const & animation) {
+    std::vector<float> times;
+    times.push_back(animation.GetStartTime() - 1.0f);
+    for (UINT i = 0; i < animation.Keyframes.size(); ++i) {
+        times.push_back(animation.Keyframes[i].TimePoint);
+        if (i + 1 < animation.Keyframes.size())
+            times.push_back(0.5f * (animation.Keyframes[i].TimePoint + animation.Keyframes[i + 1].TimePoint));
+    }
+    times.push_back(animation.GetEndTime() + 1.0f);
+    return times;
+}
+
+class FindKeyframe : public testing::TestWithParam<UINT> {};
+
+TEST_P(FindKeyframe, MatchesLinearScan) {
+    BoneAnimation animation = make_bone_animation(GetParam(), GetParam());
+    std::vector<float> times = lookup_times(animation);
+    std::vector<float> packed_times;
+    for (Keyframe const & key : animation.Keyframes)
+        packed_times.push_back(key.TimePoint);
+    UINT num_keyframes = (UINT)packed_times.size();
+
+    // -- forward (cursor hits), backward (every lookup misses the cursor) and shuffled (seeks)
+    std::vector<float> reversed(times.rbegin(), times.rend());
+    std::vector<float> shuffled = times;
+    std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(7));
+    for (std::vector<float> const * order : {&times, &reversed, &shuffled}) {
+        UINT cursor = 0;
+        UINT packed_cursor = 0;
+        for (float t : *order) {
+            UINT i = animation.FindKeyframe(t, cursor);
+            UINT packed = PackedAnimationClip::FindKeyframe(packed_times.data(), num_keyframes, t, packed_cursor);
+            EXPECT_EQ(i, packed) << "t = " << t;
+            EXPECT_EQ(i, cursor);
+
+            // -- at a key time the original scan ends the previous segment, the lookup starts the next one
+            UINT expected = linear_scan(animation, t);
+            if (t > animation.GetStartTime() && t < animation.GetEndTime() && t == animation.Keyframes[expected + 1].TimePoint)
+                ++expected;
+            EXPECT_EQ(expected, i) << "t = " << t;
+        }
+    }
+}
+TEST_P(FindKeyframe, InterpolateMatchesLinearScan) {
+    BoneAnimation animation = make_bone_animation(GetParam(), GetParam() + 1);
+    std::vector<float> times = lookup_times(animation);
+    std::vector<float> reversed(times.rbegin(), times.rend());
+    for (std::vector<float> const * order : {&times, &reversed}) {
+        UINT cursor = 0;
+        for (float t : *order) {
+            XMFLOAT4X4 with_cursor;
+            animation.Interpolate(t, with_cursor, cursor);
+            XMFLOAT4X4 expected = linear_scan_interpolate(animation, t);
+            EXPECT_LE(MaxDifference(&expected, &with_cursor, 1), 1e-5f) << "t = " << t;
+        }
+    }
+}
+TEST_P(FindKeyframe, ClampsAtTheEnds) {
+    BoneAnimation animation = make_bone_animation(GetParam(), GetParam() + 2);
+    UINT last_segment = (UINT)animation.Keyframes.size() - 2;
+    UINT cursor = last_segment;
+    EXPECT_EQ(0u, animation.FindKeyframe(animation.GetStartTime(), cursor));
+    EXPECT_EQ(0u, animation.FindKeyframe(animation.GetStartTime() - 1.0f, cursor));
+    EXPECT_EQ(last_segment, animation.FindKeyframe(animation.GetEndTime(), cursor));
+    EXPECT_EQ(last_segment, animation.FindKeyframe(animation.GetEndTime() + 1.0f, cursor));
+
+    // -- t <= first and t >= last hold the first and last key exactly
+    XMFLOAT4X4 m;
+    animation.Interpolate(animation.GetStartTime() - 1.0f, m, cursor);
+    XMFLOAT4X4 first = linear_scan_interpolate(animation, animation.GetStartTime());
+    EXPECT_EQ(0.0f, MaxDifference(&first, &m, 1));
+    animation.Interpolate(animation.GetEndTime() + 1.0f, m, cursor);
+    XMFLOAT4X4 last = linear_scan_interpolate(animation, animation.GetEndTime());
+    EXPECT_EQ(0.0f, MaxDifference(&last, &m, 1));
+}
+INSTANTIATE_TEST_SUITE_P(KeyCounts, FindKeyframe, testing::Values(2u, 3u, 10u, 100u, 1000u));
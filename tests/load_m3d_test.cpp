@@ -0,0 +1,523 @@
+#include "test_util.h"
+#include "m3d_binary.h"
+#include "job_system.h"
+
+#include <cstring>
+#include <fstream>
+#include <functional>
+
+using namespace DirectX;
+
+TEST(LoadM3D, Soldier) {
+    SoldierModel & soldier = Soldier();
+    ASSERT_TRUE(soldier.Loaded);
+    EXPECT_EQ(13748u, soldier.Vertices.size());
+    EXPECT_EQ(58u, soldier.SkinnedInfo.BoneCount());
+    EXPECT_EQ(1u, soldier.SkinnedInfo.ClipCount());
+    EXPECT_NE(SkinnedData::InvalidClip, soldier.SkinnedInfo.FindClip("Take1"));
+    EXPECT_EQ(SkinnedData::InvalidClip, soldier.SkinnedInfo.FindClip("Walk"));
+}
+TEST(LoadM3D, MissingFile) {
+    M3DLoader loader;
+    std::vector<M3DLoader::SkinnedVertex> vertices;
+    std::vector<BYTE> indices;
+    std::vector<M3DLoader::Subset> subsets;
+    std::vector<M3DLoader::M3DMaterial> materials;
+    SkinnedData skinned_info;
+    EXPECT_FALSE(loader.LoadM3D(ModelPath("missing.m3d"), vertices, indices, subsets, materials, skinned_info));
+    ASSERT_EQ(1u, loader.Diagnostics.size());
+}
+TEST(LoadM3D, ClipNameAndHandleSampleTheSamePose) {
+    SoldierModel & soldier = Soldier();
+    ASSERT_TRUE(soldier.Loaded);
+    SkinnedData const & skinned_info = soldier.SkinnedInfo;
+    UINT num_bones = skinned_info.BoneCount();
+    SkinnedData::ClipHandle clip = skinned_info.FindClip("Take1");
+
+    PoseWorkspace workspace;
+    workspace.Resize(num_bones);
+    std::vector<XMFLOAT4X4> by_name(num_bones);
+    std::vector<XMFLOAT4X4> by_handle(num_bones);
+    for (float t = skinned_info.GetClipStartTime(clip); t < skinned_info.GetClipEndTime(clip); t += 0.1f) {
+        skinned_info.GetFinalTransforms("Take1", t, by_name);
+        skinned_info.GetFinalTransforms(clip, t, by_handle.data(), workspace);
+        ASSERT_EQ(num_bones, by_name.size());
+        EXPECT_EQ(0.0f, MaxDifference(by_name.data(), by_handle.data(), num_bones)) << "t = " << t;
+        for (XMFLOAT4X4 const & m : by_handle)
+            for (int i = 0; i < 16; ++i)
+                ASSERT_TRUE(std::isfinite(m.m[i / 4][i % 4]));
+    }
+}
+
+//
+// -- soldier.m3d converted to the binary format, loaded from it and compared with the text load
+static std::string const & soldier_binary () {
+    static std::string const filename = [] {
+        std::string name = testing::TempDir() + "soldier.m3db";
+        M3DLoader loader;
+        EXPECT_TRUE(loader.ConvertToBinary(ModelPath("soldier.m3d"), name));
+        return name;
+    }();
+    return filename;
+}
+static std::vector<char> read_file (std::string const & filename) {
+    std::ifstream file(filename, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+static void write_file (std::string const & filename, char const * data, size_t size) {
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    file.write(data, (std::streamsize)size);
+}
+
+TEST(LoadM3DBinary, RoundTrip) {
+    SoldierModel & soldier = Soldier();
+    ASSERT_TRUE(soldier.Loaded);
+    M3DBinaryFile file;
+    ASSERT_TRUE(file.Open(soldier_binary()));
+    M3DLoader loader;
+    std::vector<M3DLoader::Subset> subsets;
+    std::vector<M3DLoader::M3DMaterial> materials;
+    SkinnedData skinned_info;
+    ASSERT_TRUE(loader.LoadM3D(file, subsets, materials, skinned_info));
+    EXPECT_TRUE(loader.Diagnostics.empty());
+
+    // -- vertices and indices in place, byte for byte what the text loader returns
+    ASSERT_TRUE(file.IsSkinned());
+    ASSERT_EQ(soldier.Vertices.size(), file.VertexCount());
+    EXPECT_EQ(0, memcmp(soldier.Vertices.data(), file.SkinnedVertices(), file.VertexByteSize()));
+    ASSERT_EQ(soldier.Indices.size(), file.IndexByteSize());
+    EXPECT_EQ(0, memcmp(soldier.Indices.data(), file.Indices(), file.IndexByteSize()));
+
+    ASSERT_EQ(soldier.Subsets.size(), subsets.size());
+    for (size_t i = 0; i < subsets.size(); ++i) {
+        M3DLoader::Subset const & expected = soldier.Subsets[i];
+        EXPECT_EQ(expected.Id, subsets[i].Id) << "subset " << i;
+        EXPECT_EQ(expected.VertexStart, subsets[i].VertexStart) << "subset " << i;
+        EXPECT_EQ(expected.VertexCount, subsets[i].VertexCount) << "subset " << i;
+        EXPECT_EQ(expected.FaceStart, subsets[i].FaceStart) << "subset " << i;
+        EXPECT_EQ(expected.FaceCount, subsets[i].FaceCount) << "subset " << i;
+        EXPECT_EQ(expected.IndexSize, subsets[i].IndexSize) << "subset " << i;
+        EXPECT_EQ(expected.IndexByteOffset, subsets[i].IndexByteOffset) << "subset " << i;
+        EXPECT_EQ(expected.BaseVertex, subsets[i].BaseVertex) << "subset " << i;
+    }
+    ASSERT_EQ(soldier.Materials.size(), materials.size());
+    for (size_t i = 0; i < materials.size(); ++i) {
+        M3DLoader::M3DMaterial const & expected = soldier.Materials[i];
+        EXPECT_EQ(expected.Name, materials[i].Name);
+        EXPECT_EQ(0, memcmp(&expected.DiffuseAlbedo, &materials[i].DiffuseAlbedo, sizeof(XMFLOAT4))) << expected.Name;
+        EXPECT_EQ(0, memcmp(&expected.FresnelR0, &materials[i].FresnelR0, sizeof(XMFLOAT3))) << expected.Name;
+        EXPECT_EQ(expected.Roughness, materials[i].Roughness) << expected.Name;
+        EXPECT_EQ(expected.AlphaClip, materials[i].AlphaClip) << expected.Name;
+        EXPECT_EQ(expected.MaterialTypeName, materials[i].MaterialTypeName);
+        EXPECT_EQ(expected.DiffuseMapName, materials[i].DiffuseMapName);
+        EXPECT_EQ(expected.NormalMapName, materials[i].NormalMapName);
+    }
+
+    // -- the binary file keeps the source keyframes, so the poses are identical
+    UINT num_bones = soldier.SkinnedInfo.BoneCount();
+    ASSERT_EQ(num_bones, skinned_info.BoneCount());
+    ASSERT_EQ(soldier.SkinnedInfo.ClipCount(), skinned_info.ClipCount());
+    SkinnedData::ClipHandle text_clip = soldier.SkinnedInfo.FindClip("Take1");
+    SkinnedData::ClipHandle binary_clip = skinned_info.FindClip("Take1");
+    ASSERT_NE(SkinnedData::InvalidClip, binary_clip);
+    EXPECT_EQ(soldier.SkinnedInfo.GetClipEndTime(text_clip), skinned_info.GetClipEndTime(binary_clip));
+
+    PoseWorkspace workspace;
+    workspace.Resize(num_bones);
+    std::vector<XMFLOAT4X4> from_text(num_bones), from_binary(num_bones);
+    float end_time = skinned_info.GetClipEndTime(binary_clip);
+    for (float t : {0.0f, 0.37f * end_time, 0.5f * end_time, 0.91f * end_time, end_time}) {
+        soldier.SkinnedInfo.GetFinalTransforms(text_clip, t, from_text.data(), workspace);
+        skinned_info.GetFinalTransforms(binary_clip, t, from_binary.data(), workspace);
+        EXPECT_EQ(0.0f, MaxDifference(from_text.data(), from_binary.data(), num_bones)) << "t = " << t;
+    }
+}
+TEST(LoadM3DBinary, TruncatedFiles) {
+    std::vector<char> bytes = read_file(soldier_binary());
+    ASSERT_GT(bytes.size(), sizeof(M3DBinaryHeader));
+    M3DBinaryHeader header;
+    memcpy(&header, bytes.data(), sizeof(header));
+
+    // -- inside the header, at every section start and one byte short of the end
+    std::vector<size_t> sizes = {1, 4, 8, sizeof(M3DBinaryHeader) / 2, sizeof(M3DBinaryHeader) - 1, sizeof(M3DBinaryHeader)};
+    for (M3DSectionEntry const & entry : header.Sections) {
+        if (entry.ByteSize > 0)
+            sizes.push_back((size_t)entry.Offset + (size_t)entry.ByteSize - 1);
+    }
+    sizes.push_back(bytes.size() - 1);
+
+    std::string const filename = testing::TempDir() + "truncated.m3db";
+    M3DBinaryFile file;
+    for (size_t size : sizes) {
+        write_file(filename, bytes.data(), size);
+        EXPECT_FALSE(file.Open(filename)) << size << " of " << bytes.size() << " bytes";
+        EXPECT_FALSE(file.IsOpen());
+    }
+    remove(filename.c_str());
+}
+TEST(LoadM3DBinary, CorruptedHeaders) {
+    std::vector<char> const bytes = read_file(soldier_binary());
+    ASSERT_GT(bytes.size(), sizeof(M3DBinaryHeader));
+    M3DBinaryHeader source;
+    memcpy(&source, bytes.data(), sizeof(source));
+    uint64_t const file_size = bytes.size();
+
+    std::vector<std::pair<std::string, std::function<void (M3DBinaryHeader &)>>> corruptions = {
+        {"magic", [] (M3DBinaryHeader & h) { h.Magic[3] = 'X'; }},
+        {"version", [] (M3DBinaryHeader & h) { h.Version = M3DBinaryHeader::CurrentVersion + 1; }},
+        {"vertex stride", [] (M3DBinaryHeader & h) { h.VertexStride += 4; }},
+        {"material count", [] (M3DBinaryHeader & h) { h.NumMaterials += 1; }},
+        {"vertex count", [] (M3DBinaryHeader & h) { h.NumVertices = 0xffffffffu; }},
+        {"bone count", [] (M3DBinaryHeader & h) { h.NumBones -= 1; }},
+        {"clip count", [] (M3DBinaryHeader & h) { h.NumAnimationClips = 0x10000000u; }},
+    };
+    for (UINT s = 0; s < (UINT)M3DSection::Count; ++s) {
+        std::string section = "section " + std::to_string(s);
+        corruptions.push_back({section + " misaligned", [s] (M3DBinaryHeader & h) { h.Sections[s].Offset += 4; }});
+        corruptions.push_back({section + " past the end", [s, file_size] (M3DBinaryHeader & h) {
+            h.Sections[s].Offset = (file_size + 15) / 16 * 16;
+        }});
+        corruptions.push_back({section + " offset wraps", [s] (M3DBinaryHeader & h) { h.Sections[s].Offset = ~15ull; }});
+        corruptions.push_back({section + " too large", [s, file_size] (M3DBinaryHeader & h) {
+            h.Sections[s].ByteSize = file_size;
+        }});
+        corruptions.push_back({section + " size wraps", [s] (M3DBinaryHeader & h) { h.Sections[s].ByteSize = ~0ull; }});
+    }
+
+    std::string const filename = testing::TempDir() + "corrupted.m3db";
+    M3DBinaryFile file;
+    for (auto const & corruption : corruptions) {
+        std::vector<char> corrupted = bytes;
+        M3DBinaryHeader header = source;
+        corruption.second(header);
+        memcpy(corrupted.data(), &header, sizeof(header));
+        write_file(filename, corrupted.data(), corrupted.size());
+        EXPECT_FALSE(file.Open(filename)) << corruption.first;
+        EXPECT_FALSE(file.IsOpen()) << corruption.first;
+    }
+
+    // -- and the uncorrupted copy still opens
+    write_file(filename, bytes.data(), bytes.size());
+    EXPECT_TRUE(file.Open(filename));
+    remove(filename.c_str());
+}
+TEST(LoadM3DBinary, CorruptedSectionContents) {
+    // -- keyframe ranges and string offsets are checked by Open, before any accessor follows them
+    std::vector<char> const bytes = read_file(soldier_binary());
+    M3DBinaryHeader header;
+    memcpy(&header, bytes.data(), sizeof(header));
+    ASSERT_GT(header.NumMaterials, 0u);
+    ASSERT_GT(header.NumAnimationClips, 0u);
+    M3DSectionEntry const & strings = header.Sections[(UINT)M3DSection::Strings];
+    M3DSectionEntry const & materials = header.Sections[(UINT)M3DSection::Materials];
+    M3DSectionEntry const & clips = header.Sections[(UINT)M3DSection::Clips];
+    M3DSectionEntry const & keyframe_starts = header.Sections[(UINT)M3DSection::KeyframeStarts];
+    UINT num_tracks = header.NumAnimationClips * header.NumBones;
+
+    std::vector<std::pair<std::string, std::function<void (std::vector<char> &)>>> corruptions = {
+        {"first keyframe start", [&] (std::vector<char> & b) {
+            reinterpret_cast<UINT *>(b.data() + keyframe_starts.Offset)[0] = 1;
+        }},
+        {"keyframe starts out of order", [&] (std::vector<char> & b) {
+            reinterpret_cast<UINT *>(b.data() + keyframe_starts.Offset)[1] = 0xffffffffu;
+        }},
+        {"last keyframe start", [&] (std::vector<char> & b) {
+            reinterpret_cast<UINT *>(b.data() + keyframe_starts.Offset)[num_tracks] += 1;
+        }},
+        {"unterminated strings", [&] (std::vector<char> & b) {
+            b[(size_t)(strings.Offset + strings.ByteSize - 1)] = 'x';
+        }},
+        {"material name", [&] (std::vector<char> & b) {
+            reinterpret_cast<M3DBinaryMaterial *>(b.data() + materials.Offset)[0].Name = (UINT)strings.ByteSize;
+        }},
+        {"normal map name", [&] (std::vector<char> & b) {
+            reinterpret_cast<M3DBinaryMaterial *>(b.data() + materials.Offset)[0].NormalMapName = 0xffffffffu;
+        }},
+        {"clip name", [&] (std::vector<char> & b) {
+            reinterpret_cast<M3DBinaryClip *>(b.data() + clips.Offset)[0].Name = (UINT)strings.ByteSize;
+        }},
+    };
+
+    std::string const filename = testing::TempDir() + "corrupted.m3db";
+    M3DBinaryFile file;
+    for (auto const & corruption : corruptions) {
+        std::vector<char> corrupted = bytes;
+        corruption.second(corrupted);
+        write_file(filename, corrupted.data(), corrupted.size());
+        EXPECT_FALSE(file.Open(filename)) << corruption.first;
+        EXPECT_FALSE(file.IsOpen()) << corruption.first;
+    }
+    remove(filename.c_str());
+}
+
+//
+// -- hand-written skinned model: one material, four vertices, two triangles, a chain of three bones and one clip.
+// -- Tests break single lines of it and expect the diagnostic to name the section, the line and the problem
+class MalformedM3D : public testing::Test {
+protected:
+    void SetUp () override {
+        add("***************m3d-File-Header***************");
+        add("#Materials 1");
+        add("#Vertices 4");
+        add("#Triangles 2");
+        add("#Bones 3");
+        add("#AnimationClips 1");
+        add("");
+        add("***************Materials*********************");
+        add("Name: body");
+        add("Diffuse: 1 1 1");
+        add("Fresnel0: 0.05 0.05 0.05");
+        add("Roughness: 0.5");
+        add("AlphaClip: 0");
+        add("MaterialTypeName: Skinned");
+        add("DiffuseMap: body_diff.dds");
+        add("NormalMap: body_norm.dds");
+        add("");
+        add("***************SubsetTable*******************");
+        add("SubsetID: 0 VertexStart: 0 VertexCount: 4 FaceStart: 0 FaceCount: 2");
+        add("");
+        add("***************Vertices**********************");
+        for (UINT i = 0; i < 4; ++i) {
+            vertex_lines_.push_back(add("Position: " + std::to_string(i) + " 0 0"));
+            add("Tangent: 1 0 0 1");
+            add("Normal: 0 0 -1");
+            add("Tex-Coords: 0 0");
+            add("BlendWeights: 0.75 0.25 0 0");
+            add("BlendIndices: " + std::to_string(i % 3) + " 0 0 0");
+            add("");
+        }
+        add("***************Triangles*********************");
+        triangle_lines_.push_back(add("0 1 2"));
+        triangle_lines_.push_back(add("0 2 3"));
+        add("");
+        add("***************BoneOffsets*******************");
+        for (UINT i = 0; i < 3; ++i)
+            add("BoneOffset" + std::to_string(i) + " 1 0 0 0 0 1 0 0 0 0 1 0 0 0 0 1");
+        add("");
+        add("***************BoneHierarchy*****************");
+        for (UINT i = 0; i < 3; ++i)
+            parent_lines_.push_back(add("ParentIndexOfBone" + std::to_string(i) + ": " + std::to_string((int)i - 1)));
+        add("");
+        add("***************AnimationClips****************");
+        clip_line_ = add("AnimationClip Idle");
+        add("{");
+        for (UINT i = 0; i < 3; ++i) {
+            add("\tBone" + std::to_string(i) + " #Keyframes: 2");
+            add("\t{");
+            add("\t\tTime: 0 Pos: 0 1 0 Scale: 1 1 1 Quat: 0 0 0 1");
+            add("\t\tTime: 1 Pos: 0 1 0 Scale: 1 1 1 Quat: 0 0 0 1");
+            add("\t}");
+        }
+        add("}");
+    }
+    // -- appends a line, returns its 1-based number
+    UINT add (std::string const & line) {
+        lines_.push_back(line);
+        return (UINT)lines_.size();
+    }
+    void replace (UINT line, std::string const & text) {
+        lines_[line - 1] = text;
+    }
+    // -- diagnostics of loading the text serially, loading it on threads has to report the same
+    std::vector<M3DLoader::Diagnostic> load () {
+        std::string text;
+        for (std::string const & line : lines_)
+            text += line + "\n";
+        std::string const filename = testing::TempDir() + "malformed.m3d";
+        write_file(filename, text.data(), text.size());
+
+        static JobSystem jobs(3);
+        std::vector<M3DLoader::Diagnostic> diagnostics[2];
+        for (int parallel = 0; parallel < 2; ++parallel) {
+            M3DLoader loader;
+            loader.Jobs = parallel ? &jobs : nullptr;
+            std::vector<M3DLoader::SkinnedVertex> vertices;
+            std::vector<BYTE> indices;
+            std::vector<M3DLoader::Subset> subsets;
+            std::vector<M3DLoader::M3DMaterial> materials;
+            SkinnedData skinned_info;
+            bool loaded = loader.LoadM3D(filename, vertices, indices, subsets, materials, skinned_info);
+            EXPECT_EQ(loaded, loader.Diagnostics.empty());
+            diagnostics[parallel] = loader.Diagnostics;
+        }
+        remove(filename.c_str());
+
+        EXPECT_EQ(diagnostics[0].size(), diagnostics[1].size());
+        for (size_t i = 0; i < diagnostics[0].size() && i < diagnostics[1].size(); ++i) {
+            EXPECT_EQ(diagnostics[0][i].Section, diagnostics[1][i].Section) << "diagnostic " << i;
+            EXPECT_EQ(diagnostics[0][i].Line, diagnostics[1][i].Line) << "diagnostic " << i;
+            EXPECT_EQ(diagnostics[0][i].Reason, diagnostics[1][i].Reason) << "diagnostic " << i;
+        }
+        return diagnostics[0];
+    }
+    static void expect_diagnostic (
+        M3DLoader::Diagnostic const & diagnostic, M3DLoader::FileSection section, UINT line, std::string const & reason
+    ) {
+        EXPECT_EQ(M3DLoader::SectionName(section), std::string(M3DLoader::SectionName(diagnostic.Section))) << reason;
+        EXPECT_EQ(line, diagnostic.Line) << reason;
+        EXPECT_EQ(reason, diagnostic.Reason);
+    }
+
+    std::vector<std::string> lines_;
+    std::vector<UINT> vertex_lines_;
+    std::vector<UINT> triangle_lines_;
+    std::vector<UINT> parent_lines_;
+    UINT clip_line_ = 0;
+};
+
+TEST_F(MalformedM3D, WellFormedLoads) {
+    EXPECT_TRUE(load().empty());
+}
+TEST_F(MalformedM3D, BoneIndexOutOfRange) {
+    replace(vertex_lines_[2] + 5, "BlendIndices: 2 3 0 0");
+    // -- negative indices do not wrap around to a valid bone
+    replace(vertex_lines_[3] + 5, "BlendIndices: 0 -1 0 0");
+    std::vector<M3DLoader::Diagnostic> diagnostics = load();
+    ASSERT_EQ(2u, diagnostics.size());
+    expect_diagnostic(diagnostics[0], M3DLoader::FileSection::Vertices, vertex_lines_[2], "vertex 2 uses bone 3 of 3");
+    expect_diagnostic(diagnostics[1], M3DLoader::FileSection::Vertices, vertex_lines_[3], "vertex 3 uses bone 255 of 3");
+}
+TEST_F(MalformedM3D, BadWeightSums) {
+    replace(vertex_lines_[0] + 4, "BlendWeights: 0.5 0.25 0.5 0");
+    replace(vertex_lines_[3] + 4, "BlendWeights: 1.25 -0.25 0 0");
+    std::vector<M3DLoader::Diagnostic> diagnostics = load();
+    ASSERT_EQ(2u, diagnostics.size());
+    expect_diagnostic(diagnostics[0], M3DLoader::FileSection::Vertices, vertex_lines_[0],
+        "vertex 0 has weights 0.500000 0.250000 0.500000 that do not sum to 1 with a non-negative fourth weight");
+    expect_diagnostic(diagnostics[1], M3DLoader::FileSection::Vertices, vertex_lines_[3],
+        "vertex 3 has weights 1.250000 -0.250000 0.000000 that do not sum to 1 with a non-negative fourth weight");
+}
+TEST_F(MalformedM3D, ParentDoesNotPrecedeChild) {
+    replace(parent_lines_[1], "ParentIndexOfBone1: 1");
+    replace(parent_lines_[2], "ParentIndexOfBone2: 5");
+    std::vector<M3DLoader::Diagnostic> diagnostics = load();
+    ASSERT_EQ(2u, diagnostics.size());
+    expect_diagnostic(diagnostics[0], M3DLoader::FileSection::BoneHierarchy, parent_lines_[1],
+        "parent 1 of bone 1 does not precede it");
+    expect_diagnostic(diagnostics[1], M3DLoader::FileSection::BoneHierarchy, parent_lines_[2],
+        "parent 5 of bone 2 does not precede it");
+}
+TEST_F(MalformedM3D, LinesPointIntoTheirSections) {
+    // -- one problem per validated section, reported in validation order
+    replace(triangle_lines_[1], "0 2 7");
+    replace(vertex_lines_[1] + 5, "BlendIndices: 4 0 0 0");
+    replace(parent_lines_[0], "ParentIndexOfBone0: 0");
+    // -- second key of bone 1: the clip line, "{", five lines for bone 0, the bone line, "{" and the first key
+    replace(clip_line_ + 10, "\t\tTime: -1 Pos: 0 1 0 Scale: 1 1 1 Quat: 0 0 0 1");
+    std::vector<M3DLoader::Diagnostic> diagnostics = load();
+    ASSERT_EQ(4u, diagnostics.size());
+    expect_diagnostic(diagnostics[0], M3DLoader::FileSection::Triangles, triangle_lines_[1], "triangle 1 uses vertex 7 of 4");
+    expect_diagnostic(diagnostics[1], M3DLoader::FileSection::Vertices, vertex_lines_[1], "vertex 1 uses bone 4 of 3");
+    expect_diagnostic(diagnostics[2], M3DLoader::FileSection::BoneHierarchy, parent_lines_[0],
+        "parent 0 of bone 0 does not precede it");
+    expect_diagnostic(diagnostics[3], M3DLoader::FileSection::AnimationClips, clip_line_,
+        "clip Idle: keyframe 1 of bone 1 is out of time order");
+}
+TEST_F(MalformedM3D, ParseErrorsStopAtTheToken) {
+    UINT const roughness_line = 12;
+    ASSERT_EQ("Roughness: 0.5", lines_[roughness_line - 1]);
+    replace(roughness_line, "Roughness: rough");
+    std::vector<M3DLoader::Diagnostic> diagnostics = load();
+    ASSERT_EQ(1u, diagnostics.size());
+    expect_diagnostic(diagnostics[0], M3DLoader::FileSection::Materials, roughness_line, "cannot read \"rough\"");
+
+    replace(roughness_line, "Roughness: 0.5");
+    replace(triangle_lines_[0], "0 1 x2");
+    diagnostics = load();
+    ASSERT_EQ(1u, diagnostics.size());
+    expect_diagnostic(diagnostics[0], M3DLoader::FileSection::Triangles, triangle_lines_[0], "cannot read \"x2\"");
+}
+
+//
+// -- unskinned text model with subsets whose vertex spans need 16-bit and 32-bit indices, loaded to check
+// -- the index layout LoadM3D returns (see M3DLoader::Subset)
+struct SyntheticSubset {
+    UINT VertexStart;
+    UINT VertexCount;
+    std::vector<UINT> Indices;
+};
+TEST(LoadM3D, PacksIndicesPerSubset) {
+    std::vector<SyntheticSubset> const source = {
+        // -- 16-bit, 9 indices: 18 bytes, the next subset starts at the next multiple of 4
+        {0, 100, {0, 1, 2, 2, 1, 3, 99, 50, 0}},
+        // -- spans 70000 vertices: 32-bit, rebased to its lowest vertex
+        {100, 70000, {100, 70099, 5000, 70099, 100, 200}},
+        // -- uses only the upper half of its vertices: 16-bit from vertex 70150
+        {70100, 100, {70150, 70199, 70160}},
+        // -- spans exactly 65536 vertices (sharing those of the 32-bit subset): still 16-bit
+        {100, 65536, {100, 65635, 300, 300, 65635, 101, 102, 103, 104}},
+    };
+    UINT const num_vertices = 70200;
+
+    std::vector<UINT> source_indices;
+    std::string text;
+    text += "***************m3d-File-Header***************\n";
+    text += "#Materials " + std::to_string(source.size()) + "\n";
+    text += "#Vertices " + std::to_string(num_vertices) + "\n";
+    UINT num_tris = 0;
+    for (SyntheticSubset const & subset : source)
+        num_tris += (UINT)subset.Indices.size() / 3;
+    text += "#Triangles " + std::to_string(num_tris) + "\n#Bones 0\n#AnimationClips 0\n\n";
+    text += "***************Materials*********************\n";
+    for (UINT i = 0; i < (UINT)source.size(); ++i) {
+        text += "Name: mat" + std::to_string(i) + "\nDiffuse: 1 1 1\nFresnel0: 0.05 0.05 0.05\nRoughness: 0.5\nAlphaClip: 0\n"
+            "MaterialTypeName: Default\nDiffuseMap: diff.dds\nNormalMap: norm.dds\n\n";
+    }
+    text += "***************SubsetTable*******************\n";
+    UINT face_start = 0;
+    for (UINT i = 0; i < (UINT)source.size(); ++i) {
+        UINT face_count = (UINT)source[i].Indices.size() / 3;
+        text += "SubsetID: " + std::to_string(i) + " VertexStart: " + std::to_string(source[i].VertexStart) +
+            " VertexCount: " + std::to_string(source[i].VertexCount) + " FaceStart: " + std::to_string(face_start) +
+            " FaceCount: " + std::to_string(face_count) + "\n";
+        face_start += face_count;
+        source_indices.insert(source_indices.end(), source[i].Indices.begin(), source[i].Indices.end());
+    }
+    text += "\n***************Vertices**********************\n";
+    for (UINT i = 0; i < num_vertices; ++i)
+        text += "Position: " + std::to_string(i) + " 0 0\nTangent: 1 0 0 1\nNormal: 0 0 -1\nTex-Coords: 0 0\n\n";
+    text += "***************Triangles*********************\n";
+    for (UINT i = 0; i < (UINT)source_indices.size(); i += 3) {
+        text += std::to_string(source_indices[i]) + " " + std::to_string(source_indices[i + 1]) + " " +
+            std::to_string(source_indices[i + 2]) + "\n";
+    }
+
+    std::string const filename = testing::TempDir() + "subsets.m3d";
+    write_file(filename, text.data(), text.size());
+    M3DLoader loader;
+    std::vector<M3DLoader::Vertex> vertices;
+    std::vector<BYTE> indices;
+    std::vector<M3DLoader::Subset> subsets;
+    std::vector<M3DLoader::M3DMaterial> materials;
+    bool loaded = loader.LoadM3D(filename, vertices, indices, subsets, materials);
+    remove(filename.c_str());
+    ASSERT_TRUE(loaded);
+    ASSERT_EQ(num_vertices, vertices.size());
+    ASSERT_EQ(source.size(), subsets.size());
+
+    UINT const expected_sizes [] = {sizeof(USHORT), sizeof(UINT), sizeof(USHORT), sizeof(USHORT)};
+    UINT const expected_bases [] = {0, 100, 70150, 100};
+    UINT const expected_offsets [] = {0, 20, 44, 52};
+    UINT source_index = 0;
+    for (UINT i = 0; i < (UINT)subsets.size(); ++i) {
+        M3DLoader::Subset const & subset = subsets[i];
+        EXPECT_EQ(expected_sizes[i], subset.IndexSize) << "subset " << i;
+        EXPECT_EQ(expected_bases[i], subset.BaseVertex) << "subset " << i;
+        EXPECT_EQ(expected_offsets[i], subset.IndexByteOffset) << "subset " << i;
+        ASSERT_EQ(0u, subset.IndexByteOffset % 4) << "subset " << i;
+        ASSERT_LE(subset.IndexByteOffset + subset.FaceCount * 3 * subset.IndexSize, indices.size()) << "subset " << i;
+
+        // -- as a draw call uses it: the index buffer viewed in the subset's format, StartIndexLocation and BaseVertexLocation
+        UINT start_index_location = subset.IndexByteOffset / subset.IndexSize;
+        EXPECT_EQ(subset.IndexByteOffset, start_index_location * subset.IndexSize) << "subset " << i;
+        for (UINT k = 0; k < subset.FaceCount * 3; ++k, ++source_index) {
+            UINT index = sizeof(USHORT) == subset.IndexSize ?
+                reinterpret_cast<USHORT const *>(indices.data())[start_index_location + k] :
+                reinterpret_cast<UINT const *>(indices.data())[start_index_location + k];
+            EXPECT_EQ(source_indices[source_index], subset.BaseVertex + index) << "subset " << i << ", index " << k;
+        }
+    }
+    EXPECT_EQ(source_indices.size(), source_index);
+    // -- 9 16-bit indices of the last subset end at byte 70, the data is padded to a multiple of 4
+    EXPECT_EQ(72u, indices.size());
+}
@@ -0,0 +1,230 @@
+#include "test_util.h"
+#include "m3d_text_reader.h"
+#include "job_system.h"
+
+#include <cstring>
+#include <fstream>
+#include <random>
+
+using namespace DirectX;
+
+//
+// -- floats read by M3DTextReader must have the bits strtof gives and end where strtof stops.
+// -- Text is read from a buffer of exactly its size (no terminator) so an address sanitizer build catches over-reads
+static void expect_reads_like_strtof (std::string const & text) {
+    std::vector<char> buffer(text.begin(), text.end());
+    M3DTextReader reader(buffer.data(), buffer.size());
+    float value = 0.0f;
+    reader >> value;
+
+    char * strtof_end = nullptr;
+    float expected = strtof(text.c_str(), &strtof_end);
+    if (strtof_end == text.c_str()) {
+        EXPECT_FALSE(reader) << '"' << text << '"';
+        return;
+    }
+    EXPECT_EQ(strtof_end - text.c_str(), reader.Position() - reader.Begin()) << '"' << text << '"';
+    if (std::isinf(expected)) {
+        // -- out of range fails and clamps like operator>>
+        EXPECT_FALSE(reader) << '"' << text << '"';
+        EXPECT_EQ(expected > 0.0f ? FLT_MAX : -FLT_MAX, value) << '"' << text << '"';
+        return;
+    }
+    uint32_t bits, expected_bits;
+    memcpy(&bits, &value, sizeof(bits));
+    memcpy(&expected_bits, &expected, sizeof(expected_bits));
+    EXPECT_TRUE(reader) << '"' << text << '"';
+    EXPECT_EQ(expected_bits, bits) << '"' << text << "\" read as " << value << ", strtof gives " << expected;
+}
+static std::string random_digits (std::mt19937 & rng, int max_count) {
+    std::string digits(std::uniform_int_distribution<int>(0, max_count)(rng), '0');
+    for (char & c : digits)
+        c = (char)('0' + rng() % 10);
+    return digits;
+}
+
+TEST(M3DTextReader, FloatsMatchStrtof) {
+    std::mt19937 rng(22);
+    char text[64];
+    for (UINT k = 0; k < 200000; ++k) {
+        // -- shortest round trip, fewer digits (the usual exporter output) and exact decimal expansions of random floats
+        uint32_t bits = rng();
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        if (!std::isfinite(f))
+            continue;
+        snprintf(text, sizeof(text), "%.9g", f);
+        expect_reads_like_strtof(text);
+        snprintf(text, sizeof(text), "%.*g", 1 + k % 8, f);
+        expect_reads_like_strtof(text);
+        snprintf(text, sizeof(text), "%.6f", f);
+        expect_reads_like_strtof(text);
+    }
+}
+TEST(M3DTextReader, RandomNumberSyntaxMatchesStrtof) {
+    // -- [sign] digits [. digits] [e [sign] digits]: long mantissas, leading zeros, missing parts, huge exponents
+    std::mt19937 rng(2022);
+    for (UINT k = 0; k < 200000; ++k) {
+        std::string text;
+        if (rng() % 4 == 0)
+            text += rng() % 2 ? '-' : '+';
+        if (rng() % 4 == 0)
+            text += std::string(rng() % 30, '0');
+        text += random_digits(rng, 1 + rng() % 25);
+        if (rng() % 2) {
+            text += '.';
+            text += random_digits(rng, 1 + rng() % 25);
+        }
+        if (rng() % 2) {
+            text += rng() % 2 ? 'e' : 'E';
+            if (rng() % 2)
+                text += rng() % 2 ? '-' : '+';
+            text += random_digits(rng, rng() % 4 ? 2 : 12);
+        }
+        if (rng() % 2)
+            text += rng() % 2 ? " 1" : "x";
+        expect_reads_like_strtof(text);
+    }
+}
+TEST(M3DTextReader, FloatMidpointsMatchStrtof) {
+    // -- values exactly halfway between two floats round to even, the fast path hands them to strtof
+    std::mt19937 rng(7);
+    char text[64];
+    for (UINT k = 0; k < 20000; ++k) {
+        // -- odd 25-bit integers are the midpoints between the floats of [2^24, 2^25), scaled by powers of ten
+        uint32_t midpoint = (1u << 24) | (rng() & ((1u << 24) - 1)) | 1u;
+        int exponent = (int)(rng() % 45) - 22;
+        snprintf(text, sizeof(text), "%ue%d", midpoint, exponent);
+        expect_reads_like_strtof(text);
+        snprintf(text, sizeof(text), "%u", midpoint);
+        expect_reads_like_strtof(text);
+    }
+    // -- around the smallest normal float, the largest float and past them
+    for (char const * edge : {
+        "1.17549435e-38", "1.17549421e-38", "1.4e-45", "7e-46", "3.40282347e38", "3.40282357e38", "3.4028236e38",
+        "340282356779733661637539395458142568447", "1e39", "-1e39", "0", "-0", "0e999999", "9007199254740993",
+        "0.000000000000000000000000000000000000000000001", "1e-22", "1e22", "1e23", "123456789012345678901234567890"
+    })
+        expect_reads_like_strtof(edge);
+}
+
+//
+// -- a token stream of random bytes and mixed extractions: the reader stays inside its text and always moves forward
+TEST(M3DTextReader, RandomTokenStreams) {
+    std::mt19937 rng(16);
+    char const alphabet [] = "0123456789+-.eE \t\n\r:*{}xyz";
+    for (UINT k = 0; k < 2000; ++k) {
+        std::vector<char> text(rng() % 200);
+        for (char & c : text)
+            c = rng() % 8 ? alphabet[rng() % (sizeof(alphabet) - 1)] : (char)rng();
+
+        M3DTextReader reader(text.data(), text.size());
+        char const * last = reader.Position();
+        for (UINT token = 0; reader; ++token) {
+            float f;
+            int i;
+            UINT u;
+            USHORT s;
+            bool b;
+            std::string label;
+            switch (token % 7) {
+            case 0: reader >> M3DTextReader::Label(); break;
+            case 1: reader >> f; break;
+            case 2: reader >> i; break;
+            case 3: reader >> u; break;
+            case 4: reader >> s; break;
+            case 5: reader >> b; break;
+            default: reader >> label; break;
+            }
+            ASSERT_GE(reader.Position(), reader.Begin());
+            ASSERT_LE(reader.Position(), reader.End());
+            if (reader) {
+                ASSERT_GT(reader.Position(), last);
+            }
+            last = reader.Position();
+        }
+    }
+}
+
+//
+// -- truncated and corrupted copies of soldier.m3d: loading never crashes and a failed load always says why.
+// -- Files are parsed in place from their mapping, where reads past the end go unnoticed up to the page boundary:
+// -- the reader's bounds are checked on exactly sized heap buffers above, in a D3D12_ANIM_SANITIZE build
+class M3DFuzz : public testing::Test {
+protected:
+    static std::string const & soldier_text () {
+        static std::string const text = [] {
+            std::ifstream file(ModelPath("soldier.m3d"), std::ios::binary);
+            return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }();
+        return text;
+    }
+    // -- loads text serially and on threads, true if both loads succeeded
+    static bool load (std::string const & text, std::string const & what) {
+        std::string const filename = testing::TempDir() + "fuzz.m3d";
+        {
+            std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+            file.write(text.data(), (std::streamsize)text.size());
+        }
+        static JobSystem jobs(3);
+        bool loaded[2] = {};
+        for (int parallel = 0; parallel < 2; ++parallel) {
+            M3DLoader loader;
+            loader.Jobs = parallel ? &jobs : nullptr;
+            std::vector<M3DLoader::SkinnedVertex> vertices;
+            std::vector<BYTE> indices;
+            std::vector<M3DLoader::Subset> subsets;
+            std::vector<M3DLoader::M3DMaterial> materials;
+            SkinnedData skinned_info;
+            loaded[parallel] = loader.LoadM3D(filename, vertices, indices, subsets, materials, skinned_info);
+            EXPECT_NE(loaded[parallel], !loader.Diagnostics.empty()) << what << (parallel ? ", on threads" : "");
+            EXPECT_LE(loader.Diagnostics.size(), (size_t)loader.MaxDiagnostics) << what;
+        }
+        EXPECT_EQ(loaded[0], loaded[1]) << what;
+        remove(filename.c_str());
+        return loaded[0] && loaded[1];
+    }
+};
+
+TEST_F(M3DFuzz, TruncatedFiles) {
+    std::string const & text = soldier_text();
+    ASSERT_FALSE(text.empty());
+    size_t last_token_end = text.find_last_not_of(" \t\n\r\v\f") + 1;
+
+    std::mt19937 rng(3);
+    std::vector<size_t> sizes = {0, 1, 16, last_token_end - 1, last_token_end};
+    for (UINT k = 0; k < 24; ++k)
+        sizes.push_back(rng() % last_token_end);
+    for (size_t size : sizes) {
+        // -- anything short of the closing brace of the last clip is incomplete
+        bool loaded = load(text.substr(0, size), "truncated to " + std::to_string(size) + " bytes");
+        EXPECT_EQ(size == last_token_end, loaded) << "truncated to " << size << " bytes";
+    }
+}
+TEST_F(M3DFuzz, CorruptedFiles) {
+    std::string const & text = soldier_text();
+    ASSERT_FALSE(text.empty());
+
+    // -- mostly bytes that keep the text tokenizable, so the damage gets past the first token it hits
+    char const alphabet [] = "0123456789-+.eE \n*{}";
+    std::mt19937 rng(5);
+    for (UINT k = 0; k < 48; ++k) {
+        std::string corrupted = text;
+        // -- damage within the header and material block, anywhere else, or in one spot of the animation data
+        size_t region = k % 3 == 0 ? 2048 : corrupted.size();
+        UINT num_bytes = 1 + rng() % 16;
+        size_t at = rng() % region;
+        for (UINT b = 0; b < num_bytes; ++b) {
+            size_t p = k % 3 == 2 ? (at + b) % corrupted.size() : rng() % region;
+            corrupted[p] = rng() % 4 ? alphabet[rng() % (sizeof(alphabet) - 1)] : (char)rng();
+        }
+        // -- and sometimes a removed or repeated span
+        size_t span_at = rng() % corrupted.size();
+        size_t span_size = rng() % 64;
+        if (k % 4 == 1)
+            corrupted.erase(span_at, span_size);
+        else if (k % 4 == 3)
+            corrupted.insert(span_at, corrupted, span_at, span_size);
+        load(corrupted, "corruption " + std::to_string(k));
+    }
+}
@@ -0,0 +1,84 @@
+#include "test_util.h"
+
+using namespace DirectX;
+
+//
+// -- one bone moving along x at unit speed from t = 0 to t = end_time (x = t), keys at the given times
+static AnimationClip make_linear_clip (std::vector<float> const & key_times) {
+    AnimationClip clip;
+    clip.BoneAnimations.resize(1);
+    for (float t : key_times) {
+        Keyframe key;
+        key.TimePoint = t;
+        key.Translation = XMFLOAT3(t, 0.0f, 0.0f);
+        clip.BoneAnimations[0].Keyframes.push_back(key);
+    }
+    return clip;
+}
+
+TEST(Resample, LastFrameLandsOnTheClipEnd) {
+    // -- 1.05 s is not a whole number of frames at 30 keys per second
+    AnimationClip clip = make_linear_clip({0.0f, 0.25f, 1.05f});
+    ResampleError error = clip.Resample(30.0f);
+
+    std::vector<Keyframe> const & keys = clip.BoneAnimations[0].Keyframes;
+    ASSERT_EQ(33u, keys.size());
+    EXPECT_GE(clip.SampleRate, 30.0f);
+    EXPECT_NEAR(1.05f, (keys.size() - 1) / clip.SampleRate, 1e-6f);
+    EXPECT_EQ(0.0f, keys.front().TimePoint);
+    EXPECT_EQ(1.05f, keys.back().TimePoint);
+    for (UINT f = 0; f < keys.size(); ++f) {
+        EXPECT_NEAR(f / clip.SampleRate, keys[f].TimePoint, 1e-6f);
+        EXPECT_NEAR(keys[f].TimePoint, keys[f].Translation.x, 1e-5f);
+    }
+    EXPECT_LE(error.MaxTranslation, 1e-5f);
+}
+TEST(Resample, UniformIndexingMatchesTheSourceUpToTheEnd) {
+    AnimationClip source = make_linear_clip({0.1f, 0.6f, 1.07f});
+    AnimationClip resampled = source;
+    resampled.Resample(24.0f);
+
+    PackedAnimationClip packed;
+    packed.Build(resampled);
+    ASSERT_GT(packed.GetSampleRate(), 0.0f);
+
+    std::vector<XMFLOAT4X4> transforms(1);
+    std::vector<UINT> cursors(1, 0);
+    for (float t = 0.0f; t <= 1.2f; t += 0.01f) {
+        packed.Interpolate(t, transforms, cursors);
+        float expected = MathHelper::Clamp(t, 0.1f, 1.07f);
+        EXPECT_NEAR(expected, transforms[0]._41, 1e-5f) << "t = " << t;
+    }
+    packed.Interpolate(1.07f, transforms, cursors);
+    EXPECT_NEAR(1.07f, transforms[0]._41, 1e-6f);
+}
+TEST(Resample, ClipWithoutBones) {
+    AnimationClip clip;
+    clip.SampleRate = 30.0f;
+    PackedAnimationClip packed;
+    packed.Build(clip);
+
+    std::vector<XMFLOAT4X4> transforms;
+    std::vector<UINT> cursors;
+    packed.Interpolate(0.5f, transforms, cursors);
+    EXPECT_EQ(0u, packed.BoneCount());
+}
+TEST(Resample, ReportsOfEveryLoadStartEmpty) {
+    M3DLoader loader;
+    loader.AnimationSampleRate = 30.0f;
+    loader.KeyframeReductionTolerance = 1e-3f;
+
+    std::vector<M3DLoader::SkinnedVertex> vertices;
+    std::vector<BYTE> indices;
+    std::vector<M3DLoader::Subset> subsets;
+    std::vector<M3DLoader::M3DMaterial> materials;
+    SkinnedData skinned_info;
+    for (int load = 0; load < 2; ++load) {
+        ASSERT_TRUE(loader.LoadM3D(ModelPath("soldier.m3d"), vertices, indices, subsets, materials, skinned_info));
+        EXPECT_EQ(1u, loader.ResampleReports.size());
+        EXPECT_EQ("Take1", loader.ResampleReports[0].ClipName);
+    }
+    EXPECT_FALSE(loader.LoadM3D(ModelPath("missing.m3d"), vertices, indices, subsets, materials, skinned_info));
+    EXPECT_TRUE(loader.ResampleReports.empty());
+    EXPECT_EQ(0u, loader.NumReducedKeyframes);
+}
@@ -0,0 +1,140 @@
+#include "test_util.h"
+
+using namespace DirectX;
+
+//
+// -- root bone walking 2 units per second in +z at hip height 1 while turning 90 degrees about +y over the 2 s clip,
+// -- a child bone swinging under it. Keys every 0.25 s
+float const WalkDuration = 2.0f;
+float const WalkSpeed = 2.0f;
+float const WalkTurn = 0.5f * XM_PI;
+
+static float walk_yaw (float t) {
+    return WalkTurn * t / WalkDuration;
+}
+static AnimationClip make_walk () {
+    AnimationClip clip;
+    clip.BoneAnimations.resize(2);
+    for (UINT k = 0; k <= 8; ++k) {
+        Keyframe root, child;
+        root.TimePoint = child.TimePoint = 0.25f * k;
+        root.Translation = XMFLOAT3(0.0f, 1.0f, WalkSpeed * root.TimePoint);
+        XMStoreFloat4(&root.RotationQuat, XMQuaternionRotationRollPitchYaw(0.0f, walk_yaw(root.TimePoint), 0.0f));
+        child.Translation = XMFLOAT3(0.0f, -0.5f, 0.0f);
+        XMStoreFloat4(&child.RotationQuat, XMQuaternionRotationRollPitchYaw(0.4f * sinf(3.0f * child.TimePoint), 0.0f, 0.0f));
+        clip.BoneAnimations[0].Keyframes.push_back(root);
+        clip.BoneAnimations[1].Keyframes.push_back(child);
+    }
+    return clip;
+}
+static float matrix_difference (FXMMATRIX a, CXMMATRIX b) {
+    XMFLOAT4X4 fa, fb;
+    XMStoreFloat4x4(&fa, a);
+    XMStoreFloat4x4(&fb, b);
+    return MaxDifference(&fa, &fb, 1);
+}
+
+class RootMotionTest : public testing::Test {
+protected:
+    void SetUp () override {
+        std::vector<int> hierarchy = {-1, 0};
+        std::vector<XMFLOAT4X4> offsets(2);
+        XMStoreFloat4x4(&offsets[0], XMMatrixIdentity());
+        offsets[1] = offsets[0];
+        std::unordered_map<std::string, AnimationClip> clips;
+        clips["Walk"] = make_walk();
+        clips["Walk"].ExtractRootMotion(hierarchy);
+        walk_ = clips["Walk"];
+        skinned_info_.Set(hierarchy, offsets, clips);
+        clip_ = skinned_info_.FindClip("Walk");
+    }
+
+    AnimationClip walk_;
+    SkinnedData skinned_info_;
+    SkinnedData::ClipHandle clip_ = SkinnedData::InvalidClip;
+};
+
+TEST_F(RootMotionTest, ExtractedRootStaysInPlace) {
+    AnimationClip source = make_walk();
+    ASSERT_EQ(source.BoneAnimations[0].Keyframes.size(), walk_.RootMotionTrack.size());
+    for (UINT k = 0; k < walk_.RootMotionTrack.size(); ++k) {
+        float t = walk_.RootMotionTrack[k].TimePoint;
+        RootMotion const & placement = walk_.RootMotionTrack[k].Placement;
+        EXPECT_NEAR(0.0f, placement.Translation.x, 1e-6f);
+        EXPECT_EQ(0.0f, placement.Translation.y);
+        EXPECT_NEAR(WalkSpeed * t, placement.Translation.z, 1e-6f);
+        EXPECT_NEAR(walk_yaw(t), placement.Yaw, 1e-5f);
+
+        // -- the root keeps its height above the model origin and faces its initial direction
+        Keyframe const & root = walk_.BoneAnimations[0].Keyframes[k];
+        EXPECT_NEAR(0.0f, root.Translation.x, 1e-5f);
+        EXPECT_NEAR(1.0f, root.Translation.y, 1e-6f);
+        EXPECT_NEAR(0.0f, root.Translation.z, 1e-5f);
+        EXPECT_NEAR(1.0f, fabsf(XMVectorGetX(XMQuaternionDot(XMLoadFloat4(&root.RotationQuat), XMQuaternionIdentity()))), 1e-6f);
+
+        // -- bones below the root are left alone
+        Keyframe const & child = walk_.BoneAnimations[1].Keyframes[k];
+        Keyframe const & source_child = source.BoneAnimations[1].Keyframes[k];
+        EXPECT_EQ(0, memcmp(&source_child, &child, sizeof(Keyframe)));
+    }
+
+    // -- and stays in place between keys
+    PoseWorkspace workspace;
+    workspace.Resize(2);
+    XMFLOAT4X4 final_transforms[2];
+    for (float t : {0.1f, 0.6f, 1.3f, 1.9f}) {
+        skinned_info_.GetFinalTransforms(clip_, t, final_transforms, workspace);
+        // -- transposed: the translation is the last column
+        EXPECT_NEAR(0.0f, final_transforms[0](0, 3), 1e-5f) << "t " << t;
+        EXPECT_NEAR(1.0f, final_transforms[0](1, 3), 1e-5f) << "t " << t;
+        EXPECT_NEAR(0.0f, final_transforms[0](2, 3), 1e-5f) << "t " << t;
+    }
+}
+TEST_F(RootMotionTest, FrameDeltasAddUpToTheLoop) {
+    // -- net motion of a loop: forward by the walked distance in the initial direction, turned by the clip's yaw
+    XMMATRIX loop = RootMotion{XMFLOAT3(0.0f, 0.0f, WalkSpeed * WalkDuration), WalkTurn}.ToMatrix();
+
+    // -- 1/32 s frames land on the clip end exactly, 0.3 s frames wrap around it mid-frame
+    for (float dt : {1.0f / 32.0f, 0.3f}) {
+        SkinnedModelInstance instance;
+        instance.SkinnedInfo = &skinned_info_;
+        instance.FinalTransforms.resize(2);
+        instance.Workspace.Resize(2);
+        instance.SetClip("Walk");
+
+        UINT const num_loops = 3;
+        UINT num_frames = (UINT)roundf(num_loops * WalkDuration / dt);
+        XMMATRIX world = XMMatrixIdentity();
+        float yaw = 0.0f;
+        for (UINT f = 0; f < num_frames; ++f) {
+            instance.UpdateSkinnedAnimation(dt);
+            world = XMMatrixMultiply(instance.RootMotionDelta.ToMatrix(), world);
+            yaw += instance.RootMotionDelta.Yaw;
+            // -- after the first loop, when it ends on a frame
+            if (0 == num_frames % num_loops && num_frames / num_loops - 1 == f) {
+                EXPECT_LE(matrix_difference(loop, world), 1e-4f) << "dt " << dt;
+                EXPECT_NEAR(WalkTurn, yaw, 1e-4f) << "dt " << dt;
+            }
+        }
+        EXPECT_LE(matrix_difference(XMMatrixMultiply(XMMatrixMultiply(loop, loop), loop), world), 1e-4f) << "dt " << dt;
+        EXPECT_NEAR(num_loops * WalkTurn, yaw, 1e-4f) << "dt " << dt;
+    }
+}
+TEST_F(RootMotionTest, WrapIsToEndThenFromStart) {
+    for (float time_point0 : {1.5f, 1.9f, 2.0f}) {
+        for (float time_point1 : {0.0f, 0.3f, 1.2f}) {
+            RootMotion wrap = skinned_info_.GetRootMotion(clip_, time_point0, time_point1);
+            RootMotion to_end = skinned_info_.GetRootMotion(clip_, time_point0, WalkDuration);
+            RootMotion from_start = skinned_info_.GetRootMotion(clip_, 0.0f, time_point1);
+
+            // -- from_start continues in the frame to_end left the model in
+            XMMATRIX expected = XMMatrixMultiply(from_start.ToMatrix(), to_end.ToMatrix());
+            EXPECT_LE(matrix_difference(expected, wrap.ToMatrix()), 1e-5f) << time_point0 << " to " << time_point1;
+            EXPECT_NEAR(walk_yaw(WalkDuration - time_point0) + walk_yaw(time_point1), wrap.Yaw, 1e-5f);
+        }
+    }
+    // -- no time, no motion
+    RootMotion none = skinned_info_.GetRootMotion(clip_, 0.5f, 0.5f);
+    EXPECT_EQ(0.0f, none.Yaw);
+    EXPECT_EQ(0.0f, none.Translation.z);
+}
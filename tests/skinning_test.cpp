@@ -0,0 +1,270 @@
+#include "test_util.h"
+#include "skinning.h"
+
+#include <cstddef>
+#include <cstring>
+
+using namespace DirectX;
+
+//
+// -- rigid transform number k: a rotation about a varying axis (up to almost a full turn) and a translation
+static XMMATRIX rigid_transform (UINT k) {
+    XMVECTOR axis = XMVector3Normalize(XMVectorSet(sinf(k * 1.1f), cosf(k * 0.7f), 0.3f + sinf(k * 2.3f), 0.0f));
+    XMMATRIX m = XMMatrixRotationQuaternion(XMQuaternionRotationNormal(axis, 0.45f * k - 3.0f));
+    m.r[3] = XMVectorSet(0.1f * k, -0.5f + 0.05f * k, 2.0f - 0.2f * k, 1.0f);
+    return m;
+}
+// -- transposed 4x4 as SkinnedData::GetFinalTransforms stores it
+static XMFLOAT4X4 transposed (FXMMATRIX m) {
+    XMFLOAT4X4 t;
+    XMStoreFloat4x4(&t, XMMatrixTranspose(m));
+    return t;
+}
+static M3DLoader::SkinnedVertex make_vertex (UINT k, XMFLOAT3 weights, std::initializer_list<BYTE> bones) {
+    M3DLoader::SkinnedVertex vertex = {};
+    vertex.Pos = XMFLOAT3(sinf(k * 0.3f), 0.05f * k, cosf(k * 0.5f));
+    XMStoreFloat3(&vertex.Normal, XMVector3Normalize(XMVectorSet(cosf(k * 0.2f), 1.0f, sinf(k * 0.9f), 0.0f)));
+    XMStoreFloat3(&vertex.TangentU, XMVector3Normalize(XMVector3Cross(XMLoadFloat3(&vertex.Normal), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f))));
+    vertex.BoneWeights = weights;
+    std::copy(bones.begin(), bones.end(), vertex.BoneIndices);
+    return vertex;
+}
+// -- largest distance between the positions, normals and tangents of two skinned vertex arrays
+static float max_vertex_difference (std::vector<PosedVertex> const & a, std::vector<PosedVertex> const & b) {
+    float max_difference = 0.0f;
+    for (size_t v = 0; v < a.size(); ++v) {
+        for (auto member : {&PosedVertex::Pos, &PosedVertex::Normal, &PosedVertex::TangentU}) {
+            float d = XMVectorGetX(XMVector3Length(XMLoadFloat3(&(a[v].*member)) - XMLoadFloat3(&(b[v].*member))));
+            max_difference = MathHelper::Max(max_difference, d);
+        }
+    }
+    return max_difference;
+}
+
+TEST(DualQuaternionSkinning, MatchesLinearForARigidPose) {
+    // -- every bone moved by the same rigid transform: the blend of identical transforms is that transform
+    std::vector<XMFLOAT4X4> transforms(4);
+    std::vector<M3DLoader::SkinnedVertex> vertices;
+    for (UINT k = 0; k < 12; ++k) {
+        std::fill(transforms.begin(), transforms.end(), transposed(rigid_transform(k)));
+        vertices.push_back(make_vertex(k, XMFLOAT3(0.4f, 0.3f, 0.2f), {0, 1, 2, 3}));
+
+        std::vector<DualQuaternion> dual_quaternions(4);
+        ToDualQuaternions(transforms.data(), 4, dual_quaternions.data());
+        std::vector<PosedVertex> linear(vertices.size()), dq(vertices.size());
+        SkinVerticesLinear(vertices.data(), (UINT)vertices.size(), transforms.data(), linear.data());
+        SkinVerticesDualQuaternion(vertices.data(), (UINT)vertices.size(), dual_quaternions.data(), dq.data());
+        EXPECT_LE(max_vertex_difference(linear, dq), 1e-5f) << "transform " << k;
+    }
+}
+TEST(DualQuaternionSkinning, MatchesLinearForSingleBoneVertices) {
+    UINT const num_bones = 16;
+    std::vector<XMFLOAT4X4> transforms(num_bones);
+    for (UINT i = 0; i < num_bones; ++i)
+        transforms[i] = transposed(rigid_transform(i));
+    std::vector<DualQuaternion> dual_quaternions(num_bones);
+    ToDualQuaternions(transforms.data(), num_bones, dual_quaternions.data());
+
+    // -- all the weight on one bone, stored in any of the 4 slots (the 4th weight is implied)
+    std::vector<M3DLoader::SkinnedVertex> vertices;
+    for (UINT k = 0; k < 64; ++k) {
+        BYTE bone = (BYTE)(k % num_bones);
+        BYTE other = (BYTE)((k + 5) % num_bones);
+        switch (k % 4) {
+        case 0: vertices.push_back(make_vertex(k, XMFLOAT3(1.0f, 0.0f, 0.0f), {bone, other, other, other})); break;
+        case 1: vertices.push_back(make_vertex(k, XMFLOAT3(0.0f, 1.0f, 0.0f), {other, bone, other, other})); break;
+        case 2: vertices.push_back(make_vertex(k, XMFLOAT3(0.0f, 0.0f, 1.0f), {other, other, bone, other})); break;
+        default: vertices.push_back(make_vertex(k, XMFLOAT3(0.0f, 0.0f, 0.0f), {other, other, other, bone})); break;
+        }
+    }
+    std::vector<PosedVertex> linear(vertices.size()), dq(vertices.size());
+    SkinVerticesLinear(vertices.data(), (UINT)vertices.size(), transforms.data(), linear.data());
+    SkinVerticesDualQuaternion(vertices.data(), (UINT)vertices.size(), dual_quaternions.data(), dq.data());
+    EXPECT_LE(max_vertex_difference(linear, dq), 1e-5f);
+}
+TEST(DualQuaternionSkinning, AlignsAntipodalBones) {
+    // -- bone 1 holds the same transform as bone 0 with every component negated (q and -q are the same rotation)
+    XMMATRIX transform = rigid_transform(5);
+    XMFLOAT4X4 transforms[2] = {transposed(transform), transposed(transform)};
+    DualQuaternion dual_quaternions[2];
+    ToDualQuaternions(transforms, 2, dual_quaternions);
+    XMStoreFloat4(&dual_quaternions[1].Real, XMVectorNegate(XMLoadFloat4(&dual_quaternions[1].Real)));
+    XMStoreFloat4(&dual_quaternions[1].Dual, XMVectorNegate(XMLoadFloat4(&dual_quaternions[1].Dual)));
+
+    std::vector<M3DLoader::SkinnedVertex> vertices = {make_vertex(3, XMFLOAT3(0.5f, 0.5f, 0.0f), {0, 1, 0, 0})};
+    std::vector<PosedVertex> linear(1), dq(1);
+    SkinVerticesLinear(vertices.data(), 1, transforms, linear.data());
+    SkinVerticesDualQuaternion(vertices.data(), 1, dual_quaternions, dq.data());
+    EXPECT_LE(max_vertex_difference(linear, dq), 1e-5f);
+}
+TEST(DualQuaternionSkinning, BlendsAcrossTheShortArc) {
+    // -- +170 and -170 degrees about z are 20 degrees apart through 180, their even blend is the half turn
+    // -- (not the identity the blend of unaligned quaternions would turn toward)
+    XMFLOAT4X4 transforms[2] = {
+        transposed(XMMatrixRotationZ(XMConvertToRadians(170.0f))),
+        transposed(XMMatrixRotationZ(XMConvertToRadians(-170.0f)))
+    };
+    DualQuaternion dual_quaternions[2];
+    ToDualQuaternions(transforms, 2, dual_quaternions);
+    // -- whichever sign the conversion picked, store the two rotations in opposite hemispheres
+    if (XMVectorGetX(XMVector4Dot(XMLoadFloat4(&dual_quaternions[0].Real), XMLoadFloat4(&dual_quaternions[1].Real))) > 0.0f)
+        XMStoreFloat4(&dual_quaternions[1].Real, XMVectorNegate(XMLoadFloat4(&dual_quaternions[1].Real)));
+
+    M3DLoader::SkinnedVertex vertex = make_vertex(0, XMFLOAT3(0.5f, 0.5f, 0.0f), {0, 1, 0, 0});
+    vertex.Pos = XMFLOAT3(1.0f, 0.0f, 0.0f);
+    PosedVertex dq;
+    SkinVerticesDualQuaternion(&vertex, 1, dual_quaternions, &dq);
+    EXPECT_NEAR(-1.0f, dq.Pos.x, 1e-5f);
+    EXPECT_NEAR(0.0f, dq.Pos.y, 1e-5f);
+    EXPECT_NEAR(0.0f, dq.Pos.z, 1e-5f);
+}
+
+//
+// -- BlendBoneDualQuats, DualQuatRotate and DualQuatTransformPoint of shaders/common.hlsl written out in floats,
+// -- reading the bone buffer as the shader does: float4 2 * i is the real part of bone i, 2 * i + 1 the dual part
+struct float3_ { float x, y, z; };
+static float3_ operator+ (float3_ a, float3_ b) { return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+static float3_ operator- (float3_ a, float3_ b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+static float3_ operator* (float s, float3_ a) { return {s * a.x, s * a.y, s * a.z}; }
+static float3_ cross (float3_ a, float3_ b) { return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x}; }
+
+static void shader_skin_position (
+    float const (*bone_dual_quats)[4], float const weights[4], BYTE const bone_indices[4], float3_ p, float3_ & out_p
+) {
+    float const * first_real = bone_dual_quats[2 * bone_indices[0]];
+    float real[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    float dual[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 4; ++i) {
+        float const * bone_real = bone_dual_quats[2 * bone_indices[i]];
+        float const * bone_dual = bone_dual_quats[2 * bone_indices[i] + 1];
+        float dot = bone_real[0] * first_real[0] + bone_real[1] * first_real[1] + bone_real[2] * first_real[2] + bone_real[3] * first_real[3];
+        float w = dot < 0.0f ? -weights[i] : weights[i];
+        for (int c = 0; c < 4; ++c) {
+            real[c] += w * bone_real[c];
+            dual[c] += w * bone_dual[c];
+        }
+    }
+    float inv_length = 1.0f / sqrtf(real[0] * real[0] + real[1] * real[1] + real[2] * real[2] + real[3] * real[3]);
+    for (int c = 0; c < 4; ++c) {
+        real[c] *= inv_length;
+        dual[c] *= inv_length;
+    }
+
+    float3_ r = {real[0], real[1], real[2]};
+    float3_ d = {dual[0], dual[1], dual[2]};
+    float3_ rotated = p + 2.0f * cross(r, cross(r, p) + real[3] * p);
+    float3_ translation = 2.0f * (real[3] * d - dual[3] * r + cross(r, d));
+    out_p = rotated + translation;
+}
+
+TEST(DualQuaternionSkinning, MatchesTheVertexShader) {
+    static_assert(sizeof(DualQuaternion) == 8 * sizeof(float), "the shader reads 2 float4 per bone");
+    static_assert(offsetof(DualQuaternion, Dual) == 4 * sizeof(float), "the shader reads 2 float4 per bone");
+
+    SoldierModel & soldier = Soldier();
+    ASSERT_TRUE(soldier.Loaded);
+    SkinnedData const & skinned_info = soldier.SkinnedInfo;
+    UINT num_bones = skinned_info.BoneCount();
+
+    PoseWorkspace workspace;
+    workspace.Resize(num_bones);
+    std::vector<XMFLOAT4X4> transforms(num_bones);
+    skinned_info.GetFinalTransforms(skinned_info.FindClip("Take1"), 0.7f, transforms.data(), workspace);
+    std::vector<DualQuaternion> dual_quaternions(num_bones);
+    ToDualQuaternions(transforms.data(), num_bones, dual_quaternions.data());
+
+    std::vector<PosedVertex> dq(soldier.Vertices.size());
+    SkinVerticesDualQuaternion(soldier.Vertices.data(), (UINT)soldier.Vertices.size(), dual_quaternions.data(), dq.data());
+
+    auto bone_dual_quats = reinterpret_cast<float const (*)[4]>(dual_quaternions.data());
+    float max_difference = 0.0f;
+    for (size_t v = 0; v < soldier.Vertices.size(); ++v) {
+        M3DLoader::SkinnedVertex const & vertex = soldier.Vertices[v];
+        float weights[4] = {
+            vertex.BoneWeights.x, vertex.BoneWeights.y, vertex.BoneWeights.z,
+            1.0f - vertex.BoneWeights.x - vertex.BoneWeights.y - vertex.BoneWeights.z
+        };
+        float3_ p;
+        shader_skin_position(bone_dual_quats, weights, vertex.BoneIndices, {vertex.Pos.x, vertex.Pos.y, vertex.Pos.z}, p);
+        max_difference = MathHelper::Max(max_difference, fabsf(p.x - dq[v].Pos.x));
+        max_difference = MathHelper::Max(max_difference, fabsf(p.y - dq[v].Pos.y));
+        max_difference = MathHelper::Max(max_difference, fabsf(p.z - dq[v].Pos.z));
+    }
+    EXPECT_LE(max_difference, 1e-4f);
+}
+
+//
+// -- the 3x4 bone palette uploaded for the shaders must skin exactly like the 4x4 final transforms
+static std::vector<XMFLOAT4X4> unpack_bone_palette (std::vector<XMFLOAT3X4> const & palette) {
+    std::vector<XMFLOAT4X4> transforms(palette.size());
+    for (size_t i = 0; i < palette.size(); ++i) {
+        XMMATRIX m = XMLoadFloat3x4(&palette[i]);
+        // -- XMLoadFloat3x4 loads the transposed rows back as columns
+        XMStoreFloat4x4(&transforms[i], XMMatrixTranspose(m));
+    }
+    return transforms;
+}
+// -- the linear path of shaders/pre_skinning.hlsl written out in floats: blend the palette rows, then transform
+static void shader_skin_position_linear (
+    XMFLOAT3X4 const * palette, float const weights[4], BYTE const bone_indices[4], XMFLOAT3 p, XMFLOAT3 & out_p
+) {
+    float blended[3][4] = {};
+    for (int i = 0; i < 4; ++i) {
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 4; ++c)
+                blended[r][c] += weights[i] * palette[bone_indices[i]].m[r][c];
+        }
+    }
+    float out[3];
+    for (int r = 0; r < 3; ++r)
+        out[r] = blended[r][0] * p.x + blended[r][1] * p.y + blended[r][2] * p.z + blended[r][3];
+    out_p = XMFLOAT3(out[0], out[1], out[2]);
+}
+
+TEST(PackBonePalette, SkinsLikeTheFinalTransforms) {
+    SoldierModel & soldier = Soldier();
+    ASSERT_TRUE(soldier.Loaded);
+    SkinnedData const & skinned_info = soldier.SkinnedInfo;
+    UINT num_bones = skinned_info.BoneCount();
+    SkinnedData::ClipHandle clip = skinned_info.FindClip("Take1");
+    UINT num_vertices = (UINT)soldier.Vertices.size();
+
+    for (float time_point : {0.0f, 0.7f, 1.9f}) {
+        PoseWorkspace workspace;
+        workspace.Resize(num_bones);
+        std::vector<XMFLOAT4X4> transforms(num_bones);
+        skinned_info.GetFinalTransforms(clip, time_point, transforms.data(), workspace);
+        std::vector<XMFLOAT3X4> palette(num_bones);
+        PackBonePalette(transforms.data(), num_bones, palette.data());
+
+        // -- the 3x4 overload writes the packed palette
+        PoseWorkspace affine_workspace;
+        affine_workspace.Resize(num_bones);
+        std::vector<XMFLOAT3X4> affine(num_bones);
+        skinned_info.GetFinalTransforms(clip, time_point, affine.data(), affine_workspace);
+        EXPECT_EQ(0, memcmp(palette.data(), affine.data(), num_bones * sizeof(XMFLOAT3X4))) << "t " << time_point;
+
+        // -- nothing is lost in packing: the dropped row is (0, 0, 0, 1) and skinning gives the same vertices
+        std::vector<XMFLOAT4X4> unpacked = unpack_bone_palette(palette);
+        EXPECT_EQ(0.0f, MaxDifference(transforms.data(), unpacked.data(), num_bones)) << "t " << time_point;
+        std::vector<PosedVertex> from_transforms(num_vertices), from_palette(num_vertices);
+        SkinVerticesLinear(soldier.Vertices.data(), num_vertices, transforms.data(), from_transforms.data());
+        SkinVerticesLinear(soldier.Vertices.data(), num_vertices, unpacked.data(), from_palette.data());
+        EXPECT_EQ(0.0f, max_vertex_difference(from_transforms, from_palette)) << "t " << time_point;
+
+        // -- and the shader reading the palette puts the vertices where the CPU skinning does
+        float max_difference = 0.0f;
+        for (UINT v = 0; v < num_vertices; ++v) {
+            M3DLoader::SkinnedVertex const & vertex = soldier.Vertices[v];
+            float weights[4] = {
+                vertex.BoneWeights.x, vertex.BoneWeights.y, vertex.BoneWeights.z,
+                1.0f - vertex.BoneWeights.x - vertex.BoneWeights.y - vertex.BoneWeights.z
+            };
+            XMFLOAT3 p;
+            shader_skin_position_linear(palette.data(), weights, vertex.BoneIndices, vertex.Pos, p);
+            float d = XMVectorGetX(XMVector3Length(XMLoadFloat3(&p) - XMLoadFloat3(&from_transforms[v].Pos)));
+            max_difference = MathHelper::Max(max_difference, d);
+        }
+        EXPECT_LE(max_difference, 1e-4f) << "t " << time_point;
+    }
+}
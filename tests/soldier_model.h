@@ -0,0 +1,32 @@
+#pragma once
+
+#include "skinned_data.h"
+#include "load_m3d.h"
+
+// -- path of a file in character_animation/models
+inline std::string ModelPath (char const * filename) {
+    return std::string(D3D12_ANIM_MODELS_DIR) + "/" + filename;
+}
+
+//
+// -- soldier.m3d as the demo loads it, read once per test or benchmark binary
+struct SoldierModel {
+    std::vector<M3DLoader::SkinnedVertex> Vertices;
+    std::vector<BYTE> Indices;
+    std::vector<M3DLoader::Subset> Subsets;
+    std::vector<M3DLoader::M3DMaterial> Materials;
+    SkinnedData SkinnedInfo;
+    bool Loaded = false;
+};
+inline SoldierModel & Soldier () {
+    static SoldierModel model;
+    static bool const once = [] {
+        M3DLoader loader;
+        model.Loaded = loader.LoadM3D(
+            ModelPath("soldier.m3d"), model.Vertices, model.Indices, model.Subsets, model.Materials, model.SkinnedInfo
+        );
+        return true;
+    }();
+    (void)once;
+    return model;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "skinned_data.h"
+
+#include <cmath>
+
+//
+// -- Skeleton of any size for tests and benchmarks (soldier.m3d has 58 bones): bone i hangs off bone (i - 1) / 3,
+// -- every bone is 0.3 up from its parent and swings about its own axis. With reverse_order the indices are
+// -- reversed so every child comes before its parent. One clip "Swing", 2 s long with num_keys keys per bone
+struct SyntheticSkeleton {
+    std::vector<int> Hierarchy;
+    std::vector<DirectX::XMFLOAT4X4> Offsets;
+    std::unordered_map<std::string, AnimationClip> Clips;
+};
+inline SyntheticSkeleton MakeSyntheticSkeleton (UINT num_bones, UINT num_keys = 61, bool reverse_order = false) {
+    using namespace DirectX;
+
+    auto index = [=](UINT i) { return reverse_order ? num_bones - 1 - i : i; };
+    SyntheticSkeleton skeleton;
+    skeleton.Hierarchy.resize(num_bones);
+    for (UINT i = 0; i < num_bones; ++i)
+        skeleton.Hierarchy[index(i)] = i > 0 ? (int)index((i - 1) / 3) : -1;
+
+    AnimationClip & clip = skeleton.Clips["Swing"];
+    clip.BoneAnimations.resize(num_bones);
+    for (UINT i = 0; i < num_bones; ++i) {
+        XMVECTOR axis = XMVector3Normalize(XMVectorSet(sinf(i * 1.3f), cosf(i * 0.7f), 0.5f, 0.0f));
+        for (UINT k = 0; k < num_keys; ++k) {
+            float t = 2.0f * k / (num_keys - 1);
+            Keyframe key;
+            key.TimePoint = t;
+            key.Translation = i > 0 ? XMFLOAT3(0.0f, 0.3f, 0.0f) : XMFLOAT3(0.5f * t, 1.0f, 0.0f);
+            key.Scale = XMFLOAT3(1.0f, 1.0f, 1.0f);
+            XMStoreFloat4(&key.RotationQuat, XMQuaternionRotationNormal(axis, 0.5f * sinf(3.0f * t + i)));
+            clip.BoneAnimations[index(i)].Keyframes.push_back(key);
+        }
+    }
+
+    // -- bind pose: every bone straight up from its parent, offsets take the skin to bone space
+    skeleton.Offsets.resize(num_bones);
+    for (UINT i = 0; i < num_bones; ++i) {
+        float height = 1.0f;
+        for (int p = skeleton.Hierarchy[index(i)]; p >= 0; p = skeleton.Hierarchy[p])
+            height += 0.3f;
+        XMStoreFloat4x4(&skeleton.Offsets[index(i)], XMMatrixTranslation(0.0f, -height, 0.0f));
+    }
+    return skeleton;
+}
+
+//
+// -- final transforms as GetFinalTransforms computed them before the hierarchy pass was fused:
+// -- every bone to root space first, then the offsets premultiplied and transposed in a second loop.
+// -- order lists the bones parents first
+inline void TwoPassFinalTransforms (
+    std::vector<int> const & hierarchy,
+    std::vector<DirectX::XMFLOAT4X4> const & offsets,
+    std::vector<UINT> const & order,
+    DirectX::XMFLOAT4X4 const * to_parent_transforms,
+    DirectX::XMFLOAT4X4 * to_root_transforms,
+    DirectX::XMFLOAT4X4 * final_transforms
+) {
+    using namespace DirectX;
+
+    for (UINT i : order) {
+        XMMATRIX to_root = XMLoadFloat4x4(&to_parent_transforms[i]);
+        if (hierarchy[i] >= 0)
+            to_root = XMMatrixMultiply(to_root, XMLoadFloat4x4(&to_root_transforms[hierarchy[i]]));
+        XMStoreFloat4x4(&to_root_transforms[i], to_root);
+    }
+
+    for (UINT i = 0; i < (UINT)hierarchy.size(); ++i) {
+        XMMATRIX final_transform = XMMatrixMultiply(XMLoadFloat4x4(&offsets[i]), XMLoadFloat4x4(&to_root_transforms[i]));
+        XMStoreFloat4x4(&final_transforms[i], XMMatrixTranspose(final_transform));
+    }
+}
+// -- bone indices parents first: ascending, or descending for a reverse_order skeleton
+inline std::vector<UINT> SyntheticBoneOrder (UINT num_bones, bool reverse_order = false) {
+    std::vector<UINT> order(num_bones);
+    for (UINT i = 0; i < num_bones; ++i)
+        order[i] = reverse_order ? num_bones - 1 - i : i;
+    return order;
+}
+
+//
+// -- local transforms of a chain of num_bones bones (bone 0 at the origin), every bone 1 up its parent's y axis
+// -- and turned by bend radians about z so the chain is not straight
+inline void MakeSyntheticChain (
+    UINT num_bones, float bend,
+    std::vector<int> & out_hierarchy, std::vector<DirectX::XMFLOAT4X4> & out_to_parent_transforms
+) {
+    using namespace DirectX;
+
+    out_hierarchy.resize(num_bones);
+    out_to_parent_transforms.resize(num_bones);
+    for (UINT i = 0; i < num_bones; ++i) {
+        out_hierarchy[i] = (int)i - 1;
+        XMMATRIX to_parent = i > 0 ?
+            XMMatrixMultiply(XMMatrixRotationZ(bend), XMMatrixTranslation(0.0f, 1.0f, 0.0f)) : XMMatrixIdentity();
+        XMStoreFloat4x4(&out_to_parent_transforms[i], to_parent);
+    }
+}
+// -- root space transform of bone
+inline DirectX::XMMATRIX SyntheticToRoot (
+    int bone, std::vector<int> const & hierarchy, std::vector<DirectX::XMFLOAT4X4> const & to_parent_transforms
+) {
+    using namespace DirectX;
+
+    XMMATRIX to_root = XMMatrixIdentity();
+    for (; bone >= 0; bone = hierarchy[bone])
+        to_root = XMMatrixMultiply(to_root, XMLoadFloat4x4(&to_parent_transforms[bone]));
+    return to_root;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "soldier_model.h"
+
+#include <gtest/gtest.h>
+
+// -- largest absolute difference between the elements of two matrix arrays
+template <typename Matrix>
+float MaxDifference (Matrix const * a, Matrix const * b, UINT count) {
+    float const * fa = reinterpret_cast<float const *>(a);
+    float const * fb = reinterpret_cast<float const *>(b);
+    float max_difference = 0.0f;
+    for (size_t i = 0; i < count * sizeof(Matrix) / sizeof(float); ++i)
+        max_difference = MathHelper::Max(max_difference, fabsf(fa[i] - fb[i]));
+    return max_difference;
+}